@@ -67,6 +67,16 @@ static __always_inline int32_t maps__get_scap_tid()
 	return g_settings.scap_tid;
 }
 
+/* Flags to use when we submit an event in the ring buffer.
+ * `0` lets the kernel notify userspace only when it has already
+ * consumed all the previous events, so it is waiting for new ones.
+ * `BPF_RB_NO_WAKEUP` never notifies userspace.
+ */
+static __always_inline uint64_t maps__get_ringbuf_submit_flags()
+{
+	return g_settings.ringbuf_wakeup ? 0 : BPF_RB_NO_WAKEUP;
+}
+
 /*=============================== SETTINGS ===========================*/
 
 /*=============================== KERNEL CONFIGS ===========================*/
@@ -167,14 +167,14 @@ static __always_inline void ringbuf__rewrite_header_for_calibration(struct ringb
  * @brief This method states that the collection of the event is
  * terminated.
  *
- * `BPF_RB_NO_WAKEUP` option allow to not notify the userspace
- * when a new event is submitted.
+ * By default the `BPF_RB_NO_WAKEUP` option allow to not notify the userspace
+ * when a new event is submitted, see `maps__get_ringbuf_submit_flags`.
  *
  * @param ringbuf pointer to the `ringbuf_struct`.
  */
 static __always_inline void ringbuf__submit_event(struct ringbuf_struct *ringbuf)
 {
-	bpf_ringbuf_submit(ringbuf->data, BPF_RB_NO_WAKEUP);
+	bpf_ringbuf_submit(ringbuf->data, maps__get_ringbuf_submit_flags());
 }
 
 /////////////////////////////////
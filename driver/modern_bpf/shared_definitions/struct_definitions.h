@@ -34,6 +34,7 @@ struct capture_settings
 	uint16_t fullcapture_port_range_end;   /* last interesting port */
 	uint16_t statsd_port;		       /* port for statsd metrics */
 	int32_t scap_tid;		       /* tid of the scap process */
+	bool ringbuf_wakeup;		       /* notify userspace when it is waiting for new events in the ring buffers */
 };
 
 /**
@@ -0,0 +1,472 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+#include <libscap/scap.h>
+#include <sys/param.h> // MIN(), scap-int.h defines it only for C
+extern "C"
+{
+#include <libscap/ringbuffer/devset.h>
+}
+#include <libscap/ringbuffer/ringbuffer.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define TEST_BUFFER_SIZE (1 << 16)
+
+// A set of fake kmod-like devices, each one with a block of events already
+// written by the "driver" and ordered by timestamp inside the single device.
+class fake_devset
+{
+public:
+	fake_devset(uint32_t ndevs, uint32_t events_per_dev, enum scap_ringbuffer_merge_mode mode)
+	{
+		EXPECT_EQ(devset_init(&m_devset, ndevs, m_lasterr), SCAP_SUCCESS);
+		m_devset.m_merge_mode = mode;
+
+		std::mt19937_64 rng(42);
+		for(uint32_t j = 0; j < ndevs; j++)
+		{
+			scap_device* dev = &m_devset.m_devs[j];
+			dev->m_buffer = (char*)calloc(1, TEST_BUFFER_SIZE);
+			dev->m_buffer_size = TEST_BUFFER_SIZE;
+			dev->m_bufinfo = (struct ppm_ring_buffer_info*)calloc(1, sizeof(struct ppm_ring_buffer_info));
+
+			uint64_t ts = rng() % 1000;
+			for(uint32_t i = 0; i < events_per_dev; i++)
+			{
+				ts += 1 + rng() % 1000;
+				append_event(j, ts);
+				m_expected.push_back(ts);
+			}
+		}
+		std::sort(m_expected.begin(), m_expected.end());
+	}
+
+	void append_event(uint32_t devid, uint64_t ts)
+	{
+		scap_device* dev = &m_devset.m_devs[devid];
+		scap_evt* evt = (scap_evt*)(dev->m_buffer + dev->m_bufinfo->head);
+		ASSERT_LE(dev->m_bufinfo->head + sizeof(scap_evt), TEST_BUFFER_SIZE);
+		evt->ts = ts;
+		evt->tid = devid;
+		evt->len = sizeof(scap_evt);
+		evt->type = PPME_SYSCALL_GETUID_X;
+		evt->nparams = 0;
+		dev->m_bufinfo->head += sizeof(scap_evt);
+	}
+
+	// Return the timestamp of the next event, skipping the timeouts.
+	uint64_t next_ts()
+	{
+		scap_evt* evt = NULL;
+		uint16_t devid = 0;
+		uint32_t flags = 0;
+		int32_t ret = SCAP_TIMEOUT;
+
+		for(int timeouts = 0; ret == SCAP_TIMEOUT && timeouts < 10; timeouts++)
+		{
+			ret = ringbuffer_next(&m_devset, &evt, &devid, &flags);
+		}
+		EXPECT_EQ(ret, SCAP_SUCCESS);
+		return ret == SCAP_SUCCESS ? evt->ts : 0;
+	}
+
+	~fake_devset()
+	{
+		for(uint32_t j = 0; j < m_devset.m_ndevs; j++)
+		{
+			scap_device* dev = &m_devset.m_devs[j];
+			free(dev->m_buffer);
+			free(dev->m_bufinfo);
+			dev->m_buffer = (char*)INVALID_MAPPING;
+			dev->m_bufinfo = (struct ppm_ring_buffer_info*)INVALID_MAPPING;
+		}
+		devset_free(&m_devset);
+	}
+
+	std::vector<uint64_t> consume_all()
+	{
+		std::vector<uint64_t> res;
+		scap_evt* evt = NULL;
+		uint16_t devid = 0;
+		uint32_t flags = 0;
+		int timeouts = 0;
+
+		while(res.size() < m_expected.size() && timeouts < 10)
+		{
+			int32_t ret = ringbuffer_next(&m_devset, &evt, &devid, &flags);
+			if(ret == SCAP_TIMEOUT)
+			{
+				timeouts++;
+				continue;
+			}
+			EXPECT_EQ(ret, SCAP_SUCCESS);
+			EXPECT_EQ(evt->tid, devid);
+			res.push_back(evt->ts);
+			m_devids.push_back(devid);
+		}
+
+		// One more call to give back the consumed blocks to the "driver".
+		ringbuffer_next(&m_devset, &evt, &devid, &flags);
+		return res;
+	}
+
+	struct scap_device_set m_devset;
+	std::vector<uint64_t> m_expected;
+	std::vector<uint16_t> m_devids;
+	char m_lasterr[SCAP_LASTERR_SIZE];
+};
+
+TEST(ringbuffer_merge, heap_is_ordered)
+{
+	fake_devset devs(16, 100, SCAP_RINGBUFFER_MERGE_HEAP);
+	ASSERT_EQ(devs.consume_all(), devs.m_expected);
+	for(uint32_t j = 0; j < devs.m_devset.m_ndevs; j++)
+	{
+		ASSERT_EQ(devs.m_devset.m_devs[j].m_bufinfo->tail, devs.m_devset.m_devs[j].m_bufinfo->head);
+	}
+}
+
+TEST(ringbuffer_merge, linear_is_ordered)
+{
+	fake_devset devs(16, 100, SCAP_RINGBUFFER_MERGE_LINEAR);
+	ASSERT_EQ(devs.consume_all(), devs.m_expected);
+	for(uint32_t j = 0; j < devs.m_devset.m_ndevs; j++)
+	{
+		ASSERT_EQ(devs.m_devset.m_devs[j].m_bufinfo->tail, devs.m_devset.m_devs[j].m_bufinfo->head);
+	}
+}
+
+TEST(ringbuffer_merge, strict_order_has_no_violations)
+{
+	fake_devset devs(16, 100, SCAP_RINGBUFFER_MERGE_HEAP);
+	devs.consume_all();
+	ASSERT_EQ(devs.m_devset.m_n_evts_out_of_order, 0);
+}
+
+TEST(ringbuffer_merge, window_bounds_the_disorder)
+{
+	const uint64_t window = 2000;
+	fake_devset devs(16, 100, SCAP_RINGBUFFER_MERGE_HEAP);
+	devs.m_devset.m_order_window_ns = ringbuffer_order_window_ns(SCAP_RINGBUFFER_ORDER_WINDOW, window);
+	std::vector<uint64_t> res = devs.consume_all();
+	ASSERT_EQ(res.size(), devs.m_expected.size());
+
+	uint64_t violations = 0;
+	uint64_t max_ts = 0;
+	uint32_t switches = 0;
+	for(size_t i = 0; i < res.size(); i++)
+	{
+		// Every event is at most `window` older than all the events returned before it.
+		ASSERT_LE(max_ts, res[i] + window);
+		max_ts = std::max(max_ts, res[i]);
+		if(i > 0 && res[i] < res[i - 1])
+		{
+			violations++;
+		}
+		if(i > 0 && devs.m_devids[i] != devs.m_devids[i - 1])
+		{
+			switches++;
+		}
+	}
+	ASSERT_EQ(devs.m_devset.m_n_evts_out_of_order, violations);
+	metrics_v2 stats[DEVSET_LIBSCAP_STATS] = {};
+	devset_fill_libscap_stats(&devs.m_devset, stats);
+	ASSERT_EQ(stats[0].flags, METRICS_V2_LIBSCAP_COUNTERS);
+	ASSERT_STREQ(stats[0].name, N_EVTS_OUT_OF_ORDER_NAME);
+	ASSERT_EQ(stats[0].value.u64, violations);
+	// We should switch ring less often than with the strict ordering.
+	ASSERT_LT(switches, res.size() / 2);
+
+	std::sort(res.begin(), res.end());
+	ASSERT_EQ(res, devs.m_expected);
+	for(uint32_t j = 0; j < devs.m_devset.m_ndevs; j++)
+	{
+		ASSERT_EQ(devs.m_devset.m_devs[j].m_bufinfo->tail, devs.m_devset.m_devs[j].m_bufinfo->head);
+	}
+}
+
+TEST(ringbuffer_merge, per_cpu_drains_one_ring_at_a_time)
+{
+	fake_devset devs(8, 50, SCAP_RINGBUFFER_MERGE_HEAP);
+	devs.m_devset.m_order_window_ns = ringbuffer_order_window_ns(SCAP_RINGBUFFER_ORDER_PER_CPU, 0);
+	std::vector<uint64_t> res = devs.consume_all();
+	ASSERT_EQ(res.size(), devs.m_expected.size());
+
+	// Every ring is returned as a single run of events, in the ring order.
+	for(size_t i = 0; i < res.size(); i++)
+	{
+		ASSERT_EQ(devs.m_devids[i], devs.m_devids[i - i % 50]);
+		if(i % 50 != 0)
+		{
+			ASSERT_GT(res[i], res[i - 1]);
+		}
+	}
+
+	std::sort(res.begin(), res.end());
+	ASSERT_EQ(res, devs.m_expected);
+}
+
+// The modern_bpf rings are read up to a cached producer position, reloaded when
+// it's reached: a ring that keeps receiving events must leave the top anyway.
+TEST(ringbuffer_merge, per_cpu_busy_ring_is_not_starving_the_others)
+{
+	const uint32_t cached_events = 4;
+	struct ringbuffer_heap heap;
+	ASSERT_EQ(ringbuffer_heap_init(&heap, 3), 0);
+	uint64_t window = ringbuffer_order_window_ns(SCAP_RINGBUFFER_ORDER_PER_CPU, 0);
+
+	// ring 0 always has a new event, that soon gets newer than the single
+	// event of rings 1 and 2
+	uint64_t busy_ts = 10;
+	ringbuffer_heap_push(&heap, busy_ts, 0);
+	ringbuffer_heap_push(&heap, 50, 1);
+	ringbuffer_heap_push(&heap, 60, 2);
+
+	std::vector<uint32_t> consumed;
+	uint32_t busy_run = 0;
+	while(heap.m_size > 1 && consumed.size() < 100)
+	{
+		uint32_t id = heap.m_entries[0].id;
+		consumed.push_back(id);
+		if(id != 0)
+		{
+			ringbuffer_heap_pop(&heap);
+			continue;
+		}
+		busy_run++;
+		busy_ts += 100;
+		ringbuffer_heap_update_top_refill(&heap, busy_ts, window, busy_run % cached_events == 0);
+	}
+
+	// every idle ring is drained after at most one batch of the busy ring
+	ASSERT_EQ(heap.m_size, 1);
+	ASSERT_LE(consumed.size(), 2 * cached_events + 2);
+	ringbuffer_heap_free(&heap);
+}
+
+TEST(ringbuffer_merge, heap_with_empty_devices)
+{
+	fake_devset devs(8, 10, SCAP_RINGBUFFER_MERGE_HEAP);
+	// Drop the data of half of the devices, as if they never received anything.
+	for(uint32_t j = 0; j < devs.m_devset.m_ndevs; j += 2)
+	{
+		devs.m_devset.m_devs[j].m_bufinfo->head = 0;
+	}
+	devs.m_expected.clear();
+	for(uint32_t j = 1; j < devs.m_devset.m_ndevs; j += 2)
+	{
+		for(uint32_t i = 0; i < 10; i++)
+		{
+			devs.m_expected.push_back(((scap_evt*)devs.m_devset.m_devs[j].m_buffer)[i].ts);
+		}
+	}
+	std::sort(devs.m_expected.begin(), devs.m_expected.end());
+	ASSERT_EQ(devs.consume_all(), devs.m_expected);
+}
+
+TEST(ringbuffer_merge, incremental_tail_advance)
+{
+	fake_devset devs(4, 100, SCAP_RINGBUFFER_MERGE_HEAP);
+	devs.m_devset.m_tail_advance_bytes = 10 * sizeof(scap_evt);
+
+	for(uint32_t i = 0; i < 200; i++)
+	{
+		ASSERT_EQ(devs.next_ts(), devs.m_expected[i]);
+	}
+
+	// Half of the events are consumed, some of them must be already released.
+	uint32_t released = 0;
+	for(uint32_t j = 0; j < devs.m_devset.m_ndevs; j++)
+	{
+		struct ppm_ring_buffer_info* info = devs.m_devset.m_devs[j].m_bufinfo;
+		ASSERT_LT(info->tail, info->head);
+		released += info->tail;
+	}
+	ASSERT_GT(released, 100 * sizeof(scap_evt));
+
+	devs.m_expected.erase(devs.m_expected.begin(), devs.m_expected.begin() + 200);
+	ASSERT_EQ(devs.consume_all(), devs.m_expected);
+	for(uint32_t j = 0; j < devs.m_devset.m_ndevs; j++)
+	{
+		ASSERT_EQ(devs.m_devset.m_devs[j].m_bufinfo->tail, devs.m_devset.m_devs[j].m_bufinfo->head);
+	}
+}
+
+TEST(ringbuffer_merge, drained_device_is_refilled)
+{
+	fake_devset devs(2, 0, SCAP_RINGBUFFER_MERGE_HEAP);
+	devs.m_devset.m_tail_advance_bytes = 1;
+	for(uint64_t ts = 1; ts <= 5; ts++)
+	{
+		devs.append_event(0, ts);
+	}
+	for(uint64_t ts = 1000; ts < 1100; ts++)
+	{
+		devs.append_event(1, ts);
+	}
+
+	for(uint64_t ts = 1; ts <= 5; ts++)
+	{
+		ASSERT_EQ(devs.next_ts(), ts);
+	}
+	ASSERT_EQ(devs.next_ts(), 1000);
+	// The event is older than the ones already in the second device, so it must be
+	// returned as soon as the first device is refilled, not when all devices are drained.
+	devs.append_event(0, 6);
+	uint64_t ts = 0;
+	for(uint32_t i = 0; i < 4 && ts != 6; i++)
+	{
+		ts = devs.next_ts();
+	}
+	ASSERT_EQ(ts, 6);
+	ASSERT_GT(devs.m_devset.m_devs[0].m_buffer_latency_ns, 0);
+	ASSERT_EQ(devs.m_devset.m_devs[0].m_bufinfo->tail, devs.m_devset.m_devs[0].m_bufinfo->head - sizeof(scap_evt));
+
+	metrics_v2 stats[DEVSET_PER_CPU_STATS];
+	devset_fill_per_cpu_stats(&devs.m_devset.m_devs[1], stats, 42, 7);
+	ASSERT_STREQ(stats[0].name, N_EVTS_PER_CPU_PREFIX "1");
+	ASSERT_EQ(stats[0].value.u64, 42);
+	ASSERT_STREQ(stats[1].name, N_DROPS_PER_CPU_PREFIX "1");
+	ASSERT_EQ(stats[1].value.u64, 7);
+	ASSERT_STREQ(stats[2].name, BUFFER_LATENCY_NS_PER_CPU_PREFIX "1");
+	ASSERT_EQ(stats[2].value.u64, devs.m_devset.m_devs[1].m_buffer_latency_ns);
+}
+
+TEST(ringbuffer_merge, strict_order_sees_late_event_in_idle_device)
+{
+	fake_devset devs(3, 0, SCAP_RINGBUFFER_MERGE_HEAP);
+	devs.m_devset.m_tail_advance_bytes = 1;
+	for(uint64_t ts = 10; ts <= 100; ts += 10)
+	{
+		devs.append_event(0, ts);
+		devs.append_event(1, ts + 5);
+	}
+
+	ASSERT_EQ(devs.next_ts(), 10);
+	ASSERT_EQ(devs.m_devset.m_rescan_ts, 15);
+	// The third device was empty when the others were read: its event was
+	// written later, so it is newer than their heads, and it must be
+	// returned before the first event newer than it. The idle devices are
+	// not looked at again until an event newer than those heads is returned.
+	devs.append_event(2, 17);
+	ASSERT_EQ(devs.next_ts(), 15);
+	ASSERT_EQ(devs.m_devset.m_devs[2].m_sn_len, 0);
+	ASSERT_EQ(devs.next_ts(), 17);
+	ASSERT_EQ(devs.next_ts(), 20);
+	ASSERT_EQ(devs.m_devset.m_rescan_ts, 25);
+	ASSERT_EQ(devs.m_devset.m_n_evts_out_of_order, 0);
+
+	// With a relaxed ordering the idle devices are only looked at every
+	// `m_ndevs` events.
+	devs.m_devset.m_order_window_ns = ringbuffer_order_window_ns(SCAP_RINGBUFFER_ORDER_WINDOW, 1);
+	devs.m_devset.m_events_since_rescan = 0;
+	devs.append_event(2, 22);
+	ASSERT_EQ(devs.next_ts(), 25);
+}
+
+TEST(ringbuffer_merge, adaptive_wait_time)
+{
+	fake_devset devs(2, 0, SCAP_RINGBUFFER_MERGE_HEAP);
+	devset_set_wait_mode(&devs.m_devset, SCAP_RINGBUFFER_WAIT_ADAPTIVE, 100, 2000);
+
+	// Nothing to read: exponential backoff up to the idle time.
+	ASSERT_EQ(ringbuffer_wait_time_us(&devs.m_devset), BUFFER_EMPTY_WAIT_TIME_US_START);
+	ASSERT_EQ(ringbuffer_wait_time_us(&devs.m_devset), 2 * BUFFER_EMPTY_WAIT_TIME_US_START);
+	ASSERT_EQ(ringbuffer_wait_time_us(&devs.m_devset), 2000);
+	ASSERT_EQ(ringbuffer_wait_time_us(&devs.m_devset), 2000);
+
+	// A few events: wait at most the configured latency.
+	devs.append_event(1, 1);
+	ASSERT_EQ(ringbuffer_wait_time_us(&devs.m_devset), 100);
+
+	// Enough data: don't wait at all.
+	while(devs.m_devset.m_devs[1].m_bufinfo->head <= BUFFER_EMPTY_THRESHOLD_B)
+	{
+		devs.append_event(1, 1);
+	}
+	ASSERT_EQ(ringbuffer_wait_time_us(&devs.m_devset), 0);
+
+	// The backoff starts again after the buffers are drained.
+	devs.m_devset.m_devs[1].m_bufinfo->tail = devs.m_devset.m_devs[1].m_bufinfo->head;
+	ASSERT_EQ(ringbuffer_wait_time_us(&devs.m_devset), BUFFER_EMPTY_WAIT_TIME_US_START);
+}
+
+static void check_batches(fake_devset& devs, uint32_t batch_size)
+{
+	std::vector<scap_evt*> evts(batch_size);
+	std::vector<uint16_t> devids(batch_size);
+	std::vector<uint32_t> flags(batch_size);
+	std::vector<uint64_t> res;
+	int timeouts = 0;
+
+	while(res.size() < devs.m_expected.size() && timeouts < 10)
+	{
+		uint32_t nevents = 0;
+		int32_t ret = ringbuffer_next_batch(&devs.m_devset, evts.data(), devids.data(), flags.data(),
+						    batch_size, &nevents);
+		if(ret == SCAP_TIMEOUT)
+		{
+			timeouts++;
+			continue;
+		}
+		ASSERT_EQ(ret, SCAP_SUCCESS);
+		ASSERT_GE(nevents, 1);
+		ASSERT_LE(nevents, batch_size);
+		for(uint32_t i = 0; i < nevents; i++)
+		{
+			scap_device* dev = &devs.m_devset.m_devs[devids[i]];
+			ASSERT_EQ(evts[i]->tid, devids[i]);
+			// The events of the batch must not be given back to the "driver" yet.
+			ASSERT_GE((uint64_t)((char*)evts[i] - dev->m_buffer), dev->m_bufinfo->tail);
+			res.push_back(evts[i]->ts);
+		}
+	}
+	ASSERT_EQ(res, devs.m_expected);
+
+	// One more call to give back the consumed blocks to the "driver".
+	uint32_t nevents = 0;
+	ringbuffer_next_batch(&devs.m_devset, evts.data(), devids.data(), flags.data(), batch_size, &nevents);
+	ASSERT_EQ(nevents, 0);
+	for(uint32_t j = 0; j < devs.m_devset.m_ndevs; j++)
+	{
+		ASSERT_EQ(devs.m_devset.m_devs[j].m_bufinfo->tail, devs.m_devset.m_devs[j].m_bufinfo->head);
+	}
+}
+
+TEST(ringbuffer_merge, batch_is_ordered)
+{
+	fake_devset devs(16, 100, SCAP_RINGBUFFER_MERGE_HEAP);
+	check_batches(devs, 64);
+}
+
+TEST(ringbuffer_merge, batch_with_incremental_tail_advance)
+{
+	fake_devset devs(16, 100, SCAP_RINGBUFFER_MERGE_HEAP);
+	devs.m_devset.m_tail_advance_bytes = 10 * sizeof(scap_evt);
+	check_batches(devs, 64);
+}
+
+TEST(ringbuffer_merge, linear_batch_is_ordered)
+{
+	fake_devset devs(4, 10, SCAP_RINGBUFFER_MERGE_LINEAR);
+	check_batches(devs, 8);
+}
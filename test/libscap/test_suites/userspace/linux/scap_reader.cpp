@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+#include <libscap/engine/savefile/scap_reader.h>
+#include <libscap/scap.h>
+#include <libscap/scap_savefile_api.h>
+#include <libscap/scap_savefile.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+static int write_tmp_file(const std::string& content)
+{
+	char path[] = "/tmp/scap_reader_XXXXXX";
+	int fd = mkstemp(path);
+	EXPECT_GE(fd, 0);
+	unlink(path);
+	EXPECT_EQ(write(fd, content.data(), content.size()), (ssize_t)content.size());
+	lseek(fd, 0, SEEK_SET);
+	return fd;
+}
+
+TEST(scap_reader, mmap_read)
+{
+	int fd = write_tmp_file("0123456789abcdef");
+	lseek(fd, 2, SEEK_SET);
+	scap_reader_t* r = scap_reader_open_mmap(fd, true);
+	ASSERT_NE(r, nullptr);
+	ASSERT_NE(r->read_nocopy, nullptr);
+
+	// reading starts from the current file offset
+	char buf[8] = {};
+	ASSERT_EQ(r->tell(r), 2);
+	ASSERT_EQ(r->read(r, buf, 4), 4);
+	ASSERT_EQ(std::string(buf, 4), "2345");
+
+	char* data = (char*)r->read_nocopy(r, 4);
+	ASSERT_NE(data, nullptr);
+	ASSERT_EQ(std::string(data, 4), "6789");
+	ASSERT_EQ(r->tell(r), 10);
+
+	// data read in place can be modified without touching the file
+	data[0] = 'x';
+	ASSERT_EQ(r->seek(r, 6, SEEK_SET), 6);
+	ASSERT_EQ(std::string((char*)r->read_nocopy(r, 1), 1), "x");
+	char c;
+	ASSERT_EQ(pread(fd, &c, 1, 6), 1);
+	ASSERT_EQ(c, '6');
+
+	// short reads
+	ASSERT_EQ(r->seek(r, -2, SEEK_END), 14);
+	ASSERT_EQ(r->read_nocopy(r, 4), nullptr);
+	ASSERT_EQ(r->tell(r), 14);
+	ASSERT_EQ(r->read(r, buf, 4), 2);
+	ASSERT_EQ(std::string(buf, 2), "ef");
+	ASSERT_EQ(r->read(r, buf, 4), 0);
+
+	// the mapping follows the file when it grows
+	ASSERT_EQ(pwrite(fd, "gh", 2, 16), 2);
+	ASSERT_EQ(std::string((char*)r->read_nocopy(r, 2), 2), "gh");
+
+	ASSERT_EQ(r->seek(r, -1, SEEK_SET), -1);
+	ASSERT_EQ(r->close(r), 0);
+}
+
+TEST(scap_reader, mmap_unsupported_files)
+{
+	// gzip-compressed files are left to the gzip reader
+	int fd = write_tmp_file("\x1f\x8b\x08\x00");
+	ASSERT_EQ(scap_reader_open_mmap(fd, true), nullptr);
+	close(fd);
+
+	fd = write_tmp_file("");
+	ASSERT_EQ(scap_reader_open_mmap(fd, true), nullptr);
+	close(fd);
+
+	int pipe_fds[2];
+	ASSERT_EQ(pipe(pipe_fds), 0);
+	ASSERT_EQ(scap_reader_open_mmap(pipe_fds[0], true), nullptr);
+	close(pipe_fds[0]);
+	close(pipe_fds[1]);
+}
+
+// dump the same events in the given mode, returning the file
+static std::string dump_events(compression_mode mode, int level)
+{
+	char path[] = "/tmp/scap_reader_XXXXXX";
+	int fd = mkstemp(path);
+	EXPECT_GE(fd, 0);
+	close(fd);
+
+	char error[SCAP_LASTERR_SIZE];
+	scap_dumper_t* d = scap_dump_open(NULL, path, mode, error);
+	EXPECT_NE(d, nullptr) << error;
+	if(level != SCAP_COMPRESSION_LEVEL_DEFAULT)
+	{
+		EXPECT_EQ(scap_dump_set_compression_level(d, level), SCAP_SUCCESS);
+	}
+
+	std::vector<uint8_t> buf(4096);
+	for(uint32_t i = 0; i < 4000; i++)
+	{
+		scap_evt* e = (scap_evt*)buf.data();
+		e->ts = i;
+		e->tid = i % 7;
+		e->len = sizeof(scap_evt) + i % 1000;
+		e->type = PPME_SYSCALL_READ_X;
+		e->nparams = 0;
+		for(uint32_t j = sizeof(scap_evt); j < e->len; j++)
+		{
+			buf[j] = (uint8_t)(i * j);
+		}
+		EXPECT_EQ(scap_dump(d, e, i % 4, 0), SCAP_SUCCESS);
+	}
+	scap_dump_close(d);
+	return path;
+}
+
+static std::vector<uint8_t> read_all(scap_reader_t* r, uint32_t chunk)
+{
+	std::vector<uint8_t> ret;
+	std::vector<uint8_t> buf(chunk);
+	int n;
+	while((n = r->read(r, buf.data(), chunk)) > 0)
+	{
+		ret.insert(ret.end(), buf.begin(), buf.begin() + n);
+	}
+	return ret;
+}
+
+TEST(scap_reader, blocks_read)
+{
+	std::string plain_path = dump_events(SCAP_COMPRESSION_NONE, SCAP_COMPRESSION_LEVEL_DEFAULT);
+	std::string blocks_path = dump_events(SCAP_COMPRESSION_GZIP_BLOCKS, SCAP_COMPRESSION_LEVEL_DEFAULT);
+	std::string best_path = dump_events(SCAP_COMPRESSION_GZIP_BLOCKS, 9);
+
+	int fd = open(plain_path.c_str(), O_RDONLY);
+	ASSERT_EQ(scap_reader_open_blocks(fd, true), nullptr);
+	scap_reader_t* r = scap_reader_open_mmap(fd, true);
+	ASSERT_NE(r, nullptr);
+	std::vector<uint8_t> plain = read_all(r, 4096);
+	r->close(r);
+	ASSERT_GT(plain.size(), 4 * SCAP_GZIP_BLOCK_SIZE);
+
+	fd = open(blocks_path.c_str(), O_RDONLY);
+	ASSERT_EQ(scap_reader_open_mmap(fd, false), nullptr);
+	r = scap_reader_open_blocks(fd, true);
+	ASSERT_NE(r, nullptr);
+	ASSERT_EQ(r->read_nocopy, nullptr);
+	ASSERT_EQ(read_all(r, 1000), plain);
+	int errnum;
+	r->error(r, &errnum);
+	ASSERT_EQ(errnum, 0);
+	ASSERT_EQ(r->tell(r), (int64_t)plain.size());
+	ASSERT_EQ(r->offset(r), lseek(fd, 0, SEEK_END));
+
+	// seeking backwards and across blocks
+	uint8_t buf[64];
+	for(int64_t pos : {(int64_t)plain.size() - 10, (int64_t)10, (int64_t)SCAP_GZIP_BLOCK_SIZE - 32, (int64_t)3 * SCAP_GZIP_BLOCK_SIZE + 5})
+	{
+		ASSERT_EQ(r->seek(r, pos, SEEK_SET), pos);
+		int len = std::min((int64_t)sizeof(buf), (int64_t)plain.size() - pos);
+		ASSERT_EQ(r->read(r, buf, sizeof(buf)), len);
+		ASSERT_EQ(memcmp(buf, plain.data() + pos, len), 0);
+		ASSERT_EQ(r->tell(r), pos + len);
+	}
+	ASSERT_EQ(r->seek(r, -64, SEEK_CUR), (int64_t)3 * SCAP_GZIP_BLOCK_SIZE + 5);
+	ASSERT_EQ(r->seek(r, -4, SEEK_END), (int64_t)plain.size() - 4);
+	ASSERT_EQ(r->read(r, buf, sizeof(buf)), 4);
+	ASSERT_EQ(memcmp(buf, plain.data() + plain.size() - 4, 4), 0);
+	ASSERT_EQ(r->seek(r, plain.size() + 1, SEEK_SET), -1);
+	ASSERT_EQ(r->close(r), 0);
+
+	// the blocks are still a valid gzip file, and the level is honored
+	gzFile gz = gzopen(best_path.c_str(), "rb");
+	ASSERT_NE(gz, nullptr);
+	std::vector<uint8_t> unzipped(plain.size() + 1);
+	ASSERT_EQ(gzread(gz, unzipped.data(), unzipped.size()), (int)plain.size());
+	unzipped.resize(plain.size());
+	ASSERT_EQ(unzipped, plain);
+	gzclose(gz);
+
+	struct stat fast_st, best_st;
+	ASSERT_EQ(stat(blocks_path.c_str(), &fast_st), 0);
+	ASSERT_EQ(stat(best_path.c_str(), &best_st), 0);
+	ASSERT_LT(best_st.st_size, fast_st.st_size);
+	ASSERT_LT(fast_st.st_size, (off_t)plain.size());
+
+	unlink(plain_path.c_str());
+	unlink(blocks_path.c_str());
+	unlink(best_path.c_str());
+}
+
+TEST(scap_reader, blocks_truncated)
+{
+	std::string path = dump_events(SCAP_COMPRESSION_GZIP_BLOCKS, SCAP_COMPRESSION_LEVEL_DEFAULT);
+	struct stat st;
+	ASSERT_EQ(stat(path.c_str(), &st), 0);
+	ASSERT_EQ(truncate(path.c_str(), st.st_size / 2), 0);
+
+	int fd = open(path.c_str(), O_RDONLY);
+	scap_reader_t* r = scap_reader_open_blocks(fd, true);
+	ASSERT_NE(r, nullptr);
+	std::vector<uint8_t> data = read_all(r, 4096);
+	ASSERT_GT(data.size(), 0);
+	ASSERT_EQ(data.size() % SCAP_GZIP_BLOCK_SIZE, 0);
+	int errnum;
+	r->error(r, &errnum);
+	ASSERT_EQ(errnum, EIO);
+	ASSERT_EQ(r->close(r), 0);
+
+	unlink(path.c_str());
+}
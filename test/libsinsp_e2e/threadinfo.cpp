@@ -63,22 +63,27 @@ static void run_test(test_type ttype,
 	std::string rem;
 	sinsp_threadinfo::cgroups_t cg;
 
+	std::vector<std::string> strs;
 	for (auto& val : vals)
 	{
-		switch (ttype)
+		if (ttype == TEST_CGROUPS)
 		{
-		case TEST_ARGS:
-			ti.m_args.push_back(val.c_str());
-			break;
-		case TEST_ENV:
-			ti.m_env.push_back(val.c_str());
-			break;
-		case TEST_CGROUPS:
-			size_t pos = val.find("=");
-			ASSERT_NE(pos, std::string::npos);
-			ti.cgroups().push_back(make_pair(val.substr(0, pos), val.substr(pos + 1)));
-			break;
+			ASSERT_NE(val.find("="), std::string::npos);
 		}
+		strs.push_back(val.c_str());
+	}
+
+	switch (ttype)
+	{
+	case TEST_ARGS:
+		ti.set_args(strs);
+		break;
+	case TEST_ENV:
+		ti.set_env(strs);
+		break;
+	case TEST_CGROUPS:
+		ti.set_cgroups(strs);
+		break;
 	}
 
 	switch (ttype)
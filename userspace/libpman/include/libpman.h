@@ -276,6 +276,51 @@ extern "C"
 	 */
 	void pman_consume_first_event(void** event_ptr, int16_t* buffer_id);
 
+	/**
+	 * @brief Like `pman_consume_first_event` but return up to `max_events`
+	 * events, in the same order, with a single call. The events point
+	 * into the ring buffers: their space is given back to the producers
+	 * only at the next consume call, so they all stay valid until then.
+	 *
+	 * @param event_ptrs array of `max_events` pointers filled with the events.
+	 * @param buffer_ids array of `max_events` ids filled with the ring buffer
+	 * of every event.
+	 * @param max_events maximum number of events to return.
+	 * @param n_events number of events returned, `0` if all the ring buffers are empty.
+	 */
+	void pman_consume_batch(void** event_ptrs, int16_t* buffer_ids, uint32_t max_events, uint32_t* n_events);
+
+	/**
+	 * @brief Select how `pman_consume_first_event` merges the ring buffers.
+	 * Must be called before `pman_prepare_ringbuf_array_before_loading`.
+	 *
+	 * @param enable if true keep the ring heads in a min-heap so that every
+	 * event costs O(log(n_rings)), otherwise scan all the ring buffers for
+	 * every event.
+	 */
+	void pman_set_ringbuf_heap_merge(bool enable);
+
+	/**
+	 * @brief Relax the ordering of the events coming from different ring
+	 * buffers, only honored when the heap merge is enabled.
+	 *
+	 * @param window_ns keep consuming the same ring buffer while its events are
+	 * at most `window_ns` newer than the oldest event of the other ring buffers.
+	 * `0` means strict ordering, `UINT64_MAX` drains every ring buffer in FIFO order.
+	 */
+	void pman_set_ringbuf_order_window(uint64_t window_ns);
+
+	/**
+	 * @brief Block until at least one ring buffer has new events or
+	 * the timeout expires. The driver notifies new events only after
+	 * `pman_set_ringbuf_wakeup(true)`.
+	 *
+	 * @param timeout_ms maximum time to wait in milliseconds.
+	 * @return the number of ring buffers with new events, `0` if the
+	 * timeout expired or the wait was interrupted, `-errno` on failure.
+	 */
+	int pman_wait_ringbuf_data(int timeout_ms);
+
 	/////////////////////////////
 	// CAPTURE (EXCHANGE VALUES WITH BPF SIDE)
 	/////////////////////////////
@@ -351,6 +396,15 @@ extern "C"
 	 */
 	void pman_set_drop_failed(bool drop_failed);
 
+	/**
+	 * @brief Ask driver to notify userspace when new events are
+	 * available and userspace has consumed all the previous ones,
+	 * see `pman_wait_ringbuf_data`.
+	 *
+	 * @param wakeup whether to enable the notifications.
+	 */
+	void pman_set_ringbuf_wakeup(bool wakeup);
+
 	/**
 	 * @brief Ask driver to enable/disable dynamic_snaplen.
 	 *
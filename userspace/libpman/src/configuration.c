@@ -70,6 +70,20 @@ void pman_clear_state()
 	g_state.buffer_bytes_dim = 0;
 	g_state.last_ring_read = -1;
 	g_state.last_event_size = 0;
+	g_state.heap_merge = false;
+	g_state.heap.m_entries = NULL;
+	g_state.heap.m_size = 0;
+	g_state.heap.m_capacity = 0;
+	g_state.ring_heads = NULL;
+	g_state.ring_head_sizes = NULL;
+	g_state.ring_in_heap = NULL;
+	g_state.events_since_rescan = 0;
+	g_state.rescan_ts = 0;
+	g_state.order_window_ns = 0;
+	g_state.last_ts = 0;
+	g_state.n_evts_out_of_order = 0;
+	g_state.batching = false;
+	g_state.consumer_pos_pending = false;
 	g_state.n_attached_progs = 0;
 	g_state.stats = NULL;
 	g_state.log_fn = NULL;
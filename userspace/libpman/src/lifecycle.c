@@ -90,6 +90,11 @@ void pman_close_probe()
 		free(g_state.prod_pos);
 	}
 
+	ringbuffer_heap_free(&g_state.heap);
+	free(g_state.ring_heads);
+	free(g_state.ring_head_sizes);
+	free(g_state.ring_in_heap);
+
 	if(g_state.skel)
 	{
 		bpf_probe__detach(g_state.skel);
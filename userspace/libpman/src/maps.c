@@ -89,6 +89,11 @@ void pman_set_drop_failed(bool drop_failed)
 	g_state.skel->bss->g_settings.drop_failed = drop_failed;
 }
 
+void pman_set_ringbuf_wakeup(bool wakeup)
+{
+	g_state.skel->bss->g_settings.ringbuf_wakeup = wakeup;
+}
+
 void pman_set_do_dynamic_snaplen(bool do_dynamic_snaplen)
 {
 	g_state.skel->bss->g_settings.do_dynamic_snaplen = do_dynamic_snaplen;
@@ -370,6 +375,7 @@ int pman_finalize_maps_after_loading()
 	pman_set_dropping_mode(false);
 	pman_set_sampling_ratio(1);
 	pman_set_drop_failed(false);
+	pman_set_ringbuf_wakeup(false);
 	pman_set_do_dynamic_snaplen(false);
 	pman_set_fullcapture_port_range(0, 0);
 	pman_set_statsd_port(PPM_PORT_STATSD);
@@ -21,7 +21,9 @@ limitations under the License.
 #include <unistd.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <errno.h>
 #include <sys/mman.h>
+#include <sys/epoll.h>
 #include <driver/ppm_events_public.h>
 
 #include "ringbuffer_definitions.h"
@@ -79,6 +81,21 @@ static int allocate_consumer_producer_positions()
 		pman_print_error("failed to alloc memory for cons_pos and prod_pos");
 		return errno;
 	}
+
+	if(g_state.heap_merge)
+	{
+		g_state.events_since_rescan = 0;
+		g_state.rescan_ts = 0;
+		g_state.ring_heads = (void **)calloc(g_state.n_required_buffers, sizeof(void *));
+		g_state.ring_head_sizes = (unsigned long *)calloc(g_state.n_required_buffers, sizeof(unsigned long));
+		g_state.ring_in_heap = (bool *)calloc(g_state.n_required_buffers, sizeof(bool));
+		if(g_state.ring_heads == NULL || g_state.ring_head_sizes == NULL || g_state.ring_in_heap == NULL ||
+		   ringbuffer_heap_init(&g_state.heap, g_state.n_required_buffers) != 0)
+		{
+			pman_print_error("failed to alloc memory for the ring buffers heap");
+			return errno;
+		}
+	}
 	return 0;
 }
 
@@ -251,6 +268,29 @@ clean_percpu_ring_buffers:
 	return errno;
 }
 
+/* Move the consumer position of the ring `pos` forward by `size` bytes. While
+ * `pman_consume_batch` is collecting events the new position is published only
+ * at the next consume call, since the caller is still using the events of the batch.
+ */
+static inline void ringbuf__advance_consumer(struct ring *r, int pos, unsigned long size)
+{
+	g_state.cons_pos[pos] += size;
+	if(!g_state.batching)
+	{
+		smp_store_release(r->consumer_pos, g_state.cons_pos[pos]);
+	}
+}
+
+/* Give back to the producers the space of the events returned by the last batch. */
+static void ringbuf__publish_consumer_positions(struct ring_buffer *rb)
+{
+	for(uint16_t pos = 0; pos < rb->ring_cnt; pos++)
+	{
+		smp_store_release(rb->rings[pos]->consumer_pos, g_state.cons_pos[pos]);
+	}
+	g_state.consumer_pos_pending = false;
+}
+
 static inline void *ringbuf__get_first_ring_event(struct ring *r, int pos)
 {
 	int *len_ptr = NULL;
@@ -284,8 +324,7 @@ static inline void *ringbuf__get_first_ring_event(struct ring *r, int pos)
 	else
 	{
 		/* Discard the event kernel side and update the consumer position */
-		g_state.cons_pos[pos] += roundup_len(len);
-		smp_store_release(r->consumer_pos, g_state.cons_pos[pos]);
+		ringbuf__advance_consumer(r, pos, roundup_len(len));
 		return NULL;
 	}
 }
@@ -300,9 +339,8 @@ static void ringbuf__consume_first_event(struct ring_buffer *rb, struct ppm_evt_
 	/* If the last consume operation was successful we can push the consumer position */
 	if(g_state.last_ring_read != -1)
 	{
-		struct ring *r = rb->rings[g_state.last_ring_read];
-		g_state.cons_pos[g_state.last_ring_read] += g_state.last_event_size;
-		smp_store_release(r->consumer_pos, g_state.cons_pos[g_state.last_ring_read]);
+		ringbuf__advance_consumer(rb->rings[g_state.last_ring_read], g_state.last_ring_read,
+					  g_state.last_event_size);
 	}
 
 	for(uint16_t pos = 0; pos < rb->ring_cnt; pos++)
@@ -330,8 +368,187 @@ static void ringbuf__consume_first_event(struct ring_buffer *rb, struct ppm_evt_
 	g_state.last_event_size = tmp_cons_increment;
 }
 
+/* `ringbuf__get_first_ring_event` returns NULL also when it has just refreshed the
+ * producer position or skipped a discarded sample, so retry until the ring is really
+ * empty or its first sample is not committed yet.
+ */
+static inline void *ringbuf__peek_ring_event(struct ring *r, int pos)
+{
+	void *event = NULL;
+	unsigned long cons_pos = 0;
+	unsigned long prod_pos = 0;
+
+	do
+	{
+		cons_pos = g_state.cons_pos[pos];
+		prod_pos = g_state.prod_pos[pos];
+		event = ringbuf__get_first_ring_event(r, pos);
+	} while(event == NULL && (cons_pos != g_state.cons_pos[pos] || prod_pos != g_state.prod_pos[pos]));
+
+	return event;
+}
+
+/* Look for the first event of `pos`, and save it as the new ring head. */
+static inline bool ringbuf__load_ring_head(struct ring_buffer *rb, int pos)
+{
+	struct ppm_evt_hdr *event = ringbuf__peek_ring_event(rb->rings[pos], pos);
+	if(event == NULL)
+	{
+		return false;
+	}
+	g_state.ring_heads[pos] = event;
+	g_state.ring_head_sizes[pos] = g_state.last_event_size;
+	return true;
+}
+
+/* Same contract as `ringbuf__consume_first_event`, but the rings with an available event
+ * are kept in a min-heap ordered by timestamp. After consuming an event we only look at the
+ * ring we have just read from, so every event costs O(log(n_rings)) instead of O(n_rings).
+ *
+ * With the strict ordering (`order_window_ns` == 0) any of the empty rings could have
+ * received an event older than the heads in the heap, but only one written after we last
+ * checked them, so newer than all the heads we had then (`rescan_ts`): their producer
+ * positions are checked again before returning an event newer than that. This costs a load
+ * for every empty ring whenever the oldest head passes the newest one, i.e. still before
+ * every event when a single ring is busy. With a relaxed ordering they are checked again
+ * when the heap becomes empty or, to avoid starving them when a few rings are always busy,
+ * every `ring_cnt` events. This keeps the cost of the rescan amortized O(1) per event and
+ * bounds the delay of the events arriving in a ring that was empty.
+ *
+ * With a non-zero `order_window_ns` the ring on top is drained until its next event is more
+ * than `order_window_ns` newer than the oldest head of the other rings, or until the events
+ * that were available when its producer position was last loaded are consumed.
+ */
+static void ringbuf__consume_first_event_heap(struct ring_buffer *rb, struct ppm_evt_hdr **event_ptr, int16_t *buffer_id)
+{
+	struct ringbuffer_heap *heap = &g_state.heap;
+
+	/* If the last consume operation was successful we can push the consumer position and
+	 * look for the next event in the same ring, that is still on top of the heap.
+	 */
+	if(g_state.last_ring_read != -1)
+	{
+		int pos = g_state.last_ring_read;
+		unsigned long prod_pos = g_state.prod_pos[pos];
+		ringbuf__advance_consumer(rb->rings[pos], pos, g_state.last_event_size);
+
+		if(ringbuf__load_ring_head(rb, pos))
+		{
+			ringbuffer_heap_update_top_refill(heap, ((struct ppm_evt_hdr *)g_state.ring_heads[pos])->ts,
+							  g_state.order_window_ns, g_state.prod_pos[pos] != prod_pos);
+		}
+		else
+		{
+			g_state.ring_in_heap[pos] = false;
+			ringbuffer_heap_pop(heap);
+		}
+	}
+
+	if(heap->m_size == 0 ||
+	   (g_state.order_window_ns == 0 ? heap->m_entries[0].ts > g_state.rescan_ts
+					 : ++g_state.events_since_rescan >= (uint32_t)rb->ring_cnt))
+	{
+		g_state.events_since_rescan = 0;
+		for(uint16_t pos = 0; pos < rb->ring_cnt; pos++)
+		{
+			if(g_state.ring_in_heap[pos] || !ringbuf__load_ring_head(rb, pos))
+			{
+				continue;
+			}
+			g_state.ring_in_heap[pos] = true;
+			ringbuffer_heap_push(heap, ((struct ppm_evt_hdr *)g_state.ring_heads[pos])->ts, pos);
+		}
+		g_state.rescan_ts = ringbuffer_heap_max_ts(heap);
+	}
+
+	if(heap->m_size == 0)
+	{
+		*event_ptr = NULL;
+		*buffer_id = -1;
+		g_state.last_ring_read = -1;
+		g_state.last_event_size = 0;
+		return;
+	}
+
+	int pos = heap->m_entries[0].id;
+	*event_ptr = g_state.ring_heads[pos];
+	*buffer_id = pos;
+	g_state.last_ring_read = pos;
+	g_state.last_event_size = g_state.ring_head_sizes[pos];
+}
+
 /* Consume */
 void pman_consume_first_event(void **event_ptr, int16_t *buffer_id)
 {
-	ringbuf__consume_first_event(g_state.rb_manager, (struct ppm_evt_hdr **)event_ptr, buffer_id);
+	struct ppm_evt_hdr **event = (struct ppm_evt_hdr **)event_ptr;
+
+	if(g_state.consumer_pos_pending)
+	{
+		ringbuf__publish_consumer_positions(g_state.rb_manager);
+	}
+
+	if(g_state.heap_merge)
+	{
+		ringbuf__consume_first_event_heap(g_state.rb_manager, event, buffer_id);
+	}
+	else
+	{
+		ringbuf__consume_first_event(g_state.rb_manager, event, buffer_id);
+	}
+
+	if(*event != NULL)
+	{
+		if((*event)->ts < g_state.last_ts)
+		{
+			g_state.n_evts_out_of_order++;
+		}
+		g_state.last_ts = (*event)->ts;
+	}
+}
+
+void pman_consume_batch(void **event_ptrs, int16_t *buffer_ids, uint32_t max_events, uint32_t *n_events)
+{
+	uint32_t n = 0;
+
+	g_state.batching = true;
+	while(n < max_events)
+	{
+		pman_consume_first_event(&event_ptrs[n], &buffer_ids[n]);
+		if(event_ptrs[n] == NULL)
+		{
+			break;
+		}
+		n++;
+	}
+	g_state.batching = false;
+	g_state.consumer_pos_pending = true;
+	*n_events = n;
+}
+
+void pman_set_ringbuf_heap_merge(bool enable)
+{
+	g_state.heap_merge = enable;
+}
+
+void pman_set_ringbuf_order_window(uint64_t window_ns)
+{
+	g_state.order_window_ns = window_ns;
+}
+
+int pman_wait_ringbuf_data(int timeout_ms)
+{
+	struct epoll_event event;
+
+	/* All the ring buffers are registered in the epoll instance of the ring buffer manager. */
+	int ready = epoll_wait(ring_buffer__epoll_fd(g_state.rb_manager), &event, 1, timeout_ms);
+	if(ready < 0)
+	{
+		if(errno == EINTR)
+		{
+			return 0;
+		}
+		pman_print_error("failed to wait for new events in the ring buffers");
+		return -errno;
+	}
+	return ready;
 }
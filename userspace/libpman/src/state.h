@@ -19,6 +19,7 @@ limitations under the License.
 #pragma once
 
 #include <libscap/scap_log.h>
+#include <libscap/ringbuffer/ringbuffer_heap.h>
 
 #include <bpf/libbpf.h>
 #include <bpf/bpf.h>
@@ -52,6 +53,18 @@ struct internal_state
 	int last_ring_read; /* Last ring from which we have correctly read an event. Could be `-1` if there were no
 			       successful reads. */
 	unsigned long last_event_size; /* Last event correctly read. Could be `0` if there were no successful reads. */
+	bool heap_merge;	       /* If true the ring buffers are merged through a min-heap of ring heads. */
+	struct ringbuffer_heap heap;   /* rings with an available event, ordered by the event timestamp. */
+	void** ring_heads;	       /* for every ring in the heap, its first available event. */
+	unsigned long* ring_head_sizes; /* for every ring in the heap, the size of its first available event. */
+	bool* ring_in_heap;	       /* true if the ring is in the heap, false if it was empty the last time we checked. */
+	uint32_t events_since_rescan;  /* events consumed since we last looked for new data in the empty rings. */
+	uint64_t rescan_ts;	       /* newest head in the heap when we last looked for new data in the empty rings. */
+	uint64_t order_window_ns;      /* see `pman_set_ringbuf_order_window`, 0 means strict ordering. */
+	uint64_t last_ts;	       /* timestamp of the last returned event. */
+	uint64_t n_evts_out_of_order;  /* events returned with a timestamp lower than the previous one. */
+	bool batching;		       /* true while `pman_consume_batch` collects events, consumer positions are not published. */
+	bool consumer_pos_pending;     /* true if some consumer positions have not been published yet. */
 
 	/* Stats v2 utilities */
 	int32_t attached_progs_fds[MODERN_BPF_PROG_ATTACHED_MAX]; /* file descriptors of attached programs, used to
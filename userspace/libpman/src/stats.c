@@ -52,6 +52,12 @@ typedef enum modern_bpf_libbpf_stats
 	MODERN_BPF_MAX_LIBBPF_STATS,
 } modern_bpf_libbpf_stats;
 
+typedef enum modern_bpf_libscap_stats
+{
+	N_EVTS_OUT_OF_ORDER = 0,
+	MODERN_BPF_MAX_LIBSCAP_STATS,
+} modern_bpf_libscap_stats;
+
 const char *const modern_bpf_kernel_counters_stats_names[] = {
 	[MODERN_BPF_N_EVTS] = "n_evts",
 	[MODERN_BPF_N_DROPS_BUFFER_TOTAL] = "n_drops_buffer_total",
@@ -144,7 +150,7 @@ struct metrics_v2 *pman_get_metrics_v2(uint32_t flags, uint32_t *nstats, int32_t
 {
 	*rc = SCAP_FAILURE;
 	/* This is the expected number of stats */
-	*nstats = (MODERN_BPF_MAX_KERNEL_COUNTERS_STATS + (g_state.n_attached_progs * MODERN_BPF_MAX_LIBBPF_STATS));
+	*nstats = (MODERN_BPF_MAX_KERNEL_COUNTERS_STATS + (g_state.n_attached_progs * MODERN_BPF_MAX_LIBBPF_STATS) + MODERN_BPF_MAX_LIBSCAP_STATS);
 	/* offset in stats buffer */
 	int offset = 0;
 
@@ -287,6 +293,20 @@ struct metrics_v2 *pman_get_metrics_v2(uint32_t flags, uint32_t *nstats, int32_t
 		}
 	}
 
+	/* LIBSCAP COUNTERS */
+
+	/* Counted in userspace while consuming the ring buffers, see `pman_set_ringbuf_order_window`. */
+	if((flags & METRICS_V2_LIBSCAP_COUNTERS) && offset + MODERN_BPF_MAX_LIBSCAP_STATS <= *nstats)
+	{
+		g_state.stats[offset].type = METRIC_VALUE_TYPE_U64;
+		g_state.stats[offset].flags = METRICS_V2_LIBSCAP_COUNTERS;
+		g_state.stats[offset].unit = METRIC_VALUE_UNIT_COUNT;
+		g_state.stats[offset].metric_type = METRIC_VALUE_METRIC_TYPE_MONOTONIC;
+		strlcpy(g_state.stats[offset].name, N_EVTS_OUT_OF_ORDER_NAME, METRIC_NAME_MAX);
+		g_state.stats[offset].value.u64 = g_state.n_evts_out_of_order;
+		offset += MODERN_BPF_MAX_LIBSCAP_STATS;
+	}
+
 	/* Update with the real number of stats collected */
 	*nstats = offset;
 	*rc = SCAP_SUCCESS;
@@ -24,3 +24,8 @@ static inline void sleep_ms(int ms)
 {
 	usleep(ms * 1000);
 }
+
+static inline void sleep_us(int us)
+{
+	usleep(us);
+}
@@ -93,6 +93,7 @@ static inline void scap_bpf_advance_to_next_evt(scap_device* dev, scap_evt *even
 
 #define GET_BUF_POINTERS scap_bpf_get_buf_pointers
 #define ADVANCE_TAIL scap_bpf_advance_tail
+#define ADVANCE_TAIL_BY scap_bpf_advance_tail_by
 #define ADVANCE_TO_EVT scap_bpf_advance_to_next_evt
 #define READBUF scap_bpf_readbuf
 #define NEXT_EVENT scap_bpf_next_event
@@ -866,7 +867,8 @@ static int allocate_metrics_v2(struct bpf_engine *handle)
 			nprogs_attached++;
 		}
 	}
-	handle->m_nstats = (BPF_MAX_KERNEL_COUNTERS_STATS + (nprogs_attached * BPF_MAX_LIBBPF_STATS));
+	handle->m_nstats = (BPF_MAX_KERNEL_COUNTERS_STATS + (nprogs_attached * BPF_MAX_LIBBPF_STATS) +
+			    (handle->m_dev_set.m_ndevs * DEVSET_PER_CPU_STATS) + DEVSET_LIBSCAP_STATS);
 	handle->m_stats = (metrics_v2*)malloc(handle->m_nstats * sizeof(metrics_v2));
 
 	if(!handle->m_stats)
@@ -1612,6 +1614,7 @@ int32_t scap_bpf_load(
 
 		struct scap_device *dev = &devset->m_devs[online_idx];
 		dev->m_fd = pmu_fd;
+		dev->m_cpu = cpu_idx;
 
 		if((ret = bpf_map_update_elem(handle->m_bpf_map_fds[SCAP_PERF_MAP], &cpu_idx, &pmu_fd, BPF_ANY)) != 0)
 		{
@@ -1772,6 +1775,23 @@ const struct metrics_v2* scap_bpf_get_stats_v2(struct scap_engine_handle engine,
 		offset = BPF_MAX_KERNEL_COUNTERS_STATS;
 	}
 
+	if((flags & METRICS_V2_KERNEL_COUNTERS_PER_CPU))
+	{
+		for(uint32_t j = 0; j < handle->m_dev_set.m_ndevs && offset + DEVSET_PER_CPU_STATS <= nstats_allocated; j++)
+		{
+			struct scap_device *dev = &handle->m_dev_set.m_devs[j];
+			struct scap_bpf_per_cpu_state v;
+			if((ret = bpf_map_lookup_elem(handle->m_bpf_map_fds[SCAP_LOCAL_STATE_MAP], &dev->m_cpu, &v)))
+			{
+				*rc = scap_errprintf(handle->m_lasterr, -ret, "Error looking up local state %d", dev->m_cpu);
+				return stats;
+			}
+			devset_fill_per_cpu_stats(dev, &stats[offset], v.n_evts,
+						  v.n_drops_buffer + v.n_drops_scratch_map + v.n_drops_pf + v.n_drops_bug);
+			offset += DEVSET_PER_CPU_STATS;
+		}
+	}
+
 	/* LIBBPF STATS */
 
 	/* At the time of writing (Apr 2, 2023) libbpf stats are only available on a per program granularity.
@@ -1854,6 +1874,12 @@ const struct metrics_v2* scap_bpf_get_stats_v2(struct scap_engine_handle engine,
 			}
 		}
 	}
+
+	if((flags & METRICS_V2_LIBSCAP_COUNTERS) && offset + DEVSET_LIBSCAP_STATS <= nstats_allocated)
+	{
+		devset_fill_libscap_stats(&handle->m_dev_set, &stats[offset]);
+		offset += DEVSET_LIBSCAP_STATS;
+	}
 	*nstats = offset; // return true number of stats that were available as libbpf metrics are a function of attached progs
 	*rc = SCAP_SUCCESS;
 	return stats;
@@ -1884,6 +1910,12 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 	return ringbuffer_next(&engine.m_handle->m_dev_set, pevent, pdevid, pflags);
 }
 
+static int32_t next_batch(struct scap_engine_handle engine, scap_evt **pevents, uint16_t *pdevids, uint32_t *pflags,
+			  uint32_t max_events, uint32_t *pnevents)
+{
+	return ringbuffer_next_batch(&engine.m_handle->m_dev_set, pevents, pdevids, pflags, max_events, pnevents);
+}
+
 static int32_t unsupported_config(struct scap_engine_handle engine, const char* msg)
 {
 	struct bpf_engine* handle = engine.m_handle;
@@ -2003,6 +2035,10 @@ static int32_t init(scap_t* handle, scap_open_args *oargs)
 	{
 		return rc;
 	}
+	engine.m_handle->m_dev_set.m_merge_mode = params->merge_mode;
+	engine.m_handle->m_dev_set.m_order_window_ns = ringbuffer_order_window_ns(params->order_mode, params->order_window_ns);
+	engine.m_handle->m_dev_set.m_tail_advance_bytes = params->tail_advance_bytes;
+	devset_set_wait_mode(&engine.m_handle->m_dev_set, params->wait_mode, params->wait_latency_us, params->wait_idle_us);
 
 	/* Here we need to load maps and progs but we shouldn't attach tracepoints */
 	rc = scap_bpf_load(engine.m_handle, bpf_probe_buf, oargs);
@@ -2085,4 +2121,5 @@ const struct scap_vtable scap_bpf_engine = {
 	.get_max_buf_used = get_max_buf_used,
 	.get_api_version = scap_bpf_get_api_version,
 	.get_schema_version = scap_bpf_get_schema_version,
+	.next_batch = next_batch,
 };
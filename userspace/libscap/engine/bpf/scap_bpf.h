@@ -139,8 +139,8 @@ static inline int32_t scap_bpf_advance_to_evt(struct scap_device *dev, bool skip
 	return SCAP_SUCCESS;
 }
 
-/* This helper increments the consumer position */
-static inline void scap_bpf_advance_tail(struct scap_device *dev)
+/* This helper increments the consumer position by the first `size` bytes of the block */
+static inline void scap_bpf_advance_tail_by(struct scap_device *dev, uint32_t size)
 {
 	struct perf_event_mmap_page *header;
 
@@ -150,10 +150,17 @@ static inline void scap_bpf_advance_tail(struct scap_device *dev)
 	asm volatile("" ::: "memory");
 	// clang-format on
 
-	ASSERT(dev->m_lastreadsize > 0);
+	ASSERT(dev->m_lastreadsize >= size);
 	/* `header->data_tail` is the consumer position. */
-	header->data_tail += dev->m_lastreadsize;
-	dev->m_lastreadsize = 0;
+	header->data_tail += size;
+	dev->m_lastreadsize -= size;
+}
+
+/* This helper increments the consumer position */
+static inline void scap_bpf_advance_tail(struct scap_device *dev)
+{
+	ASSERT(dev->m_lastreadsize > 0);
+	scap_bpf_advance_tail_by(dev, dev->m_lastreadsize);
 }
 
 static inline int32_t scap_bpf_readbuf(struct scap_device *dev, char **buf, uint32_t *len)
@@ -15,6 +15,7 @@ limitations under the License.
 #pragma once
 
 #include <stdint.h>
+#include <libscap/ringbuffer/ringbuffer_public.h>
 
 #define KMOD_ENGINE "kmod"
 
@@ -27,6 +28,13 @@ extern "C"
 	struct scap_kmod_engine_params
 	{
 		unsigned long buffer_bytes_dim; ///< Dimension of a single per-CPU buffer in bytes. Please note: this buffer will be mapped twice in the process virtual memory, so pay attention to its size.
+		enum scap_ringbuffer_merge_mode merge_mode; ///< How to select the next event among the ring buffers, see `scap_ringbuffer_merge_mode`.
+		enum scap_ringbuffer_order_mode order_mode; ///< How strictly the events of different ring buffers are ordered, see `scap_ringbuffer_order_mode`.
+		uint64_t order_window_ns; ///< Ordering window used by `SCAP_RINGBUFFER_ORDER_WINDOW`.
+		enum scap_ringbuffer_wait_mode wait_mode; ///< How to wait for new events, see `scap_ringbuffer_wait_mode`.
+		uint64_t wait_latency_us; ///< `SCAP_RINGBUFFER_WAIT_ADAPTIVE` only: maximum delay added to the events while waiting for more data.
+		uint64_t wait_idle_us; ///< `SCAP_RINGBUFFER_WAIT_ADAPTIVE` only: maximum sleep when there are no events, 0 for the default (30 ms).
+		uint32_t tail_advance_bytes; ///< If not 0, give back the consumed part of a ring buffer block to the driver every `tail_advance_bytes` bytes and refill every ring buffer as soon as it is drained.
 	};
 
 	extern const struct scap_linux_vtable scap_kmod_linux_vtable;
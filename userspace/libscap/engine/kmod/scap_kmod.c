@@ -352,6 +352,18 @@ int32_t scap_kmod_init(scap_t *handle, scap_open_args *oargs)
 	{
 		return rc;
 	}
+	engine.m_handle->m_dev_set.m_merge_mode = params->merge_mode;
+	engine.m_handle->m_dev_set.m_order_window_ns = ringbuffer_order_window_ns(params->order_mode, params->order_window_ns);
+	engine.m_handle->m_dev_set.m_tail_advance_bytes = params->tail_advance_bytes;
+	devset_set_wait_mode(&engine.m_handle->m_dev_set, params->wait_mode, params->wait_latency_us, params->wait_idle_us);
+
+	engine.m_handle->m_nstats = KMOD_MAX_KERNEL_COUNTERS_STATS + ndevs * DEVSET_PER_CPU_STATS + DEVSET_LIBSCAP_STATS;
+	engine.m_handle->m_stats = (metrics_v2*)calloc(engine.m_handle->m_nstats, sizeof(metrics_v2));
+	if(!engine.m_handle->m_stats)
+	{
+		engine.m_handle->m_nstats = 0;
+		return scap_errprintf(handle->m_lasterr, 0, "error allocating the metrics buffer");
+	}
 
 	//
 	// Allocate the device descriptors.
@@ -365,6 +377,7 @@ int32_t scap_kmod_init(scap_t *handle, scap_open_args *oargs)
 	for(uint32_t cpu_idx = 0; online_idx < devset->m_ndevs && cpu_idx < ncpus; ++cpu_idx)
 	{
 		struct scap_device *dev = &devset->m_devs[online_idx];
+		dev->m_cpu = cpu_idx;
 
 		//
 		// Open the device
@@ -523,6 +536,10 @@ int32_t scap_kmod_close(struct scap_engine_handle engine)
 
 	devset_free(devset);
 
+	free(engine.m_handle->m_stats);
+	engine.m_handle->m_stats = NULL;
+	engine.m_handle->m_nstats = 0;
+
 	return SCAP_SUCCESS;
 }
 
@@ -532,6 +549,12 @@ int32_t scap_kmod_next(struct scap_engine_handle engine, scap_evt **pevent, uint
 	return ringbuffer_next(&engine.m_handle->m_dev_set, pevent, pdevid, pflags);
 }
 
+static int32_t scap_kmod_next_batch(struct scap_engine_handle engine, scap_evt **pevents, uint16_t *pdevids,
+				    uint32_t *pflags, uint32_t max_events, uint32_t *pnevents)
+{
+	return ringbuffer_next_batch(&engine.m_handle->m_dev_set, pevents, pdevids, pflags, max_events, pnevents);
+}
+
 uint32_t scap_kmod_get_n_devs(struct scap_engine_handle engine)
 {
 	return engine.m_handle->m_dev_set.m_ndevs;
@@ -583,6 +606,7 @@ const struct metrics_v2* scap_kmod_get_stats_v2(struct scap_engine_handle engine
 	struct kmod_engine *handle = engine.m_handle;
 	struct scap_device_set *devset = &handle->m_dev_set;
 	uint32_t j;
+	uint32_t offset = 0;
 	*nstats = 0;
 	metrics_v2* stats = handle->m_stats;
 
@@ -629,8 +653,26 @@ const struct metrics_v2* scap_kmod_get_stats_v2(struct scap_engine_handle engine
 					dev->m_bufinfo->n_drops_pf;
 			stats[KMOD_N_PREEMPTIONS].value.u64 += dev->m_bufinfo->n_preemptions;
 		}
-		*nstats = KMOD_MAX_KERNEL_COUNTERS_STATS;
+		offset = KMOD_MAX_KERNEL_COUNTERS_STATS;
+	}
+
+	if((flags & METRICS_V2_KERNEL_COUNTERS_PER_CPU))
+	{
+		for(j = 0; j < devset->m_ndevs && offset + DEVSET_PER_CPU_STATS <= handle->m_nstats; j++)
+		{
+			struct scap_device *dev = &devset->m_devs[j];
+			devset_fill_per_cpu_stats(dev, &stats[offset], dev->m_bufinfo->n_evts,
+						  dev->m_bufinfo->n_drops_buffer + dev->m_bufinfo->n_drops_pf);
+			offset += DEVSET_PER_CPU_STATS;
+		}
+	}
+
+	if((flags & METRICS_V2_LIBSCAP_COUNTERS) && offset + DEVSET_LIBSCAP_STATS <= handle->m_nstats)
+	{
+		devset_fill_libscap_stats(devset, &stats[offset]);
+		offset += DEVSET_LIBSCAP_STATS;
 	}
+	*nstats = offset;
 
 	*rc = SCAP_SUCCESS;
 	return stats;
@@ -987,4 +1029,5 @@ struct scap_vtable scap_kmod_engine = {
 	.get_max_buf_used = scap_kmod_get_max_buf_used,
 	.get_api_version = scap_kmod_get_api_version,
 	.get_schema_version = scap_kmod_get_schema_version,
+	.next_batch = scap_kmod_next_batch,
 };
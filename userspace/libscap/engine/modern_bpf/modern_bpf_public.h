@@ -15,6 +15,7 @@ limitations under the License.
 #pragma once
 
 #include <stdint.h>
+#include <libscap/ringbuffer/ringbuffer_public.h>
 
 #define MODERN_BPF_ENGINE "modern_bpf"
 #define DEFAULT_CPU_FOR_EACH_BUFFER 1
@@ -29,6 +30,12 @@ extern "C"
 		uint16_t cpus_for_each_buffer;	///< [EXPERIMENTAL] We will allocate a ring buffer every `cpus_for_each_buffer` CPUs. `0` is a special value and means a single ring buffer shared between all the CPUs.
 		bool allocate_online_only; ///< [EXPERIMENTAL] Allocate ring buffers only for online CPUs. The number of ring buffers allocated changes according to the `cpus_for_each_buffer` param. Please note: this buffer will be mapped twice both kernel and userspace-side, so pay attention to its size.
 		unsigned long buffer_bytes_dim; ///< Dimension of a ring buffer in bytes. The number of ring buffers allocated changes according to the `cpus_for_each_buffer` param. Please note: this buffer will be mapped twice both kernel and userspace-side, so pay attention to its size.
+		enum scap_ringbuffer_merge_mode merge_mode; ///< How to select the next event among the ring buffers, see `scap_ringbuffer_merge_mode`.
+		enum scap_ringbuffer_order_mode order_mode; ///< How strictly the events of different ring buffers are ordered, see `scap_ringbuffer_order_mode`.
+		uint64_t order_window_ns; ///< Ordering window used by `SCAP_RINGBUFFER_ORDER_WINDOW`.
+		enum scap_ringbuffer_wait_mode wait_mode; ///< How to wait for new events, see `scap_ringbuffer_wait_mode`.
+		uint64_t wait_latency_us; ///< `SCAP_RINGBUFFER_WAIT_ADAPTIVE` only: maximum delay added to the events while waiting for more data.
+		uint64_t wait_idle_us; ///< `SCAP_RINGBUFFER_WAIT_ADAPTIVE` only: maximum sleep when there are no events, 0 for the default (30 ms).
 	};
 
 #ifdef __cplusplus
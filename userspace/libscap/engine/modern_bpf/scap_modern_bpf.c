@@ -18,6 +18,7 @@ limitations under the License.
 #include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/socket.h>
 
 #define SCAP_HANDLE_T struct modern_bpf_engine
@@ -49,6 +50,33 @@ static void scap_modern_bpf__free_engine(struct scap_engine_handle engine)
 	free(engine.m_handle);
 }
 
+/* Wait for new events after finding all the ring buffers empty. */
+static int32_t scap_modern_bpf__wait(struct scap_engine_handle engine)
+{
+	if(engine.m_handle->m_wait_mode == SCAP_RINGBUFFER_WAIT_ADAPTIVE)
+	{
+		/* Block until the driver notifies new events, then give them
+		 * `m_wait_latency_us` to accumulate so that we don't wake up for every event.
+		 */
+		int32_t res = pman_wait_ringbuf_data((int)((engine.m_handle->m_wait_idle_us + 999) / 1000));
+		if(res < 0)
+		{
+			return scap_errprintf(engine.m_handle->m_lasterr, -res, "unable to wait for new events");
+		}
+		/* After an idle timeout there is nothing to accumulate. */
+		if(res > 0 && engine.m_handle->m_wait_latency_us > 0)
+		{
+			usleep(engine.m_handle->m_wait_latency_us);
+		}
+		return SCAP_TIMEOUT;
+	}
+
+	/* The first time we sleep 500 us, if we have consecutive timeouts we can reach also 30 ms. */
+	usleep(engine.m_handle->m_retry_us);
+	engine.m_handle->m_retry_us = MIN(engine.m_handle->m_retry_us * 2, BUFFER_EMPTY_WAIT_TIME_US_MAX);
+	return SCAP_TIMEOUT;
+}
+
 /* The third parameter is not the CPU number from which we extract the event but the ring buffer number.
  * For the old BPF probe and the kernel module the number of CPUs is equal to the number of buffers since we always use a per-CPU approach.
  */
@@ -59,10 +87,7 @@ static int32_t scap_modern_bpf__next(struct scap_engine_handle engine, scap_evt*
 
 	if((*pevent) == NULL)
 	{
-		/* The first time we sleep 500 us, if we have consecutive timeouts we can reach also 30 ms. */
-		usleep(engine.m_handle->m_retry_us);
-		engine.m_handle->m_retry_us = MIN(engine.m_handle->m_retry_us * 2, BUFFER_EMPTY_WAIT_TIME_US_MAX);
-		return SCAP_TIMEOUT;
+		return scap_modern_bpf__wait(engine);
 	}
 	else
 	{
@@ -72,6 +97,22 @@ static int32_t scap_modern_bpf__next(struct scap_engine_handle engine, scap_evt*
 	return SCAP_SUCCESS;
 }
 
+static int32_t scap_modern_bpf__next_batch(struct scap_engine_handle engine, scap_evt** pevents, uint16_t* buffer_ids,
+					   uint32_t* pflags, uint32_t max_events, uint32_t* pnevents)
+{
+	pman_consume_batch((void**)pevents, (int16_t*)buffer_ids, max_events, pnevents);
+
+	if(*pnevents == 0)
+	{
+		return scap_modern_bpf__wait(engine);
+	}
+
+	engine.m_handle->m_retry_us = BUFFER_EMPTY_WAIT_TIME_US_START;
+	/* We don't store the flags in the ring buffers. */
+	memset(pflags, 0, *pnevents * sizeof(uint32_t));
+	return SCAP_SUCCESS;
+}
+
 static int32_t scap_modern_bpf_start_dropping_mode(struct scap_engine_handle engine, uint32_t sampling_ratio)
 {
 	pman_set_sampling_ratio(sampling_ratio);
@@ -267,8 +308,14 @@ int32_t scap_modern_bpf__init(scap_t* handle, scap_open_args* oargs)
 		return SCAP_FAILURE;
 	}
 
+	pman_set_ringbuf_heap_merge(params->merge_mode == SCAP_RINGBUFFER_MERGE_HEAP);
+	pman_set_ringbuf_order_window(ringbuffer_order_window_ns(params->order_mode, params->order_window_ns));
+
 	/* Set an initial sleep time in case of timeouts. */
 	engine.m_handle->m_retry_us = BUFFER_EMPTY_WAIT_TIME_US_START;
+	engine.m_handle->m_wait_mode = params->wait_mode;
+	engine.m_handle->m_wait_latency_us = params->wait_latency_us;
+	engine.m_handle->m_wait_idle_us = params->wait_idle_us != 0 ? params->wait_idle_us : BUFFER_EMPTY_WAIT_TIME_US_MAX;
 
 	/* Load and attach */
 	ret = pman_open_probe();
@@ -290,6 +337,9 @@ int32_t scap_modern_bpf__init(scap_t* handle, scap_open_args* oargs)
 	}
 	pman_set_boot_time(boot_time);
 
+	/* Without notifications from the driver we would block until the timeout. */
+	pman_set_ringbuf_wakeup(engine.m_handle->m_wait_mode == SCAP_RINGBUFFER_WAIT_ADAPTIVE);
+
 	/* Calibrate the socket at init time */
 	if(calibrate_socket_file_ops(engine) != SCAP_SUCCESS)
 	{
@@ -386,4 +436,5 @@ struct scap_vtable scap_modern_bpf_engine = {
 	.get_max_buf_used = noop_get_max_buf_used,
 	.get_api_version = scap_modern_bpf__get_api_version,
 	.get_schema_version = scap_modern_bpf__get_schema_version,
+	.next_batch = scap_modern_bpf__next_batch,
 };
@@ -29,6 +29,9 @@ struct scap;
 struct modern_bpf_engine
 {
 	unsigned long m_retry_us; /* Microseconds to wait if all ring buffers are empty */
+	enum scap_ringbuffer_wait_mode m_wait_mode; /* How to wait if all ring buffers are empty */
+	uint64_t m_wait_latency_us; /* `SCAP_RINGBUFFER_WAIT_ADAPTIVE`: time to let new events accumulate after a wakeup */
+	uint64_t m_wait_idle_us; /* `SCAP_RINGBUFFER_WAIT_ADAPTIVE`: maximum time to block waiting for new events */
 	char* m_lasterr; /* Last error caught by the engine */
 	interesting_ppm_sc_set curr_sc_set; /* current ppm_sc */
 	uint64_t m_api_version;
@@ -107,5 +107,10 @@ struct savefile_engine
 	size_t m_reader_evt_buf_size;
 	uint32_t m_last_evt_dump_flags;
 	struct scap_platform* m_platform;
+	char* m_fname; ///< The name of the capture file, NULL if opened from a fd
+	int64_t m_events_pos; ///< The position of the first event block
+	idx_entry* m_index; ///< The index of the events, loaded on the first seek
+	uint32_t m_index_size;
+	bool m_index_loaded;
 };
 
@@ -48,6 +48,17 @@ typedef struct scap_reader
      */
     int (*read)(struct scap_reader *r, void* buf, uint32_t len);
 
+    /**
+     * @brief Optional, NULL if not supported by the implementation.
+     * Reads the next len bytes without copying them when possible,
+     * returning a pointer to them that stays valid until the next call to
+     * read_nocopy() or close(), whatever the other operations in between.
+     * The data can be modified through the pointer, without affecting the
+     * underlying source. On failure or if less than len bytes are left,
+     * returns NULL and nothing is read.
+     */
+    void* (*read_nocopy)(struct scap_reader *r, uint32_t len);
+
     /**
      * @brief Returns the current offset in the data being read.
      * On error, returns a negative value and error() can be used to
@@ -99,6 +110,31 @@ scap_reader_t *scap_reader_open_gzfile(gzFile file);
  */
 scap_reader_t *scap_reader_open_buffered(scap_reader_t* reader, uint32_t bufsize, bool own_reader);
 
+/**
+ * @brief Opens a reader mapping in memory the regular file referred by fd,
+ * starting from the current file offset. This supports read_nocopy().
+ * The file is mapped once: the data appended later (e.g. by a process still
+ * writing the capture) is copied from the file instead, so the pointers
+ * handed out are never unmapped before close(). As with any mapping, the file
+ * must not be truncated while it's read, or the accesses to the pages that
+ * were cut off raise SIGBUS: use the gzip reader for files that can shrink.
+ * Returns NULL if the file can't be mapped, or if it's gzip-compressed,
+ * without closing fd.
+ * @param own_fd if true, fd will be closed when the reader gets closed.
+ */
+scap_reader_t *scap_reader_open_mmap(int fd, bool own_fd);
+
+/**
+ * @brief Opens a reader for the capture file referred by fd, starting from the
+ * current file offset, if it has been written with SCAP_COMPRESSION_GZIP_BLOCKS.
+ * The blocks are decompressed by a helper thread ahead of the reads.
+ * Like the gzip reader, a read at the end of the file is retried on the next
+ * call, so that a file still being written can be followed.
+ * Returns NULL if the file doesn't start with a block, without closing fd.
+ * @param own_fd if true, fd will be closed when the reader gets closed.
+ */
+scap_reader_t *scap_reader_open_blocks(int fd, bool own_fd);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,577 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libscap/engine/savefile/scap_reader.h>
+
+#if defined(_WIN32) || !defined(USE_ZLIB)
+
+scap_reader_t *scap_reader_open_blocks(int fd, bool own_fd)
+{
+    return NULL;
+}
+
+#else
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <libscap/scap_savefile.h>
+
+// number of blocks decompressed ahead of the reads
+#define BLOCKS_READAHEAD 8
+
+// status of a block that is past the end of the file
+#define BLOCK_EOF (-1)
+
+// the file ends in the middle of the data being read
+#define BLOCK_PARTIAL (-2)
+
+typedef struct block
+{
+    uint8_t* m_data; ///< The decompressed data
+    uint32_t m_len; ///< The length of the decompressed data
+    uint32_t m_size; ///< The size of the data buffer
+    int64_t m_file_off; ///< The offset of the gzip member in the file
+    uint32_t m_member_size; ///< The size of the gzip member in the file
+    int m_status; ///< 0 if decompressed, BLOCK_EOF, or the errno of the failure
+} block_t;
+
+typedef struct reader_handle
+{
+    int m_fd; ///< The file being read
+    bool m_close_fd; ///< Whether the file should be closed
+    int64_t m_start_off; ///< The offset of the first gzip member in the file
+
+    // shared by the reader and the decompressing thread
+    pthread_t m_thread;
+    bool m_running; ///< Whether m_thread has been started and not joined yet
+    pthread_mutex_t m_mtx;
+    pthread_cond_t m_produced; ///< Signaled when a block is ready
+    pthread_cond_t m_consumed; ///< Signaled when a block is released, or on stop
+    bool m_stop;
+    bool m_eof_pending; ///< Whether a BLOCK_EOF block is waiting to be read
+    block_t m_blocks[BLOCKS_READAHEAD]; ///< Ring of the blocks read ahead
+    uint32_t m_head; ///< The first ready block
+    uint32_t m_nready; ///< The number of ready blocks
+
+    // owned by the decompressing thread while it runs
+    int64_t m_next_file_off; ///< The offset of the next gzip member to read
+    uint8_t* m_inbuf; ///< The compressed gzip member
+    uint32_t m_inbuf_size;
+    z_stream m_stream;
+
+    // owned by the reader
+    block_t* m_cur; ///< The block being read, if any
+    uint64_t m_cur_uoff; ///< The uncompressed offset of the head block
+    uint64_t m_pos; ///< The position past m_cur_uoff
+    int64_t m_offset; ///< The file offset up to which the data has been consumed
+    int m_errnum; ///< The errno of the last failed operation, 0 if none
+} reader_handle_t;
+
+static bool blocks_is_header(const gzip_block_header* gh)
+{
+    return gh->id1 == 0x1f && gh->id2 == 0x8b && gh->cm == Z_DEFLATED &&
+        (gh->flg & 0x04) && gh->xlen == 8 &&
+        gh->si1 == SCAP_GZIP_BLOCK_SI1 && gh->si2 == SCAP_GZIP_BLOCK_SI2 &&
+        gh->slen == sizeof(gh->member_size) &&
+        gh->member_size >= sizeof(gzip_block_header) + 2 * sizeof(uint32_t);
+}
+
+//
+// Read exactly len bytes at off. Returns 0 on success, BLOCK_EOF if the file
+// ends before off, BLOCK_PARTIAL if it ends before off + len, or an errno.
+//
+static int blocks_pread(int fd, void* buf, size_t len, int64_t off)
+{
+    uint8_t* p = (uint8_t*) buf;
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = pread(fd, p + done, len - done, off + done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno;
+        }
+        if (n == 0)
+        {
+            return done == 0 ? BLOCK_EOF : BLOCK_PARTIAL;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+static int blocks_grow(uint8_t** buf, uint32_t* size, uint32_t len)
+{
+    if (len <= *size)
+    {
+        return 0;
+    }
+    uint8_t* tmp = (uint8_t*) realloc(*buf, len);
+    if (tmp == NULL)
+    {
+        return ENOMEM;
+    }
+    *buf = tmp;
+    *size = len;
+    return 0;
+}
+
+//
+// Read and decompress the gzip member at off into b. A member that is not
+// complete yet is reported as BLOCK_EOF, since the file may still be written.
+//
+static int blocks_decompress(reader_handle_t* h, block_t* b, int64_t off)
+{
+    gzip_block_header gh;
+    uint32_t trailer[2];
+    int res;
+
+    b->m_file_off = off;
+    b->m_len = 0;
+    res = blocks_pread(h->m_fd, &gh, sizeof(gh), off);
+    if (res != 0)
+    {
+        return res == BLOCK_PARTIAL ? BLOCK_EOF : res;
+    }
+    if (!blocks_is_header(&gh))
+    {
+        return EINVAL;
+    }
+    b->m_member_size = gh.member_size;
+
+    res = blocks_grow(&h->m_inbuf, &h->m_inbuf_size, gh.member_size);
+    if (res != 0)
+    {
+        return res;
+    }
+    res = blocks_pread(h->m_fd, h->m_inbuf, gh.member_size, off);
+    if (res != 0)
+    {
+        return res == BLOCK_PARTIAL ? BLOCK_EOF : res;
+    }
+    memcpy(trailer, h->m_inbuf + gh.member_size - sizeof(trailer), sizeof(trailer));
+
+    res = blocks_grow(&b->m_data, &b->m_size, trailer[1]);
+    if (res != 0)
+    {
+        return res;
+    }
+
+    z_stream* zs = &h->m_stream;
+    if (inflateReset(zs) != Z_OK)
+    {
+        return EINVAL;
+    }
+    zs->next_in = h->m_inbuf + sizeof(gh);
+    zs->avail_in = gh.member_size - sizeof(gh) - sizeof(trailer);
+    zs->next_out = b->m_data;
+    zs->avail_out = trailer[1];
+    if (inflate(zs, Z_FINISH) != Z_STREAM_END || zs->total_out != trailer[1] ||
+        crc32(0, b->m_data, trailer[1]) != trailer[0])
+    {
+        return EINVAL;
+    }
+
+    b->m_len = trailer[1];
+    return 0;
+}
+
+//
+// Decompress the members ahead of the reader. After reaching the end of the
+// file, the member is read again once the reader has seen the end, like the
+// gzip reader does, so that a file that is still being written can be
+// followed. Failures are final.
+//
+static void* blocks_decompress_ahead(void* arg)
+{
+    reader_handle_t* h = (reader_handle_t*) arg;
+    bool failed = false;
+
+    pthread_mutex_lock(&h->m_mtx);
+    while (!h->m_stop)
+    {
+        if (failed || h->m_eof_pending || h->m_nready == BLOCKS_READAHEAD)
+        {
+            pthread_cond_wait(&h->m_consumed, &h->m_mtx);
+            continue;
+        }
+
+        // the block past the ready ones is not touched by the reader
+        block_t* b = &h->m_blocks[(h->m_head + h->m_nready) % BLOCKS_READAHEAD];
+        pthread_mutex_unlock(&h->m_mtx);
+        b->m_status = blocks_decompress(h, b, h->m_next_file_off);
+        pthread_mutex_lock(&h->m_mtx);
+
+        if (b->m_status == 0)
+        {
+            h->m_next_file_off += b->m_member_size;
+        }
+        else if (b->m_status == BLOCK_EOF)
+        {
+            h->m_eof_pending = true;
+        }
+        else
+        {
+            failed = true;
+        }
+        h->m_nready++;
+        pthread_cond_signal(&h->m_produced);
+    }
+    pthread_mutex_unlock(&h->m_mtx);
+    return NULL;
+}
+
+static bool blocks_start(reader_handle_t* h, int64_t file_off)
+{
+    h->m_stop = false;
+    h->m_eof_pending = false;
+    h->m_head = 0;
+    h->m_nready = 0;
+    h->m_next_file_off = file_off;
+    h->m_cur = NULL;
+    h->m_errnum = pthread_create(&h->m_thread, NULL, blocks_decompress_ahead, h);
+    h->m_running = h->m_errnum == 0;
+    return h->m_running;
+}
+
+static void blocks_stop(reader_handle_t* h)
+{
+    if (!h->m_running)
+    {
+        return;
+    }
+    pthread_mutex_lock(&h->m_mtx);
+    h->m_stop = true;
+    pthread_cond_signal(&h->m_consumed);
+    pthread_mutex_unlock(&h->m_mtx);
+    pthread_join(h->m_thread, NULL);
+    h->m_running = false;
+}
+
+//
+// Return the block that contains the reading position, waiting for it to be
+// decompressed, or NULL at the end of the file or on error
+//
+static block_t* blocks_current(reader_handle_t* h)
+{
+    block_t* b = h->m_cur;
+    if (b != NULL && h->m_pos < b->m_len)
+    {
+        return b;
+    }
+
+    // a failed seek couldn't restart the decompressing thread
+    if (!h->m_running)
+    {
+        if (h->m_errnum == 0)
+        {
+            h->m_errnum = ECHILD;
+        }
+        return NULL;
+    }
+
+    pthread_mutex_lock(&h->m_mtx);
+    while (true)
+    {
+        if (b != NULL)
+        {
+            h->m_pos -= b->m_len;
+            h->m_cur_uoff += b->m_len;
+            h->m_head = (h->m_head + 1) % BLOCKS_READAHEAD;
+            h->m_nready--;
+            h->m_cur = NULL;
+            pthread_cond_signal(&h->m_consumed);
+        }
+
+        while (h->m_nready == 0)
+        {
+            pthread_cond_wait(&h->m_produced, &h->m_mtx);
+        }
+
+        // the end of the file is released to read it again at the next
+        // call, failed blocks are never released so that the next reads
+        // fail too
+        b = &h->m_blocks[h->m_head];
+        if (b->m_status == BLOCK_EOF)
+        {
+            h->m_head = (h->m_head + 1) % BLOCKS_READAHEAD;
+            h->m_nready--;
+            h->m_eof_pending = false;
+            pthread_cond_signal(&h->m_consumed);
+            h->m_errnum = 0;
+            b = NULL;
+            break;
+        }
+        if (b->m_status != 0)
+        {
+            h->m_errnum = b->m_status;
+            b = NULL;
+            break;
+        }
+
+        h->m_cur = b;
+        h->m_offset = b->m_file_off + b->m_member_size;
+        if (h->m_pos < b->m_len)
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&h->m_mtx);
+    return b;
+}
+
+static int blocks_read(scap_reader_t *r, void* buf, uint32_t len)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    uint8_t* p = (uint8_t*) buf;
+    uint32_t done = 0;
+
+    while (done < len)
+    {
+        block_t* b = blocks_current(h);
+        if (b == NULL)
+        {
+            break;
+        }
+
+        uint32_t n = b->m_len - (uint32_t) h->m_pos;
+        if (n > len - done)
+        {
+            n = len - done;
+        }
+        memcpy(p + done, b->m_data + h->m_pos, n);
+        h->m_pos += n;
+        done += n;
+    }
+
+    return done > 0 || h->m_errnum == 0 ? (int) done : -1;
+}
+
+static int64_t blocks_offset(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    return ((reader_handle_t*) r->handle)->m_offset;
+}
+
+static int64_t blocks_tell(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    return (int64_t) (h->m_cur_uoff + h->m_pos);
+}
+
+//
+// Find the gzip member containing the uncompressed offset target using the
+// headers and trailers of the members only. Returns BLOCK_EOF if the target
+// is past the end, with file_off and uoff at the end, or an errno.
+//
+static int blocks_find(reader_handle_t* h, uint64_t target, int64_t* file_off, uint64_t* uoff)
+{
+    gzip_block_header gh;
+    uint32_t isize;
+    int res;
+
+    *file_off = h->m_start_off;
+    *uoff = 0;
+    while (true)
+    {
+        res = blocks_pread(h->m_fd, &gh, sizeof(gh), *file_off);
+        if (res != 0)
+        {
+            return res == BLOCK_PARTIAL ? EIO : res;
+        }
+        if (!blocks_is_header(&gh))
+        {
+            return EINVAL;
+        }
+        res = blocks_pread(h->m_fd, &isize, sizeof(isize), *file_off + gh.member_size - sizeof(isize));
+        if (res != 0)
+        {
+            return res < 0 ? EIO : res;
+        }
+        if (target < *uoff + isize)
+        {
+            return 0;
+        }
+        *file_off += gh.member_size;
+        *uoff += isize;
+    }
+}
+
+static int64_t blocks_seek(scap_reader_t *r, int64_t offset, int whence)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int64_t file_off;
+    uint64_t uoff;
+    int res;
+
+    if (whence == SEEK_CUR)
+    {
+        offset += blocks_tell(r);
+    }
+    else if (whence == SEEK_END)
+    {
+        res = blocks_find(h, UINT64_MAX, &file_off, &uoff);
+        if (res != BLOCK_EOF)
+        {
+            h->m_errnum = res;
+            return -1;
+        }
+        offset += uoff;
+    }
+    else if (whence != SEEK_SET)
+    {
+        h->m_errnum = EINVAL;
+        return -1;
+    }
+    if (offset < 0)
+    {
+        h->m_errnum = EINVAL;
+        return -1;
+    }
+
+    // moving inside the current block needs no decompression
+    if (h->m_cur != NULL && (uint64_t) offset >= h->m_cur_uoff &&
+        (uint64_t) offset < h->m_cur_uoff + h->m_cur->m_len)
+    {
+        h->m_pos = offset - h->m_cur_uoff;
+        return offset;
+    }
+
+    blocks_stop(h);
+
+    res = blocks_find(h, offset, &file_off, &uoff);
+    if (res > 0)
+    {
+        h->m_errnum = res;
+        offset = -1;
+    }
+    else if (res == BLOCK_EOF && (uint64_t) offset > uoff)
+    {
+        h->m_errnum = EINVAL;
+        offset = -1;
+    }
+    if (offset < 0)
+    {
+        // stay at the beginning of the file
+        file_off = h->m_start_off;
+        uoff = 0;
+    }
+
+    h->m_cur_uoff = uoff;
+    h->m_pos = offset < 0 ? 0 : offset - uoff;
+    h->m_offset = file_off;
+    int errnum = h->m_errnum;
+    if (!blocks_start(h, file_off))
+    {
+        return -1;
+    }
+    h->m_errnum = errnum;
+    return offset;
+}
+
+static const char* blocks_error(scap_reader_t *r, int *errnum)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    *errnum = h->m_errnum;
+    return h->m_errnum != 0 ? strerror(h->m_errnum) : "";
+}
+
+static void blocks_free(reader_handle_t* h)
+{
+    for (int i = 0; i < BLOCKS_READAHEAD; i++)
+    {
+        free(h->m_blocks[i].m_data);
+    }
+    free(h->m_inbuf);
+    inflateEnd(&h->m_stream);
+    pthread_cond_destroy(&h->m_consumed);
+    pthread_cond_destroy(&h->m_produced);
+    pthread_mutex_destroy(&h->m_mtx);
+    free(h);
+}
+
+static int blocks_close(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int res = 0;
+    blocks_stop(h);
+    if (h->m_close_fd)
+    {
+        res = close(h->m_fd);
+    }
+    blocks_free(h);
+    free(r);
+    return res;
+}
+
+scap_reader_t *scap_reader_open_blocks(int fd, bool own_fd)
+{
+    gzip_block_header gh;
+    int64_t start = fd < 0 ? -1 : lseek(fd, 0, SEEK_CUR);
+    if (start < 0 || blocks_pread(fd, &gh, sizeof(gh), start) != 0 || !blocks_is_header(&gh))
+    {
+        return NULL;
+    }
+
+    reader_handle_t* h = (reader_handle_t *) calloc (1, sizeof (reader_handle_t));
+    if (h == NULL)
+    {
+        return NULL;
+    }
+    if (inflateInit2(&h->m_stream, -MAX_WBITS) != Z_OK)
+    {
+        free(h);
+        return NULL;
+    }
+    pthread_mutex_init(&h->m_mtx, NULL);
+    pthread_cond_init(&h->m_produced, NULL);
+    pthread_cond_init(&h->m_consumed, NULL);
+    h->m_fd = fd;
+    h->m_close_fd = own_fd;
+    h->m_start_off = start;
+    h->m_offset = start;
+    if (!blocks_start(h, start))
+    {
+        blocks_free(h);
+        return NULL;
+    }
+
+    scap_reader_t* r = (scap_reader_t *) malloc (sizeof (scap_reader_t));
+    r->handle = h;
+    r->read = &blocks_read;
+    r->read_nocopy = NULL;
+    r->offset = &blocks_offset;
+    r->tell = &blocks_tell;
+    r->seek = &blocks_seek;
+    r->error = &blocks_error;
+    r->close = &blocks_close;
+    return r;
+}
+
+#endif // _WIN32
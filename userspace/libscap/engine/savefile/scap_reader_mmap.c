@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libscap/engine/savefile/scap_reader.h>
+
+#ifdef _WIN32
+
+scap_reader_t *scap_reader_open_mmap(int fd, bool own_fd)
+{
+    return NULL;
+}
+
+#else
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// the kernel is asked to read ahead this much data past the cursor
+#define MMAP_READAHEAD_SIZE (8 * 1024 * 1024)
+
+typedef struct reader_handle
+{
+    int m_fd; ///< The mapped file
+    bool m_close_fd; ///< Whether the file should be closed
+    uint8_t* m_data; ///< The mapping of the file as it was when opened
+    size_t m_size; ///< The size of the mapping
+    size_t m_file_size; ///< The last known size of the file, at least m_size
+    size_t m_pos; ///< The cursor position in the file
+    size_t m_readahead_pos; ///< The end of the range the kernel was asked to read ahead
+    uint8_t* m_buf; ///< The data handed out by read_nocopy() past the mapping
+    uint32_t m_buf_size; ///< The size of m_buf
+    int m_errnum; ///< The errno of the last failed operation, 0 if none
+} reader_handle_t;
+
+//
+// Check whether the file has grown since its size was last known (e.g. when
+// tailing a capture being written by another process). The file is never
+// remapped, so that the events handed out in place stay valid: the data
+// appended after the mapping is read from the file instead.
+//
+static bool mmap_grow(reader_handle_t* h, size_t len)
+{
+    if (h->m_file_size - h->m_pos >= len)
+    {
+        return true;
+    }
+
+    struct stat st;
+    if (fstat(h->m_fd, &st) != 0)
+    {
+        h->m_errnum = errno;
+        return false;
+    }
+    if ((uint64_t) st.st_size > h->m_file_size && (uint64_t) st.st_size <= SIZE_MAX)
+    {
+        h->m_file_size = (size_t) st.st_size;
+    }
+    return h->m_file_size - h->m_pos >= len;
+}
+
+//
+// Copy len bytes at the cursor, from the mapping and then from the file past
+// it. Returns the number of bytes copied, less than len if the file is
+// shorter than expected.
+//
+static size_t mmap_copy(reader_handle_t* h, uint8_t* buf, size_t len)
+{
+    size_t done = 0;
+    if (h->m_pos < h->m_size)
+    {
+        done = h->m_size - h->m_pos < len ? h->m_size - h->m_pos : len;
+        memcpy(buf, h->m_data + h->m_pos, done);
+    }
+    while (done < len)
+    {
+        ssize_t n = pread(h->m_fd, buf + done, len - done, (off_t) (h->m_pos + done));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            h->m_errnum = errno;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        done += (size_t) n;
+    }
+    return done;
+}
+
+static void mmap_readahead(reader_handle_t* h)
+{
+    // ask for the next chunk once half of the previous one has been read
+    if (h->m_pos + MMAP_READAHEAD_SIZE / 2 < h->m_readahead_pos || h->m_readahead_pos >= h->m_size)
+    {
+        return;
+    }
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t start = h->m_readahead_pos > h->m_pos ? h->m_readahead_pos : h->m_pos;
+    start -= start % page_size;
+    size_t end = h->m_pos + MMAP_READAHEAD_SIZE;
+    if (end > h->m_size)
+    {
+        end = h->m_size;
+    }
+    madvise(h->m_data + start, end - start, MADV_WILLNEED);
+    h->m_readahead_pos = end;
+}
+
+static int mmap_read(scap_reader_t *r, void* buf, uint32_t len)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if (!mmap_grow(h, len))
+    {
+        len = (uint32_t) (h->m_file_size - h->m_pos);
+    }
+    if (h->m_pos > h->m_size || h->m_size - h->m_pos < len)
+    {
+        len = (uint32_t) mmap_copy(h, (uint8_t*) buf, len);
+    }
+    else
+    {
+        memcpy(buf, h->m_data + h->m_pos, len);
+    }
+    h->m_pos += len;
+    mmap_readahead(h);
+    return (int) len;
+}
+
+static void* mmap_read_nocopy(scap_reader_t *r, uint32_t len)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if (h->m_pos <= h->m_size && h->m_size - h->m_pos >= len)
+    {
+        void* ret = h->m_data + h->m_pos;
+        h->m_pos += len;
+        mmap_readahead(h);
+        return ret;
+    }
+
+    // past the mapping, the data is copied in the handle
+    if (!mmap_grow(h, len))
+    {
+        return NULL;
+    }
+    if (len > h->m_buf_size)
+    {
+        uint8_t* buf = (uint8_t*) realloc(h->m_buf, len);
+        if (buf == NULL)
+        {
+            h->m_errnum = ENOMEM;
+            return NULL;
+        }
+        h->m_buf = buf;
+        h->m_buf_size = len;
+    }
+    if (mmap_copy(h, h->m_buf, len) != len)
+    {
+        return NULL;
+    }
+    h->m_pos += len;
+    return h->m_buf;
+}
+
+static int64_t mmap_offset(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    return (int64_t) ((reader_handle_t*) r->handle)->m_pos;
+}
+
+static int64_t mmap_tell(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    return (int64_t) ((reader_handle_t*) r->handle)->m_pos;
+}
+
+static int64_t mmap_seek(scap_reader_t *r, int64_t offset, int whence)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int64_t pos;
+    switch (whence)
+    {
+    case SEEK_SET:
+        pos = offset;
+        break;
+    case SEEK_CUR:
+        pos = (int64_t) h->m_pos + offset;
+        break;
+    case SEEK_END:
+        mmap_grow(h, SIZE_MAX);
+        pos = (int64_t) h->m_file_size + offset;
+        break;
+    default:
+        h->m_errnum = EINVAL;
+        return -1;
+    }
+
+    if (pos < 0 || (pos > (int64_t) h->m_file_size && !mmap_grow(h, (size_t) pos - h->m_pos)))
+    {
+        h->m_errnum = EINVAL;
+        return -1;
+    }
+    h->m_pos = (size_t) pos;
+    h->m_readahead_pos = h->m_pos;
+    mmap_readahead(h);
+    return pos;
+}
+
+static const char* mmap_error(scap_reader_t *r, int *errnum)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    *errnum = h->m_errnum;
+    return h->m_errnum != 0 ? strerror(h->m_errnum) : "";
+}
+
+static int mmap_close(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int res = munmap(h->m_data, h->m_size);
+    free(h->m_buf);
+    if (h->m_close_fd)
+    {
+        res = close(h->m_fd) != 0 ? -1 : res;
+    }
+    free(h);
+    free(r);
+    return res;
+}
+
+scap_reader_t *scap_reader_open_mmap(int fd, bool own_fd)
+{
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_size < 2 || (uint64_t) st.st_size > SIZE_MAX)
+    {
+        return NULL;
+    }
+
+    // the reading starts from the current position, like for the other readers
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0 || pos > st.st_size)
+    {
+        return NULL;
+    }
+
+    // private and writable, so that the events handed out in place can
+    // still be modified by the consumers without touching the file
+    void* data = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    // compressed files must be read through the gzip reader
+    const uint8_t* bytes = (const uint8_t*) data;
+    if (bytes[0] == 0x1f && bytes[1] == 0x8b)
+    {
+        munmap(data, (size_t) st.st_size);
+        return NULL;
+    }
+    madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+    reader_handle_t* h = (reader_handle_t *) calloc (1, sizeof (reader_handle_t));
+    h->m_fd = fd;
+    h->m_close_fd = own_fd;
+    h->m_data = (uint8_t*) data;
+    h->m_size = (size_t) st.st_size;
+    h->m_file_size = h->m_size;
+    h->m_pos = (size_t) pos;
+    h->m_readahead_pos = h->m_pos;
+    mmap_readahead(h);
+
+    scap_reader_t* r = (scap_reader_t *) malloc (sizeof (scap_reader_t));
+    r->handle = h;
+    r->read = &mmap_read;
+    r->read_nocopy = &mmap_read_nocopy;
+    r->offset = &mmap_offset;
+    r->tell = &mmap_tell;
+    r->seek = &mmap_seek;
+    r->error = &mmap_error;
+    r->close = &mmap_close;
+    return r;
+}
+
+#endif // _WIN32
@@ -19,9 +19,12 @@ limitations under the License.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
 #ifndef _WIN32
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/uio.h>
 #else
 struct iovec {
@@ -36,6 +39,7 @@ struct iovec {
 #include <libscap/scap-int.h>
 #include <libscap/scap_platform.h>
 #include <libscap/scap_savefile.h>
+#include <libscap/scap_savefile_api.h>
 #include <libscap/engine/savefile/savefile_platform.h>
 #include <libscap/engine/savefile/scap_reader.h>
 #include <libscap/engine/noop/noop.h>
@@ -1856,6 +1860,8 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 	size_t readsize;
 	uint32_t readlen;
 	size_t hdr_len;
+	char* evt_buf;
+	bool is_v2;
 	scap_reader_t* r = handle->m_reader;
 
 	ASSERT(r != NULL);
@@ -1898,6 +1904,21 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 			}
 		}
 
+		if(bh.block_type == IDX_BLOCK_TYPE)
+		{
+			//
+			// The index is loaded only when seeking, skip it
+			//
+			if(bh.block_total_length < sizeof(bh) + 4 ||
+			   r->seek(r, bh.block_total_length - sizeof(bh), SEEK_CUR) < 0)
+			{
+				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "corrupted input file. Can't skip index block of size %u.",
+					 bh.block_total_length);
+				return SCAP_FAILURE;
+			}
+			continue;
+		}
+
 		if(bh.block_type != EV_BLOCK_TYPE &&
 		   bh.block_type != EV_BLOCK_TYPE_V2 &&
 		   bh.block_type != EV_BLOCK_TYPE_V2_LARGE &&
@@ -1911,11 +1932,13 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 			return SCAP_UNEXPECTED_BLOCK;
 		}
 
+		is_v2 = bh.block_type == EV_BLOCK_TYPE_V2 ||
+			bh.block_type == EV_BLOCK_TYPE_V2_LARGE ||
+			bh.block_type == EVF_BLOCK_TYPE_V2 ||
+			bh.block_type == EVF_BLOCK_TYPE_V2_LARGE;
+
 		hdr_len = sizeof(struct ppm_evt_hdr);
-		if(bh.block_type != EV_BLOCK_TYPE_V2 &&
-		   bh.block_type != EV_BLOCK_TYPE_V2_LARGE &&
-		   bh.block_type != EVF_BLOCK_TYPE_V2 &&
-		   bh.block_type != EVF_BLOCK_TYPE_V2_LARGE)
+		if(!is_v2)
 		{
 			hdr_len -= 4;
 		}
@@ -1938,38 +1961,59 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 					 READER_BUF_SIZE);
 				return SCAP_FAILURE;
 			}
-		} else if (readlen > handle->m_reader_evt_buf_size) {
-			// Try to allocate a buffer large enough
-			char *tmp = realloc(handle->m_reader_evt_buf, readlen);
-			if (!tmp) {
-				free(handle->m_reader_evt_buf);
-				handle->m_reader_evt_buf = NULL;
-				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "event block length %u greater than read buffer size %zu",
-					 readlen,
-					 handle->m_reader_evt_buf_size);
+		}
+
+		if(is_v2 && r->read_nocopy != NULL)
+		{
+			//
+			// The reader can hand out the event in place, without copying it.
+			// Old events need the read buffer instead, to be converted.
+			//
+			evt_buf = r->read_nocopy(r, readlen);
+			if(evt_buf == NULL)
+			{
+				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "expecting %u bytes for the event block. Is the file truncated?",
+					 readlen);
 				return SCAP_FAILURE;
 			}
-			handle->m_reader_evt_buf = tmp;
-			handle->m_reader_evt_buf_size = readlen;
 		}
+		else
+		{
+			if ((bh.block_type == EV_BLOCK_TYPE_V2_LARGE || bh.block_type == EVF_BLOCK_TYPE_V2_LARGE) &&
+			    readlen > handle->m_reader_evt_buf_size) {
+				// Try to allocate a buffer large enough
+				char *tmp = realloc(handle->m_reader_evt_buf, readlen);
+				if (!tmp) {
+					free(handle->m_reader_evt_buf);
+					handle->m_reader_evt_buf = NULL;
+					snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "event block length %u greater than read buffer size %zu",
+						 readlen,
+						 handle->m_reader_evt_buf_size);
+					return SCAP_FAILURE;
+				}
+				handle->m_reader_evt_buf = tmp;
+				handle->m_reader_evt_buf_size = readlen;
+			}
 
-		readsize = r->read(r, handle->m_reader_evt_buf, readlen);
-		CHECK_READ_SIZE(readsize, readlen);
+			readsize = r->read(r, handle->m_reader_evt_buf, readlen);
+			CHECK_READ_SIZE(readsize, readlen);
+			evt_buf = handle->m_reader_evt_buf;
+		}
 
 		//
 		// EVF_BLOCK_TYPE has 32 bits of flags
 		//
-		*pdevid = *(uint16_t *)handle->m_reader_evt_buf;
+		*pdevid = *(uint16_t *)evt_buf;
 
 		if(bh.block_type == EVF_BLOCK_TYPE || bh.block_type == EVF_BLOCK_TYPE_V2 || bh.block_type == EVF_BLOCK_TYPE_V2_LARGE)
 		{
-			memcpy(pflags, handle->m_reader_evt_buf + sizeof(uint16_t), sizeof(uint32_t));
-			*pevent = (struct ppm_evt_hdr *)(handle->m_reader_evt_buf + sizeof(uint16_t) + sizeof(uint32_t));
+			memcpy(pflags, evt_buf + sizeof(uint16_t), sizeof(uint32_t));
+			*pevent = (struct ppm_evt_hdr *)(evt_buf + sizeof(uint16_t) + sizeof(uint32_t));
 		}
 		else
 		{
 			*pflags = 0;
-			*pevent = (struct ppm_evt_hdr *)(handle->m_reader_evt_buf + sizeof(uint16_t));
+			*pevent = (struct ppm_evt_hdr *)(evt_buf + sizeof(uint16_t));
 		}
 
 		if((*pevent)->type >= PPM_EVENT_MAX)
@@ -1981,10 +2025,7 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 			continue;
 		}
 
-		if(bh.block_type != EV_BLOCK_TYPE_V2 &&
-		   bh.block_type != EV_BLOCK_TYPE_V2_LARGE &&
-		   bh.block_type != EVF_BLOCK_TYPE_V2 &&
-		   bh.block_type != EVF_BLOCK_TYPE_V2_LARGE)
+		if(!is_v2)
 		{
 			//
 			// We're reading an old capture whose events don't have nparams in the header.
@@ -2000,7 +2041,7 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 
 			memmove((char *)*pevent + sizeof(struct ppm_evt_hdr),
 				(char *)*pevent + sizeof(struct ppm_evt_hdr) - sizeof(uint32_t),
-				readlen - ((char *)*pevent - handle->m_reader_evt_buf) - (sizeof(struct ppm_evt_hdr) - sizeof(uint32_t)));
+				readlen - ((char *)*pevent - evt_buf) - (sizeof(struct ppm_evt_hdr) - sizeof(uint32_t)));
 			(*pevent)->len += sizeof(uint32_t);
 
 			// In old captures, the length of PPME_NOTIFICATION_E and PPME_INFRASTRUCTURE_EVENT_E
@@ -2069,6 +2110,334 @@ void scap_savefile_fseek(struct scap_engine_handle engine, uint64_t off)
 	reader->seek(reader, off, SEEK_SET);
 }
 
+//
+// Return the position of the next block to be read
+//
+static int64_t block_pos(struct savefile_engine* handle)
+{
+	int64_t pos = handle->m_reader->tell(handle->m_reader);
+	return handle->m_use_last_block_header ? pos - (int64_t)sizeof(block_header) : pos;
+}
+
+static int32_t seek_block(struct savefile_engine* handle, int64_t pos)
+{
+	handle->m_use_last_block_header = false;
+	if(handle->m_reader->seek(handle->m_reader, pos, SEEK_SET) != pos)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "can't seek to position %" PRId64, pos);
+		return SCAP_FAILURE;
+	}
+	return SCAP_SUCCESS;
+}
+
+//
+// Read the index block at the end of r, if any
+//
+static bool read_index_block(scap_reader_t* r, idx_entry** entries, uint32_t* n_entries)
+{
+	block_header bh;
+	uint32_t bt;
+	uint32_t entries_len;
+
+	if(r->seek(r, -(int64_t)sizeof(bt), SEEK_END) < 0 ||
+	   r->read(r, &bt, sizeof(bt)) != sizeof(bt) ||
+	   bt < sizeof(bh) + sizeof(bt) ||
+	   r->seek(r, -(int64_t)bt, SEEK_END) < 0 ||
+	   r->read(r, &bh, sizeof(bh)) != sizeof(bh) ||
+	   bh.block_type != IDX_BLOCK_TYPE || bh.block_total_length != bt)
+	{
+		return false;
+	}
+
+	entries_len = bt - sizeof(bh) - sizeof(bt);
+	if(entries_len % sizeof(idx_entry) != 0 || entries_len == 0)
+	{
+		return false;
+	}
+
+	*entries = (idx_entry*)malloc(entries_len);
+	if(*entries == NULL)
+	{
+		return false;
+	}
+
+	if(r->read(r, *entries, entries_len) != (int)entries_len)
+	{
+		free(*entries);
+		*entries = NULL;
+		return false;
+	}
+
+	*n_entries = entries_len / sizeof(idx_entry);
+	return true;
+}
+
+#ifndef _WIN32
+static char* sidecar_name(struct savefile_engine* handle)
+{
+	size_t len = strlen(handle->m_fname) + sizeof(SCAP_INDEX_SIDECAR_SUFFIX);
+	char* name = (char*)malloc(len);
+	if(name != NULL)
+	{
+		snprintf(name, len, "%s%s", handle->m_fname, SCAP_INDEX_SIDECAR_SUFFIX);
+	}
+	return name;
+}
+
+//
+// Read the index from the sidecar file of the capture, if it's up to date
+//
+static bool read_index_sidecar(struct savefile_engine* handle)
+{
+	struct stat capture_st, sidecar_st;
+	bool res = false;
+	char* name = sidecar_name(handle);
+	if(name == NULL)
+	{
+		return false;
+	}
+
+	int fd = open(name, O_RDONLY);
+	if(fd >= 0 &&
+	   stat(handle->m_fname, &capture_st) == 0 &&
+	   fstat(fd, &sidecar_st) == 0 &&
+	   sidecar_st.st_mtime >= capture_st.st_mtime)
+	{
+		scap_reader_t* r = scap_reader_open_mmap(fd, true);
+		if(r != NULL)
+		{
+			fd = -1;
+			res = read_index_block(r, &handle->m_index, &handle->m_index_size);
+			r->close(r);
+		}
+	}
+
+	if(fd >= 0)
+	{
+		close(fd);
+	}
+	free(name);
+	return res;
+}
+
+//
+// Save the index in a sidecar file of the capture. This is best-effort,
+// because the capture can be in a read-only location.
+//
+static void write_index_sidecar(struct savefile_engine* handle)
+{
+	block_header bh;
+	uint32_t bt;
+	char* name = sidecar_name(handle);
+	if(name == NULL)
+	{
+		return;
+	}
+
+	bh.block_type = IDX_BLOCK_TYPE;
+	bh.block_total_length = sizeof(bh) + handle->m_index_size * sizeof(idx_entry) + sizeof(bt);
+	bt = bh.block_total_length;
+
+	FILE* f = fopen(name, "wb");
+	if(f != NULL)
+	{
+		bool ok = fwrite(&bh, sizeof(bh), 1, f) == 1 &&
+			fwrite(handle->m_index, sizeof(idx_entry), handle->m_index_size, f) == handle->m_index_size &&
+			fwrite(&bt, sizeof(bt), 1, f) == 1;
+		if(fclose(f) != 0 || !ok)
+		{
+			remove(name);
+		}
+	}
+	free(name);
+}
+#endif
+
+//
+// Read the whole capture to index its events
+//
+static int32_t build_index(struct scap_engine_handle engine)
+{
+	struct savefile_engine* handle = engine.m_handle;
+	scap_reader_t* r = handle->m_reader;
+	uint32_t capacity = 0;
+	uint64_t evtnum = 0;
+	uint64_t max_ts = 0;
+	scap_evt* pevent;
+	uint16_t devid;
+	uint32_t flags;
+	int32_t res;
+
+	if(seek_block(handle, handle->m_events_pos) != SCAP_SUCCESS)
+	{
+		return SCAP_FAILURE;
+	}
+
+	while(true)
+	{
+		int64_t pos = r->tell(r);
+		res = next(engine, &pevent, &devid, &flags);
+		if(res != SCAP_SUCCESS)
+		{
+			break;
+		}
+
+		if(evtnum % SCAP_INDEX_INTERVAL_DEFAULT == 0)
+		{
+			if(handle->m_index_size == capacity)
+			{
+				capacity = capacity == 0 ? 1024 : capacity * 2;
+				idx_entry* entries = (idx_entry*)realloc(handle->m_index, capacity * sizeof(idx_entry));
+				if(entries == NULL)
+				{
+					snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "index memory allocation failure");
+					return SCAP_FAILURE;
+				}
+				handle->m_index = entries;
+			}
+
+			handle->m_index[handle->m_index_size].ts = max_ts;
+			handle->m_index[handle->m_index_size].pos = pos;
+			handle->m_index[handle->m_index_size].evtnum = evtnum;
+			handle->m_index_size++;
+		}
+		if(pevent->ts > max_ts)
+		{
+			max_ts = pevent->ts;
+		}
+		evtnum++;
+	}
+
+	// a section ends at an unexpected block in merged captures
+	return res == SCAP_FAILURE ? SCAP_FAILURE : SCAP_SUCCESS;
+}
+
+//
+// Load the index at the end of the capture, or the one in its sidecar file.
+// If there is none, build it reading the capture, and try to save it in the
+// sidecar file.
+//
+static int32_t load_index(struct scap_engine_handle engine)
+{
+	struct savefile_engine* handle = engine.m_handle;
+
+	if(handle->m_index_loaded)
+	{
+		return SCAP_SUCCESS;
+	}
+
+	if(!read_index_block(handle->m_reader, &handle->m_index, &handle->m_index_size)
+#ifndef _WIN32
+	   && (handle->m_fname == NULL || !read_index_sidecar(handle))
+#endif
+	  )
+	{
+		if(build_index(engine) != SCAP_SUCCESS)
+		{
+			free(handle->m_index);
+			handle->m_index = NULL;
+			handle->m_index_size = 0;
+			return SCAP_FAILURE;
+		}
+#ifndef _WIN32
+		if(handle->m_fname != NULL && handle->m_index_size > 0)
+		{
+			write_index_sidecar(handle);
+		}
+#endif
+	}
+
+	handle->m_index_loaded = true;
+	return SCAP_SUCCESS;
+}
+
+//
+// Move to the first event with a timestamp, or number, not lower than the
+// given one, starting from the closest entry of the index before it
+//
+static int32_t seek_event(struct scap_engine_handle engine, bool by_ts, uint64_t target, uint64_t* pevtnum)
+{
+	struct savefile_engine* handle = engine.m_handle;
+	scap_reader_t* r = handle->m_reader;
+	int64_t pos = block_pos(handle);
+	uint64_t evtnum = 0;
+	uint32_t lo = 0;
+	uint32_t hi;
+	scap_evt* pevent;
+	uint16_t devid;
+	uint32_t flags;
+	int32_t res;
+
+	if(load_index(engine) != SCAP_SUCCESS)
+	{
+		seek_block(handle, pos);
+		return SCAP_FAILURE;
+	}
+
+	// first entry past the target
+	hi = handle->m_index_size;
+	while(lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo) / 2;
+		if(by_ts ? handle->m_index[mid].ts < target : handle->m_index[mid].evtnum <= target)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	if(lo == 0)
+	{
+		res = seek_block(handle, handle->m_events_pos);
+	}
+	else
+	{
+		evtnum = handle->m_index[lo - 1].evtnum;
+		res = seek_block(handle, handle->m_index[lo - 1].pos);
+	}
+	if(res != SCAP_SUCCESS)
+	{
+		return SCAP_FAILURE;
+	}
+
+	while(true)
+	{
+		pos = r->tell(r);
+		res = next(engine, &pevent, &devid, &flags);
+		if(res != SCAP_SUCCESS)
+		{
+			// the reading continues from the end of the section
+			break;
+		}
+
+		if(by_ts ? pevent->ts >= target : evtnum >= target)
+		{
+			res = seek_block(handle, pos);
+			break;
+		}
+		evtnum++;
+	}
+
+	if(pevtnum != NULL)
+	{
+		*pevtnum = evtnum;
+	}
+	return res == SCAP_FAILURE ? SCAP_FAILURE : SCAP_SUCCESS;
+}
+
+static int32_t scap_savefile_fseek_ts(struct scap_engine_handle engine, uint64_t ts, uint64_t* evtnum)
+{
+	return seek_event(engine, true, ts, evtnum);
+}
+
+static int32_t scap_savefile_fseek_evtnum(struct scap_engine_handle engine, uint64_t evtnum)
+{
+	return seek_event(engine, false, evtnum, NULL);
+}
+
 static int32_t
 scap_savefile_init_platform(struct scap_platform *platform, char *lasterr, struct scap_engine_handle engine,
 			    struct scap_open_args *oargs)
@@ -2140,44 +2509,69 @@ static int32_t init(struct scap* main_handle, struct scap_open_args* oargs)
 	struct scap_platform *platform = params->platform;
 	handle->m_platform = params->platform;
 
-	if(fd != 0)
-	{
-		gzfile = gzdopen(fd, "rb");
-	}
-	else
+	//
+	// Uncompressed regular files are mapped in memory, so that the events
+	// can be read in place, and files compressed in blocks are decompressed
+	// ahead of the reads. Anything else goes through zlib.
+	//
+	scap_reader_t* reader = NULL;
+#ifndef _WIN32
+	int direct_fd = fd != 0 ? fd : open(fname, O_RDONLY);
+	if(direct_fd >= 0)
 	{
-		gzfile = gzopen(fname, "rb");
+		reader = scap_reader_open_blocks(direct_fd, true);
+		if(!reader)
+		{
+			reader = scap_reader_open_mmap(direct_fd, true);
+		}
+		if(!reader && fd == 0)
+		{
+			close(direct_fd);
+		}
 	}
+#endif
 
-	if(gzfile == NULL)
+	if(!reader)
 	{
 		if(fd != 0)
 		{
-			snprintf(main_handle->m_lasterr, SCAP_LASTERR_SIZE, "can't open fd %d", fd);
+			gzfile = gzdopen(fd, "rb");
 		}
 		else
 		{
-			snprintf(main_handle->m_lasterr, SCAP_LASTERR_SIZE, "can't open file %s", fname);
+			gzfile = gzopen(fname, "rb");
 		}
-		return SCAP_FAILURE;
-	}
 
-	scap_reader_t* reader = scap_reader_open_gzfile(gzfile);
-	if(!reader)
-	{
-		gzclose(gzfile);
-		return SCAP_FAILURE;
-	}
+		if(gzfile == NULL)
+		{
+			if(fd != 0)
+			{
+				snprintf(main_handle->m_lasterr, SCAP_LASTERR_SIZE, "can't open fd %d", fd);
+			}
+			else
+			{
+				snprintf(main_handle->m_lasterr, SCAP_LASTERR_SIZE, "can't open file %s", fname);
+			}
+			return SCAP_FAILURE;
+		}
 
-	if (fbuffer_size > 0)
-	{
-		scap_reader_t* buffered_reader = scap_reader_open_buffered(reader, fbuffer_size, true);
-		if(!buffered_reader)
+		reader = scap_reader_open_gzfile(gzfile);
+		if(!reader)
 		{
-			reader->close(reader);
+			gzclose(gzfile);
 			return SCAP_FAILURE;
 		}
-		reader = buffered_reader;
+
+		if (fbuffer_size > 0)
+		{
+			scap_reader_t* buffered_reader = scap_reader_open_buffered(reader, fbuffer_size, true);
+			if(!buffered_reader)
+			{
+				reader->close(reader);
+				return SCAP_FAILURE;
+			}
+			reader = buffered_reader;
+		}
 	}
 
 	//
@@ -2214,6 +2608,8 @@ static int32_t init(struct scap* main_handle, struct scap_open_args* oargs)
 	}
 	handle->m_reader_evt_buf_size = READER_BUF_SIZE;
 	handle->m_reader = reader;
+	handle->m_events_pos = block_pos(handle);
+	handle->m_fname = fd == 0 ? strdup(fname) : NULL;
 
 	if(!oargs->import_users)
 	{
@@ -2247,6 +2643,13 @@ static int32_t scap_savefile_close(struct scap_engine_handle engine)
 		handle->m_reader_evt_buf = NULL;
 	}
 
+	free(handle->m_fname);
+	handle->m_fname = NULL;
+	free(handle->m_index);
+	handle->m_index = NULL;
+	handle->m_index_size = 0;
+	handle->m_index_loaded = false;
+
 	return SCAP_SUCCESS;
 }
 
@@ -2282,6 +2685,8 @@ static int64_t get_readfile_offset(struct scap_engine_handle engine)
 static struct scap_savefile_vtable savefile_ops = {
 	.ftell_capture = scap_savefile_ftell,
 	.fseek_capture = scap_savefile_fseek,
+	.fseek_capture_ts = scap_savefile_fseek_ts,
+	.fseek_capture_evtnum = scap_savefile_fseek_evtnum,
 
 	.restart_capture = scap_savefile_restart_capture,
 	.get_readfile_offset = get_readfile_offset,
@@ -70,6 +70,27 @@ static int32_t next(struct scap_engine_handle handle, scap_evt** pevent, uint16_
 	return SCAP_SUCCESS;
 }
 
+static int32_t next_batch(struct scap_engine_handle handle, scap_evt** pevents, uint16_t* pdevids, uint32_t* pflags,
+			  uint32_t max_events, uint32_t* pnevents)
+{
+	test_input_engine *engine = handle.m_handle;
+	scap_test_input_data *data = engine->m_data;
+	uint32_t n = 0;
+
+	while(n < max_events && data->events && data->event_count > 0)
+	{
+		pevents[n] = *(data->events++);
+		data->event_count--;
+		/* All the events are sent by device 1 */
+		pdevids[n] = 1;
+		pflags[n] = 0;
+		n++;
+	}
+
+	*pnevents = n;
+	return n > 0 ? SCAP_SUCCESS : SCAP_TIMEOUT;
+}
+
 static int32_t init(scap_t* main_handle, scap_open_args* oargs)
 {
 	test_input_engine *engine = main_handle->m_engine.m_handle;
@@ -103,4 +124,5 @@ const struct scap_vtable scap_test_input_engine = {
 	.get_max_buf_used = noop_get_max_buf_used,
 	.get_api_version = NULL,
 	.get_schema_version = NULL,
+	.next_batch = next_batch,
 };
@@ -39,6 +39,11 @@ limitations under the License.
 #define NUM_EVENTS_OPTION "--num_events"
 #define EVENT_TYPE_OPTION "--evt_type"
 #define BUFFER_OPTION "--buffer_dim"
+#define LINEAR_MERGE_OPTION "--linear_merge"
+#define ORDER_WINDOW_OPTION "--order_window"
+#define PER_CPU_ORDER_OPTION "--per_cpu_order"
+#define TAIL_ADVANCE_OPTION "--tail_advance"
+#define ADAPTIVE_WAIT_OPTION "--adaptive_wait"
 #define SIMPLE_SET_OPTION "--simple_set"
 #define CPUS_FOR_EACH_BUFFER_MODE "--cpus_for_buf"
 #define ALL_AVAILABLE_CPUS_MODE "--available_cpus"
@@ -547,6 +552,11 @@ void print_help()
 	printf("'%s <num_events>': number of events to catch before terminating. (default: UINT64_MAX)\n", NUM_EVENTS_OPTION);
 	printf("'%s <event_type>': every event of this type will be printed to console. (default: -1, no print)\n", EVENT_TYPE_OPTION);
 	printf("'%s <dim>': dimension in bytes of a single per CPU buffer.\n", BUFFER_OPTION);
+	printf("'%s': scan all the buffers for every event instead of using the heap of ring heads.\n", LINEAR_MERGE_OPTION);
+	printf("'%s <ns>': keep draining the same buffer while its events are at most <ns> newer than the oldest event of the other buffers.\n", ORDER_WINDOW_OPTION);
+	printf("'%s': drain every buffer in FIFO order, events of different buffers are not ordered.\n", PER_CPU_ORDER_OPTION);
+	printf("'%s <bytes>': [KMOD, BPF] give back consumed data to the driver every <bytes> and refill every buffer as soon as it is drained.\n", TAIL_ADVANCE_OPTION);
+	printf("'%s <latency_us> <idle_us>': never hold events for more than <latency_us> and sleep at most <idle_us> when there are no events, instead of the exponential backoff.\n", ADAPTIVE_WAIT_OPTION);
 	printf("[MODERN PROBE ONLY, EXPERIMENTAL]\n");
 	printf("'%s <cpus_for_each_buffer>': allocate a ring buffer for every `cpus_for_each_buffer` CPUs.\n", CPUS_FOR_EACH_BUFFER_MODE);
 	printf("'%s': allocate ring buffers for all available CPUs. Default: allocate ring buffers for online CPUs only.\n", ALL_AVAILABLE_CPUS_MODE);
@@ -716,6 +726,59 @@ void parse_CLI_options(int argc, char** argv)
 			bpf_params.buffer_bytes_dim = buffer_bytes_dim;
 			modern_bpf_params.buffer_bytes_dim = buffer_bytes_dim;
 		}
+		if(!strcmp(argv[i], LINEAR_MERGE_OPTION))
+		{
+			kmod_params.merge_mode = SCAP_RINGBUFFER_MERGE_LINEAR;
+			bpf_params.merge_mode = SCAP_RINGBUFFER_MERGE_LINEAR;
+			modern_bpf_params.merge_mode = SCAP_RINGBUFFER_MERGE_LINEAR;
+		}
+		if(!strcmp(argv[i], ORDER_WINDOW_OPTION))
+		{
+			if(!(i + 1 < argc))
+			{
+				printf("\nYou need to specify also the ordering window in nanoseconds. Bye!\n");
+				exit(EXIT_FAILURE);
+			}
+			kmod_params.order_mode = SCAP_RINGBUFFER_ORDER_WINDOW;
+			kmod_params.order_window_ns = strtoull(argv[++i], NULL, 10);
+			bpf_params.order_mode = kmod_params.order_mode;
+			bpf_params.order_window_ns = kmod_params.order_window_ns;
+			modern_bpf_params.order_mode = kmod_params.order_mode;
+			modern_bpf_params.order_window_ns = kmod_params.order_window_ns;
+		}
+		if(!strcmp(argv[i], TAIL_ADVANCE_OPTION))
+		{
+			if(!(i + 1 < argc))
+			{
+				printf("\nYou need to specify also the number of bytes. Bye!\n");
+				exit(EXIT_FAILURE);
+			}
+			kmod_params.tail_advance_bytes = atoi(argv[++i]);
+			bpf_params.tail_advance_bytes = kmod_params.tail_advance_bytes;
+		}
+		if(!strcmp(argv[i], ADAPTIVE_WAIT_OPTION))
+		{
+			if(!(i + 2 < argc))
+			{
+				printf("\nYou need to specify also the latency and the idle time in microseconds. Bye!\n");
+				exit(EXIT_FAILURE);
+			}
+			kmod_params.wait_mode = SCAP_RINGBUFFER_WAIT_ADAPTIVE;
+			kmod_params.wait_latency_us = strtoull(argv[++i], NULL, 10);
+			kmod_params.wait_idle_us = strtoull(argv[++i], NULL, 10);
+			bpf_params.wait_mode = kmod_params.wait_mode;
+			bpf_params.wait_latency_us = kmod_params.wait_latency_us;
+			bpf_params.wait_idle_us = kmod_params.wait_idle_us;
+			modern_bpf_params.wait_mode = kmod_params.wait_mode;
+			modern_bpf_params.wait_latency_us = kmod_params.wait_latency_us;
+			modern_bpf_params.wait_idle_us = kmod_params.wait_idle_us;
+		}
+		if(!strcmp(argv[i], PER_CPU_ORDER_OPTION))
+		{
+			kmod_params.order_mode = SCAP_RINGBUFFER_ORDER_PER_CPU;
+			bpf_params.order_mode = SCAP_RINGBUFFER_ORDER_PER_CPU;
+			modern_bpf_params.order_mode = SCAP_RINGBUFFER_ORDER_PER_CPU;
+		}
 		if(!strcmp(argv[i], PPM_SC_OPTION))
 		{
 			if(!(i + 1 < argc))
@@ -866,7 +929,7 @@ void print_stats()
 {
 	gettimeofday(&tval_end, NULL);
 	timersub(&tval_end, &tval_start, &tval_result);
-	uint32_t flags = METRICS_V2_KERNEL_COUNTERS | METRICS_V2_LIBBPF_STATS;
+	uint32_t flags = METRICS_V2_KERNEL_COUNTERS | METRICS_V2_LIBBPF_STATS | METRICS_V2_KERNEL_COUNTERS_PER_CPU | METRICS_V2_LIBSCAP_COUNTERS;
 	uint32_t nstats;
 	int32_t rc;
 	const metrics_v2* stats_v2;
@@ -39,6 +39,22 @@ extern "C" {
 #define METRICS_V2_STATE_COUNTERS (1 << 3)
 #define METRICS_V2_RULE_COUNTERS (1 << 4)
 #define METRICS_V2_MISC (1 << 5)
+#define METRICS_V2_KERNEL_COUNTERS_PER_CPU (1 << 6)
+#define METRICS_V2_LIBSCAP_COUNTERS (1 << 7)
+
+//
+// Prefixes of the METRICS_V2_KERNEL_COUNTERS_PER_CPU metrics,
+// the index of the ring buffer device is appended to them
+//
+#define N_EVTS_PER_CPU_PREFIX "n_evts_cpu_"
+#define N_DROPS_PER_CPU_PREFIX "n_drops_cpu_"
+#define BUFFER_LATENCY_NS_PER_CPU_PREFIX "buffer_latency_ns_cpu_"
+
+//
+// Names of the METRICS_V2_LIBSCAP_COUNTERS metrics, counted in userspace
+// while reading the ring buffers of the live drivers
+//
+#define N_EVTS_OUT_OF_ORDER_NAME "n_evts_out_of_order"
 
 typedef union metrics_v2_value {
 	uint32_t u32;
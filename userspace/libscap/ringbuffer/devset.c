@@ -36,6 +36,14 @@ int32_t devset_init(struct scap_device_set *devset, size_t num_devs, char *laste
 		return SCAP_FAILURE;
 	}
 
+	if(ringbuffer_heap_init(&devset->m_heap, devset->m_ndevs) != 0)
+	{
+		free(devset->m_devs);
+		devset->m_devs = NULL;
+		strlcpy(lasterr, "error allocating the ring buffer merge heap", SCAP_LASTERR_SIZE);
+		return SCAP_FAILURE;
+	}
+
 	for(size_t j = 0; j < num_devs; ++j)
 	{
 		devset->m_devs[j].m_buffer = INVALID_MAPPING;
@@ -45,13 +53,69 @@ int32_t devset_init(struct scap_device_set *devset, size_t num_devs, char *laste
 		devset->m_devs[j].m_bufinfo_fd = INVALID_FD;
 		devset->m_devs[j].m_lastreadsize = 0;
 		devset->m_devs[j].m_sn_len = 0;
+		devset->m_devs[j].m_buffer_latency_ns = 0;
+		devset->m_devs[j].m_cpu = j;
 	}
 	devset->m_buffer_empty_wait_time_us = BUFFER_EMPTY_WAIT_TIME_US_START;
 	devset->m_lasterr = lasterr;
+	devset->m_merge_mode = SCAP_RINGBUFFER_MERGE_HEAP;
+	devset->m_order_window_ns = 0;
+	devset->m_last_ts = 0;
+	devset->m_n_evts_out_of_order = 0;
+	devset->m_tail_advance_bytes = 0;
+	devset->m_last_devid = devset->m_ndevs;
+	devset->m_events_since_rescan = 0;
+	devset->m_rescan_ts = 0;
+	devset_set_wait_mode(devset, SCAP_RINGBUFFER_WAIT_BACKOFF, 0, 0);
 
 	return SCAP_SUCCESS;
 }
 
+void devset_set_wait_mode(struct scap_device_set *devset, enum scap_ringbuffer_wait_mode mode, uint64_t latency_us, uint64_t idle_us)
+{
+	devset->m_wait_mode = mode;
+	devset->m_wait_latency_us = latency_us;
+	devset->m_wait_idle_us = idle_us != 0 ? idle_us : BUFFER_EMPTY_WAIT_TIME_US_MAX;
+}
+
+/* Fill the `DEVSET_PER_CPU_STATS` metrics of a device starting from `stats`,
+ * the engine provides the counters collected by the driver.
+ */
+void devset_fill_per_cpu_stats(struct scap_device *dev, metrics_v2 *stats, uint64_t n_evts, uint64_t n_drops)
+{
+	for(uint32_t stat = 0; stat < DEVSET_PER_CPU_STATS; stat++)
+	{
+		stats[stat].type = METRIC_VALUE_TYPE_U64;
+		stats[stat].flags = METRICS_V2_KERNEL_COUNTERS_PER_CPU;
+		stats[stat].unit = METRIC_VALUE_UNIT_COUNT;
+		stats[stat].metric_type = METRIC_VALUE_METRIC_TYPE_MONOTONIC;
+	}
+
+	snprintf(stats[0].name, METRIC_NAME_MAX, N_EVTS_PER_CPU_PREFIX "%u", dev->m_cpu);
+	stats[0].value.u64 = n_evts;
+
+	snprintf(stats[1].name, METRIC_NAME_MAX, N_DROPS_PER_CPU_PREFIX "%u", dev->m_cpu);
+	stats[1].value.u64 = n_drops;
+
+	snprintf(stats[2].name, METRIC_NAME_MAX, BUFFER_LATENCY_NS_PER_CPU_PREFIX "%u", dev->m_cpu);
+	stats[2].unit = METRIC_VALUE_UNIT_TIME_NS;
+	stats[2].metric_type = METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT;
+	stats[2].value.u64 = dev->m_buffer_latency_ns;
+}
+
+/* Fill the `DEVSET_LIBSCAP_STATS` metrics counted while reading the devices,
+ * see `scap_ringbuffer_order_mode`.
+ */
+void devset_fill_libscap_stats(struct scap_device_set *devset, metrics_v2 *stats)
+{
+	stats[0].type = METRIC_VALUE_TYPE_U64;
+	stats[0].flags = METRICS_V2_LIBSCAP_COUNTERS;
+	stats[0].unit = METRIC_VALUE_UNIT_COUNT;
+	stats[0].metric_type = METRIC_VALUE_METRIC_TYPE_MONOTONIC;
+	strlcpy(stats[0].name, N_EVTS_OUT_OF_ORDER_NAME, METRIC_NAME_MAX);
+	stats[0].value.u64 = devset->m_n_evts_out_of_order;
+}
+
 void devset_close_device(struct scap_device *dev)
 {
 	devset_munmap(dev->m_buffer, dev->m_mmap_size);
@@ -74,4 +138,5 @@ void devset_free(struct scap_device_set *devset)
 		devset_close_device(dev);
 	}
 	free(devset->m_devs);
+	ringbuffer_heap_free(&devset->m_heap);
 }
@@ -27,6 +27,9 @@ limitations under the License.
 #define INVALID_MAPPING MAP_FAILED
 
 #include <libscap/scap_assert.h>
+#include <libscap/metrics_v2.h>
+#include <libscap/ringbuffer/ringbuffer_heap.h>
+#include <libscap/ringbuffer/ringbuffer_public.h>
 
 //
 // Read buffer timeout constants
@@ -48,9 +51,11 @@ typedef struct scap_device
 	char* m_buffer;
 	unsigned long m_buffer_size;
 	unsigned long m_mmap_size; // generally 2 * m_buffer_size, but bpf does weird things
+	uint32_t m_cpu; // CPU the buffer belongs to
 	uint32_t m_lastreadsize;
 	char* m_sn_next_event; // Pointer to the next event available for scap_next
 	uint32_t m_sn_len; // Number of bytes available in the buffer pointed by m_sn_next_event
+	uint64_t m_buffer_latency_ns; // Age of the oldest event of the last block read from the buffer
 	union
 	{
 		// Anonymous struct with ppm stuff
@@ -69,11 +74,32 @@ struct scap_device_set
 	uint32_t m_ndevs;
 	uint64_t m_buffer_empty_wait_time_us;
 	char* m_lasterr;
+	enum scap_ringbuffer_merge_mode m_merge_mode;
+	struct ringbuffer_heap m_heap; // devices with a non-empty block, used by `SCAP_RINGBUFFER_MERGE_HEAP`
+	uint64_t m_order_window_ns; // 0 for the strict ordering, `UINT64_MAX` for the per-CPU one
+	uint64_t m_last_ts; // timestamp of the last returned event
+	uint64_t m_n_evts_out_of_order; // events returned with a timestamp lower than the previous one
+	uint32_t m_tail_advance_bytes; // 0 to release a block only when fully consumed, see `ringbuffer_release_consumed`
+	uint32_t m_last_devid; // device of the last returned event, `m_ndevs` if none
+	uint32_t m_events_since_rescan; // events returned since we last refilled the idle devices
+	uint64_t m_rescan_ts; // newest head in the heap when we last refilled the idle devices
+	enum scap_ringbuffer_wait_mode m_wait_mode;
+	uint64_t m_wait_latency_us; // see `ringbuffer_wait_time_us`
+	uint64_t m_wait_idle_us;
 };
 
 int32_t devset_init(struct scap_device_set *devset, size_t num_devs, char *lasterr);
 void devset_close_device(struct scap_device *dev);
 void devset_free(struct scap_device_set *devset);
+void devset_set_wait_mode(struct scap_device_set *devset, enum scap_ringbuffer_wait_mode mode, uint64_t latency_us, uint64_t idle_us);
+
+// Number of METRICS_V2_KERNEL_COUNTERS_PER_CPU metrics of every device
+#define DEVSET_PER_CPU_STATS 3
+void devset_fill_per_cpu_stats(struct scap_device *dev, metrics_v2 *stats, uint64_t n_evts, uint64_t n_drops);
+
+// Number of METRICS_V2_LIBSCAP_COUNTERS metrics of the device set
+#define DEVSET_LIBSCAP_STATS 1
+void devset_fill_libscap_stats(struct scap_device_set *devset, metrics_v2 *stats);
 
 static inline void devset_munmap(void* addr, size_t size)
 {
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <stdio.h>
 #include <stdint.h>
+#include <time.h>
 
 #include <libscap/ringbuffer/devset.h>
 #include <driver/ppm_ringbuffer.h>
@@ -50,18 +51,14 @@ static inline void ringbuffer_get_buf_pointers(scap_device* dev, uint64_t* phead
 }
 #endif
 
-#ifndef ADVANCE_TAIL
-#define ADVANCE_TAIL ringbuffer_advance_tail
-static inline void ringbuffer_advance_tail(struct scap_device* dev)
+#ifndef ADVANCE_TAIL_BY
+#define ADVANCE_TAIL_BY ringbuffer_advance_tail_by
+/* Give back to the producer the first `size` bytes of the block read by `READBUF`. */
+static inline void ringbuffer_advance_tail_by(struct scap_device* dev, uint32_t size)
 {
 	uint32_t ttail;
 
-	//
-	// Update the tail based on the amount of data read in the *previous* call.
-	// Tail is never updated when we serve the data, because we assume that the caller is using
-	// the buffer we give to her until she calls us again.
-	//
-	ttail = dev->m_bufinfo->tail + dev->m_lastreadsize;
+	ttail = dev->m_bufinfo->tail + size;
 
 	//
 	// Make sure every read of the old buffer is completed before we move the tail and the
@@ -80,7 +77,20 @@ static inline void ringbuffer_advance_tail(struct scap_device* dev)
 		dev->m_bufinfo->tail = ttail - dev->m_buffer_size;
 	}
 
-	dev->m_lastreadsize = 0;
+	dev->m_lastreadsize -= size;
+}
+#endif
+
+#ifndef ADVANCE_TAIL
+#define ADVANCE_TAIL ringbuffer_advance_tail
+static inline void ringbuffer_advance_tail(struct scap_device* dev)
+{
+	//
+	// Update the tail based on the amount of data read in the *previous* call.
+	// Tail is never updated when we serve the data, because we assume that the caller is using
+	// the buffer we give to her until she calls us again.
+	//
+	ADVANCE_TAIL_BY(dev, dev->m_lastreadsize);
 }
 #endif
 
@@ -119,6 +129,40 @@ static inline int32_t ringbuffer_readbuf(struct scap_device *dev, char** buf, ui
 }
 #endif
 
+#ifndef NEXT_EVENT
+#define NEXT_EVENT ringbuffer_next_event
+static inline scap_evt* ringbuffer_next_event(scap_device* dev)
+{
+	return (scap_evt*)dev->m_sn_next_event;
+}
+#endif
+
+static inline uint64_t ringbuffer_now_ns()
+{
+	struct timespec ts;
+
+	if(clock_gettime(CLOCK_REALTIME, &ts) != 0)
+	{
+		return 0;
+	}
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Record how long the oldest event of the block just read has been waiting in the buffer. */
+static inline void ringbuffer_sample_latency(scap_device* dev, uint64_t now)
+{
+	uint64_t ts;
+
+	if(dev->m_sn_len == 0)
+	{
+		dev->m_buffer_latency_ns = 0;
+		return;
+	}
+
+	ts = NEXT_EVENT(dev)->ts;
+	dev->m_buffer_latency_ns = now > ts ? now - ts : 0;
+}
+
 static inline uint64_t buf_size_used(scap_device* dev)
 {
 	uint64_t read_size;
@@ -148,12 +192,56 @@ static inline bool are_buffers_empty(struct scap_device_set *devset)
 	return true;
 }
 
+/* How long `SCAP_RINGBUFFER_WAIT_ADAPTIVE` waits before reading the buffers:
+ * - some buffer has more than `BUFFER_EMPTY_THRESHOLD_B`: don't wait at all.
+ * - there are fewer data: wait `m_wait_latency_us`, the maximum delay we add
+ *   to these events to read them in larger blocks.
+ * - there is nothing to read: wait with an exponential backoff up to
+ *   `m_wait_idle_us`, that bounds both the wakeups when idle and the latency
+ *   of the first event after an idle period.
+ */
+static inline uint64_t ringbuffer_wait_time_us(struct scap_device_set *devset)
+{
+	uint32_t j;
+	uint64_t used = 0;
+	uint64_t wait_us;
+
+	for(j = 0; j < devset->m_ndevs; j++)
+	{
+		used = MAX(used, buf_size_used(&devset->m_devs[j]));
+		if(used > BUFFER_EMPTY_THRESHOLD_B)
+		{
+			devset->m_buffer_empty_wait_time_us = BUFFER_EMPTY_WAIT_TIME_US_START;
+			return 0;
+		}
+	}
+
+	if(used > 0)
+	{
+		devset->m_buffer_empty_wait_time_us = BUFFER_EMPTY_WAIT_TIME_US_START;
+		return devset->m_wait_latency_us;
+	}
+
+	wait_us = MIN(devset->m_buffer_empty_wait_time_us, devset->m_wait_idle_us);
+	devset->m_buffer_empty_wait_time_us = MIN(devset->m_buffer_empty_wait_time_us * 2, devset->m_wait_idle_us);
+	return wait_us;
+}
+
 static inline int32_t refill_read_buffers(struct scap_device_set *devset)
 {
 	uint32_t j;
 	uint32_t ndevs = devset->m_ndevs;
+	uint64_t now;
 
-	if(are_buffers_empty(devset))
+	if(devset->m_wait_mode == SCAP_RINGBUFFER_WAIT_ADAPTIVE)
+	{
+		uint64_t wait_us = ringbuffer_wait_time_us(devset);
+		if(wait_us > 0)
+		{
+			sleep_us(wait_us);
+		}
+	}
+	else if(are_buffers_empty(devset))
 	{
 		sleep_ms(devset->m_buffer_empty_wait_time_us / 1000);
 		devset->m_buffer_empty_wait_time_us = MIN(devset->m_buffer_empty_wait_time_us * 2,
@@ -165,6 +253,7 @@ static inline int32_t refill_read_buffers(struct scap_device_set *devset)
 	}
 
 	/* In any case (potentially also after a `sleep`) we refill our buffers */
+	now = ringbuffer_now_ns();
 	for(j = 0; j < ndevs; j++)
 	{
 		struct scap_device *dev = &(devset->m_devs[j]);
@@ -177,20 +266,13 @@ static inline int32_t refill_read_buffers(struct scap_device_set *devset)
 		{
 			return res;
 		}
+		ringbuffer_sample_latency(dev, now);
 	}
 
 	/* Return `SCAP_TIMEOUT` after a refill so we can start consuming the new events. */
 	return SCAP_TIMEOUT;
 }
 
-#ifndef NEXT_EVENT
-#define NEXT_EVENT ringbuffer_next_event
-static inline scap_evt* ringbuffer_next_event(scap_device* dev)
-{
-	return (scap_evt*)dev->m_sn_next_event;
-}
-#endif
-
 #ifndef ADVANCE_TO_EVT
 #define ADVANCE_TO_EVT ringbuffer_advance_to_evt
 static inline void ringbuffer_advance_to_evt(scap_device* dev, scap_evt *event)
@@ -201,6 +283,255 @@ static inline void ringbuffer_advance_to_evt(scap_device* dev, scap_evt *event)
 }
 #endif
 
+/* Count the events returned with a timestamp lower than the previous one. */
+static inline void ringbuffer_track_order(struct scap_device_set* devset, scap_evt* pe)
+{
+	if(pe->ts < devset->m_last_ts)
+	{
+		devset->m_n_evts_out_of_order++;
+	}
+	devset->m_last_ts = pe->ts;
+}
+
+/* When `m_tail_advance_bytes` is set, give back to the producer the part of the
+ * block of the last used device that we have already consumed, as soon as it is
+ * at least `m_tail_advance_bytes` long, instead of waiting for the whole block.
+ * This must be called before serving a new event: the caller is done with all
+ * the events we returned before.
+ */
+static inline void ringbuffer_release_consumed(struct scap_device_set* devset)
+{
+	scap_device* dev;
+	uint32_t consumed;
+
+	if(devset->m_tail_advance_bytes == 0 || devset->m_last_devid >= devset->m_ndevs)
+	{
+		return;
+	}
+
+	dev = &devset->m_devs[devset->m_last_devid];
+	consumed = dev->m_lastreadsize - dev->m_sn_len;
+	if(consumed >= devset->m_tail_advance_bytes)
+	{
+		ADVANCE_TAIL_BY(dev, consumed);
+	}
+}
+
+/* Read a new block from a single device whose previous block has been fully
+ * consumed, without waiting for the other devices.
+ */
+static inline int32_t ringbuffer_refill_device(scap_device* dev)
+{
+	int32_t res;
+
+	if(dev->m_lastreadsize > 0)
+	{
+		ADVANCE_TAIL(dev);
+	}
+
+	res = READBUF(dev, &dev->m_sn_next_event, &dev->m_sn_len);
+	if(res != SCAP_SUCCESS)
+	{
+		return res;
+	}
+
+	/* The block could contain only records that are not events (e.g. bpf lost samples). */
+	if(dev->m_sn_len == 0 && dev->m_lastreadsize > 0)
+	{
+		ADVANCE_TAIL(dev);
+	}
+	/* Idle devices are refilled often, don't read the clock for them. */
+	ringbuffer_sample_latency(dev, dev->m_sn_len > 0 ? ringbuffer_now_ns() : 0);
+	return SCAP_SUCCESS;
+}
+
+/* Refill the devices that are not in the heap, so that they are not starved by
+ * the ones that always have new data when their block is over, and so that
+ * their new events are merged with the heads in the heap.
+ */
+static inline int32_t ringbuffer_refill_idle_devices(struct scap_device_set* devset)
+{
+	uint32_t j;
+	int32_t res;
+	struct ringbuffer_heap* heap = &devset->m_heap;
+	/* A device with a consumed block can still be on top of the heap, see `ringbuffer_next_heap`. */
+	uint32_t top = heap->m_size > 0 ? heap->m_entries[0].id : devset->m_ndevs;
+
+	for(j = 0; j < devset->m_ndevs; j++)
+	{
+		scap_device* dev = &devset->m_devs[j];
+		if(j == top || dev->m_sn_len > 0)
+		{
+			continue;
+		}
+
+		res = ringbuffer_refill_device(dev);
+		if(res != SCAP_SUCCESS)
+		{
+			return res;
+		}
+
+		if(dev->m_sn_len > 0)
+		{
+			ringbuffer_heap_push(heap, NEXT_EVENT(dev)->ts, j);
+		}
+	}
+	return SCAP_SUCCESS;
+}
+
+/* Release the blocks that we have fully consumed, refill all the buffers and
+ * rebuild the heap with the devices that have new data.
+ */
+static inline int32_t ringbuffer_refill_heap(struct scap_device_set* devset)
+{
+	uint32_t j;
+	int32_t res;
+	struct ringbuffer_heap* heap = &devset->m_heap;
+
+	for(j = 0; j < devset->m_ndevs; j++)
+	{
+		scap_device* dev = &devset->m_devs[j];
+		/* The block could have been discarded without going through the heap,
+		 * e.g. when the snaplen changes.
+		 */
+		if(dev->m_sn_len == 0 && dev->m_lastreadsize > 0)
+		{
+			ADVANCE_TAIL(dev);
+		}
+	}
+
+	res = refill_read_buffers(devset);
+
+	heap->m_size = 0;
+	for(j = 0; j < devset->m_ndevs; j++)
+	{
+		scap_device* dev = &devset->m_devs[j];
+		if(dev->m_sn_len > 0)
+		{
+			ringbuffer_heap_append(heap, NEXT_EVENT(dev)->ts, j);
+		}
+	}
+	ringbuffer_heap_build(heap);
+
+	return res;
+}
+
+/**
+ * \brief Get next event in the ringbuffer using the heap of ring heads
+ *
+ * Same flow as `ringbuffer_next` but the devices with data in their block
+ * are kept in a min-heap ordered by the timestamp of their next event, so
+ * that selecting the next event costs O(log(ndevs)) and touches only the
+ * device we have just consumed instead of all of them.
+ *
+ * When the block of a device is fully consumed its heap entry is kept on
+ * top with a zero timestamp: the consumer position is moved at the next
+ * call, since the caller is still using the event we have just returned.
+ *
+ * With a relaxed order mode (`m_order_window_ns` != 0) the top device is
+ * not replaced until its next event is more than `m_order_window_ns` newer
+ * than the oldest head of the other devices, see `ringbuffer_heap_update_top_window`.
+ *
+ * When `m_tail_advance_bytes` is set a device is refilled as soon as its
+ * block is over, so we never wait for all the devices to be drained. The
+ * devices that were empty are refilled every `m_ndevs` events with a relaxed
+ * ordering. With the strict one any of them could have received an event
+ * older than the heads in the heap, but only one written after we last
+ * refilled them, so newer than all the heads we had then (`m_rescan_ts`):
+ * they are refilled only before returning an event newer than that. This
+ * costs a refill of every idle device whenever the oldest head passes the
+ * newest one, i.e. still before every event when a single device is busy:
+ * use a relaxed ordering to keep the cost of the idle devices amortized.
+ */
+static inline int32_t ringbuffer_next_heap(struct scap_device_set* devset, scap_evt** pevent, uint16_t* pdevid,
+					   uint32_t* pflags)
+{
+	struct ringbuffer_heap* heap = &devset->m_heap;
+	int32_t res;
+
+	if(devset->m_tail_advance_bytes > 0 && heap->m_size > 0 && devset->m_order_window_ns != 0 &&
+	   ++devset->m_events_since_rescan >= devset->m_ndevs)
+	{
+		devset->m_events_since_rescan = 0;
+		res = ringbuffer_refill_idle_devices(devset);
+		if(res != SCAP_SUCCESS)
+		{
+			return res;
+		}
+	}
+
+	while(heap->m_size > 0)
+	{
+		uint32_t j = heap->m_entries[0].id;
+		scap_device* dev = &devset->m_devs[j];
+		scap_evt* pe;
+
+		if(dev->m_sn_len == 0)
+		{
+			if(devset->m_tail_advance_bytes > 0)
+			{
+				res = ringbuffer_refill_device(dev);
+				if(res != SCAP_SUCCESS)
+				{
+					return res;
+				}
+
+				if(dev->m_sn_len > 0)
+				{
+					ringbuffer_heap_update_top(heap, NEXT_EVENT(dev)->ts);
+					continue;
+				}
+			}
+			else if(dev->m_lastreadsize > 0)
+			{
+				ADVANCE_TAIL(dev);
+			}
+			ringbuffer_heap_pop(heap);
+			continue;
+		}
+
+		pe = NEXT_EVENT(dev);
+
+		/* if the event length is greater than the remaining size in our block there is something wrong! */
+		if(pe->len > dev->m_sn_len)
+		{
+			snprintf(devset->m_lasterr, SCAP_LASTERR_SIZE, "scap_next buffer corruption");
+
+			/* if you get the following assertion, first recompile the driver and `libscap` */
+			ASSERT(false);
+			return SCAP_FAILURE;
+		}
+
+		if(devset->m_tail_advance_bytes > 0 && devset->m_order_window_ns == 0 && pe->ts > devset->m_rescan_ts)
+		{
+			res = ringbuffer_refill_idle_devices(devset);
+			if(res != SCAP_SUCCESS)
+			{
+				return res;
+			}
+			/* `pe` is still in the heap, we don't come back here for it. */
+			devset->m_rescan_ts = ringbuffer_heap_max_ts(heap);
+			continue;
+		}
+
+		ADVANCE_TO_EVT(dev, pe);
+		ringbuffer_heap_update_top_window(heap, dev->m_sn_len > 0 ? NEXT_EVENT(dev)->ts : 0,
+						  devset->m_order_window_ns);
+		ringbuffer_track_order(devset, pe);
+		devset->m_last_devid = j;
+
+		*pevent = pe;
+		*pdevid = j;
+		// we don't really store the flags in the ringbuffer anywhere
+		*pflags = 0;
+		return SCAP_SUCCESS;
+	}
+
+	*pdevid = 65535;
+	devset->m_last_devid = devset->m_ndevs;
+	return ringbuffer_refill_heap(devset);
+}
+
 /**
  * \brief Get next event in the ringbuffer
  *
@@ -216,7 +547,9 @@ static inline void ringbuffer_advance_to_evt(scap_device* dev, scap_evt *event)
  * - we increase the consumer position only when we have consumed the entire block, but if the block
  *   is huge we could cause several drops.
  * - before refilling a buffer we have to consume all the others!
- * - we perform a lot of cycles but we have to be super fast here!
+ * - we perform a lot of cycles but we have to be super fast here! When `m_merge_mode` is
+ *   `SCAP_RINGBUFFER_MERGE_HEAP` (the default) we delegate to `ringbuffer_next_heap` that
+ *   doesn't scan all the buffers for every event.
  *
  * \param pevent [out] where the pointer to the next event gets stored
  * \param pdevid [out] where the device on which the event was received
@@ -231,6 +564,13 @@ static inline int32_t ringbuffer_next(struct scap_device_set* devset, scap_evt**
 	scap_evt* pe = NULL;
 	uint32_t ndevs = devset->m_ndevs;
 
+	ringbuffer_release_consumed(devset);
+
+	if(devset->m_merge_mode == SCAP_RINGBUFFER_MERGE_HEAP)
+	{
+		return ringbuffer_next_heap(devset, pevent, pdevid, pflags);
+	}
+
 	*pdevid = 65535;
 
 	for(j = 0; j < ndevs; j++)
@@ -301,6 +641,8 @@ static inline int32_t ringbuffer_next(struct scap_device_set* devset, scap_evt**
 	 	 */
 		struct scap_device* dev = &devset->m_devs[*pdevid];
 		ADVANCE_TO_EVT(dev, (*pevent));
+		ringbuffer_track_order(devset, *pevent);
+		devset->m_last_devid = *pdevid;
 
 		// we don't really store the flags in the ringbuffer anywhere
 		*pflags = 0;
@@ -311,10 +653,82 @@ static inline int32_t ringbuffer_next(struct scap_device_set* devset, scap_evt**
 		/* If there are enough new data read again one block for every buffer
 		 * otherwise sleep!
 		 */
+		devset->m_last_devid = devset->m_ndevs;
 		return refill_read_buffers(devset);
 	}
 }
 
+/**
+ * \brief Get up to `max_events` events in the ringbuffer with a single call
+ *
+ * The first event goes through `ringbuffer_next`, that releases the blocks
+ * consumed by the previous call and refills the buffers when needed. The
+ * following ones are taken from the heap of ring heads without moving any
+ * consumer position: all the events of the batch point into the blocks we
+ * have already read, so they stay valid until the next call. A device whose
+ * block is over is dropped from the heap, its tail is moved when it is
+ * refilled. The devices that were empty are refilled only by the next call,
+ * so the batch is ordered among the blocks already read. With
+ * `SCAP_RINGBUFFER_MERGE_LINEAR` only one event is returned.
+ *
+ * \param pevents [out] array of `max_events` pointers where the events get stored
+ * \param pdevids [out] array of `max_events` devices on which the events were received
+ * \param pflags [out] array of `max_events` flags of the events
+ * \param pnevents [out] where the number of returned events gets stored
+ */
+static inline int32_t ringbuffer_next_batch(struct scap_device_set* devset, scap_evt** pevents, uint16_t* pdevids,
+					    uint32_t* pflags, uint32_t max_events, uint32_t* pnevents)
+{
+	struct ringbuffer_heap* heap = &devset->m_heap;
+	uint32_t n = 1;
+	int32_t res;
+
+	*pnevents = 0;
+	res = ringbuffer_next(devset, &pevents[0], &pdevids[0], &pflags[0]);
+	if(res != SCAP_SUCCESS)
+	{
+		return res;
+	}
+
+	if(devset->m_merge_mode == SCAP_RINGBUFFER_MERGE_HEAP)
+	{
+		while(n < max_events && heap->m_size > 0)
+		{
+			uint32_t j = heap->m_entries[0].id;
+			scap_device* dev = &devset->m_devs[j];
+			scap_evt* pe;
+
+			if(dev->m_sn_len == 0)
+			{
+				ringbuffer_heap_pop(heap);
+				continue;
+			}
+
+			pe = NEXT_EVENT(dev);
+			if(pe->len > dev->m_sn_len)
+			{
+				/* Return the events we have, the corruption is reported by the next call. */
+				break;
+			}
+
+			ADVANCE_TO_EVT(dev, pe);
+			ringbuffer_heap_update_top_window(heap, dev->m_sn_len > 0 ? NEXT_EVENT(dev)->ts : 0,
+							  devset->m_order_window_ns);
+			ringbuffer_track_order(devset, pe);
+			devset->m_last_devid = j;
+
+			pevents[n] = pe;
+			pdevids[n] = j;
+			pflags[n] = 0;
+			n++;
+		}
+		devset->m_events_since_rescan += n - 1;
+	}
+
+	*pnevents = n;
+	return SCAP_SUCCESS;
+}
+
 static inline uint64_t ringbuffer_get_max_buf_used(struct scap_device_set *devset)
 {
 	uint64_t i;
@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <libscap/ringbuffer/ringbuffer_public.h>
+
+/*
+ * Binary min-heap of ring buffer heads, ordered by the timestamp of the first
+ * event available in every ring. It is used to merge the per-CPU ring buffers
+ * in O(log(nrings)) for every event instead of scanning all the rings.
+ *
+ * The timestamp is copied into the entry so that restoring the heap property
+ * never touches the memory of rings other than the one we just consumed.
+ */
+struct ringbuffer_heap_entry
+{
+	uint64_t ts;
+	uint32_t id;
+};
+
+struct ringbuffer_heap
+{
+	struct ringbuffer_heap_entry* m_entries;
+	uint32_t m_size;
+	uint32_t m_capacity;
+};
+
+static inline int ringbuffer_heap_init(struct ringbuffer_heap* heap, uint32_t capacity)
+{
+	heap->m_size = 0;
+	heap->m_capacity = capacity;
+	heap->m_entries = NULL;
+	if(capacity == 0)
+	{
+		return 0;
+	}
+
+	heap->m_entries = (struct ringbuffer_heap_entry*)calloc(capacity, sizeof(struct ringbuffer_heap_entry));
+	return heap->m_entries == NULL ? -1 : 0;
+}
+
+static inline void ringbuffer_heap_free(struct ringbuffer_heap* heap)
+{
+	free(heap->m_entries);
+	heap->m_entries = NULL;
+	heap->m_size = 0;
+	heap->m_capacity = 0;
+}
+
+static inline void ringbuffer_heap_sift_down(struct ringbuffer_heap* heap, uint32_t pos)
+{
+	struct ringbuffer_heap_entry* e = heap->m_entries;
+	struct ringbuffer_heap_entry tmp = e[pos];
+
+	for(;;)
+	{
+		uint32_t child = 2 * pos + 1;
+		if(child >= heap->m_size)
+		{
+			break;
+		}
+
+		if(child + 1 < heap->m_size && e[child + 1].ts < e[child].ts)
+		{
+			child++;
+		}
+
+		if(tmp.ts <= e[child].ts)
+		{
+			break;
+		}
+
+		e[pos] = e[child];
+		pos = child;
+	}
+	e[pos] = tmp;
+}
+
+static inline void ringbuffer_heap_sift_up(struct ringbuffer_heap* heap, uint32_t pos)
+{
+	struct ringbuffer_heap_entry* e = heap->m_entries;
+	struct ringbuffer_heap_entry tmp = e[pos];
+
+	while(pos > 0)
+	{
+		uint32_t parent = (pos - 1) / 2;
+		if(e[parent].ts <= tmp.ts)
+		{
+			break;
+		}
+
+		e[pos] = e[parent];
+		pos = parent;
+	}
+	e[pos] = tmp;
+}
+
+/* Append an entry without restoring the heap property, call `ringbuffer_heap_build`
+ * when all the entries have been added.
+ */
+static inline void ringbuffer_heap_append(struct ringbuffer_heap* heap, uint64_t ts, uint32_t id)
+{
+	heap->m_entries[heap->m_size].ts = ts;
+	heap->m_entries[heap->m_size].id = id;
+	heap->m_size++;
+}
+
+static inline void ringbuffer_heap_build(struct ringbuffer_heap* heap)
+{
+	uint32_t j;
+
+	for(j = heap->m_size / 2; j > 0; j--)
+	{
+		ringbuffer_heap_sift_down(heap, j - 1);
+	}
+}
+
+static inline void ringbuffer_heap_push(struct ringbuffer_heap* heap, uint64_t ts, uint32_t id)
+{
+	/* With a relaxed ordering the top may be newer than its children, see
+	 * `ringbuffer_heap_update_top_window`: fix it before moving it down the tree.
+	 */
+	if(heap->m_size > 0)
+	{
+		ringbuffer_heap_sift_down(heap, 0);
+	}
+	ringbuffer_heap_append(heap, ts, id);
+	ringbuffer_heap_sift_up(heap, heap->m_size - 1);
+}
+
+static inline void ringbuffer_heap_pop(struct ringbuffer_heap* heap)
+{
+	heap->m_size--;
+	if(heap->m_size > 0)
+	{
+		heap->m_entries[0] = heap->m_entries[heap->m_size];
+		ringbuffer_heap_sift_down(heap, 0);
+	}
+}
+
+/* Update the timestamp of the top entry after its ring has been consumed. */
+static inline void ringbuffer_heap_update_top(struct ringbuffer_heap* heap, uint64_t ts)
+{
+	heap->m_entries[0].ts = ts;
+	ringbuffer_heap_sift_down(heap, 0);
+}
+
+/* Like `ringbuffer_heap_update_top` but leave the top entry in place as long as
+ * `ts` is at most `window` ns newer than the oldest of the other entries, so that
+ * the same ring is drained in a contiguous batch. A `window` of 0 gives the strict
+ * ordering, `UINT64_MAX` never switches ring until the top one is empty.
+ */
+static inline void ringbuffer_heap_update_top_window(struct ringbuffer_heap* heap, uint64_t ts, uint64_t window)
+{
+	uint64_t next_ts = UINT64_MAX;
+
+	if(window != 0)
+	{
+		if(heap->m_size > 1)
+		{
+			next_ts = heap->m_entries[1].ts;
+		}
+		if(heap->m_size > 2 && heap->m_entries[2].ts < next_ts)
+		{
+			next_ts = heap->m_entries[2].ts;
+		}
+
+		if(ts <= next_ts || ts - next_ts <= window)
+		{
+			heap->m_entries[0].ts = ts;
+			return;
+		}
+	}
+	ringbuffer_heap_update_top(heap, ts);
+}
+
+/* Like `ringbuffer_heap_update_top_window`, for rings that are read up to a cached
+ * producer position. `refilled` tells that the top ring has just reloaded that
+ * position, so the data available when it was selected has been consumed: as the
+ * kmod engine does on every new block, the top is then placed with the strict
+ * ordering, otherwise a ring that keeps receiving events would never leave the
+ * top with the per-CPU order.
+ */
+static inline void ringbuffer_heap_update_top_refill(struct ringbuffer_heap* heap, uint64_t ts, uint64_t window,
+						     bool refilled)
+{
+	if(refilled)
+	{
+		ringbuffer_heap_update_top(heap, ts);
+	}
+	else
+	{
+		ringbuffer_heap_update_top_window(heap, ts, window);
+	}
+}
+
+/* Timestamp of the newest head in the heap, 0 if it is empty. */
+static inline uint64_t ringbuffer_heap_max_ts(const struct ringbuffer_heap* heap)
+{
+	uint64_t ts = 0;
+	uint32_t j;
+
+	for(j = 0; j < heap->m_size; j++)
+	{
+		if(heap->m_entries[j].ts > ts)
+		{
+			ts = heap->m_entries[j].ts;
+		}
+	}
+	return ts;
+}
+
+/* Window to pass to `ringbuffer_heap_update_top_window` for the given order mode. */
+static inline uint64_t ringbuffer_order_window_ns(enum scap_ringbuffer_order_mode mode, uint64_t window_ns)
+{
+	switch(mode)
+	{
+	case SCAP_RINGBUFFER_ORDER_WINDOW:
+		return window_ns;
+	case SCAP_RINGBUFFER_ORDER_PER_CPU:
+		return UINT64_MAX;
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/*!
+	 * \brief Strategy used by the live engines (kmod, bpf, modern_bpf) to select
+	 * the event with the lowest timestamp among all the ring buffers.
+	 */
+	enum scap_ringbuffer_merge_mode
+	{
+		SCAP_RINGBUFFER_MERGE_HEAP = 0,	  ///< Keep the ring heads in a min-heap, O(log(nrings)) for every event.
+		SCAP_RINGBUFFER_MERGE_LINEAR = 1, ///< Scan all the ring buffers for every event (legacy behavior).
+	};
+
+	/*!
+	 * \brief How strictly the live engines order the events coming from different
+	 * ring buffers. The relaxed modes are honored only by `SCAP_RINGBUFFER_MERGE_HEAP`.
+	 */
+	enum scap_ringbuffer_order_mode
+	{
+		SCAP_RINGBUFFER_ORDER_STRICT = 0,  ///< Always return the event with the lowest timestamp (default). The heap merge looks for new events in all the empty rings whenever the oldest head passes the newest head seen when it last looked, so its cost stays linear in the idle rings when a single ring is busy: prefer `SCAP_RINGBUFFER_ORDER_WINDOW` for throughput.
+		SCAP_RINGBUFFER_ORDER_WINDOW = 1,  ///< Keep draining the same ring while its events are at most `order_window_ns` newer than the oldest event of the other rings.
+		SCAP_RINGBUFFER_ORDER_PER_CPU = 2, ///< Drain every ring until its block is empty, only the order inside a single ring is preserved.
+	};
+
+	/*!
+	 * \brief How the live engines wait for new events when the ring buffers are (almost) empty.
+	 */
+	enum scap_ringbuffer_wait_mode
+	{
+		SCAP_RINGBUFFER_WAIT_BACKOFF = 0,  ///< Sleep with an exponential backoff up to 30 ms (default).
+		SCAP_RINGBUFFER_WAIT_ADAPTIVE = 1, ///< Never hold events for more than `wait_latency_us` and sleep at most `wait_idle_us` when there is nothing to read. The modern_bpf engine blocks on the ring buffers readiness instead of sleeping.
+	};
+
+#ifdef __cplusplus
+};
+#endif
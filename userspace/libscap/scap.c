@@ -251,6 +251,36 @@ int32_t scap_next(scap_t* handle, scap_evt** pevent, uint16_t* pdevid, uint32_t*
 	return res;
 }
 
+int32_t scap_next_batch(scap_t* handle, scap_evt** pevents, uint16_t* pdevids, uint32_t* pflags, uint32_t max_events,
+			uint32_t* pnevents)
+{
+	int32_t res = SCAP_FAILURE;
+
+	*pnevents = 0;
+	if(handle && handle->m_vtable && max_events > 0)
+	{
+		if(handle->m_vtable->next_batch)
+		{
+			res = handle->m_vtable->next_batch(handle->m_engine, pevents, pdevids, pflags, max_events, pnevents);
+		}
+		else
+		{
+			res = handle->m_vtable->next(handle->m_engine, pevents, pdevids, pflags);
+			if(res == SCAP_SUCCESS)
+			{
+				*pnevents = 1;
+			}
+		}
+	}
+
+	if(res == SCAP_SUCCESS)
+	{
+		handle->m_evtcnt += *pnevents;
+	}
+
+	return res;
+}
+
 //
 // Return the number of dropped events for the given handle.
 //
@@ -537,6 +567,34 @@ void scap_fseek(scap_t *handle, uint64_t off)
 	}
 }
 
+int32_t scap_fseek_ts(scap_t *handle, uint64_t ts, uint64_t* evtnum)
+{
+	if(handle && handle->m_vtable->savefile_ops)
+	{
+		return handle->m_vtable->savefile_ops->fseek_capture_ts(handle->m_engine, ts, evtnum);
+	}
+
+	if(handle)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "operation not supported");
+	}
+	return SCAP_FAILURE;
+}
+
+int32_t scap_fseek_evtnum(scap_t *handle, uint64_t evtnum)
+{
+	if(handle && handle->m_vtable->savefile_ops)
+	{
+		return handle->m_vtable->savefile_ops->fseek_capture_evtnum(handle->m_engine, evtnum);
+	}
+
+	if(handle)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "operation not supported");
+	}
+	return SCAP_FAILURE;
+}
+
 int32_t scap_get_n_tracepoint_hit(scap_t* handle, long* ret)
 {
 	if(!handle)
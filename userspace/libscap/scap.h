@@ -571,6 +571,27 @@ uint64_t scap_max_buf_used(scap_t* handle);
 */
 int32_t scap_next(scap_t* handle, scap_evt** pevent, uint16_t* pcpuid, uint32_t* pflags);
 
+/*!
+  \brief Get the next batch of events from the given capture instance
+
+  The events are returned in the same order as with \ref scap_next, but the
+  live engines collect them with a single call and return pointers into their
+  ring buffers. All the events stay valid until the next call to \ref scap_next
+  or \ref scap_next_batch. Engines without batch support return one event per call.
+
+  \param handle Handle to the capture instance.
+  \param pevents [out] User-provided array of `max_events` event pointers.
+  \param pdevids [out] User-provided array of `max_events` device IDs.
+  \param pflags [out] User-provided array of `max_events` event flags.
+  \param max_events Capacity of the arrays, must be at least 1.
+  \param pnevents [out] Number of events stored in the arrays.
+
+  \return SCAP_SUCCESS if at least one event is returned, otherwise the same
+   codes as \ref scap_next.
+*/
+int32_t scap_next_batch(scap_t* handle, scap_evt** pevents, uint16_t* pdevids, uint32_t* pflags, uint32_t max_events,
+			uint32_t* pnevents);
+
 /*!
   \brief Get the length of an event
 
@@ -876,6 +897,28 @@ int32_t scap_enable_dynamic_snaplen(scap_t* handle);
 int32_t scap_disable_dynamic_snaplen(scap_t* handle);
 uint64_t scap_ftell(scap_t *handle);
 void scap_fseek(scap_t *handle, uint64_t off);
+
+/*!
+  \brief Move the reading of a capture file to its first event with a
+         timestamp not lower than ts, or to its end. The events are located
+         through the index of the capture, which is read from the end of the
+         file or from its sidecar file, or otherwise is built reading the whole
+         capture and saved in the sidecar file.
+
+  \param handle Handle to the capture instance.
+  \param ts The timestamp to seek to.
+  \param evtnum If not NULL, set to the number of the event at the new
+         position, 0 being the first one of the capture.
+
+  \return SCAP_SUCCESS or SCAP_FAILURE.
+*/
+int32_t scap_fseek_ts(scap_t *handle, uint64_t ts, uint64_t* evtnum);
+
+/*!
+  \brief Like \ref scap_fseek_ts, moving to the event with the given number.
+*/
+int32_t scap_fseek_evtnum(scap_t *handle, uint64_t evtnum);
+
 int32_t scap_fd_add(scap_threadinfo* tinfo, scap_fdinfo* fdinfo);
 
 int32_t scap_get_n_tracepoint_hit(scap_t* handle, long* ret);
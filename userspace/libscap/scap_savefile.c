@@ -48,6 +48,174 @@ const char* scap_dump_getlasterr(scap_dumper_t* d)
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+#if defined(USE_ZLIB)
+//
+// State of a dump file written with SCAP_COMPRESSION_GZIP_BLOCKS
+//
+struct scap_dump_block
+{
+	z_stream m_stream;
+	int m_level;
+	int m_stream_level;
+	uint8_t* m_in; // Data of the block being filled
+	uint32_t m_inlen;
+	uint8_t* m_out; // Compressed gzip member of the last block
+	uint32_t m_outsize;
+	uint64_t m_total_in;
+};
+
+static struct scap_dump_block* scap_dump_block_create()
+{
+	struct scap_dump_block* b = (struct scap_dump_block*)calloc(1, sizeof(struct scap_dump_block));
+	if(b == NULL)
+	{
+		return NULL;
+	}
+
+	b->m_level = Z_BEST_SPEED;
+	b->m_stream_level = Z_BEST_SPEED;
+	if(deflateInit2(&b->m_stream, b->m_stream_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		free(b);
+		return NULL;
+	}
+
+	b->m_in = (uint8_t*)malloc(SCAP_GZIP_BLOCK_SIZE);
+	b->m_outsize = sizeof(gzip_block_header) + compressBound(SCAP_GZIP_BLOCK_SIZE) + 2 * sizeof(uint32_t);
+	b->m_out = (uint8_t*)malloc(b->m_outsize);
+	if(b->m_in == NULL || b->m_out == NULL)
+	{
+		deflateEnd(&b->m_stream);
+		free(b->m_in);
+		free(b->m_out);
+		free(b);
+		return NULL;
+	}
+
+	return b;
+}
+
+static void scap_dump_block_free(struct scap_dump_block* b)
+{
+	deflateEnd(&b->m_stream);
+	free(b->m_in);
+	free(b->m_out);
+	free(b);
+}
+
+//
+// Compress the block being filled into its own gzip member
+//
+static int scap_dump_block_flush(scap_dumper_t *d)
+{
+	struct scap_dump_block* b = d->m_block;
+	gzip_block_header* gh = (gzip_block_header*)b->m_out;
+	z_stream* zs = &b->m_stream;
+	uint32_t trailer[2];
+	uint32_t member_size;
+
+	if(b->m_inlen == 0)
+	{
+		return 0;
+	}
+
+	if(deflateReset(zs) != Z_OK)
+	{
+		return -1;
+	}
+
+	if(b->m_level != b->m_stream_level)
+	{
+		if(deflateParams(zs, b->m_level, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			return -1;
+		}
+		b->m_stream_level = b->m_level;
+	}
+
+	zs->next_in = b->m_in;
+	zs->avail_in = b->m_inlen;
+	zs->next_out = b->m_out + sizeof(gzip_block_header);
+	zs->avail_out = b->m_outsize - sizeof(gzip_block_header) - sizeof(trailer);
+	if(deflate(zs, Z_FINISH) != Z_STREAM_END)
+	{
+		return -1;
+	}
+
+	member_size = sizeof(gzip_block_header) + zs->total_out + sizeof(trailer);
+
+	gh->id1 = 0x1f;
+	gh->id2 = 0x8b;
+	gh->cm = Z_DEFLATED;
+	gh->flg = 0x04; // FEXTRA
+	gh->mtime = 0;
+	gh->xfl = 0;
+	gh->os = 0xff; // unknown
+	gh->xlen = 8;
+	gh->si1 = SCAP_GZIP_BLOCK_SI1;
+	gh->si2 = SCAP_GZIP_BLOCK_SI2;
+	gh->slen = sizeof(gh->member_size);
+	gh->member_size = member_size;
+
+	trailer[0] = crc32(0, b->m_in, b->m_inlen);
+	trailer[1] = b->m_inlen;
+	memcpy(b->m_out + member_size - sizeof(trailer), trailer, sizeof(trailer));
+
+	if(gzwrite(d->m_f, b->m_out, member_size) != (int)member_size)
+	{
+		return -1;
+	}
+
+	b->m_inlen = 0;
+	return 0;
+}
+
+static int scap_dump_block_write(scap_dumper_t *d, void* buf, unsigned len)
+{
+	struct scap_dump_block* b = d->m_block;
+	uint8_t* data = (uint8_t*)buf;
+	unsigned left = len;
+
+	while(left > 0)
+	{
+		uint32_t n = SCAP_GZIP_BLOCK_SIZE - b->m_inlen;
+		if(n > left)
+		{
+			n = left;
+		}
+
+		memcpy(b->m_in + b->m_inlen, data, n);
+		b->m_inlen += n;
+		data += n;
+		left -= n;
+
+		if(b->m_inlen == SCAP_GZIP_BLOCK_SIZE && scap_dump_block_flush(d) != 0)
+		{
+			return -1;
+		}
+	}
+
+	b->m_total_in += len;
+	return len;
+}
+#endif
+
+//
+// Index of the events of a dump file
+//
+struct scap_dump_index
+{
+	uint32_t m_interval;
+	uint64_t m_nevts;
+	uint64_t m_max_ts;
+	idx_entry* m_entries;
+	uint32_t m_size;
+	uint32_t m_capacity;
+};
+
+// beyond this, every other entry is dropped and the interval doubles
+#define SCAP_DUMP_INDEX_MAX_ENTRIES (1 << 20)
+
 //
 // Write data into a dump file
 //
@@ -55,6 +223,12 @@ static int scap_dump_write(scap_dumper_t *d, void* buf, unsigned len)
 {
 	if(d->m_type == DT_FILE)
 	{
+#if defined(USE_ZLIB)
+		if(d->m_block != NULL)
+		{
+			return scap_dump_block_write(d, buf, len);
+		}
+#endif
 		return gzwrite(d->m_f, buf, len);
 	}
 	else
@@ -1116,7 +1290,7 @@ static int32_t scap_setup_dump(scap_dumper_t* d, struct scap_platform *platform,
 }
 
 // fname is only used for log messages in scap_setup_dump
-static scap_dumper_t *scap_dump_open_gzfile(struct scap_platform* platform, gzFile gzfile, const char *fname, char* lasterr)
+static scap_dumper_t *scap_dump_open_gzfile(struct scap_platform* platform, gzFile gzfile, compression_mode compress, const char *fname, char* lasterr)
 {
 	scap_dumper_t* res = (scap_dumper_t*)malloc(sizeof(scap_dumper_t));
 	res->m_f = gzfile;
@@ -1124,10 +1298,32 @@ static scap_dumper_t *scap_dump_open_gzfile(struct scap_platform* platform, gzFi
 	res->m_targetbuf = NULL;
 	res->m_targetbufcurpos = NULL;
 	res->m_targetbufend = NULL;
+	res->m_block = NULL;
+	res->m_index = NULL;
+
+#if defined(USE_ZLIB)
+	if(compress == SCAP_COMPRESSION_GZIP_BLOCKS)
+	{
+		res->m_block = scap_dump_block_create();
+		if(res->m_block == NULL)
+		{
+			snprintf(lasterr, SCAP_LASTERR_SIZE, "can't initialize the compression of %s", fname);
+			gzclose(gzfile);
+			free(res);
+			return NULL;
+		}
+	}
+#endif
 
 	if(scap_setup_dump(res, platform, fname) != SCAP_SUCCESS)
 	{
 		strlcpy(lasterr, res->m_lasterr, SCAP_LASTERR_SIZE);
+#if defined(USE_ZLIB)
+		if(res->m_block != NULL)
+		{
+			scap_dump_block_free(res->m_block);
+		}
+#endif
 		free(res);
 		res = NULL;
 	}
@@ -1151,6 +1347,10 @@ scap_dumper_t *scap_dump_open(struct scap_platform *platform, const char *fname,
 		mode = "wb";
 		break;
 	case SCAP_COMPRESSION_NONE:
+#if defined(USE_ZLIB)
+	case SCAP_COMPRESSION_GZIP_BLOCKS:
+#endif
+		// blocks are compressed by the dumper itself
 		mode = "wbT";
 		break;
 	default:
@@ -1190,7 +1390,7 @@ scap_dumper_t *scap_dump_open(struct scap_platform *platform, const char *fname,
 		return NULL;
 	}
 
-	return scap_dump_open_gzfile(platform, f, fname, lasterr);
+	return scap_dump_open_gzfile(platform, f, compress, fname, lasterr);
 }
 
 //
@@ -1205,6 +1405,9 @@ scap_dumper_t* scap_dump_open_fd(struct scap_platform* platform, int fd, compres
 		f = gzdopen(fd, "wb");
 		break;
 	case SCAP_COMPRESSION_NONE:
+#if defined(USE_ZLIB)
+	case SCAP_COMPRESSION_GZIP_BLOCKS:
+#endif
 		f = gzdopen(fd, "wbT");
 		break;
 	default:
@@ -1219,7 +1422,7 @@ scap_dumper_t* scap_dump_open_fd(struct scap_platform* platform, int fd, compres
 		return NULL;
 	}
 
-	return scap_dump_open_gzfile(platform, f, "", lasterr);
+	return scap_dump_open_gzfile(platform, f, compress, "", lasterr);
 }
 
 //
@@ -1239,6 +1442,8 @@ scap_dumper_t *scap_memory_dump_open(struct scap_platform* platform, uint8_t* ta
 	res->m_targetbuf = targetbuf;
 	res->m_targetbufcurpos = targetbuf;
 	res->m_targetbufend = targetbuf + targetbufsize;
+	res->m_block = NULL;
+	res->m_index = NULL;
 
 	if(scap_setup_dump(res, platform, "") != SCAP_SUCCESS)
 	{
@@ -1266,6 +1471,8 @@ scap_dumper_t *scap_managedbuf_dump_create()
 	res->m_targetbuf = (uint8_t *)malloc(PPM_DUMPER_MANAGED_BUF_SIZE);
 	res->m_targetbufcurpos = res->m_targetbuf;
 	res->m_targetbufend = res->m_targetbuf + PPM_DUMPER_MANAGED_BUF_SIZE;
+	res->m_block = NULL;
+	res->m_index = NULL;
 
 	return res;
 }
@@ -1273,10 +1480,130 @@ scap_dumper_t *scap_managedbuf_dump_create()
 //
 // Close a "savefile" opened with scap_dump_open
 //
+static int32_t scap_write_index(scap_dumper_t *d)
+{
+	struct scap_dump_index* idx = d->m_index;
+	block_header bh;
+	uint32_t bt;
+	uint32_t entries_len = idx->m_size * sizeof(idx_entry);
+
+	bh.block_type = IDX_BLOCK_TYPE;
+	bh.block_total_length = sizeof(block_header) + entries_len + 4;
+	bt = bh.block_total_length;
+
+	if(scap_dump_write(d, &bh, sizeof(bh)) != sizeof(bh) ||
+	        scap_dump_write(d, idx->m_entries, entries_len) != (int)entries_len ||
+	        scap_dump_write(d, &bt, sizeof(bt)) != sizeof(bt))
+	{
+		snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "error writing to file (index)");
+		return SCAP_FAILURE;
+	}
+
+	return SCAP_SUCCESS;
+}
+
+static int32_t scap_dump_index_add(scap_dumper_t *d, scap_evt *e)
+{
+	struct scap_dump_index* idx = d->m_index;
+	uint64_t evtnum = idx->m_nevts++;
+	uint64_t max_ts = idx->m_max_ts;
+
+	if(e->ts > idx->m_max_ts)
+	{
+		idx->m_max_ts = e->ts;
+	}
+
+	if(evtnum % idx->m_interval != 0)
+	{
+		return SCAP_SUCCESS;
+	}
+
+	if(idx->m_size == SCAP_DUMP_INDEX_MAX_ENTRIES)
+	{
+		for(uint32_t j = 0; j < idx->m_size / 2; j++)
+		{
+			idx->m_entries[j] = idx->m_entries[j * 2];
+		}
+		idx->m_size /= 2;
+		idx->m_interval *= 2;
+		if(evtnum % idx->m_interval != 0)
+		{
+			return SCAP_SUCCESS;
+		}
+	}
+
+	if(idx->m_size == idx->m_capacity)
+	{
+		uint32_t capacity = idx->m_capacity == 0 ? 1024 : idx->m_capacity * 2;
+		idx_entry* entries = (idx_entry*)realloc(idx->m_entries, capacity * sizeof(idx_entry));
+		if(entries == NULL)
+		{
+			snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "index memory allocation failure");
+			return SCAP_FAILURE;
+		}
+		idx->m_entries = entries;
+		idx->m_capacity = capacity;
+	}
+
+	idx->m_entries[idx->m_size].ts = max_ts;
+	idx->m_entries[idx->m_size].pos = scap_dump_ftell(d);
+	idx->m_entries[idx->m_size].evtnum = evtnum;
+	idx->m_size++;
+	return SCAP_SUCCESS;
+}
+
+int32_t scap_dump_enable_index(scap_dumper_t *d, uint32_t interval)
+{
+	if(d->m_type != DT_FILE)
+	{
+		snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "the index is supported only for files");
+		return SCAP_FAILURE;
+	}
+
+#if defined(USE_ZLIB)
+	// a gzip stream can only be read from the start, nothing could use the index
+	if(d->m_block == NULL && !gzdirect(d->m_f))
+	{
+		snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "the index is not supported for gzip files, use the gzip blocks compression");
+		return SCAP_FAILURE;
+	}
+#endif
+
+	if(d->m_index == NULL)
+	{
+		d->m_index = (struct scap_dump_index*)calloc(1, sizeof(struct scap_dump_index));
+		if(d->m_index == NULL)
+		{
+			snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "index memory allocation failure");
+			return SCAP_FAILURE;
+		}
+	}
+
+	d->m_index->m_interval = interval == 0 ? 1 : interval;
+	return SCAP_SUCCESS;
+}
+
 void scap_dump_close(scap_dumper_t *d)
 {
+	if(d->m_index != NULL)
+	{
+		if(d->m_index->m_size > 0)
+		{
+			scap_write_index(d);
+		}
+		free(d->m_index->m_entries);
+		free(d->m_index);
+	}
+
 	if(d->m_type == DT_FILE)
 	{
+#if defined(USE_ZLIB)
+		if(d->m_block != NULL)
+		{
+			scap_dump_block_flush(d);
+			scap_dump_block_free(d->m_block);
+		}
+#endif
 		gzclose(d->m_f);
 	}
 	else if (d->m_type == DT_MANAGED_BUF)
@@ -1306,6 +1633,12 @@ int64_t scap_dump_ftell(scap_dumper_t *d)
 {
 	if(d->m_type == DT_FILE)
 	{
+#if defined(USE_ZLIB)
+		if(d->m_block != NULL)
+		{
+			return d->m_block->m_total_in;
+		}
+#endif
 		return gztell(d->m_f);
 	}
 	else
@@ -1318,10 +1651,49 @@ void scap_dump_flush(scap_dumper_t *d)
 {
 	if(d->m_type == DT_FILE)
 	{
+#if defined(USE_ZLIB)
+		if(d->m_block != NULL)
+		{
+			scap_dump_block_flush(d);
+		}
+#endif
 		gzflush(d->m_f, Z_FULL_FLUSH);
 	}
 }
 
+int32_t scap_dump_set_compression_level(scap_dumper_t *d, int level)
+{
+#if defined(USE_ZLIB)
+	if(d->m_type != DT_FILE)
+	{
+		snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "the dump is not compressed");
+		return SCAP_FAILURE;
+	}
+
+	if(level != SCAP_COMPRESSION_LEVEL_DEFAULT && (level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION))
+	{
+		snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "invalid compression level %d", level);
+		return SCAP_FAILURE;
+	}
+
+	if(d->m_block != NULL)
+	{
+		d->m_block->m_level = level == SCAP_COMPRESSION_LEVEL_DEFAULT ? Z_BEST_SPEED : level;
+		return SCAP_SUCCESS;
+	}
+
+	if(gzsetparams(d->m_f, level == SCAP_COMPRESSION_LEVEL_DEFAULT ? Z_DEFAULT_COMPRESSION : level, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "can't set the compression level %d", level);
+		return SCAP_FAILURE;
+	}
+	return SCAP_SUCCESS;
+#else
+	snprintf(d->m_lasterr, SCAP_LASTERR_SIZE, "compression not supported");
+	return SCAP_FAILURE;
+#endif
+}
+
 //
 // Write an event to a dump file
 //
@@ -1331,6 +1703,11 @@ int32_t scap_dump(scap_dumper_t *d, scap_evt *e, uint16_t cpuid, uint32_t flags)
 	uint32_t bt;
 	bool large_payload = flags & SCAP_DF_LARGE;
 
+	if(d->m_index != NULL && scap_dump_index_add(d, e) != SCAP_SUCCESS)
+	{
+		return SCAP_FAILURE;
+	}
+
 	flags &= ~SCAP_DF_LARGE;
 	if(flags == 0)
 	{
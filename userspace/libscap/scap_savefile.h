@@ -153,4 +153,50 @@ typedef struct _section_header_block
 
 #define EVF_BLOCK_TYPE_V2_LARGE		0x222
 
+///////////////////////////////////////////////////////////////////////////////
+// INDEX BLOCK
+///////////////////////////////////////////////////////////////////////////////
+// Optional block at the end of a capture, listing the position of one event
+// every few ones. The same block can be saved alone in a sidecar file, named
+// after the capture with the SCAP_INDEX_SIDECAR_SUFFIX suffix.
+#define IDX_BLOCK_TYPE			0x223
+
+#define SCAP_INDEX_SIDECAR_SUFFIX	".idx"
+
+typedef struct _idx_entry
+{
+	uint64_t ts; // Highest timestamp of the events before this one, since
+	             // the events of different CPUs are not sorted by timestamp
+	uint64_t pos; // Position of the event block, in uncompressed bytes
+	uint64_t evtnum; // Number of the event, 0 being the first one
+}idx_entry;
+
+///////////////////////////////////////////////////////////////////////////////
+// GZIP BLOCKS
+///////////////////////////////////////////////////////////////////////////////
+// Captures written with SCAP_COMPRESSION_GZIP_BLOCKS are a sequence of gzip
+// members, each one compressing on its own up to SCAP_GZIP_BLOCK_SIZE bytes
+// of the capture. The header of every member has an extra field with the
+// total size of the member, so that readers can find the members without
+// decompressing them. The files are still valid gzip files.
+#define SCAP_GZIP_BLOCK_SIZE	(256 * 1024)
+#define SCAP_GZIP_BLOCK_SI1		'S'
+#define SCAP_GZIP_BLOCK_SI2		'C'
+
+typedef struct _gzip_block_header
+{
+	uint8_t id1;
+	uint8_t id2;
+	uint8_t cm;
+	uint8_t flg;
+	uint32_t mtime;
+	uint8_t xfl;
+	uint8_t os;
+	uint16_t xlen; // Length of the extra field, holding only the subfield below
+	uint8_t si1;
+	uint8_t si2;
+	uint16_t slen;
+	uint32_t member_size; // Member length, including this header and the trailing crc32 and size.
+}gzip_block_header;
+
 #pragma pack(pop)
@@ -40,6 +40,9 @@ typedef enum ppm_dumper_type
 #define PPM_DUMPER_MANAGED_BUF_SIZE (3 * 1024 * 1024)
 #define PPM_DUMPER_MANAGED_BUF_RESIZE_FACTOR (1.25)
 
+struct scap_dump_block;
+struct scap_dump_index;
+
 typedef struct scap_dumper
 {
 	gzFile m_f;
@@ -47,6 +50,8 @@ typedef struct scap_dumper
 	uint8_t* m_targetbuf;
 	uint8_t* m_targetbufcurpos;
 	uint8_t* m_targetbufend;
+	struct scap_dump_block* m_block;
+	struct scap_dump_index* m_index;
 	char m_lasterr[SCAP_LASTERR_SIZE];
 } scap_dumper_t;
 
@@ -60,9 +65,20 @@ struct iovec;
 typedef enum compression_mode
 {
 	SCAP_COMPRESSION_NONE = 0,
-	SCAP_COMPRESSION_GZIP = 1
+	SCAP_COMPRESSION_GZIP = 1,
+	SCAP_COMPRESSION_GZIP_BLOCKS = 2 ///< gzip-compatible, in independent blocks that can be decompressed ahead of reading
 } compression_mode;
 
+/*!
+  \brief Use the default compression level of the compression mode
+*/
+#define SCAP_COMPRESSION_LEVEL_DEFAULT (-1)
+
+/*!
+  \brief Default number of events between two entries of the index of a trace file
+*/
+#define SCAP_INDEX_INTERVAL_DEFAULT 1000
+
 uint8_t* scap_get_memorydumper_curpos(scap_dumper_t *d);
 int32_t scap_write_proc_fds(scap_dumper_t *d, struct scap_threadinfo *tinfo);
 scap_dumper_t* scap_write_proclist_begin();
@@ -104,6 +120,37 @@ scap_dumper_t *scap_dump_open(struct scap_platform *platform, const char *fname,
 */
 scap_dumper_t* scap_dump_open_fd(struct scap_platform* platform, int fd, compression_mode compress, bool skip_proc_scan, char* lasterr);
 
+/*!
+  \brief Set the compression level of a trace file, from 1 (fastest) to 9
+         (smallest), for the data written from now on. The default level is
+         the zlib one for SCAP_COMPRESSION_GZIP and the fastest one for
+         SCAP_COMPRESSION_GZIP_BLOCKS.
+
+  \param d The dump handle, returned by \ref scap_dump_open
+  \param level The compression level, or SCAP_COMPRESSION_LEVEL_DEFAULT
+
+  \return SCAP_SUCCESS, or SCAP_FAILURE if the level is invalid or d doesn't
+          write to a file
+*/
+int32_t scap_dump_set_compression_level(scap_dumper_t *d, int level);
+
+/*!
+  \brief Write an index of the events at the end of a trace file when it gets
+         closed, with an entry every interval events, so that readers can
+         seek through the file by timestamp or event number. Trace files
+         with an index can't be read by library versions older than this
+         feature. Only uncompressed files and files compressed with
+         SCAP_COMPRESSION_GZIP_BLOCKS can be indexed: a SCAP_COMPRESSION_GZIP
+         file can only be read from its start.
+
+  \param d The dump handle, returned by \ref scap_dump_open
+  \param interval The number of events between two entries of the index
+
+  \return SCAP_SUCCESS, or SCAP_FAILURE if d doesn't write to a file or
+          writes a SCAP_COMPRESSION_GZIP file
+*/
+int32_t scap_dump_enable_index(scap_dumper_t *d, uint32_t interval);
+
 /*!
   \brief Close a trace file.
 
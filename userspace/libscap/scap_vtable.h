@@ -98,6 +98,25 @@ struct scap_savefile_vtable {
 	 */
 	void (*fseek_capture)(struct scap_engine_handle engine, uint64_t off);
 
+	/**
+	 * @brief seek through the capture to the first event with a timestamp
+	 * not lower than the given one, using the index of the capture
+	 * @param engine the handle to the engine
+	 * @param ts the timestamp
+	 * @param evtnum if not NULL, set to the number of the event
+	 * @return SCAP_SUCCESS or a failure code
+	 */
+	int32_t (*fseek_capture_ts)(struct scap_engine_handle engine, uint64_t ts, uint64_t* evtnum);
+
+	/**
+	 * @brief seek through the capture to the event with the given number,
+	 * 0 being the first one, using the index of the capture
+	 * @param engine the handle to the engine
+	 * @param evtnum the event number
+	 * @return SCAP_SUCCESS or a failure code
+	 */
+	int32_t (*fseek_capture_evtnum)(struct scap_engine_handle engine, uint64_t evtnum);
+
 	/**
 	 * @brief restart a capture from the current offset
 	 * @param handle the full scap_t handle
@@ -257,6 +276,24 @@ struct scap_vtable {
 	 * @return the schema version
 	 */
 	uint64_t (*get_schema_version)(struct scap_engine_handle engine);
+
+	/**
+	 * @brief fetch a batch of events, optional
+	 * @param engine wraps the pointer to the engine-specific handle
+	 * @param pevents [out] array of `max_events` pointers where the events get stored
+	 * @param pdevids [out] array of `max_events` devices on which the events were received
+	 * @param pflags [out] array of `max_events` flags of the events
+	 * @param max_events the maximum number of events to return, at least 1
+	 * @param pnevents [out] where the number of returned events gets stored
+	 * @return SCAP_SUCCESS or a failure code, like next()
+	 *
+	 * SCAP_SUCCESS is returned only with at least one event, in the same
+	 * order next() would return them. The memory pointed to by all the
+	 * events must remain valid at least until the next call to next()
+	 * or next_batch(). When NULL, scap_next_batch() falls back to next().
+	 */
+	int32_t (*next_batch)(struct scap_engine_handle engine, scap_evt** pevents, uint16_t* pdevids, uint32_t* pflags,
+			      uint32_t max_events, uint32_t* pnevents);
 };
 
 #ifdef __cplusplus
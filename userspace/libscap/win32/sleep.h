@@ -24,3 +24,8 @@ static inline void sleep_ms(int ms)
 {
 	Sleep((DWORD)ms);
 }
+
+static inline void sleep_us(int us)
+{
+	Sleep((DWORD)((us + 999) / 1000));
+}
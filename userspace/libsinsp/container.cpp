@@ -136,6 +136,7 @@ bool sinsp_container_manager::resolve_container(sinsp_threadinfo* tinfo, bool qu
 	bool matches = false;
 
 	tinfo->m_container_id = "";
+	tinfo->invalidate_snapshot();
 	if(m_inspector->get_observer())
 	{
 		matches = m_inspector->get_observer()->on_resolve_container(this, tinfo, query_os_for_missing_info);
@@ -450,6 +451,9 @@ void sinsp_container_manager::identify_category(sinsp_threadinfo *tinfo)
 		return;
 	}
 
+	// the category may be set below
+	tinfo->invalidate_snapshot();
+
 	if(tinfo->m_vpid == 1)
 	{
 		if(libsinsp_logger()->get_severity() >= sinsp_logger::SEV_DEBUG)
@@ -172,11 +172,11 @@ sinsp_container_info::container_health_probe::probe_type sinsp_container_info::m
                 libsinsp_logger()->format(sinsp_logger::SEV_DEBUG,
 				"match_health_probe (%s): Matching tinfo %s %d against %s %d",
 				m_id.c_str(),
-				tinfo->m_exe.c_str(), tinfo->m_args.size(),
+				tinfo->m_exe.c_str(), tinfo->get_args().size(),
 				p.m_health_probe_exe.c_str(), p.m_health_probe_args.size());
 
                 return (p.m_health_probe_exe == tinfo->m_exe &&
-			p.m_health_probe_args == tinfo->m_args);
+			p.m_health_probe_args == tinfo->get_args());
         };
 
 	auto match = std::find_if(m_health_probes.begin(),
@@ -27,6 +27,7 @@ sinsp_dumper::sinsp_dumper()
 	m_target_memory_buffer = NULL;
 	m_target_memory_buffer_size = 0;
 	m_nevts = 0;
+	m_index_interval = 0;
 }
 
 sinsp_dumper::sinsp_dumper(uint8_t* target_memory_buffer, uint64_t target_memory_buffer_size)
@@ -34,6 +35,7 @@ sinsp_dumper::sinsp_dumper(uint8_t* target_memory_buffer, uint64_t target_memory
 	m_dumper = NULL;
 	m_target_memory_buffer = target_memory_buffer;
 	m_target_memory_buffer_size = target_memory_buffer_size;
+	m_index_interval = 0;
 }
 
 sinsp_dumper::~sinsp_dumper()
@@ -45,6 +47,16 @@ sinsp_dumper::~sinsp_dumper()
 }
 
 void sinsp_dumper::open(sinsp* inspector, const std::string& filename, bool compress)
+{
+	open(inspector, filename, compress ? SCAP_COMPRESSION_GZIP : SCAP_COMPRESSION_NONE);
+}
+
+void sinsp_dumper::fdopen(sinsp* inspector, int fd, bool compress)
+{
+	fdopen(inspector, fd, compress ? SCAP_COMPRESSION_GZIP : SCAP_COMPRESSION_NONE);
+}
+
+void sinsp_dumper::open(sinsp* inspector, const std::string& filename, compression_mode compress, int compression_level)
 {
 	char error[SCAP_LASTERR_SIZE];
 	if(inspector->get_scap_handle() == NULL)
@@ -58,23 +70,13 @@ void sinsp_dumper::open(sinsp* inspector, const std::string& filename, bool comp
 	}
 	else
 	{
-		auto compress_mode = compress ? SCAP_COMPRESSION_GZIP : SCAP_COMPRESSION_NONE;
-		m_dumper = scap_dump_open(inspector->get_scap_platform(), filename.c_str(), compress_mode, error);
-	}
-
-	if(m_dumper == nullptr)
-	{
-		throw sinsp_exception(error);
+		m_dumper = scap_dump_open(inspector->get_scap_platform(), filename.c_str(), compress, error);
 	}
 
-	inspector->m_thread_manager->dump_threads_to_file(m_dumper);
-	inspector->m_container_manager.dump_containers(*this);
-	inspector->m_usergroup_manager.dump_users_groups(*this);
-
-	m_nevts = 0;
+	setup(inspector, m_target_memory_buffer ? SCAP_COMPRESSION_LEVEL_DEFAULT : compression_level, error);
 }
 
-void sinsp_dumper::fdopen(sinsp* inspector, int fd, bool compress)
+void sinsp_dumper::fdopen(sinsp* inspector, int fd, compression_mode compress, int compression_level)
 {
 	char error[SCAP_LASTERR_SIZE];
 	if(inspector->get_scap_handle() == NULL)
@@ -82,14 +84,28 @@ void sinsp_dumper::fdopen(sinsp* inspector, int fd, bool compress)
 		throw sinsp_exception("can't start event dump, inspector not opened yet");
 	}
 
-	auto compress_mode = compress ? SCAP_COMPRESSION_GZIP : SCAP_COMPRESSION_NONE;
-	m_dumper = scap_dump_open_fd(inspector->get_scap_platform(), fd, compress_mode, true, error);
+	m_dumper = scap_dump_open_fd(inspector->get_scap_platform(), fd, compress, true, error);
+
+	setup(inspector, compression_level, error);
+}
 
+void sinsp_dumper::setup(sinsp* inspector, int compression_level, const char* error)
+{
 	if(m_dumper == nullptr)
 	{
 		throw sinsp_exception(error);
 	}
 
+	if((compression_level != SCAP_COMPRESSION_LEVEL_DEFAULT &&
+	    scap_dump_set_compression_level(m_dumper, compression_level) != SCAP_SUCCESS) ||
+	   (m_index_interval != 0 &&
+	    scap_dump_enable_index(m_dumper, m_index_interval) != SCAP_SUCCESS))
+	{
+		std::string err = scap_dump_getlasterr(m_dumper);
+		close();
+		throw sinsp_exception(err);
+	}
+
 	inspector->m_thread_manager->dump_threads_to_file(m_dumper);
 	inspector->m_container_manager.dump_containers(*this);
 	inspector->m_usergroup_manager.dump_users_groups(*this);
@@ -97,6 +113,16 @@ void sinsp_dumper::fdopen(sinsp* inspector, int fd, bool compress)
 	m_nevts = 0;
 }
 
+void sinsp_dumper::enable_index(uint32_t interval)
+{
+	if(m_dumper != NULL)
+	{
+		throw sinsp_exception("can't enable the index, dumper already opened");
+	}
+
+	m_index_interval = interval == 0 ? 1 : interval;
+}
+
 void sinsp_dumper::close()
 {
 	if(m_dumper != NULL)
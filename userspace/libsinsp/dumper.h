@@ -74,6 +74,25 @@ public:
 
 	void fdopen(sinsp* inspector, int fd, bool compress);
 
+	/*!
+	  \brief Opens the dump file, with the given compression mode and level.
+	  The level goes from 1 (fastest) to 9 (smallest), see
+	  scap_dump_set_compression_level().
+	*/
+	void open(sinsp* inspector, const std::string& filename, compression_mode compress,
+		  int compression_level = SCAP_COMPRESSION_LEVEL_DEFAULT);
+
+	void fdopen(sinsp* inspector, int fd, compression_mode compress,
+		    int compression_level = SCAP_COMPRESSION_LEVEL_DEFAULT);
+
+	/*!
+	  \brief Adds an index of the events to the end of the file, with an
+	  entry every interval events, that lets readers seek by timestamp or
+	  event number. Must be called before opening the file, which then
+	  fails with the SCAP_COMPRESSION_GZIP mode. See scap_dump_enable_index().
+	*/
+	void enable_index(uint32_t interval = SCAP_INDEX_INTERVAL_DEFAULT);
+
 	/*!
 	  \brief Closes the dump file.
 	*/
@@ -129,11 +148,14 @@ public:
 	}
 
 private:
+	void setup(sinsp* inspector, int compression_level, const char* error);
+
 	sinsp* m_inspector;
 	scap_dumper_t* m_dumper;
 	uint8_t* m_target_memory_buffer;
 	uint64_t m_target_memory_buffer_size;
 	uint64_t m_nevts;
+	uint32_t m_index_interval;
 };
 
 /*@}*/
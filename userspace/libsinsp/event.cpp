@@ -121,6 +121,123 @@ sinsp_evt::~sinsp_evt()
 	}
 }
 
+std::unique_ptr<sinsp_evt> sinsp_evt::snapshot() const
+{
+	std::unique_ptr<uint8_t[]> evdata(new uint8_t[m_pevt->len]);
+	memcpy(evdata.get(), m_pevt, m_pevt->len);
+
+	auto ret = from_scap_evt(std::move(evdata));
+	ret->m_inspector = m_inspector;
+	ret->m_cpuid = m_cpuid;
+	ret->m_evtnum = m_evtnum;
+	ret->m_dump_flags = m_dump_flags;
+	ret->m_info = m_info;
+	ret->m_fdinfo_name_changed = m_fdinfo_name_changed;
+	ret->m_iosize = m_iosize;
+	ret->m_errorcode = m_errorcode;
+	ret->m_rawbuf_str_len = m_rawbuf_str_len;
+	ret->m_filtered_out = m_filtered_out;
+	ret->m_event_info_table = m_event_info_table;
+	ret->m_enter_path_param = m_enter_path_param;
+	ret->m_source_idx = m_source_idx;
+	ret->m_source_name = m_source_name;
+
+	// the threads, users and groups referenced by the parameters are looked
+	// up in the inspector when rendering them: copy them with the event
+	auto state = std::make_shared<snapshot_state>();
+	for(uint32_t j = 0; j < ret->get_num_params(); j++)
+	{
+		const sinsp_evt_param* param = ret->get_param(j);
+		switch(param->get_info()->type)
+		{
+		case PT_PID:
+			if(m_inspector != nullptr && param->m_len == sizeof(int64_t))
+			{
+				sinsp_threadinfo* tinfo = m_inspector->get_thread_ptr(param->as<int64_t>(), false, true);
+				if(tinfo != nullptr)
+				{
+					state->m_param_threads.push_back(tinfo->snapshot());
+				}
+			}
+			break;
+		case PT_UID:
+			if(m_tinfo != nullptr && param->m_len == sizeof(uint32_t))
+			{
+				scap_userinfo* user = m_inspector->m_usergroup_manager.get_user(m_tinfo->m_container_id, param->as<uint32_t>());
+				if(user != nullptr)
+				{
+					state->m_users.push_back(*user);
+				}
+			}
+			break;
+		case PT_GID:
+			if(m_tinfo != nullptr && param->m_len == sizeof(uint32_t))
+			{
+				scap_groupinfo* group = m_inspector->m_usergroup_manager.get_group(m_tinfo->m_container_id, param->as<uint32_t>());
+				if(group != nullptr)
+				{
+					state->m_groups.push_back(*group);
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	if(m_inspector != nullptr && m_inspector->get_parser()->get_syslog_decoder().is_data_valid())
+	{
+		state->m_syslog_decoder = m_inspector->get_parser()->get_syslog_decoder();
+	}
+
+	if(m_tinfo != nullptr)
+	{
+		// the shared snapshot of the thread doesn't have the values
+		// updated by every event
+		state->m_lastevent_fd = m_tinfo->m_lastevent_fd;
+		state->m_lastevent_ts = m_tinfo->m_lastevent_ts;
+		state->m_latency = m_tinfo->m_latency;
+		state->m_fd_opencount = m_tinfo->get_fd_opencount();
+
+		ret->m_tinfo_ref = m_tinfo->snapshot();
+		ret->m_tinfo = ret->m_tinfo_ref.get();
+	}
+	ret->m_snapshot = state;
+
+	if(m_fdinfo != nullptr)
+	{
+		// the fd tables are not copied with the threads, the fd of the
+		// event is found by number with find_fd()
+		ret->m_fdinfo_ref = m_fdinfo->clone();
+		ret->m_fdinfo = ret->m_fdinfo_ref.get();
+	}
+
+	return ret;
+}
+
+sinsp_fdinfo* sinsp_evt::find_fd(int64_t fd)
+{
+	if(m_snapshot != nullptr)
+	{
+		if(fd >= 0 && fd == m_snapshot->m_lastevent_fd)
+		{
+			return m_fdinfo_ref.get();
+		}
+		return nullptr;
+	}
+
+	sinsp_threadinfo* tinfo = get_thread_info();
+	return tinfo != nullptr ? tinfo->get_fd(fd) : nullptr;
+}
+
+const sinsp_syslog_decoder& sinsp_evt::get_syslog_decoder() const
+{
+	if(m_snapshot != nullptr)
+	{
+		return m_snapshot->m_syslog_decoder;
+	}
+	return m_inspector->get_parser()->get_syslog_decoder();
+}
+
 const char *sinsp_evt::get_name() const
 {
 	return m_info->name;
@@ -159,14 +276,20 @@ sinsp_threadinfo* sinsp_evt::get_thread_info(bool query_os_if_not_found)
 		return m_tinfo;
 	}
 
-	return m_inspector->get_thread_ref(m_pevt->tid, query_os_if_not_found, false).get();
+	// a snapshot only knows the threads copied with it
+	if(m_snapshot != nullptr)
+	{
+		return nullptr;
+	}
+
+	return m_inspector->get_thread_ptr(m_pevt->tid, query_os_if_not_found, false);
 }
 
 int64_t sinsp_evt::get_fd_num() const
 {
 	if(m_fdinfo)
 	{
-		return m_tinfo->m_lastevent_fd;
+		return get_thread_lastevent_fd();
 	}
 	else
 	{
@@ -174,6 +297,15 @@ int64_t sinsp_evt::get_fd_num() const
 	}
 }
 
+int64_t sinsp_evt::get_thread_lastevent_fd() const
+{
+	if(m_snapshot != nullptr)
+	{
+		return m_snapshot->m_lastevent_fd;
+	}
+	return m_tinfo != nullptr ? m_tinfo->m_lastevent_fd : -1;
+}
+
 
 uint32_t sinsp_evt::get_num_params()
 {
@@ -197,6 +329,27 @@ const sinsp_evt_param *sinsp_evt::get_param(uint32_t id)
 	return &(m_params.at(id));
 }
 
+sinsp_evt_param_lookup::sinsp_evt_param_lookup()
+{
+	m_positions.fill(-1);
+}
+
+sinsp_evt_param_lookup::sinsp_evt_param_lookup(std::string_view name): sinsp_evt_param_lookup()
+{
+	for(uint32_t j = 0; j < PPM_EVENT_MAX; j++)
+	{
+		const ppm_event_info* ei = &g_infotables.m_event_info[j];
+		for(uint32_t k = 0; k < ei->nparams; k++)
+		{
+			if(name == ei->params[k].name)
+			{
+				m_positions[j] = k;
+				break;
+			}
+		}
+	}
+}
+
 const sinsp_evt_param* sinsp_evt::get_param_by_name(const char* name)
 {
 	//
@@ -224,6 +377,17 @@ const sinsp_evt_param* sinsp_evt::get_param_by_name(const char* name)
 	return NULL;
 }
 
+const sinsp_evt_param* sinsp_evt::get_param_by_name(const sinsp_evt_param_lookup& lookup)
+{
+	// events from old captures can have less parameters than the table
+	int32_t id = lookup.position(get_type());
+	if(id < 0 || (uint32_t)id >= get_num_params())
+	{
+		return NULL;
+	}
+	return &m_params[id];
+}
+
 const char *sinsp_evt::get_param_name(uint32_t id)
 {
 	if((m_flags & sinsp_evt::SINSP_EF_PARAMS_LOADED) == 0)
@@ -600,7 +764,7 @@ int sinsp_evt::render_fd_json(Json::Value *ret, int64_t fd, const char** resolve
 
 	if(fd >= 0)
 	{
-		sinsp_fdinfo *fdinfo = tinfo->get_fd(fd);
+		sinsp_fdinfo *fdinfo = find_fd(fd);
 		if(fdinfo)
 		{
 			char tch = fdinfo->get_typechar();
@@ -693,7 +857,7 @@ char* sinsp_evt::render_fd(int64_t fd, const char** resolved_str, sinsp_evt::par
 
 	if(fd >= 0)
 	{
-		sinsp_fdinfo *fdinfo = tinfo->get_fd(fd);
+		sinsp_fdinfo *fdinfo = find_fd(fd);
 		if(fdinfo)
 		{
 			char tch = fdinfo->get_typechar();
@@ -732,24 +896,28 @@ char* sinsp_evt::render_fd(int64_t fd, const char** resolved_str, sinsp_evt::par
 				0
 			};
 
-			//
-			// Make sure we remove invalid characters from the resolved name
-			//
-			std::string sanitized_str = fdinfo->m_name;
-
-			sanitize_string(sanitized_str);
-
 			//
 			// Make sure the string will fit
 			//
-			if(sanitized_str.size() >= m_resolved_paramstr_storage.size())
+			size_t prefix_len = strlen(typestr) + 2;
+			if(prefix_len + fdinfo->m_name.size() >= m_resolved_paramstr_storage.size())
 			{
-				m_resolved_paramstr_storage.resize(sanitized_str.size() + 1);
+				m_resolved_paramstr_storage.resize(prefix_len + fdinfo->m_name.size() + 1);
 			}
 
 			snprintf(&m_resolved_paramstr_storage[0],
 				m_resolved_paramstr_storage.size(),
-				"<%s>%s", typestr, sanitized_str.c_str());
+				"<%s>", typestr);
+
+			//
+			// Make sure we remove invalid characters from the resolved name,
+			// copying it in place
+			//
+			auto end = std::remove_copy_if(fdinfo->m_name.begin(),
+				fdinfo->m_name.end(),
+				&m_resolved_paramstr_storage[prefix_len],
+				g_invalidchar());
+			*end = 0;
 		}
 	}
 	else if(fd == PPM_AT_FDCWD)
@@ -825,6 +993,16 @@ std::string sinsp_evt::get_base_dir(uint32_t id, sinsp_threadinfo *tinfo)
 	return rel_path_base;
 }
 
+// Same as std::filesystem::path(path).is_absolute(), without allocating a path
+static inline bool is_absolute_path(std::string_view path)
+{
+#ifdef _WIN32
+	return std::filesystem::path(path).is_absolute();
+#else
+	return !path.empty() && path[0] == '/';
+#endif
+}
+
 const char* sinsp_evt::get_param_as_str(uint32_t id, const char** resolved_str, sinsp_evt::param_fmt fmt)
 {
 	char* prfmt = NULL;
@@ -926,7 +1104,22 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, const char** resolved_str,
 					 m_paramstr_storage.size(),
 					 "%" PRId64, param->as<int64_t>());
 
-			sinsp_threadinfo* atinfo = m_inspector->get_thread_ref(param->as<int64_t>(), false, true).get();
+			sinsp_threadinfo* atinfo = nullptr;
+			if(m_snapshot == nullptr)
+			{
+				atinfo = m_inspector->get_thread_ptr(param->as<int64_t>(), false, true);
+			}
+			else
+			{
+				for(const auto& t : m_snapshot->m_param_threads)
+				{
+					if(t->m_tid == param->as<int64_t>())
+					{
+						atinfo = t.get();
+						break;
+					}
+				}
+			}
 			if(atinfo != NULL)
 			{
 				std::string& tcomm = atinfo->m_comm;
@@ -1029,19 +1222,21 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, const char** resolved_str,
 		{
 			if(path != "<NA>")
 			{
-				std::string cwd = get_base_dir(id, tinfo);
-
-				if(path.length() + cwd.length() + 1 >= m_resolved_paramstr_storage.size())
-				{
-					m_resolved_paramstr_storage.resize(path.length() + cwd.length() + 2, 0);
-				}
-
-				if(path.empty() || std::filesystem::path(path).is_absolute())
+				// absolute paths don't need to be resolved, so they are
+				// checked before copying the base directory
+				if(path.empty() || is_absolute_path(path))
 				{
 					m_resolved_paramstr_storage[0] = 0;
 				}
 				else
 				{
+					std::string cwd = get_base_dir(id, tinfo);
+
+					if(path.length() + cwd.length() + 1 >= m_resolved_paramstr_storage.size())
+					{
+						m_resolved_paramstr_storage.resize(path.length() + cwd.length() + 2, 0);
+					}
+
 					std::string concatenated_path = sinsp_utils::concatenate_paths(cwd, path);
 					strcpy_sanitized(&m_resolved_paramstr_storage[0], concatenated_path.data(), std::min(concatenated_path.size() + 1, m_resolved_paramstr_storage.size()));
 				}
@@ -1292,7 +1487,7 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, const char** resolved_str,
 				int64_t fd = 0;
 				memcpy(&fd, param->m_val + pos, sizeof(uint64_t));
 
-				sinsp_fdinfo *fdinfo = tinfo->get_fd(fd);
+				sinsp_fdinfo *fdinfo = find_fd(fd);
 				if(fdinfo)
 				{
 					tch = fdinfo->get_typechar();
@@ -1559,8 +1754,19 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, const char** resolved_str,
 					 m_paramstr_storage.size(),
 					 "%d", val);
 			sinsp_threadinfo* tinfo = get_thread_info();
-			scap_userinfo *user_info = NULL;
-			if (tinfo)
+			const scap_userinfo *user_info = NULL;
+			if (m_snapshot != nullptr)
+			{
+				for (const auto& user : m_snapshot->m_users)
+				{
+					if (user.uid == val)
+					{
+						user_info = &user;
+						break;
+					}
+				}
+			}
+			else if (tinfo)
 			{
 				user_info = m_inspector->m_usergroup_manager.get_user(tinfo->m_container_id, val);
 			}
@@ -1601,8 +1807,19 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, const char** resolved_str,
 					 m_paramstr_storage.size(),
 					 "%d", val);
 			sinsp_threadinfo* tinfo = get_thread_info();
-			scap_groupinfo *group_info = NULL;
-			if (tinfo)
+			const scap_groupinfo *group_info = NULL;
+			if (m_snapshot != nullptr)
+			{
+				for (const auto& group : m_snapshot->m_groups)
+				{
+					if (group.gid == val)
+					{
+						group_info = &group;
+						break;
+					}
+				}
+			}
+			else if (tinfo)
 			{
 				group_info = m_inspector->m_usergroup_manager.get_group(tinfo->m_container_id, val);
 			}
@@ -1866,6 +2083,17 @@ const char* sinsp_evt::get_param_value_str(std::string_view name, const char** r
 	return NULL;
 }
 
+const char* sinsp_evt::get_param_value_str(const sinsp_evt_param_lookup& lookup, const char** resolved_str, param_fmt fmt)
+{
+	int32_t id = lookup.position(get_type());
+	if(id < 0 || (uint32_t)id >= get_num_params())
+	{
+		*resolved_str = NULL;
+		return NULL;
+	}
+	return get_param_as_str(id, resolved_str, fmt);
+}
+
 void sinsp_evt::get_category(sinsp_evt::category* cat) const
 {
 	/* We always search the category inside the event table */
@@ -2031,9 +2259,31 @@ bool sinsp_evt::is_network_error() const
 
 uint64_t sinsp_evt::get_lastevent_ts() const
 {
+	if(m_snapshot != nullptr)
+	{
+		return m_snapshot->m_lastevent_ts;
+	}
 	return m_tinfo->m_lastevent_ts;
 }
 
+uint64_t sinsp_evt::get_thread_latency() const
+{
+	if(m_snapshot != nullptr)
+	{
+		return m_snapshot->m_latency;
+	}
+	return m_tinfo->m_latency;
+}
+
+uint64_t sinsp_evt::get_fd_opencount() const
+{
+	if(m_snapshot != nullptr)
+	{
+		return m_snapshot->m_fd_opencount;
+	}
+	return m_tinfo->get_fd_opencount();
+}
+
 bool sinsp_evt::clone_event(sinsp_evt &dest, const sinsp_evt &src)
 {
 	dest.m_inspector = src.m_inspector;
@@ -2109,6 +2359,7 @@ bool sinsp_evt::clone_event(sinsp_evt &dest, const sinsp_evt &src)
 		dest.m_fdinfo = dest.m_fdinfo_ref.get();
 	}
 	dest.m_fdinfo_name_changed = src.m_fdinfo_name_changed;
+	dest.m_snapshot = src.m_snapshot;
 
 	return true;
 }
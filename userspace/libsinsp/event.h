@@ -18,6 +18,7 @@ limitations under the License.
 
 #pragma once
 
+#include <array>
 #include <optional>
 #include <unordered_map>
 #include <string_view>
@@ -32,6 +33,7 @@ limitations under the License.
 #include <libsinsp/settings.h>
 #include <libsinsp/sinsp_exception.h>
 #include <libsinsp/fdinfo.h>
+#include <libsinsp/sinsp_syslog.h>
 #include <libsinsp/utils.h>
 
 class sinsp;
@@ -112,6 +114,30 @@ public:
 	void throw_invalid_len_error(size_t requested_len) const;
 };
 
+/*!
+  \brief The position of a parameter in every event type, looked up by name
+  once in the event table. Unlike sinsp_evt::get_param_by_name(const char*),
+  finding a parameter with it doesn't compare the names at every event.
+*/
+class SINSP_PUBLIC sinsp_evt_param_lookup
+{
+public:
+	sinsp_evt_param_lookup();
+	explicit sinsp_evt_param_lookup(std::string_view name);
+
+	/*!
+	  \brief Return the position of the parameter in the given event type,
+	  or -1 if the event type doesn't have it.
+	*/
+	inline int32_t position(uint16_t evt_type) const
+	{
+		return evt_type < PPM_EVENT_MAX ? m_positions[evt_type] : -1;
+	}
+
+private:
+	std::array<int8_t, PPM_EVENT_MAX> m_positions;
+};
+
 /*!
   \brief Get the value of a parameter, interpreted with the type specified in the template argument.
   \param param The parameter.
@@ -427,6 +453,19 @@ public:
 	*/
 	int64_t get_fd_num() const;
 
+	/*!
+	  \brief Return the fd of the last event of the thread of this event,
+	  i.e. the one of this event if it's I/O related, even if it has no fd
+	  info. Returns -1 if there is no thread info.
+	*/
+	int64_t get_thread_lastevent_fd() const;
+
+	/*!
+	  \brief Return the fd info of an fd of the thread of this event, or
+	  nullptr. A snapshot only knows the fd of the event, see snapshot().
+	*/
+	sinsp_fdinfo* find_fd(int64_t fd);
+
 	/*!
 	  \brief Return the number of parameters that this event has.
 	*/
@@ -463,6 +502,13 @@ public:
 	*/
 	const sinsp_evt_param* get_param_by_name(const char* name);
 
+	/*!
+	  \brief Get a parameter in raw format by name, resolved in advance.
+
+	  \param lookup The position of the parameter in the event types.
+	*/
+	const sinsp_evt_param* get_param_by_name(const sinsp_evt_param_lookup& lookup);
+
 	/*!
 	  \brief Get a parameter as a C++ string.
 
@@ -523,6 +569,18 @@ public:
 
 	uint64_t get_lastevent_ts() const;
 
+	/*!
+	  \brief Return the latency of the system call of this event, if it's an
+	  exit event, as computed for its thread.
+	*/
+	uint64_t get_thread_latency() const;
+
+	/*!
+	  \brief Return the number of fds open by the process of this event,
+	  see sinsp_threadinfo::get_fd_opencount().
+	*/
+	uint64_t get_fd_opencount() const;
+
 	void set_iosize(uint32_t size);
 	uint32_t get_iosize() const;
 
@@ -537,6 +595,7 @@ public:
 	  \param resolved_str [out] the string representation of the parameter
 	*/
 	const char* get_param_value_str(std::string_view name, const char** resolved_str, param_fmt fmt = PF_NORMAL);
+	const char* get_param_value_str(const sinsp_evt_param_lookup& lookup, const char** resolved_str, param_fmt fmt = PF_NORMAL);
 
 	inline void init_keep_threadinfo()
 	{
@@ -605,6 +664,29 @@ public:
 		return ret;
 	}
 
+	/*!
+	  \brief Return a copy of this event that owns its scap event and a
+	  snapshot of its thread and fd info, see sinsp_threadinfo::snapshot().
+	  The threads, users and groups referenced by the event parameters are
+	  copied too, together with the values of the thread that change with
+	  every event (e.g. the latency and the number of open fds), so the copy
+	  never reads the inspector state: it stays valid and unchanged while
+	  the inspector parses the following events, and can be used from
+	  another thread. The snapshots of the threads are shared among the
+	  events, so only the event and its fd info are copied each time.
+	*/
+	std::unique_ptr<sinsp_evt> snapshot() const;
+
+	/*!
+	  \brief Return the syslog message decoded from this event, if any.
+	*/
+	const sinsp_syslog_decoder& get_syslog_decoder() const;
+
+	inline bool is_snapshot() const
+	{
+		return m_snapshot != nullptr;
+	}
+
 	inline void load_params()
 	{
 		uint32_t j;
@@ -855,6 +937,22 @@ private:
 
 	size_t m_source_idx;
 	const char* m_source_name;
+
+	// The state referenced by a snapshot that is not shared with the other
+	// events, see snapshot(). It is only set for snapshots, that never read
+	// the inspector.
+	struct snapshot_state
+	{
+		std::vector<scap_userinfo> m_users;
+		std::vector<scap_groupinfo> m_groups;
+		std::vector<std::shared_ptr<sinsp_threadinfo>> m_param_threads;
+		sinsp_syslog_decoder m_syslog_decoder;
+		int64_t m_lastevent_fd = -1;
+		uint64_t m_lastevent_ts = 0;
+		uint64_t m_latency = 0;
+		uint64_t m_fd_opencount = 0;
+	};
+	std::shared_ptr<const snapshot_state> m_snapshot;
 };
 
 uint32_t binary_buffer_to_string(char *dst, const char *src, uint32_t dstlen, uint32_t srclen, sinsp_evt::param_fmt fmt);
@@ -24,17 +24,21 @@ limitations under the License.
 static constexpr const char* s_not_available_str = "<NA>";
 
 sinsp_evt_formatter::sinsp_evt_formatter(sinsp* inspector,
-					 filter_check_list &available_checks)
+					 filter_check_list &available_checks,
+					 std::shared_ptr<sinsp_filter_cache> cache)
 	: m_inspector(inspector),
-	  m_available_checks(available_checks)
+	  m_available_checks(available_checks),
+	  m_cache(cache)
 {
 }
 
 sinsp_evt_formatter::sinsp_evt_formatter(sinsp* inspector,
 					 const std::string& fmt,
-					 filter_check_list &available_checks)
+					 filter_check_list &available_checks,
+					 std::shared_ptr<sinsp_filter_cache> cache)
 	: m_inspector(inspector),
-	  m_available_checks(available_checks)
+	  m_available_checks(available_checks),
+	  m_cache(cache)
 {
 	output_format of = sinsp_evt_formatter::OF_NORMAL;
 
@@ -170,6 +174,11 @@ void sinsp_evt_formatter::set_format(output_format of, const std::string& fmt)
 			j += fsize;
 			ASSERT(j <= lfmtlen);
 
+			if(m_cache)
+			{
+				m_cache->set_extraction_cache(chk.get(), std::string(fstart, fsize), true);
+			}
+
 			// we always add the field with no transformers for key->value resolution
 			m_resolution_tokens.emplace_back(std::string(fstart, fsize), chk, false);
 
@@ -200,6 +209,11 @@ void sinsp_evt_formatter::set_format(output_format of, const std::string& fmt)
 					msize++; // count ')'
 				}
 
+				if(m_cache)
+				{
+					m_cache->set_extraction_cache(chk.get(), std::string(tstart, fsize + msize), true);
+				}
+
 				// when requested to do so, we'll resolve the field with transformers
 				// in addition to the non-transformed version
 				m_resolution_tokens.emplace_back(std::string(tstart, fsize + msize), chk, true);
@@ -51,10 +51,14 @@ public:
 	  \param fmt The printf-like format to use. The accepted format is the same
 	   as the one of the output in Falco rules, so refer to the Falco
 	   documentation for details.
+	  \param cache Optional cache shared with other filters and formatters,
+	   see sinsp_filter_cache.
 	*/
-	sinsp_evt_formatter(sinsp* inspector, filter_check_list &available_checks);
+	sinsp_evt_formatter(sinsp* inspector, filter_check_list &available_checks,
+			    std::shared_ptr<sinsp_filter_cache> cache = nullptr);
 
-	sinsp_evt_formatter(sinsp* inspector, const std::string& fmt, filter_check_list &available_checks);
+	sinsp_evt_formatter(sinsp* inspector, const std::string& fmt, filter_check_list &available_checks,
+			    std::shared_ptr<sinsp_filter_cache> cache = nullptr);
 
 	virtual ~sinsp_evt_formatter() = default;
 
@@ -139,6 +143,7 @@ private:
 	std::vector<resolution_token> m_resolution_tokens;
 	sinsp* m_inspector = nullptr;
 	filter_check_list &m_available_checks;
+	std::shared_ptr<sinsp_filter_cache> m_cache;
 	bool m_require_all_values = false;
 	bool m_resolve_transformed_fields = false;
 
@@ -230,13 +230,42 @@ scap_l4_proto sinsp_fdinfo::get_l4proto() const
 	}
 }
 
+// shared by all the inspectors, as the class operator new can't tell them
+// apart; never destroyed, fd infos can be freed by static destructors
+static libsinsp::object_allocation_hook& fdinfo_allocation_hook()
+{
+	static auto hook = new libsinsp::object_allocation_hook();
+	return *hook;
+}
+
+void* sinsp_fdinfo::operator new(size_t size)
+{
+	return fdinfo_allocation_hook().allocate(size);
+}
+
+void sinsp_fdinfo::operator delete(void* p, size_t size)
+{
+	fdinfo_allocation_hook().deallocate(p, size);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // sinsp_fdtable implementation
 ///////////////////////////////////////////////////////////////////////////////
+void sinsp_fdtable::set_fdinfo_allocator(std::shared_ptr<libsinsp::object_allocator> allocator)
+{
+	fdinfo_allocation_hook().set_allocator(std::move(allocator));
+}
+
+libsinsp::object_allocator_stats sinsp_fdtable::get_fdinfo_allocator_stats()
+{
+	return fdinfo_allocation_hook().get_stats();
+}
+
 sinsp_fdtable::sinsp_fdtable(sinsp* inspector)
 {
 	m_tid = 0;
 	m_inspector = inspector;
+	m_dense_count = 0;
 	reset_cache();
 }
 
@@ -257,9 +286,9 @@ sinsp_fdinfo* sinsp_fdtable::find(int64_t fd)
 	//
 	// Caching failed, do a real lookup
 	//
-	auto fdit = m_table.find(fd);
+	auto slot = find_slot(fd);
 
-	if(fdit == m_table.end())
+	if(slot == nullptr)
 	{
 		if (m_inspector != nullptr && m_inspector->get_sinsp_stats_v2())
 		{
@@ -275,7 +304,7 @@ sinsp_fdinfo* sinsp_fdtable::find(int64_t fd)
 		}
 
 		m_last_accessed_fd = fd;
-		m_last_accessed_fdinfo = fdit->second.get();
+		m_last_accessed_fdinfo = slot->get();
 		lookup_device(m_last_accessed_fdinfo, fd);
 		return m_last_accessed_fdinfo;
 	}
@@ -288,16 +317,16 @@ sinsp_fdinfo* sinsp_fdtable::add(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinf
 	//
 	// Look for the FD in the table
 	//
-	auto it = m_table.find(fd);
+	auto slot = find_slot(fd);
 
 	// Three possible exits here:
 	// 1. fd is not on the table
 	//   a. the table size is under the limit so create a new entry
 	//   b. table size is over the limit, discard the fd
 	// 2. fd is already in the table, replace it
-	if(it == m_table.end())
+	if(slot == nullptr)
 	{
-		if(m_table.size() < m_inspector->m_max_fdtable_size)
+		if(m_inspector == nullptr || size() < m_inspector->m_max_fdtable_size)
 		{
 			//
 			// No entry in the table, this is the normal case
@@ -308,7 +337,7 @@ sinsp_fdinfo* sinsp_fdtable::add(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinf
 				m_inspector->get_sinsp_stats_v2()->m_n_added_fds++;
 			}
 
-			return m_table.emplace(fd, std::move(fdinfo)).first->second.get();
+			return insert(fd, std::move(fdinfo));
 		}
 		else
 		{
@@ -320,7 +349,7 @@ sinsp_fdinfo* sinsp_fdtable::add(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinf
 		//
 		// the fd is already in the table.
 		//
-		if(it->second->m_flags & sinsp_fdinfo::FLAGS_CLOSE_IN_PROGRESS)
+		if((*slot)->m_flags & sinsp_fdinfo::FLAGS_CLOSE_IN_PROGRESS)
 		{
 			//
 			// Sometimes an FD-creating syscall can be called on an FD that is being closed (i.e
@@ -331,7 +360,10 @@ sinsp_fdinfo* sinsp_fdtable::add(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinf
 			fdinfo->m_flags &= ~sinsp_fdinfo::FLAGS_CLOSE_IN_PROGRESS;
 			fdinfo->m_flags |= sinsp_fdinfo::FLAGS_CLOSE_CANCELED;
 
-			m_table[CANCELED_FD_NUMBER] = it->second->clone();
+			auto canceled = (*slot)->clone();
+			m_sparse.insert(CANCELED_FD_NUMBER, std::move(canceled));
+			// the insertion can move the sparse entries
+			slot = find_slot(fd);
 		}
 		else
 		{
@@ -352,21 +384,21 @@ sinsp_fdinfo* sinsp_fdtable::add(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinf
 		// Replace the fd as a struct copy
 		//
 		m_last_accessed_fd = -1;
-		it->second = std::move(fdinfo);
-		return it->second.get();
+		*slot = std::move(fdinfo);
+		return slot->get();
 	}
 }
 
 bool sinsp_fdtable::erase(int64_t fd)
 {
-	auto fdit = m_table.find(fd);
+	auto slot = find_slot(fd);
 
 	if(fd == m_last_accessed_fd)
 	{
 		m_last_accessed_fd = -1;
 	}
 
-	if(fdit == m_table.end())
+	if(slot == nullptr)
 	{
 		//
 		// Looks like there's no fd to remove.
@@ -382,7 +414,15 @@ bool sinsp_fdtable::erase(int64_t fd)
 	}
 	else
 	{
-		m_table.erase(fdit);
+		if(is_dense(fd))
+		{
+			slot->reset();
+			m_dense_count--;
+		}
+		else
+		{
+			m_sparse.erase(fd);
+		}
 		if (m_inspector != nullptr && m_inspector->get_sinsp_stats_v2())
 		{
 			m_inspector->get_sinsp_stats_v2()->m_n_noncached_fd_lookups++;
@@ -394,12 +434,37 @@ bool sinsp_fdtable::erase(int64_t fd)
 
 void sinsp_fdtable::clear()
 {
-	m_table.clear();
+	m_dense.clear();
+	m_dense_count = 0;
+	m_sparse.clear();
 }
 
 size_t sinsp_fdtable::size() const
 {
-	return m_table.size();
+	return m_dense_count + m_sparse.size();
+}
+
+sinsp_fdinfo* sinsp_fdtable::insert(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinfo)
+{
+	if(!is_dense(fd))
+	{
+		m_sparse.insert(fd, std::move(fdinfo));
+		return m_sparse.find(fd)->get();
+	}
+
+	if(fd >= (int64_t)m_dense.size())
+	{
+		// grow in powers of two, most processes never go past a few dozens
+		size_t new_size = m_dense.empty() ? 16 : m_dense.size();
+		while((int64_t)new_size <= fd)
+		{
+			new_size *= 2;
+		}
+		m_dense.resize(new_size);
+	}
+	m_dense[fd] = std::move(fdinfo);
+	m_dense_count++;
+	return m_dense[fd].get();
 }
 
 void sinsp_fdtable::reset_cache()
@@ -410,13 +475,19 @@ void sinsp_fdtable::reset_cache()
 void sinsp_fdtable::lookup_device(sinsp_fdinfo* fdi, uint64_t fd)
 {
 #ifndef _WIN32
+	// check the fd first, this runs on every non-cached lookup
+	if(fdi->m_mount_id == 0 || fdi->m_dev != 0 || !fdi->is_file())
+	{
+		return;
+	}
+
 	if(m_inspector == nullptr || m_inspector->is_offline() ||
 	   (m_inspector->is_plugin() && !m_inspector->is_syscall_plugin()))
 	{
 		return;
 	}
 
-	if(m_tid != 0 && m_tid != (uint64_t)-1 && fdi->is_file() && fdi->m_dev == 0 && fdi->m_mount_id != 0)
+	if(m_tid != 0 && m_tid != (uint64_t)-1)
 	{
 		char procdir[SCAP_MAX_PATH_SIZE];
 		snprintf(procdir, sizeof(procdir), "%s/proc/%ld/", scap_get_host_root(), m_tid);
@@ -21,6 +21,8 @@ limitations under the License.
 #include <libscap/scap.h>
 #include <libsinsp/tuples.h>
 #include <libsinsp/sinsp_public.h>
+#include <libsinsp/flat_int_map.h>
+#include <libsinsp/object_pool.h>
 
 #include <unordered_map>
 #include <vector>
@@ -118,6 +120,13 @@ public:
 
 	virtual ~sinsp_fdinfo() = default;
 
+	/*!
+	  \brief Fd infos are allocated with the process-global allocator set by
+	  sinsp_fdtable::set_fdinfo_allocator().
+	*/
+	static void* operator new(size_t size);
+	static void operator delete(void* p, size_t size);
+
 	virtual std::unique_ptr<sinsp_fdinfo> clone() const
 	{
 		return std::make_unique<sinsp_fdinfo>(*this);
@@ -452,32 +461,50 @@ public:
 		return sinsp_fdinfo{}.clone();
 	}
 
+	/*!
+	  \brief Set the process-global allocator of the sinsp_fdinfo objects,
+	  with the same semantics of sinsp_thread_manager::set_threadinfo_allocator().
+	*/
+	static void set_fdinfo_allocator(std::shared_ptr<libsinsp::object_allocator> allocator);
+
+	/*!
+	  \brief Return the stats of the sinsp_fdinfo allocators, these include
+	  the objects of all the inspectors of the process.
+	*/
+	static libsinsp::object_allocator_stats get_fdinfo_allocator_stats();
+
 	sinsp_fdinfo* find(int64_t fd);
 
 	sinsp_fdinfo* add(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinfo);
 
 	inline bool const_loop(const fdtable_const_visitor_t callback) const
 	{
-		for(auto it = m_table.begin(); it != m_table.end(); ++it)
+		for(size_t fd = 0; fd < m_dense.size(); fd++)
 		{
-			if (!callback(it->first, *it->second))
+			if (m_dense[fd] && !callback((int64_t)fd, *m_dense[fd]))
 			{
 				return false;
 			}
 		}
-		return true;
+		return m_sparse.for_each([&callback](int64_t fd, const std::unique_ptr<sinsp_fdinfo>& fdinfo)
+		{
+			return callback(fd, *fdinfo);
+		});
 	}
 
 	inline bool loop(const fdtable_visitor_t callback)
 	{
-		for(auto it = m_table.begin(); it != m_table.end(); ++it)
+		for(size_t fd = 0; fd < m_dense.size(); fd++)
 		{
-			if (!callback(it->first, *it->second))
+			if (m_dense[fd] && !callback((int64_t)fd, *m_dense[fd]))
 			{
 				return false;
 			}
 		}
-		return true;
+		return m_sparse.for_each([&callback](int64_t fd, std::unique_ptr<sinsp_fdinfo>& fdinfo)
+		{
+			return callback(fd, *fdinfo);
+		});
 	}
 
 	// If the key is present, returns true, otherwise returns false.
@@ -500,8 +527,37 @@ public:
 	}
 
 private:
+	//
+	// Processes mostly use small and dense fd numbers: the fds below this
+	// limit are stored in a vector indexed by fd, the others in a hash map
+	//
+	static constexpr int64_t s_dense_fd_limit = 1024;
+
+	inline bool is_dense(int64_t fd) const
+	{
+		return fd >= 0 && fd < s_dense_fd_limit;
+	}
+
+	// returns the slot of an existing fd, or nullptr
+	inline std::unique_ptr<sinsp_fdinfo>* find_slot(int64_t fd)
+	{
+		if(is_dense(fd))
+		{
+			if(fd < (int64_t)m_dense.size() && m_dense[fd])
+			{
+				return &m_dense[fd];
+			}
+			return nullptr;
+		}
+		return m_sparse.find(fd);
+	}
+
+	sinsp_fdinfo* insert(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinfo);
+
 	sinsp* m_inspector;
-	std::unordered_map<int64_t, std::unique_ptr<sinsp_fdinfo>> m_table;
+	std::vector<std::unique_ptr<sinsp_fdinfo>> m_dense;
+	size_t m_dense_count;
+	flat_int_map<int64_t, std::unique_ptr<sinsp_fdinfo>> m_sparse;
 
 	//
 	// Simple fd cache
@@ -27,7 +27,11 @@ limitations under the License.
 //
 
 #include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
 #include <iomanip>
+#include <unordered_map>
 
 #include <libsinsp/sinsp.h>
 #include <libsinsp/sinsp_int.h>
@@ -47,6 +51,36 @@ void sinsp_filter_expression::add_check(std::unique_ptr<sinsp_filter_check> chk)
 
 bool sinsp_filter_expression::compare(sinsp_evt *evt)
 {
+	if(m_eval_cache_entry == nullptr)
+	{
+		return compare_nocache(evt);
+	}
+
+	if(m_cache_metrics != nullptr)
+	{
+		m_cache_metrics->m_num_eval++;
+	}
+
+	uint64_t en = evt->get_num();
+	if(en != m_eval_cache_entry->m_evtnum)
+	{
+		m_eval_cache_entry->m_res = compare_nocache(evt);
+		m_eval_cache_entry->m_evtnum = en;
+	}
+	else if(m_cache_metrics != nullptr)
+	{
+		m_cache_metrics->m_num_eval_cache++;
+	}
+	return m_eval_cache_entry->m_res;
+}
+
+bool sinsp_filter_expression::compare_nocache(sinsp_evt *evt)
+{
+	if(m_ordering)
+	{
+		return compare_adaptive(evt);
+	}
+
 	bool res = true;
 
 	sinsp_filter_check* chk = nullptr;
@@ -119,6 +153,131 @@ bool sinsp_filter_expression::extract(sinsp_evt *evt, std::vector<extract_value_
 	return false;
 }
 
+// the evaluation time is measured once every this many evaluations,
+// reading the clock costs about as much as the cheapest checks
+static constexpr uint32_t s_ordering_time_sample_period = 16;
+
+void sinsp_filter_expression::set_adaptive_ordering(uint32_t period)
+{
+	m_ordering.reset();
+	if(period > 0 && m_checks.size() > 1)
+	{
+		m_ordering = std::make_unique<ordering_state>();
+		m_ordering->m_and = (m_checks[1]->m_boolop & BO_AND) != 0;
+		m_ordering->m_period = period;
+		m_ordering->m_profiles.resize(m_checks.size());
+	}
+
+	for(auto& c : m_checks)
+	{
+		auto expr = dynamic_cast<sinsp_filter_expression*>(c.get());
+		if(expr != nullptr)
+		{
+			expr->set_adaptive_ordering(period);
+		}
+	}
+}
+
+bool sinsp_filter_expression::compare_adaptive(sinsp_evt *evt)
+{
+	auto& o = *m_ordering;
+	bool timed = (o.m_num_eval % s_ordering_time_sample_period) == 0;
+
+	// "and" is false as soon as a check is false, "or" is true as soon as
+	// a check is true
+	bool res = o.m_and;
+	for(size_t j = 0; j < m_checks.size(); j++)
+	{
+		auto chk = m_checks[j].get();
+		auto& p = o.m_profiles[j];
+
+		std::chrono::steady_clock::time_point start;
+		if(timed)
+		{
+			start = std::chrono::steady_clock::now();
+		}
+		bool r = chk->compare(evt);
+		if(chk->m_boolop & BO_NOT)
+		{
+			r = !r;
+		}
+		if(timed)
+		{
+			p.m_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+			p.m_num_timed++;
+		}
+		p.m_num_eval++;
+		p.m_num_true += r;
+
+		if(r != o.m_and)
+		{
+			res = r;
+			break;
+		}
+	}
+
+	if(++o.m_num_eval >= o.m_period)
+	{
+		reorder();
+	}
+	return res;
+}
+
+void sinsp_filter_expression::reorder()
+{
+	auto& o = *m_ordering;
+	o.m_num_eval = 0;
+
+	// expected cost of reaching a decision with each check, the checks
+	// never evaluated or timed so far keep their relative order at the end
+	std::vector<double> scores(m_checks.size());
+	for(size_t j = 0; j < m_checks.size(); j++)
+	{
+		const auto& p = o.m_profiles[j];
+		if(p.m_num_timed == 0)
+		{
+			scores[j] = std::numeric_limits<double>::infinity();
+			continue;
+		}
+		double cost = (double)p.m_time_ns / p.m_num_timed;
+		double pass = (p.m_num_true + 1.0) / (p.m_num_eval + 2.0);
+		double decisive = o.m_and ? 1.0 - pass : pass;
+		scores[j] = cost / decisive;
+	}
+
+	std::vector<size_t> order(m_checks.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+		[&scores](size_t a, size_t b) { return scores[a] < scores[b]; });
+
+	std::vector<std::unique_ptr<sinsp_filter_check>> checks;
+	std::vector<check_profile> profiles;
+	for(auto j : order)
+	{
+		checks.push_back(std::move(m_checks[j]));
+
+		// halve the counters, so that the profile follows the workload
+		auto p = o.m_profiles[j];
+		p.m_num_eval /= 2;
+		p.m_num_true /= 2;
+		p.m_num_timed /= 2;
+		p.m_time_ns /= 2;
+		profiles.push_back(p);
+	}
+
+	// the first check has no boolean operator other than "not"
+	boolop op = o.m_and ? BO_AND : BO_OR;
+	for(size_t j = 0; j < checks.size(); j++)
+	{
+		uint32_t negated = checks[j]->m_boolop & BO_NOT;
+		checks[j]->m_boolop = (boolop)((j == 0 ? BO_NONE : op) | negated);
+	}
+
+	m_checks = std::move(checks);
+	o.m_profiles = std::move(profiles);
+}
+
 int32_t sinsp_filter_expression::get_expr_boolop() const
 {
 	if(m_checks.size() <= 1)
@@ -157,6 +316,7 @@ sinsp_filter::sinsp_filter(sinsp *inspector)
 
 void sinsp_filter::push_expression(boolop op)
 {
+	m_program.reset();
 	sinsp_filter_expression* newexpr = new sinsp_filter_expression();
 	newexpr->m_boolop = op;
 	newexpr->m_parent = m_curexpr;
@@ -179,11 +339,31 @@ void sinsp_filter::pop_expression()
 
 bool sinsp_filter::run(sinsp_evt *evt)
 {
+	if(m_program)
+	{
+		return m_program->run(evt);
+	}
 	return m_filter->compare(evt);
 }
 
+void sinsp_filter::set_adaptive_ordering(uint32_t period)
+{
+	// the program has a fixed order, only the tree can be reordered
+	if(period > 0)
+	{
+		m_program.reset();
+	}
+	m_filter->set_adaptive_ordering(period);
+}
+
+void sinsp_filter::compile_program()
+{
+	m_program = sinsp_filter_program::lower(m_filter.get());
+}
+
 void sinsp_filter::add_check(std::unique_ptr<sinsp_filter_check> chk)
 {
+	m_program.reset();
 	m_curexpr->add_check(std::move(chk));
 }
 
@@ -200,17 +380,21 @@ sinsp_filter_compiler::sinsp_filter_compiler(
 
 sinsp_filter_compiler::sinsp_filter_compiler(
 		std::shared_ptr<sinsp_filter_factory> factory,
-		const std::string& fltstr)
+		const std::string& fltstr,
+		std::shared_ptr<sinsp_filter_cache> cache)
 	: m_flt_str(fltstr),
-	  m_factory(factory)
+	  m_factory(factory),
+	  m_cache(cache)
 {
 }
 
 sinsp_filter_compiler::sinsp_filter_compiler(
 		std::shared_ptr<sinsp_filter_factory> factory,
-		const libsinsp::filter::ast::expr* fltast)
+		const libsinsp::filter::ast::expr* fltast,
+		std::shared_ptr<sinsp_filter_cache> cache)
 	: m_flt_ast(fltast),
-	  m_factory(factory)
+	  m_factory(factory),
+	  m_cache(cache)
 {
 }
 
@@ -250,6 +434,11 @@ std::unique_ptr<sinsp_filter> sinsp_filter_compiler::compile()
 		throw e;
 	}
 
+	if (m_flat_program)
+	{
+		m_filter->compile_program();
+	}
+
 	// return compiled filter
 	return std::move(m_filter);
 }
@@ -262,6 +451,10 @@ void sinsp_filter_compiler::visit(const libsinsp::filter::ast::and_expr* e)
 	{
 		m_filter->push_expression(m_last_boolop);
 		m_last_boolop = BO_NONE;
+		if (m_cache)
+		{
+			m_cache->set_eval_cache(m_filter->get_current_expression(), libsinsp::filter::ast::as_string(e));
+		}
 	}
 	for (auto &c : e->children)
 	{
@@ -282,8 +475,25 @@ void sinsp_filter_compiler::visit(const libsinsp::filter::ast::or_expr* e)
 	{
 		m_filter->push_expression(m_last_boolop);
 		m_last_boolop = BO_NONE;
+		if (m_cache)
+		{
+			m_cache->set_eval_cache(m_filter->get_current_expression(), libsinsp::filter::ast::as_string(e));
+		}
 	}
-	for (auto &c : e->children)
+	std::vector<const libsinsp::filter::ast::expr*> children;
+	std::vector<std::unique_ptr<libsinsp::filter::ast::expr>> merged;
+	if (m_merge_patterns)
+	{
+		merge_pattern_checks(e, children, merged);
+	}
+	else
+	{
+		for (auto &c : e->children)
+		{
+			children.push_back(c.get());
+		}
+	}
+	for (auto c : children)
 	{
 		c->accept(this);
 		m_last_boolop = BO_OR;
@@ -294,6 +504,105 @@ void sinsp_filter_compiler::visit(const libsinsp::filter::ast::or_expr* e)
 	}
 }
 
+// Returns true if the field (and transformers) of the left-hand side of a
+// check extracts a single string value compared with compare_rhs(), which
+// means that the check can use a multi_pattern_search for a list of values
+bool sinsp_filter_compiler::is_pattern_field(const libsinsp::filter::ast::expr* e)
+{
+	auto pos = m_pos;
+	auto is_plugin = m_last_node_field_is_plugin;
+	bool res = false;
+	try
+	{
+		m_last_node_field = nullptr;
+		e->accept(this);
+		if (m_last_node_field)
+		{
+			auto info = m_last_node_field->get_transformed_field_info();
+			res = info != nullptr
+				&& !info->is_list()
+				&& info->is_rhs_field_supported()
+				&& (info->m_type == PT_CHARBUF
+					|| info->m_type == PT_FSPATH
+					|| info->m_type == PT_FSRELPATH);
+		}
+	}
+	catch (const sinsp_exception&)
+	{
+		// the field will be compiled (and the error reported) as usual
+	}
+	m_last_node_field = nullptr;
+	m_last_node_field_is_plugin = is_plugin;
+	m_pos = pos;
+	return res;
+}
+
+//
+// Collects the children of an "or" expression to be compiled, replacing
+// the checks of the same field and string operator with a single one
+// against the list of their values, e.g. "a contains x or b = y or
+// a contains z" becomes "a contains (x, z) or b = y". The merged check
+// takes the place of the first one of its group.
+//
+void sinsp_filter_compiler::merge_pattern_checks(
+		const libsinsp::filter::ast::or_expr* e,
+		std::vector<const libsinsp::filter::ast::expr*>& children,
+		std::vector<std::unique_ptr<libsinsp::filter::ast::expr>>& merged)
+{
+	std::vector<std::string> keys(e->children.size());
+	std::unordered_map<std::string, std::vector<size_t>> groups;
+	for (size_t i = 0; i < e->children.size(); i++)
+	{
+		auto c = dynamic_cast<const libsinsp::filter::ast::binary_check_expr*>(e->children[i].get());
+		if (c != nullptr
+			&& dynamic_cast<const libsinsp::filter::ast::value_expr*>(c->right.get()) != nullptr
+			&& flt_is_multi_pattern_op(str_to_cmpop(c->op)))
+		{
+			keys[i] = c->op + " " + libsinsp::filter::ast::as_string(c->left.get());
+			groups[keys[i]].push_back(i);
+		}
+	}
+
+	for (auto it = groups.begin(); it != groups.end(); )
+	{
+		auto first = dynamic_cast<const libsinsp::filter::ast::binary_check_expr*>(e->children[it->second[0]].get());
+		if (it->second.size() < 2 || !is_pattern_field(first->left.get()))
+		{
+			it = groups.erase(it);
+			continue;
+		}
+		++it;
+	}
+
+	for (size_t i = 0; i < e->children.size(); i++)
+	{
+		auto g = keys[i].empty() ? groups.end() : groups.find(keys[i]);
+		if (g == groups.end())
+		{
+			children.push_back(e->children[i].get());
+			continue;
+		}
+		if (g->second[0] != i)
+		{
+			continue;
+		}
+
+		std::vector<std::string> values;
+		for (auto j : g->second)
+		{
+			auto c = static_cast<const libsinsp::filter::ast::binary_check_expr*>(e->children[j].get());
+			values.push_back(static_cast<const libsinsp::filter::ast::value_expr*>(c->right.get())->value);
+		}
+		auto first = static_cast<const libsinsp::filter::ast::binary_check_expr*>(e->children[i].get());
+		merged.push_back(libsinsp::filter::ast::binary_check_expr::create(
+			libsinsp::filter::ast::clone(first->left.get()),
+			first->op,
+			libsinsp::filter::ast::list_expr::create(values, first->right->get_pos()),
+			first->get_pos()));
+		children.push_back(merged.back().get());
+	}
+}
+
 void sinsp_filter_compiler::visit(const libsinsp::filter::ast::not_expr* e)
 {
 	m_pos = e->get_pos();
@@ -317,6 +626,11 @@ void sinsp_filter_compiler::visit(const libsinsp::filter::ast::unary_check_expr*
 	auto check = std::move(m_last_node_field);
 	check->m_cmpop = str_to_cmpop(e->op);
 	check->m_boolop = m_last_boolop;
+	if (m_cache)
+	{
+		m_cache->set_extraction_cache(check.get(), libsinsp::filter::ast::as_string(e->left.get()), false, true);
+		m_cache->set_eval_cache(check.get(), libsinsp::filter::ast::as_string(e));
+	}
 	m_filter->add_check(std::move(check));
 }
 
@@ -354,6 +668,11 @@ void sinsp_filter_compiler::visit(const libsinsp::filter::ast::binary_check_expr
 	auto check = std::move(m_last_node_field);
 	check->m_cmpop = str_to_cmpop(e->op);
 	check->m_boolop = m_last_boolop;
+	if (m_cache)
+	{
+		m_cache->set_extraction_cache(check.get(), libsinsp::filter::ast::as_string(e->left.get()), false, true);
+		m_cache->set_eval_cache(check.get(), libsinsp::filter::ast::as_string(e));
+	}
 
 	// Read the right-hand values of the filtercheck.
 	m_last_node_field_is_plugin = false;
@@ -384,6 +703,18 @@ void sinsp_filter_compiler::visit(const libsinsp::filter::ast::binary_check_expr
 		}
 
 		// We found another field as right-hand side of the comparison
+		if (m_cache)
+		{
+			// val() is the identity transformer, the field extracts the same
+			// values as when it's used alone
+			auto right = e->right.get();
+			auto tr = dynamic_cast<const libsinsp::filter::ast::field_transformer_expr*>(right);
+			if (tr && tr->transformer == "val")
+			{
+				right = tr->value.get();
+			}
+			m_cache->set_extraction_cache(m_last_node_field.get(), libsinsp::filter::ast::as_string(right), false);
+		}
 		check->add_filter_value(std::move(m_last_node_field));
 	}
 	else
@@ -394,6 +725,20 @@ void sinsp_filter_compiler::visit(const libsinsp::filter::ast::binary_check_expr
 		// can be filled with more than 1 value, whereas in all other cases we
 		// expect the vector to only have 1 value. We don't check this here, as
 		// the parser is trusted to apply proper grammar checks on this constraint.
+		// The string operators supported by multi_pattern_search accept a list
+		// of values too, which is matched if any of the values matches.
+		if (m_field_values.size() > 1 && flt_is_multi_pattern_op(check->m_cmpop))
+		{
+			auto info = check->get_transformed_field_info();
+			if (info == nullptr || info->is_list() || !info->is_rhs_field_supported()
+				|| (info->m_type != PT_CHARBUF
+					&& info->m_type != PT_FSPATH
+					&& info->m_type != PT_FSRELPATH))
+			{
+				throw sinsp_exception("filter error: operator '" + e->op
+					+ "' supports a list of values only with string fields");
+			}
+		}
 		for (size_t i = 0; i < m_field_values.size(); i++)
 		{
 			check_value_and_add_warnings(e->right->get_pos(), m_field_values[i]);
@@ -18,7 +18,9 @@ limitations under the License.
 
 #pragma once
 
+#include <libsinsp/filter_cache.h>
 #include <libsinsp/filter_check_list.h>
+#include <libsinsp/filter_program.h>
 #include <libsinsp/sinsp_filtercheck.h>
 #include <libsinsp/filter/parser.h>
 
@@ -70,8 +72,45 @@ public:
 	//
 	int32_t get_expr_boolop() const;
 
+	//
+	// Enables the adaptive ordering of the children of this expression and
+	// of all the nested ones, or disables it if period is 0. Every child
+	// is profiled (pass rate and sampled evaluation time) and every `period`
+	// evaluations the children are reordered so that the cheapest and most
+	// decisive ones run first, e.g. the ones that are most often false in
+	// an "and" expression. Since "and"/"or" are commutative and filterchecks
+	// have no side effects, the result of the expression doesn't change.
+	//
+	void set_adaptive_ordering(uint32_t period);
+
 	sinsp_filter_expression* m_parent = nullptr;
 	std::vector<std::unique_ptr<sinsp_filter_check>> m_checks;
+
+protected:
+	bool compare_nocache(sinsp_evt*) override;
+
+private:
+	// same counters of check_cache_metrics, for every child
+	struct check_profile
+	{
+		uint64_t m_num_eval = 0;
+		uint64_t m_num_true = 0;
+		uint64_t m_num_timed = 0;
+		uint64_t m_time_ns = 0;
+	};
+
+	struct ordering_state
+	{
+		bool m_and = true;
+		uint32_t m_period = 0;
+		uint32_t m_num_eval = 0;
+		std::vector<check_profile> m_profiles;
+	};
+
+	bool compare_adaptive(sinsp_evt*);
+	void reorder();
+
+	std::unique_ptr<ordering_state> m_ordering;
 };
 
 
@@ -90,10 +129,36 @@ public:
 	void pop_expression();
 	void add_check(std::unique_ptr<sinsp_filter_check> chk);
 
+	inline sinsp_filter_expression* get_current_expression() const
+	{
+		return m_curexpr;
+	}
+
+	/*!
+	  \brief Reorders the and/or expressions of the filter at runtime by
+	  measured cost and selectivity, see
+	  sinsp_filter_expression::set_adaptive_ordering(). Disabled by default.
+	*/
+	void set_adaptive_ordering(uint32_t period = 4096);
+
+	/*!
+	  \brief Lowers the filtercheck tree into a sinsp_filter_program, which
+	  is then used by run() in place of the tree. Adding checks or
+	  expressions or enabling the adaptive ordering afterwards discards the
+	  program and falls back to the tree.
+	*/
+	void compile_program();
+
+	inline const sinsp_filter_program* get_program() const
+	{
+		return m_program.get();
+	}
+
 	std::unique_ptr<sinsp_filter_expression> m_filter;
 
 private:
 	sinsp_filter_expression* m_curexpr;
+	std::unique_ptr<sinsp_filter_program> m_program;
 
 	sinsp* m_inspector;
 };
@@ -214,10 +279,13 @@ public:
 		\param factory Pointer to a filter factory to be used to build
 		the filtercheck tree
 		\param fltstr The filter string to compile
+		\param cache Optional cache shared with other filters and
+		formatters, see sinsp_filter_cache
 	*/
 	sinsp_filter_compiler(
 		std::shared_ptr<sinsp_filter_factory> factory,
-		const std::string& fltstr);
+		const std::string& fltstr,
+		std::shared_ptr<sinsp_filter_cache> cache = nullptr);
 
 	/*!
 		\brief Constructs the compiler
@@ -226,10 +294,13 @@ public:
 		the filtercheck tree
 		\param fltast AST of a parsed filter, used to build the filtercheck
 		tree
+		\param cache Optional cache shared with other filters and
+		formatters, see sinsp_filter_cache
 	*/
 	sinsp_filter_compiler(
 		std::shared_ptr<sinsp_filter_factory> factory,
-		const libsinsp::filter::ast::expr* fltast);
+		const libsinsp::filter::ast::expr* fltast,
+		std::shared_ptr<sinsp_filter_cache> cache = nullptr);
 
 	/*!
 		\brief Builds a filtercheck tree and bundles it in sinsp_filter
@@ -239,6 +310,22 @@ public:
 	*/
 	std::unique_ptr<sinsp_filter> compile();
 
+	/*!
+		\brief If enabled, the filters returned by compile() are evaluated
+		as a flat sinsp_filter_program instead of walking the filtercheck
+		tree, see sinsp_filter::compile_program(). Disabled by default.
+	*/
+	void set_flat_program(bool enabled) { m_flat_program = enabled; }
+
+	/*!
+		\brief If enabled, the children of an "or" expression comparing the
+		same string field with the same contains, icontains, startswith,
+		endswith, glob or iglob operator are merged in a single check
+		against the list of all their values, which is matched in a single
+		pass with a multi_pattern_search. Disabled by default.
+	*/
+	void set_merge_patterns(bool enabled) { m_merge_patterns = enabled; }
+
 	std::shared_ptr<const libsinsp::filter::ast::expr> get_filter_ast() const { return m_internal_flt_ast; }
 
 	std::shared_ptr<libsinsp::filter::ast::expr> get_filter_ast() { return m_internal_flt_ast; }
@@ -262,6 +349,11 @@ private:
 	std::string create_filtercheck_name(const std::string& name, const std::string& arg);
 	std::unique_ptr<sinsp_filter_check> create_filtercheck(std::string_view field);
 	void check_value_and_add_warnings(const libsinsp::filter::ast::pos_info& pos, const std::string& v);
+	bool is_pattern_field(const libsinsp::filter::ast::expr* e);
+	void merge_pattern_checks(
+		const libsinsp::filter::ast::or_expr* e,
+		std::vector<const libsinsp::filter::ast::expr*>& children,
+		std::vector<std::unique_ptr<libsinsp::filter::ast::expr>>& merged);
 
 	libsinsp::filter::ast::pos_info m_pos;
 	boolop m_last_boolop;
@@ -273,6 +365,9 @@ private:
 	std::shared_ptr<libsinsp::filter::ast::expr> m_internal_flt_ast;
 	const libsinsp::filter::ast::expr* m_flt_ast = nullptr;
 	std::shared_ptr<sinsp_filter_factory> m_factory;
+	std::shared_ptr<sinsp_filter_cache> m_cache;
+	bool m_flat_program = false;
+	bool m_merge_patterns = false;
 	std::vector<message> m_warnings;
 	sinsp_filter_check_list m_default_filterlist;
 };
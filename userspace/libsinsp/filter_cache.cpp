@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/filter_cache.h>
+
+sinsp_filter_cache::sinsp_filter_cache():
+	m_metrics(std::make_shared<check_cache_metrics>())
+{
+}
+
+void sinsp_filter_cache::set_extraction_cache(sinsp_filter_check* chk, const std::string& expr, bool sanitize_strings, bool compared)
+{
+	auto& entry = m_extraction_entries[(sanitize_strings ? "s:" : compared ? "c:" : "r:") + expr];
+	if(!entry)
+	{
+		entry = std::make_shared<check_extraction_cache_entry>();
+	}
+	chk->m_extraction_cache_entry = entry;
+	chk->m_cache_metrics = m_metrics;
+}
+
+void sinsp_filter_cache::set_eval_cache(sinsp_filter_check* chk, const std::string& expr)
+{
+	auto& entry = m_eval_entries[expr];
+	if(!entry)
+	{
+		entry = std::make_shared<check_eval_cache_entry>();
+	}
+	chk->m_eval_cache_entry = entry;
+	chk->m_cache_metrics = m_metrics;
+}
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <libsinsp/sinsp_filtercheck.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/*!
+  \brief Shares the per-event extraction and evaluation caches of the
+  filterchecks among all the filters and formatters built with it.
+
+  Identical field extractions (e.g. `proc.name`) and identical
+  sub-expressions (e.g. `evt.type in (open, openat)`) are recognized by
+  their string representation: all the filterchecks built for them point
+  to the same cache entries, so they are extracted or evaluated only once
+  per event. Entries are keyed by event number, so the same cache must
+  not be used by filters evaluated on different threads at the same time.
+*/
+class SINSP_PUBLIC sinsp_filter_cache
+{
+public:
+	sinsp_filter_cache();
+	virtual ~sinsp_filter_cache() = default;
+
+	sinsp_filter_cache(const sinsp_filter_cache&) = delete;
+	sinsp_filter_cache& operator=(const sinsp_filter_cache&) = delete;
+
+	/*!
+	  \brief Attaches the shared extraction cache entry of the given
+	  expression to a filtercheck. Extractions done with and without
+	  string sanitization (i.e. for formatters and for filters) are cached
+	  separately, and so are the extractions of the left-hand side of the
+	  comparisons (`compared`), since some fields (e.g. evt.buffer) are
+	  extracted in their raw form only when compared.
+	*/
+	void set_extraction_cache(sinsp_filter_check* chk, const std::string& expr, bool sanitize_strings, bool compared = false);
+
+	/*!
+	  \brief Attaches the shared evaluation cache entry of the given
+	  expression to a filtercheck.
+	*/
+	void set_eval_cache(sinsp_filter_check* chk, const std::string& expr);
+
+	inline const check_cache_metrics& get_metrics() const
+	{
+		return *m_metrics;
+	}
+
+	inline size_t num_extraction_entries() const
+	{
+		return m_extraction_entries.size();
+	}
+
+	inline size_t num_eval_entries() const
+	{
+		return m_eval_entries.size();
+	}
+
+private:
+	std::unordered_map<std::string, std::shared_ptr<check_extraction_cache_entry>> m_extraction_entries;
+	std::unordered_map<std::string, std::shared_ptr<check_eval_cache_entry>> m_eval_entries;
+	std::shared_ptr<check_cache_metrics> m_metrics;
+};
@@ -0,0 +1,526 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/filter_program.h>
+#include <libsinsp/filter.h>
+#include <libsinsp/sinsp_int.h>
+
+#include <cstring>
+#include <sstream>
+
+template<class T>
+static inline T load_value(const uint8_t* ptr)
+{
+	T val;
+	memcpy(&val, ptr, sizeof(T));
+	return val;
+}
+
+static inline int64_t load_int(const uint8_t* ptr, uint32_t width)
+{
+	switch(width)
+	{
+	case 1:
+		return load_value<int8_t>(ptr);
+	case 2:
+		return load_value<int16_t>(ptr);
+	case 4:
+		return load_value<int32_t>(ptr);
+	default:
+		return load_value<int64_t>(ptr);
+	}
+}
+
+static inline uint64_t load_uint(const uint8_t* ptr, uint32_t width)
+{
+	switch(width)
+	{
+	case 1:
+		return load_value<uint8_t>(ptr);
+	case 2:
+		return load_value<uint16_t>(ptr);
+	case 4:
+		return load_value<uint32_t>(ptr);
+	default:
+		return load_value<uint64_t>(ptr);
+	}
+}
+
+//
+// Returns the size of the types that flt_compare() compares as integers,
+// or 0 for the other types.
+//
+static uint32_t integer_width(ppm_param_type type, bool& is_signed)
+{
+	is_signed = false;
+	switch(type)
+	{
+	case PT_INT8:
+		is_signed = true;
+		return 1;
+	case PT_INT16:
+		is_signed = true;
+		return 2;
+	case PT_INT32:
+		is_signed = true;
+		return 4;
+	case PT_INT64:
+	case PT_FD:
+	case PT_PID:
+	case PT_ERRNO:
+		is_signed = true;
+		return 8;
+	case PT_FLAGS8:
+	case PT_ENUMFLAGS8:
+	case PT_UINT8:
+	case PT_SIGTYPE:
+		return 1;
+	case PT_FLAGS16:
+	case PT_UINT16:
+	case PT_ENUMFLAGS16:
+	case PT_PORT:
+	case PT_SYSCALLID:
+		return 2;
+	case PT_UINT32:
+	case PT_FLAGS32:
+	case PT_ENUMFLAGS32:
+	case PT_MODE:
+	case PT_BOOL:
+		return 4;
+	case PT_UINT64:
+	case PT_RELTIME:
+	case PT_ABSTIME:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+std::unique_ptr<sinsp_filter_program> sinsp_filter_program::lower(const sinsp_filter_expression* expr)
+{
+	if(expr == nullptr)
+	{
+		throw sinsp_exception("can't lower a null filter expression");
+	}
+
+	std::unique_ptr<sinsp_filter_program> p(new sinsp_filter_program());
+	p->lower_expression(expr);
+	p->emit(OP_RET);
+	p->thread_jumps();
+	return p;
+}
+
+uint32_t sinsp_filter_program::emit(opcode op, uint32_t arg)
+{
+	m_code.push_back({op, arg, 0});
+	return m_code.size() - 1;
+}
+
+void sinsp_filter_program::lower_check(const sinsp_filter_check* c)
+{
+	auto chk = const_cast<sinsp_filter_check*>(c);
+	uint32_t idx = m_checks.size();
+	m_checks.push_back(chk);
+
+	// the cached results are stored by the check itself
+	operand o = {};
+	opcode cmp = OP_CHECK;
+	if(chk->m_eval_cache_entry == nullptr && chk->has_default_compare())
+	{
+		cmp = lower_comparison(chk, o);
+	}
+
+	if(cmp == OP_CHECK)
+	{
+		emit(OP_CHECK, idx);
+		return;
+	}
+
+	uint32_t extract = emit(OP_EXTRACT, idx);
+	if(cmp == OP_CONST)
+	{
+		emit(OP_CONST, 1);
+	}
+	else
+	{
+		emit(cmp, m_operands.size());
+		m_operands.push_back(o);
+	}
+	m_code[extract].m_jump = m_code.size();
+}
+
+//
+// This follows sinsp_filter_check::compare_rhs() for a single extracted
+// value. Returns the typed comparison of the value with the filter values
+// of the check, OP_CONST if the value only needs to exist, or OP_CHECK if
+// the check has to compare it by itself.
+//
+sinsp_filter_program::opcode sinsp_filter_program::lower_comparison(sinsp_filter_check* chk, operand& o) const
+{
+	o.m_cmpop = chk->m_cmpop;
+	o.m_type = chk->get_transformed_field_info()->m_type;
+	o.m_check = chk;
+	if(o.m_cmpop == CO_EXISTS)
+	{
+		return OP_CONST;
+	}
+
+	if(o.m_cmpop == CO_IN || o.m_cmpop == CO_PMATCH || o.m_cmpop == CO_INTERSECTS)
+	{
+		switch(o.m_type)
+		{
+		case PT_IPV4NET:
+		case PT_IPV6NET:
+		case PT_IPNET:
+			o.m_ipnets = chk->get_ipnet_search();
+			return o.m_ipnets != nullptr ? OP_CMP_IPNET : OP_CHECK;
+		default:
+			return OP_CHECK;
+		}
+	}
+
+	const auto& vals = chk->get_filter_values();
+	if(vals.size() != 1)
+	{
+		return OP_CHECK;
+	}
+
+	bool is_signed;
+	o.m_width = integer_width(o.m_type, is_signed);
+	if(o.m_width != 0)
+	{
+		// flt_compare() rejects the constants of the wrong size
+		if(vals[0].second != o.m_width)
+		{
+			return OP_CHECK;
+		}
+		o.m_num = is_signed ? (uint64_t)load_int(vals[0].first, o.m_width) : load_uint(vals[0].first, o.m_width);
+		return is_signed ? OP_CMP_INT : OP_CMP_UINT;
+	}
+
+	switch(o.m_type)
+	{
+	case PT_CHARBUF:
+	case PT_FSPATH:
+	case PT_FSRELPATH:
+		// glob patterns are compiled by the check
+		if(o.m_cmpop == CO_GLOB || o.m_cmpop == CO_IGLOB)
+		{
+			return OP_CHECK;
+		}
+		o.m_str = (char*)vals[0].first;
+		return OP_CMP_STR;
+	default:
+		return OP_CHECK;
+	}
+}
+
+//
+// This follows the semantics of sinsp_filter_expression::compare_nocache():
+// every child but the first one is preceded by a jump to the end of the
+// expression, taken when the result is already decided by the children
+// evaluated so far.
+//
+void sinsp_filter_program::lower_expression(const sinsp_filter_expression* expr)
+{
+	uint32_t cached = 0;
+	uint32_t load = 0;
+	bool has_cache = expr->m_eval_cache_entry != nullptr;
+	if(has_cache)
+	{
+		cached = m_cached.size();
+		m_cached.push_back({expr->m_eval_cache_entry.get(), expr->m_cache_metrics.get()});
+		load = emit(OP_LOAD_CACHED, cached);
+	}
+
+	if(expr->m_checks.empty())
+	{
+		emit(OP_CONST, 1);
+	}
+
+	std::vector<uint32_t> exits;
+	for(size_t j = 0; j < expr->m_checks.size(); j++)
+	{
+		const sinsp_filter_check* chk = expr->m_checks[j].get();
+		bool has_op = (chk->m_boolop & (BO_AND | BO_OR)) != 0;
+		if(j == 0)
+		{
+			// malformed trees are evaluated as the tree evaluator does
+			if(has_op)
+			{
+				emit(OP_CONST, 1);
+				continue;
+			}
+		}
+		else
+		{
+			if(!has_op)
+			{
+				continue;
+			}
+			exits.push_back(emit((chk->m_boolop & BO_OR) ? OP_JMP_TRUE : OP_JMP_FALSE));
+		}
+
+		auto sub = dynamic_cast<const sinsp_filter_expression*>(chk);
+		if(sub != nullptr)
+		{
+			lower_expression(sub);
+		}
+		else
+		{
+			lower_check(chk);
+		}
+
+		if(chk->m_boolop & BO_NOT)
+		{
+			emit(OP_NOT);
+		}
+	}
+
+	for(auto e : exits)
+	{
+		m_code[e].m_jump = m_code.size();
+	}
+
+	if(has_cache)
+	{
+		emit(OP_STORE_CACHED, cached);
+		m_code[load].m_jump = m_code.size();
+	}
+}
+
+//
+// A jump landing on another conditional jump already knows the value of
+// the register, so it can skip it or follow it directly. This collapses
+// the exits of nested expressions, e.g. in "(a and b) or c" a false "a"
+// jumps straight to "c".
+//
+void sinsp_filter_program::thread_jumps()
+{
+	for(auto& i : m_code)
+	{
+		if(i.m_op != OP_JMP_FALSE && i.m_op != OP_JMP_TRUE)
+		{
+			continue;
+		}
+
+		// all the jumps go forward, so this terminates
+		while(true)
+		{
+			const auto& target = m_code[i.m_jump];
+			if(target.m_op == i.m_op)
+			{
+				i.m_jump = target.m_jump;
+			}
+			else if(target.m_op == OP_JMP_FALSE || target.m_op == OP_JMP_TRUE)
+			{
+				i.m_jump++;
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+}
+
+bool sinsp_filter_program::run(sinsp_evt* evt)
+{
+	bool reg = true;
+	extract_value_t val;
+	const instruction* code = m_code.data();
+	uint32_t pc = 0;
+	while(true)
+	{
+		const instruction& i = code[pc];
+		switch(i.m_op)
+		{
+		case OP_CHECK:
+			reg = m_checks[i.m_arg]->compare(evt);
+			pc++;
+			break;
+		case OP_NOT:
+			reg = !reg;
+			pc++;
+			break;
+		case OP_JMP_FALSE:
+			pc = reg ? pc + 1 : i.m_jump;
+			break;
+		case OP_JMP_TRUE:
+			pc = reg ? i.m_jump : pc + 1;
+			break;
+		case OP_CONST:
+			reg = i.m_arg != 0;
+			pc++;
+			break;
+		case OP_LOAD_CACHED:
+		{
+			const auto& c = m_cached[i.m_arg];
+			if(c.m_metrics != nullptr)
+			{
+				c.m_metrics->m_num_eval++;
+			}
+			if(c.m_entry->m_evtnum == evt->get_num())
+			{
+				if(c.m_metrics != nullptr)
+				{
+					c.m_metrics->m_num_eval_cache++;
+				}
+				reg = c.m_entry->m_res;
+				pc = i.m_jump;
+			}
+			else
+			{
+				pc++;
+			}
+			break;
+		}
+		case OP_STORE_CACHED:
+			m_cached[i.m_arg].m_entry->m_res = reg;
+			m_cached[i.m_arg].m_entry->m_evtnum = evt->get_num();
+			pc++;
+			break;
+		case OP_EXTRACT:
+		{
+			sinsp_filter_check* chk = m_checks[i.m_arg];
+			if(chk->m_cache_metrics != nullptr)
+			{
+				chk->m_cache_metrics->m_num_eval++;
+			}
+			switch(chk->extract_into(evt, &val, 1, false))
+			{
+			case 0:
+				reg = false;
+				pc = i.m_jump;
+				break;
+			case 1:
+				pc++;
+				break;
+			default:
+				// let the check report the error
+				reg = chk->compare(evt);
+				pc = i.m_jump;
+				break;
+			}
+			break;
+		}
+		case OP_CMP_INT:
+		{
+			const operand& o = m_operands[i.m_arg];
+			reg = flt_compare_int64(o.m_cmpop, load_int(val.ptr, o.m_width), (int64_t)o.m_num);
+			pc++;
+			break;
+		}
+		case OP_CMP_UINT:
+		{
+			const operand& o = m_operands[i.m_arg];
+			reg = flt_compare_uint64(o.m_cmpop, load_uint(val.ptr, o.m_width), o.m_num);
+			pc++;
+			break;
+		}
+		case OP_CMP_STR:
+		{
+			const operand& o = m_operands[i.m_arg];
+			reg = flt_compare_string(o.m_cmpop, (char*)val.ptr, o.m_str);
+			pc++;
+			break;
+		}
+		case OP_CMP_IPNET:
+		{
+			// same length checks of sinsp_filter_check::match_ipnet_values()
+			const operand& o = m_operands[i.m_arg];
+			if(o.m_type == PT_IPV4NET || (o.m_type == PT_IPNET && val.len == sizeof(uint32_t)))
+			{
+				reg = o.m_ipnets->match(load_value<uint32_t>(val.ptr));
+			}
+			else if(o.m_type == PT_IPV6NET || (o.m_type == PT_IPNET && val.len == sizeof(ipv6addr)))
+			{
+				reg = o.m_ipnets->match(*(ipv6addr*)val.ptr);
+			}
+			else
+			{
+				reg = o.m_check->compare(evt);
+			}
+			pc++;
+			break;
+		}
+		case OP_RET:
+			return reg;
+		}
+	}
+}
+
+std::string sinsp_filter_program::as_string() const
+{
+	std::ostringstream out;
+	for(size_t pc = 0; pc < m_code.size(); pc++)
+	{
+		const auto& i = m_code[pc];
+		out << pc << ": ";
+		switch(i.m_op)
+		{
+		case OP_CHECK:
+		{
+			auto info = m_checks[i.m_arg]->get_field_info();
+			out << "check " << i.m_arg << " (" << (info != nullptr ? info->m_name : "?") << ")";
+			break;
+		}
+		case OP_NOT:
+			out << "not";
+			break;
+		case OP_JMP_FALSE:
+			out << "jmp_false " << i.m_jump;
+			break;
+		case OP_JMP_TRUE:
+			out << "jmp_true " << i.m_jump;
+			break;
+		case OP_CONST:
+			out << "const " << i.m_arg;
+			break;
+		case OP_LOAD_CACHED:
+			out << "load_cached " << i.m_arg << " " << i.m_jump;
+			break;
+		case OP_STORE_CACHED:
+			out << "store_cached " << i.m_arg;
+			break;
+		case OP_RET:
+			out << "ret";
+			break;
+		case OP_EXTRACT:
+		{
+			auto info = m_checks[i.m_arg]->get_field_info();
+			out << "extract " << i.m_arg << " (" << (info != nullptr ? info->m_name : "?") << ") " << i.m_jump;
+			break;
+		}
+		case OP_CMP_INT:
+			out << "cmp_int " << i.m_arg << " " << std::to_string(m_operands[i.m_arg].m_cmpop);
+			break;
+		case OP_CMP_UINT:
+			out << "cmp_uint " << i.m_arg << " " << std::to_string(m_operands[i.m_arg].m_cmpop);
+			break;
+		case OP_CMP_STR:
+			out << "cmp_str " << i.m_arg << " " << std::to_string(m_operands[i.m_arg].m_cmpop);
+			break;
+		case OP_CMP_IPNET:
+			out << "cmp_ipnet " << i.m_arg << " " << std::to_string(m_operands[i.m_arg].m_cmpop);
+			break;
+		}
+		out << "\n";
+	}
+	return out.str();
+}
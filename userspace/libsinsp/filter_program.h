@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <libsinsp/sinsp_filtercheck.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class sinsp_filter_expression;
+
+/*!
+  \brief A filter lowered into a linear instruction stream.
+
+  The and/or/not expressions of a compiled filter are flattened into a
+  sequence of instructions working on a single boolean register, where
+  short-circuiting becomes a forward conditional jump. The leaves with
+  the default comparison of sinsp_filter_check are split into the
+  extraction of their value and a comparison typed after the field,
+  which works on constants decoded at lowering time: numbers, strings
+  and network lists are compared without going through the virtual
+  compare() and the type dispatch of flt_compare(). The other leaves
+  are compared by their filtercheck. Evaluating the filter is then a
+  loop over a contiguous array with no recursion, and it does not
+  allocate.
+
+  The program does not own the filterchecks, which belong to the
+  expression tree it has been lowered from and must outlive it.
+*/
+class SINSP_PUBLIC sinsp_filter_program
+{
+public:
+	enum opcode : uint8_t
+	{
+		OP_CHECK = 0,        ///< reg = checks[arg]->compare(evt)
+		OP_NOT = 1,          ///< reg = !reg
+		OP_JMP_FALSE = 2,    ///< if !reg, continue at jump
+		OP_JMP_TRUE = 3,     ///< if reg, continue at jump
+		OP_CONST = 4,        ///< reg = arg != 0
+		OP_LOAD_CACHED = 5,  ///< if cache[arg] is valid for the event, reg = its value and continue at jump
+		OP_STORE_CACHED = 6, ///< cache[arg] = reg
+		OP_RET = 7,          ///< return reg
+		OP_EXTRACT = 8,      ///< val = checks[arg]->extract_into(evt), if there is no value reg = false and continue at jump
+		OP_CMP_INT = 9,      ///< reg = val compared with operands[arg] as a signed integer
+		OP_CMP_UINT = 10,    ///< reg = val compared with operands[arg] as an unsigned integer
+		OP_CMP_STR = 11,     ///< reg = val compared with operands[arg] as a string
+		OP_CMP_IPNET = 12,   ///< reg = val belongs to one of the networks of operands[arg]
+	};
+
+	struct instruction
+	{
+		opcode m_op;
+		uint32_t m_arg;
+		uint32_t m_jump;
+	};
+
+	/*!
+	  \brief Lowers a filtercheck tree into a program.
+	*/
+	static std::unique_ptr<sinsp_filter_program> lower(const sinsp_filter_expression* expr);
+
+	bool run(sinsp_evt* evt);
+
+	inline const std::vector<instruction>& get_instructions() const
+	{
+		return m_code;
+	}
+
+	inline size_t num_checks() const
+	{
+		return m_checks.size();
+	}
+
+	inline size_t num_operands() const
+	{
+		return m_operands.size();
+	}
+
+	/*!
+	  \brief Returns a human-readable listing of the instructions, one per
+	  line, useful for debugging.
+	*/
+	std::string as_string() const;
+
+private:
+	struct cached_expression
+	{
+		check_eval_cache_entry* m_entry;
+		check_cache_metrics* m_metrics;
+	};
+
+	// the right-hand side of a typed comparison
+	struct operand
+	{
+		cmpop m_cmpop;
+		ppm_param_type m_type;
+		uint32_t m_width;
+		uint64_t m_num;
+		char* m_str;
+		const ipnet_search* m_ipnets;
+		sinsp_filter_check* m_check;
+	};
+
+	sinsp_filter_program() = default;
+
+	uint32_t emit(opcode op, uint32_t arg = 0);
+	void lower_expression(const sinsp_filter_expression* expr);
+	void lower_check(const sinsp_filter_check* chk);
+	opcode lower_comparison(sinsp_filter_check* chk, operand& o) const;
+	void thread_jumps();
+
+	std::vector<instruction> m_code;
+	std::vector<sinsp_filter_check*> m_checks;
+	std::vector<cached_expression> m_cached;
+	std::vector<operand> m_operands;
+};
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/filter_ruleset.h>
+#include <libsinsp/filter/ppm_codes.h>
+#include <libsinsp/sinsp_int.h>
+
+sinsp_filter_ruleset::sinsp_filter_ruleset(sinsp* inspector):
+	m_inspector(inspector),
+	m_cache(std::make_shared<sinsp_filter_cache>()),
+	m_flat_program(false),
+	m_merge_patterns(false),
+	m_index_dirty(true)
+{
+}
+
+size_t sinsp_filter_ruleset::add(const std::string& name,
+				 const std::string& source,
+				 const std::string& condition,
+				 std::shared_ptr<sinsp_filter_factory> factory)
+{
+	sinsp_filter_compiler compiler(factory, condition, m_cache);
+	compiler.set_flat_program(m_flat_program);
+	compiler.set_merge_patterns(m_merge_patterns);
+	auto filter = compiler.compile();
+	auto codes = libsinsp::filter::ast::ppm_event_codes(compiler.get_filter_ast().get());
+	return add(name, source, std::move(filter), codes);
+}
+
+size_t sinsp_filter_ruleset::add(const std::string& name,
+				 const std::string& source,
+				 std::unique_ptr<sinsp_filter> filter,
+				 const libsinsp::events::set<ppm_event_code>& event_codes)
+{
+	if(!filter)
+	{
+		throw sinsp_exception("null filter for rule '" + name + "'");
+	}
+
+	auto r = std::make_unique<rule>(rule{name, source, std::move(filter), event_codes, true});
+	m_rules.push_back(std::move(r));
+	m_index_dirty = true;
+	return m_rules.size() - 1;
+}
+
+void sinsp_filter_ruleset::enable(size_t id, bool enabled)
+{
+	auto& r = m_rules.at(id);
+	if(r->m_enabled != enabled)
+	{
+		r->m_enabled = enabled;
+		m_index_dirty = true;
+	}
+}
+
+libsinsp::events::set<ppm_event_code> sinsp_filter_ruleset::enabled_event_codes(const std::string& source) const
+{
+	libsinsp::events::set<ppm_event_code> ret;
+	for(const auto& r : m_rules)
+	{
+		if(r->m_enabled && r->m_source == source)
+		{
+			ret = ret.merge(r->m_event_codes);
+		}
+	}
+	return ret;
+}
+
+bool sinsp_filter_ruleset::run(sinsp_evt* evt, std::vector<size_t>& matches)
+{
+	bool matched = false;
+	for(auto id : candidates(evt))
+	{
+		if(m_rules[id]->m_filter->run(evt))
+		{
+			matches.push_back(id);
+			matched = true;
+		}
+	}
+	return matched;
+}
+
+bool sinsp_filter_ruleset::run_first(sinsp_evt* evt, size_t& id)
+{
+	for(auto candidate : candidates(evt))
+	{
+		if(m_rules[candidate]->m_filter->run(evt))
+		{
+			id = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+const std::vector<size_t>& sinsp_filter_ruleset::candidates(sinsp_evt* evt)
+{
+	auto src_idx = evt->get_source_idx();
+	if(src_idx == sinsp_no_event_source_idx || evt->get_type() >= PPM_EVENT_MAX)
+	{
+		return m_no_candidates;
+	}
+
+	// sources can be added after the rules, e.g. by plugins
+	if(m_index_dirty || src_idx >= m_index.size())
+	{
+		rebuild_index();
+		if(src_idx >= m_index.size())
+		{
+			return m_no_candidates;
+		}
+	}
+
+	return m_index[src_idx][evt->get_type()];
+}
+
+void sinsp_filter_ruleset::rebuild_index()
+{
+	const auto& sources = m_inspector->event_sources();
+	m_index.assign(sources.size(), source_index(PPM_EVENT_MAX));
+	for(size_t src_idx = 0; src_idx < sources.size(); src_idx++)
+	{
+		auto& index = m_index[src_idx];
+		for(size_t id = 0; id < m_rules.size(); id++)
+		{
+			const auto& r = m_rules[id];
+			if(!r->m_enabled || r->m_source != sources[src_idx])
+			{
+				continue;
+			}
+			r->m_event_codes.for_each([&index, id](ppm_event_code code)
+			{
+				index[code].push_back(id);
+				return true;
+			});
+		}
+	}
+	m_index_dirty = false;
+}
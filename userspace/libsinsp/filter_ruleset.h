@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <libsinsp/filter.h>
+#include <libsinsp/events/sinsp_events.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*!
+  \brief A set of compiled filters (rules), each one bound to an event
+  source, evaluated together on every event.
+
+  Rules are indexed by event source and by the event types they can match
+  (see libsinsp::filter::ast::ppm_event_codes()), so that only the
+  candidate rules are evaluated for each event instead of all of them.
+  Rules are evaluated in the order they were added. The rules compiled by
+  the ruleset share a sinsp_filter_cache, which can be passed to the
+  formatters of the rules too. Like sinsp_filter, a ruleset is not thread
+  safe.
+*/
+class SINSP_PUBLIC sinsp_filter_ruleset
+{
+public:
+	struct rule
+	{
+		std::string m_name;
+		std::string m_source;
+		std::unique_ptr<sinsp_filter> m_filter;
+		libsinsp::events::set<ppm_event_code> m_event_codes;
+		bool m_enabled;
+	};
+
+	explicit sinsp_filter_ruleset(sinsp* inspector);
+	virtual ~sinsp_filter_ruleset() = default;
+
+	sinsp_filter_ruleset(const sinsp_filter_ruleset&) = delete;
+	sinsp_filter_ruleset& operator=(const sinsp_filter_ruleset&) = delete;
+
+	/*!
+	  \brief Compiles a rule condition with the given factory and adds it
+	  to the ruleset, enabled. Throws a sinsp_exception if the condition is
+	  not valid.
+
+	  \return the id of the rule, i.e. the number of rules added before it.
+	*/
+	size_t add(const std::string& name,
+		   const std::string& source,
+		   const std::string& condition,
+		   std::shared_ptr<sinsp_filter_factory> factory);
+
+	/*!
+	  \brief Adds an already compiled filter, which is evaluated only for
+	  the given event types.
+	*/
+	size_t add(const std::string& name,
+		   const std::string& source,
+		   std::unique_ptr<sinsp_filter> filter,
+		   const libsinsp::events::set<ppm_event_code>& event_codes);
+
+	void enable(size_t id, bool enabled);
+
+	/*!
+	  \brief If enabled, the rules added afterwards from a condition are
+	  compiled as flat programs, see
+	  sinsp_filter_compiler::set_flat_program(). Disabled by default.
+	*/
+	inline void set_flat_program(bool enabled)
+	{
+		m_flat_program = enabled;
+	}
+
+	/*!
+	  \brief If enabled, the rules added afterwards from a condition get
+	  their string pattern lists merged, see
+	  sinsp_filter_compiler::set_merge_patterns(). Disabled by default.
+	*/
+	inline void set_merge_patterns(bool enabled)
+	{
+		m_merge_patterns = enabled;
+	}
+
+	inline size_t size() const
+	{
+		return m_rules.size();
+	}
+
+	inline const rule& get(size_t id) const
+	{
+		return *m_rules.at(id);
+	}
+
+	inline const std::shared_ptr<sinsp_filter_cache>& get_cache() const
+	{
+		return m_cache;
+	}
+
+	/*!
+	  \brief Returns the event types that can be matched by the enabled
+	  rules of the given source.
+	*/
+	libsinsp::events::set<ppm_event_code> enabled_event_codes(const std::string& source) const;
+
+	/*!
+	  \brief Evaluates all the candidate rules and appends the ids of the
+	  matching ones to `matches`. Returns true if at least one rule matched.
+	*/
+	bool run(sinsp_evt* evt, std::vector<size_t>& matches);
+
+	/*!
+	  \brief Evaluates the candidate rules until one matches and sets `id`
+	  to its id. Returns false if no rule matched.
+	*/
+	bool run_first(sinsp_evt* evt, size_t& id);
+
+private:
+	// ids of the candidate rules, by event type
+	typedef std::vector<std::vector<size_t>> source_index;
+
+	const std::vector<size_t>& candidates(sinsp_evt* evt);
+	void rebuild_index();
+
+	sinsp* m_inspector;
+	std::shared_ptr<sinsp_filter_cache> m_cache;
+	std::vector<std::unique_ptr<rule>> m_rules;
+	bool m_flat_program;
+	bool m_merge_patterns;
+
+	// by event source index, see sinsp_evt::get_source_idx()
+	std::vector<source_index> m_index;
+	bool m_index_dirty;
+	std::vector<size_t> m_no_candidates;
+};
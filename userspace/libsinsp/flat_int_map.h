@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Hash map with integer keys, stored in a single flat array of
+ * key/value slots with linear probing. Compared to std::unordered_map, a
+ * lookup touches one or two adjacent cache lines instead of walking a bucket
+ * list of separately allocated nodes.
+ *
+ * Values must be testable as booleans (e.g. smart pointers) and an empty
+ * value marks a free slot, so null values can't be stored. Erasing moves the
+ * following slots of the probe sequence backward (no tombstones), so the
+ * pointers returned by find() and the ongoing for_each() loops are
+ * invalidated by insert() and erase(), like the std::unordered_map iterators
+ * on rehash.
+ */
+template<typename K, typename V>
+class flat_int_map
+{
+	static_assert(std::is_integral<K>::value, "flat_int_map requires integer keys");
+
+public:
+	explicit flat_int_map(size_t capacity = 0)
+	{
+		reserve(capacity);
+	}
+
+	inline size_t size() const { return m_size; }
+
+	inline bool empty() const { return m_size == 0; }
+
+	/**
+	 * @brief Returns a pointer to the value of the given key, or nullptr if
+	 * the key is not in the map.
+	 */
+	inline V* find(K key)
+	{
+		if(m_size == 0)
+		{
+			return nullptr;
+		}
+		for(size_t i = home(key);; i = (i + 1) & m_mask)
+		{
+			slot& s = m_slots[i];
+			if(!s.value)
+			{
+				return nullptr;
+			}
+			if(s.key == key)
+			{
+				return &s.value;
+			}
+		}
+	}
+
+	inline const V* find(K key) const
+	{
+		return const_cast<flat_int_map*>(this)->find(key);
+	}
+
+	/**
+	 * @brief Inserts the value, or replaces the existing one. Returns true
+	 * if the key was not in the map.
+	 */
+	inline bool insert(K key, V value)
+	{
+		if((m_size + 1) * 4 > m_slots.size() * 3)
+		{
+			rehash(m_slots.size() < min_capacity ? min_capacity : m_slots.size() * 2);
+		}
+		for(size_t i = home(key);; i = (i + 1) & m_mask)
+		{
+			slot& s = m_slots[i];
+			if(!s.value)
+			{
+				s.key = key;
+				s.value = std::move(value);
+				m_size++;
+				return true;
+			}
+			if(s.key == key)
+			{
+				s.value = std::move(value);
+				return false;
+			}
+		}
+	}
+
+	/**
+	 * @brief Removes the given key. Returns false if the key was not in the
+	 * map.
+	 */
+	inline bool erase(K key)
+	{
+		if(m_size == 0)
+		{
+			return false;
+		}
+		size_t i = home(key);
+		while(m_slots[i].key != key || !m_slots[i].value)
+		{
+			if(!m_slots[i].value)
+			{
+				return false;
+			}
+			i = (i + 1) & m_mask;
+		}
+
+		// shift back the following entries that can't be found anymore
+		// once slot i is freed, i.e. whose home slot is not in (i, j]
+		for(size_t j = (i + 1) & m_mask; m_slots[j].value; j = (j + 1) & m_mask)
+		{
+			size_t h = home(m_slots[j].key);
+			if(((j - h) & m_mask) >= ((j - i) & m_mask))
+			{
+				m_slots[i].key = m_slots[j].key;
+				m_slots[i].value = std::move(m_slots[j].value);
+				i = j;
+			}
+		}
+		m_slots[i].value = V();
+		m_size--;
+		return true;
+	}
+
+	/**
+	 * @brief Removes all the entries, keeping the allocated slots.
+	 */
+	inline void clear()
+	{
+		if(m_size == 0)
+		{
+			return;
+		}
+		for(auto& s : m_slots)
+		{
+			s.value = V();
+		}
+		m_size = 0;
+	}
+
+	/**
+	 * @brief Makes room for at least n entries without rehashing.
+	 */
+	inline void reserve(size_t n)
+	{
+		size_t capacity = min_capacity;
+		while(capacity * 3 < n * 4)
+		{
+			capacity *= 2;
+		}
+		if(n > 0 && capacity > m_slots.size())
+		{
+			rehash(capacity);
+		}
+	}
+
+	/**
+	 * @brief Calls f(key, value) for every entry, in no particular order,
+	 * until f returns false. Returns false if the loop was interrupted.
+	 */
+	template<typename F>
+	inline bool for_each(F&& f)
+	{
+		for(auto& s : m_slots)
+		{
+			if(s.value && !f(s.key, s.value))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<typename F>
+	inline bool for_each(F&& f) const
+	{
+		for(const auto& s : m_slots)
+		{
+			if(s.value && !f(s.key, s.value))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	static constexpr size_t min_capacity = 16;
+
+	struct slot
+	{
+		K key;
+		V value;
+	};
+
+	// Fibonacci hashing: the multiplication spreads the sequential tids
+	// allocated by the kernel over the whole table
+	inline size_t home(K key) const
+	{
+		return (size_t)(((uint64_t)key * UINT64_C(0x9E3779B97F4A7C15)) >> m_shift);
+	}
+
+	void rehash(size_t capacity)
+	{
+		std::vector<slot> old(capacity);
+		old.swap(m_slots);
+		m_mask = capacity - 1;
+		m_shift = 64;
+		for(size_t c = capacity; c > 1; c >>= 1)
+		{
+			m_shift--;
+		}
+		for(auto& s : old)
+		{
+			if(s.value)
+			{
+				size_t i = home(s.key);
+				while(m_slots[i].value)
+				{
+					i = (i + 1) & m_mask;
+				}
+				m_slots[i].key = s.key;
+				m_slots[i].value = std::move(s.value);
+			}
+		}
+	}
+
+	std::vector<slot> m_slots;
+	size_t m_size = 0;
+	size_t m_mask = 0;
+	unsigned m_shift = 64;
+};
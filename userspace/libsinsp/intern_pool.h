@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace libsinsp {
+
+struct intern_pool_stats
+{
+	/** Number of values looked up in the pools */
+	uint64_t n_lookups = 0;
+
+	/** Number of lookups that found an equal value already pooled */
+	uint64_t n_hits = 0;
+
+	/** Number of distinct values currently pooled */
+	uint64_t n_values = 0;
+
+	/** Memory currently not allocated thanks to the values shared by more than one holder */
+	uint64_t n_saved_bytes = 0;
+
+	intern_pool_stats& operator+=(const intern_pool_stats& other)
+	{
+		n_lookups += other.n_lookups;
+		n_hits += other.n_hits;
+		n_values += other.n_values;
+		n_saved_bytes += other.n_saved_bytes;
+		return *this;
+	}
+};
+
+/**
+ * @brief Thread safe pool of immutable values shared by all the holders of
+ * equal ones. intern() returns the pooled value equal to the given one,
+ * adding it to the pool if there is none, and a value leaves the pool when
+ * its last reference is released. Hash hashes a value and Size estimates the
+ * memory it takes. A pool must outlive the values it returns. The values are
+ * spread by hash over independently locked shards, so that the inspectors
+ * updating their thread tables at the same time seldom wait for each other.
+ */
+template<typename T, typename Hash, typename Size>
+class intern_pool
+{
+public:
+	using ptr_t = std::shared_ptr<const T>;
+
+	intern_pool() = default;
+	intern_pool(const intern_pool&) = delete;
+	intern_pool& operator=(const intern_pool&) = delete;
+
+	ptr_t intern(T&& value)
+	{
+		size_t hash = Hash{}(value);
+		shard& sh = get_shard(hash);
+
+		std::lock_guard<std::mutex> lock(sh.m_mtx);
+		sh.m_n_lookups++;
+		auto range = sh.m_values.equal_range(hash);
+		for(auto it = range.first; it != range.second; ++it)
+		{
+			// the value is still alive until its deleter removes the
+			// entry, but it can be already unreferenced
+			if(*it->second.m_value == value)
+			{
+				if(ptr_t ret = it->second.m_ref.lock())
+				{
+					sh.m_n_hits++;
+					return ret;
+				}
+			}
+		}
+
+		const T* pooled = new T(std::move(value));
+		ptr_t ret(pooled, [this, hash](const T* p) { release(hash, p); });
+		sh.m_values.emplace(hash, entry{pooled, ret, Size{}(*pooled)});
+		return ret;
+	}
+
+	intern_pool_stats get_stats() const
+	{
+		intern_pool_stats ret;
+
+		for(const auto& sh : m_shards)
+		{
+			std::lock_guard<std::mutex> lock(sh.m_mtx);
+			ret.n_lookups += sh.m_n_lookups;
+			ret.n_hits += sh.m_n_hits;
+			ret.n_values += sh.m_values.size();
+			for(const auto& it : sh.m_values)
+			{
+				long refs = it.second.m_ref.use_count();
+				if(refs > 1)
+				{
+					ret.n_saved_bytes += (refs - 1) * it.second.m_size;
+				}
+			}
+		}
+		return ret;
+	}
+
+private:
+	struct entry
+	{
+		const T* m_value;
+		std::weak_ptr<const T> m_ref;
+		size_t m_size;
+	};
+
+	struct shard
+	{
+		mutable std::mutex m_mtx;
+		std::unordered_multimap<size_t, entry> m_values;
+		uint64_t m_n_lookups = 0;
+		uint64_t m_n_hits = 0;
+	};
+
+	// a power of two, the shard is picked by the top 4 bits of the mixed hash
+	static constexpr size_t s_n_shards = 16;
+
+	shard& get_shard(size_t hash)
+	{
+		// the low bits also pick the bucket in the shard, so the shard is
+		// picked by the high bits of the (fibonacci) mixed hash
+		return m_shards[((uint64_t)hash * 0x9e3779b97f4a7c15ULL) >> 60];
+	}
+
+	void release(size_t hash, const T* p)
+	{
+		{
+			shard& sh = get_shard(hash);
+			std::lock_guard<std::mutex> lock(sh.m_mtx);
+			auto range = sh.m_values.equal_range(hash);
+			for(auto it = range.first; it != range.second; ++it)
+			{
+				if(it->second.m_value == p)
+				{
+					sh.m_values.erase(it);
+					break;
+				}
+			}
+		}
+		delete p;
+	}
+
+	std::array<shard, s_n_shards> m_shards;
+};
+
+}; // libsinsp
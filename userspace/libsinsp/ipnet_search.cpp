@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/ipnet_search.h>
+
+#include <bitset>
+
+static inline uint32_t addr_bit(const uint8_t* addr, uint32_t i)
+{
+	return (addr[i / 8] >> (7 - (i % 8))) & 1;
+}
+
+void ipnet_search::add_network(const ipv4net& net)
+{
+	// the netmask is always contiguous, see sinsp_filter_value_parser
+	uint32_t prefix_len = std::bitset<32>(net.m_netmask).count();
+	add(m_ipv4, (const uint8_t*)&net.m_ip, prefix_len);
+}
+
+void ipnet_search::add_network(const ipv6net& net)
+{
+	add(m_ipv6, (const uint8_t*)net.get_addr().m_b, net.get_prefix_len());
+}
+
+bool ipnet_search::match(uint32_t addr) const
+{
+	return match(m_ipv4, (const uint8_t*)&addr, 32);
+}
+
+bool ipnet_search::match(const ipv6addr& addr) const
+{
+	return match(m_ipv6, (const uint8_t*)addr.m_b, 128);
+}
+
+void ipnet_search::add(std::vector<node>& trie, const uint8_t* addr, uint32_t prefix_len)
+{
+	if(trie.empty())
+	{
+		trie.emplace_back();
+	}
+
+	uint32_t n = 0;
+	for(uint32_t i = 0; i < prefix_len; i++)
+	{
+		if(trie[n].m_terminal)
+		{
+			// already covered by a wider network
+			return;
+		}
+
+		uint32_t b = addr_bit(addr, i);
+		if(trie[n].m_child[b] == 0)
+		{
+			trie[n].m_child[b] = trie.size();
+			trie.emplace_back();
+		}
+		n = trie[n].m_child[b];
+	}
+
+	// the narrower networks below this one are unreachable from now on
+	trie[n].m_terminal = true;
+	trie[n].m_child[0] = 0;
+	trie[n].m_child[1] = 0;
+}
+
+bool ipnet_search::match(const std::vector<node>& trie, const uint8_t* addr, uint32_t addr_len)
+{
+	if(trie.empty())
+	{
+		return false;
+	}
+
+	uint32_t n = 0;
+	for(uint32_t i = 0; i < addr_len; i++)
+	{
+		if(trie[n].m_terminal)
+		{
+			return true;
+		}
+
+		n = trie[n].m_child[addr_bit(addr, i)];
+		if(n == 0)
+		{
+			return false;
+		}
+	}
+	return trie[n].m_terminal;
+}
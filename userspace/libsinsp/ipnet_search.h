@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <libsinsp/tuples.h>
+
+#include <cstdint>
+#include <vector>
+
+//
+// A data structure that allows testing an IP address A against a set of
+// networks N. The search succeeds if A belongs to any of the networks Ni,
+// e.g. with the same semantics of flt_compare_ipv4net/flt_compare_ipv6net
+// and CO_EQ, but in a time that depends on the address length and not on
+// the number of networks.
+//
+// The networks are stored in two binary tries (one for IPv4 and one for
+// IPv6) indexed by the address bits in network order. Every network marks
+// the node at the depth of its prefix length, so a lookup walks the bits
+// of the address until it finds a marked node (the address matches the
+// shortest of the networks containing it) or a missing child. Networks
+// contained in other networks are dropped, since they can't change the
+// result of a lookup.
+//
+class ipnet_search
+{
+public:
+	ipnet_search() = default;
+	virtual ~ipnet_search() = default;
+
+	void add_network(const ipv4net& net);
+	void add_network(const ipv6net& net);
+
+	// addr is in network byte order, as in the IPv4 fields of the fdinfos
+	bool match(uint32_t addr) const;
+	bool match(const ipv6addr& addr) const;
+
+	inline size_t num_nodes() const
+	{
+		return m_ipv4.size() + m_ipv6.size();
+	}
+
+private:
+	struct node
+	{
+		// 0 means no child, since the root is never a child
+		uint32_t m_child[2] = {0, 0};
+		bool m_terminal = false;
+	};
+
+	static void add(std::vector<node>& trie, const uint8_t* addr, uint32_t prefix_len);
+	static bool match(const std::vector<node>& trie, const uint8_t* addr, uint32_t addr_len);
+
+	std::vector<node> m_ipv4;
+	std::vector<node> m_ipv6;
+};
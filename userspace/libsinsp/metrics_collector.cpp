@@ -460,7 +460,8 @@ void libs_metrics_collector::snapshot()
 	 * libscap metrics 
 	 */
 
-	if((m_metrics_flags & METRICS_V2_KERNEL_COUNTERS) || (m_metrics_flags & METRICS_V2_LIBBPF_STATS))
+	if((m_metrics_flags & METRICS_V2_KERNEL_COUNTERS) || (m_metrics_flags & METRICS_V2_LIBBPF_STATS) ||
+	   (m_metrics_flags & METRICS_V2_KERNEL_COUNTERS_PER_CPU) || (m_metrics_flags & METRICS_V2_LIBSCAP_COUNTERS))
 	{
 		uint32_t nstats = 0;
 		int32_t rc = 0;
@@ -485,6 +486,8 @@ void libs_metrics_collector::snapshot()
 	uint64_t n_fds = 0;
 	uint64_t n_threads = 0;
 	std::shared_ptr<const sinsp_stats_v2> sinsp_stats_v2 = m_inspector->get_sinsp_stats_v2();
+	libsinsp::object_allocator_stats threadinfo_alloc_stats, fdinfo_alloc_stats;
+	libsinsp::intern_pool_stats threadinfo_interning_stats;
 
 	const std::function<metrics_v2()> sinsp_stats_v2_collectors[] = {
 		[SINSP_RESOURCE_UTILIZATION_CPU_PERC] = [this,&cpu_usage_perc]() {
@@ -711,6 +714,70 @@ void libs_metrics_collector::snapshot()
 					  METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
 					  sinsp_stats_v2->m_n_containers);
 		},
+		[SINSP_STATS_V2_GLOBAL_N_THREADINFO_OBJECTS] = [this,&threadinfo_alloc_stats]() {
+			return new_metric("global_n_threadinfo_objects",
+					  METRICS_V2_STATE_COUNTERS,
+					  METRIC_VALUE_TYPE_U64,
+					  METRIC_VALUE_UNIT_COUNT,
+					  METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+					  threadinfo_alloc_stats.n_objects);
+		},
+		[SINSP_STATS_V2_GLOBAL_THREADINFO_RESERVED_MEMORY] = [this,&threadinfo_alloc_stats]() {
+			return new_metric("global_threadinfo_reserved_memory_bytes",
+					  METRICS_V2_STATE_COUNTERS,
+					  METRIC_VALUE_TYPE_U64,
+					  METRIC_VALUE_UNIT_MEMORY_BYTES,
+					  METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+					  threadinfo_alloc_stats.n_reserved_bytes);
+		},
+		[SINSP_STATS_V2_GLOBAL_N_FDINFO_OBJECTS] = [this,&fdinfo_alloc_stats]() {
+			return new_metric("global_n_fdinfo_objects",
+					  METRICS_V2_STATE_COUNTERS,
+					  METRIC_VALUE_TYPE_U64,
+					  METRIC_VALUE_UNIT_COUNT,
+					  METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+					  fdinfo_alloc_stats.n_objects);
+		},
+		[SINSP_STATS_V2_GLOBAL_FDINFO_RESERVED_MEMORY] = [this,&fdinfo_alloc_stats]() {
+			return new_metric("global_fdinfo_reserved_memory_bytes",
+					  METRICS_V2_STATE_COUNTERS,
+					  METRIC_VALUE_TYPE_U64,
+					  METRIC_VALUE_UNIT_MEMORY_BYTES,
+					  METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+					  fdinfo_alloc_stats.n_reserved_bytes);
+		},
+		[SINSP_STATS_V2_THREADS_PURGING_TIME] = [this,&sinsp_stats_v2]() {
+			return new_metric("threads_purging_time_ns",
+					  METRICS_V2_STATE_COUNTERS,
+					  METRIC_VALUE_TYPE_U64,
+					  METRIC_VALUE_UNIT_TIME_NS_COUNT,
+					  METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+					  sinsp_stats_v2->m_threads_purging_time_ns);
+		},
+		[SINSP_STATS_V2_GLOBAL_N_INTERNED_LOOKUPS] = [this,&threadinfo_interning_stats]() {
+			return new_metric("global_n_interned_lookups",
+					  METRICS_V2_STATE_COUNTERS,
+					  METRIC_VALUE_TYPE_U64,
+					  METRIC_VALUE_UNIT_COUNT,
+					  METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+					  threadinfo_interning_stats.n_lookups);
+		},
+		[SINSP_STATS_V2_GLOBAL_N_INTERNED_HITS] = [this,&threadinfo_interning_stats]() {
+			return new_metric("global_n_interned_hits",
+					  METRICS_V2_STATE_COUNTERS,
+					  METRIC_VALUE_TYPE_U64,
+					  METRIC_VALUE_UNIT_COUNT,
+					  METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+					  threadinfo_interning_stats.n_hits);
+		},
+		[SINSP_STATS_V2_GLOBAL_INTERNED_SAVED_MEMORY] = [this,&threadinfo_interning_stats]() {
+			return new_metric("global_interned_saved_memory_bytes",
+					  METRICS_V2_STATE_COUNTERS,
+					  METRIC_VALUE_TYPE_U64,
+					  METRIC_VALUE_UNIT_MEMORY_BYTES,
+					  METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+					  threadinfo_interning_stats.n_saved_bytes);
+		},
 	};
 
 	static_assert(sizeof(sinsp_stats_v2_collectors) / sizeof(sinsp_stats_v2_collectors[0]) == SINSP_MAX_STATS_V2, "sinsp_stats_v2_resource_utilization_names array size does not match expected size");
@@ -762,6 +829,12 @@ void libs_metrics_collector::snapshot()
 				}
 			}
 
+			// the allocators and the interning pools are shared by all the
+			// inspectors, their metrics are the same for every inspector
+			threadinfo_alloc_stats = sinsp_thread_manager::get_threadinfo_allocator_stats();
+			fdinfo_alloc_stats = sinsp_fdtable::get_fdinfo_allocator_stats();
+			threadinfo_interning_stats = sinsp_thread_manager::get_threadinfo_interning_stats();
+
 			// Resource utilization of the agent itself
 			for (int i = SINSP_STATS_V2_N_THREADS; i < SINSP_MAX_STATS_V2; i++)
 			{
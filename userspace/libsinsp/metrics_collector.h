@@ -44,6 +44,7 @@ struct sinsp_stats_v2
 	uint32_t m_n_drops_full_threadtable;
 	uint32_t m_n_missing_container_images;
 	uint32_t m_n_containers;
+	uint64_t m_threads_purging_time_ns;
 };
 
 enum sinsp_stats_v2_resource_utilization
@@ -76,6 +77,14 @@ enum sinsp_stats_v2_resource_utilization
 	SINSP_STATS_V2_N_DROPS_FULL_THREADTABLE, ///< Number of drops due to full threadtable, unit: count.
 	SINSP_STATS_V2_N_MISSING_CONTAINER_IMAGES, ///<  Number of cached containers (cgroups) without container info such as image, hijacked sinsp_container_manager::remove_inactive_containers() -> every flush snapshot update, unit: count.
 	SINSP_STATS_V2_N_CONTAINERS, ///<  Number of containers (cgroups) currently cached by sinsp_container_manager, hijacked sinsp_container_manager::remove_inactive_containers() -> every flush snapshot update, unit: count.
+	SINSP_STATS_V2_GLOBAL_N_THREADINFO_OBJECTS, ///< Number of sinsp_threadinfo objects currently allocated by all the inspectors of the process, including the ones not in a thread table, unit: count.
+	SINSP_STATS_V2_GLOBAL_THREADINFO_RESERVED_MEMORY, ///< Memory held by the process-global sinsp_threadinfo allocators, including the pooled free blocks, see sinsp_thread_manager::set_threadinfo_allocator(), unit: bytes.
+	SINSP_STATS_V2_GLOBAL_N_FDINFO_OBJECTS, ///< Number of sinsp_fdinfo objects currently allocated by all the inspectors of the process, including the ones not in an fd table, unit: count.
+	SINSP_STATS_V2_GLOBAL_FDINFO_RESERVED_MEMORY, ///< Memory held by the process-global sinsp_fdinfo allocators, including the pooled free blocks, see sinsp_fdtable::set_fdinfo_allocator(), unit: bytes.
+	SINSP_STATS_V2_THREADS_PURGING_TIME, ///< Time spent removing inactive threads from the sinsp state thread table, see sinsp::set_auto_threads_purging_batch_size(), unit: ns total.
+	SINSP_STATS_V2_GLOBAL_N_INTERNED_LOOKUPS, ///< Number of arguments, environments and cgroups lists of the threads looked up in the process-global interning pools, see sinsp_thread_manager::get_threadinfo_interning_stats(), unit: count.
+	SINSP_STATS_V2_GLOBAL_N_INTERNED_HITS, ///< Number of lookups in the process-global interning pools that found an equal list to share, unit: count.
+	SINSP_STATS_V2_GLOBAL_INTERNED_SAVED_MEMORY, ///< Memory currently saved by sharing the interned lists among the threads of all the inspectors of the process, unit: bytes.
 	SINSP_MAX_STATS_V2
 };
 
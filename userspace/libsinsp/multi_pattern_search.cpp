@@ -0,0 +1,692 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/multi_pattern_search.h>
+#include <libsinsp/string_kernels.h>
+#include <libsinsp/utils.h>
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <map>
+
+static constexpr uint32_t s_unknown_state = UINT32_MAX;
+
+// the lazily built glob DFA is discarded and rebuilt when it grows past
+// this many states, which bounds its memory with pathological patterns
+static constexpr size_t s_max_glob_states = 4096;
+
+// sinsp_utils::glob_match follows PathMatchSpec() on Windows, whose syntax
+// differs from the fnmatch() one of the DFA, so every pattern goes to it
+#ifdef _WIN32
+static constexpr bool s_glob_dfa_enabled = false;
+#else
+static constexpr bool s_glob_dfa_enabled = true;
+#endif
+
+// With case folding, the libc implementations of fnmatch() disagree on the
+// ranges that mix letters with other bytes or span both cases, e.g. glibc
+// folds the bounds of "[A-z]" and doesn't match '_', musl does. Only the
+// ranges with all letters of the same case, or without letters, are
+// matched by the DFA.
+static bool is_single_case_range(uint8_t lo, uint8_t hi)
+{
+	auto is_letter = [](uint32_t v) { return (v >= 'A' && v <= 'Z') || (v >= 'a' && v <= 'z'); };
+	if(lo > hi)
+	{
+		return !is_letter(lo) && !is_letter(hi);
+	}
+	if((lo >= 'A' && hi <= 'Z') || (lo >= 'a' && hi <= 'z'))
+	{
+		return true;
+	}
+	for(uint32_t v = lo; v <= hi; v++)
+	{
+		if(is_letter(v))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+multi_pattern_search::multi_pattern_search(mode m, bool case_insensitive):
+	m_mode(m),
+	m_case_insensitive(case_insensitive)
+{
+}
+
+void multi_pattern_search::add_pattern(std::string_view pattern)
+{
+	m_patterns.emplace_back(pattern);
+	m_dirty = true;
+}
+
+bool multi_pattern_search::match(const char* s, size_t len)
+{
+	if(m_dirty)
+	{
+		build();
+	}
+
+	if(m_mode == mode::GLOB)
+	{
+		return match_globs(s, len);
+	}
+	return match_literals(s, len);
+}
+
+void multi_pattern_search::build()
+{
+	m_dirty = false;
+	m_delta.clear();
+	m_accept.clear();
+	m_match_all = false;
+	m_dead = UINT32_MAX;
+
+	if(m_mode != mode::GLOB)
+	{
+		build_literals();
+		return;
+	}
+
+	m_glob_tokens.clear();
+	m_glob_final.clear();
+	m_glob_sets.clear();
+	m_glob_starts.clear();
+	m_glob_states.clear();
+	m_glob_outcomes.clear();
+	m_glob_state_ids.clear();
+	m_glob_fallback.clear();
+	m_glob_shape = glob_shape::AUTOMATON;
+
+	std::vector<std::string> alphabet;
+	for(const auto& p : m_patterns)
+	{
+		std::vector<glob_token> tokens;
+		if(!s_glob_dfa_enabled || !parse_glob(p, tokens))
+		{
+			m_glob_fallback.push_back(p);
+			continue;
+		}
+
+		if(m_patterns.size() == 1 && set_glob_shape(tokens))
+		{
+			return;
+		}
+
+		std::string literals;
+		m_glob_starts.push_back(m_glob_tokens.size());
+		for(const auto& t : tokens)
+		{
+			m_glob_tokens.push_back(t);
+			m_glob_final.push_back(false);
+			if(t.m_type == glob_token::LITERAL)
+			{
+				literals.push_back(t.m_byte);
+			}
+		}
+		m_glob_tokens.push_back({glob_token::LITERAL, 0, 0});
+		m_glob_final.push_back(true);
+		alphabet.push_back(literals);
+	}
+	build_classes(alphabet, m_glob_sets);
+
+	std::vector<uint32_t> start = m_glob_starts;
+	glob_state(start);
+}
+
+//
+// A single pattern made only of literals and stars at its ends is matched
+// without the automaton, e.g. "/etc/*" is a prefix match.
+//
+bool multi_pattern_search::set_glob_shape(const std::vector<glob_token>& tokens)
+{
+	size_t begin = 0;
+	size_t end = tokens.size();
+	bool star_begin = begin < end && tokens[begin].m_type == glob_token::STAR;
+	begin += star_begin;
+	bool star_end = begin < end && tokens[end - 1].m_type == glob_token::STAR;
+	end -= star_end;
+
+	std::string literal;
+	for(size_t i = begin; i < end; i++)
+	{
+		if(tokens[i].m_type != glob_token::LITERAL)
+		{
+			return false;
+		}
+		literal.push_back(tokens[i].m_byte);
+	}
+
+	m_glob_literal = literal;
+	if(star_begin && star_end)
+	{
+		m_glob_shape = glob_shape::CONTAINS;
+	}
+	else if(star_begin)
+	{
+		m_glob_shape = glob_shape::SUFFIX;
+	}
+	else if(star_end)
+	{
+		m_glob_shape = glob_shape::PREFIX;
+	}
+	else
+	{
+		m_glob_shape = glob_shape::EXACT;
+	}
+	return true;
+}
+
+//
+// Two bytes are in the same class if they match the same glob tokens, i.e.
+// if they are not literals of the patterns and belong to the same sets.
+// The class of a byte is the one of its folded value.
+//
+void multi_pattern_search::build_classes(const std::vector<std::string>& alphabet, const std::vector<std::bitset<256>>& sets)
+{
+	bool used[256] = {};
+	for(const auto& s : alphabet)
+	{
+		for(auto c : s)
+		{
+			used[(uint8_t)c] = true;
+		}
+	}
+
+	uint8_t folded_class[256] = {};
+	std::map<std::vector<bool>, uint8_t> signatures;
+	m_num_classes = 0;
+	for(uint32_t c = 0; c < 256; c++)
+	{
+		if(used[c])
+		{
+			folded_class[c] = m_num_classes++;
+			continue;
+		}
+
+		std::vector<bool> signature;
+		for(const auto& set : sets)
+		{
+			signature.push_back(set[c]);
+		}
+		auto it = signatures.find(signature);
+		if(it == signatures.end())
+		{
+			it = signatures.emplace(signature, m_num_classes++).first;
+		}
+		folded_class[c] = it->second;
+	}
+	for(uint32_t c = 0; c < 256; c++)
+	{
+		m_class[c] = folded_class[fold(c)];
+	}
+}
+
+void multi_pattern_search::build_literals()
+{
+	std::vector<std::string> patterns;
+	for(const auto& p : m_patterns)
+	{
+		std::string folded;
+		for(auto c : p)
+		{
+			folded.push_back(fold(c));
+		}
+		if(m_mode == mode::ENDSWITH)
+		{
+			std::reverse(folded.begin(), folded.end());
+		}
+		m_match_all = m_match_all || folded.empty();
+		patterns.push_back(std::move(folded));
+	}
+	build_classes(patterns, {});
+
+	// trie of the patterns
+	const uint32_t k = m_num_classes;
+	m_delta.assign(k, s_unknown_state);
+	m_accept.assign(1, false);
+	for(const auto& p : patterns)
+	{
+		uint32_t state = 0;
+		for(auto c : p)
+		{
+			uint32_t next = m_delta[state * k + m_class[(uint8_t)c]];
+			if(next == s_unknown_state)
+			{
+				next = m_accept.size();
+				m_delta[state * k + m_class[(uint8_t)c]] = next;
+				m_accept.push_back(false);
+				m_delta.resize(m_delta.size() + k, s_unknown_state);
+			}
+			state = next;
+		}
+		m_accept[state] = true;
+	}
+
+	if(m_mode != mode::CONTAINS)
+	{
+		// anchored: any missing transition ends the search
+		m_dead = m_accept.size();
+		m_accept.push_back(false);
+		m_delta.resize(m_delta.size() + k, s_unknown_state);
+		std::replace(m_delta.begin(), m_delta.end(), s_unknown_state, m_dead);
+		return;
+	}
+
+	// Aho-Corasick: missing transitions follow the failure links, which
+	// point to the longest proper suffix that is also a pattern prefix
+	std::vector<uint32_t> fail(m_accept.size(), 0);
+	std::deque<uint32_t> queue;
+	for(uint32_t c = 0; c < k; c++)
+	{
+		auto& next = m_delta[c];
+		if(next == s_unknown_state)
+		{
+			next = 0;
+		}
+		else
+		{
+			fail[next] = 0;
+			queue.push_back(next);
+		}
+	}
+	while(!queue.empty())
+	{
+		auto state = queue.front();
+		queue.pop_front();
+		m_accept[state] = m_accept[state] || m_accept[fail[state]];
+		for(uint32_t c = 0; c < k; c++)
+		{
+			auto& next = m_delta[state * k + c];
+			auto fallback = m_delta[fail[state] * k + c];
+			if(next == s_unknown_state)
+			{
+				next = fallback;
+			}
+			else
+			{
+				fail[next] = fallback;
+				queue.push_back(next);
+			}
+		}
+	}
+}
+
+bool multi_pattern_search::match_literals(const char* s, size_t len) const
+{
+	if(m_match_all)
+	{
+		return true;
+	}
+	if(m_patterns.empty())
+	{
+		return false;
+	}
+
+	const uint32_t k = m_num_classes;
+	const uint32_t* delta = m_delta.data();
+	const uint8_t* accept = m_accept.data();
+	uint32_t state = 0;
+	if(m_mode == mode::ENDSWITH)
+	{
+		for(size_t i = len; i > 0; i--)
+		{
+			state = delta[state * k + m_class[(uint8_t)s[i - 1]]];
+			if(accept[state])
+			{
+				return true;
+			}
+			if(state == m_dead)
+			{
+				return false;
+			}
+		}
+		return false;
+	}
+
+	for(size_t i = 0; i < len; i++)
+	{
+		state = delta[state * k + m_class[(uint8_t)s[i]]];
+		if(accept[state])
+		{
+			return true;
+		}
+		if(state == m_dead)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
+//
+// Supports literals, '?', '*', bracket expressions and backslash escapes,
+// following fnmatch() without flags in the C locale. Returns false for the
+// patterns that must be matched with fnmatch() instead: the ones with a
+// trailing backslash, unterminated brackets, collating symbols, equivalence
+// classes, or character classes and ranges mixing cases in case-insensitive
+// mode.
+//
+bool multi_pattern_search::parse_glob(const std::string& pattern, std::vector<glob_token>& tokens)
+{
+	for(size_t i = 0; i < pattern.size(); i++)
+	{
+		char c = pattern[i];
+		switch(c)
+		{
+		case '[':
+		{
+			std::bitset<256> set;
+			if(!parse_glob_set(pattern, i, set))
+			{
+				return false;
+			}
+			tokens.push_back({glob_token::SET, 0, (uint32_t)m_glob_sets.size()});
+			m_glob_sets.push_back(set);
+			break;
+		}
+		case '\\':
+			if(i + 1 == pattern.size())
+			{
+				return false;
+			}
+			tokens.push_back({glob_token::LITERAL, fold(pattern[++i]), 0});
+			break;
+		case '?':
+			tokens.push_back({glob_token::ANY, 0, 0});
+			break;
+		case '*':
+			// consecutive stars are equivalent to a single one
+			if(tokens.empty() || tokens.back().m_type != glob_token::STAR)
+			{
+				tokens.push_back({glob_token::STAR, 0, 0});
+			}
+			break;
+		default:
+			tokens.push_back({glob_token::LITERAL, fold(c), 0});
+			break;
+		}
+	}
+	return true;
+}
+
+//
+// Parses the bracket expression starting at pattern[i] in the set of the
+// (folded) bytes it matches, and moves i to its closing bracket. A closing
+// bracket right after the opening one or the negation is a literal, and
+// so is a '-' that can't be a range.
+//
+bool multi_pattern_search::parse_glob_set(const std::string& pattern, size_t& i, std::bitset<256>& set) const
+{
+	static const std::vector<std::pair<std::string, int (*)(int)>> classes = {
+		{"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank}, {"cntrl", iscntrl},
+		{"digit", isdigit}, {"graph", isgraph}, {"lower", islower}, {"print", isprint},
+		{"punct", ispunct}, {"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit},
+	};
+
+	size_t j = i + 1;
+	bool negate = j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^');
+	j += negate;
+	for(bool first = true; ; first = false)
+	{
+		if(j >= pattern.size())
+		{
+			return false;
+		}
+
+		uint8_t c = pattern[j];
+		if(c == ']' && !first)
+		{
+			break;
+		}
+
+		if(c == '[' && j + 1 < pattern.size()
+		   && (pattern[j + 1] == ':' || pattern[j + 1] == '=' || pattern[j + 1] == '.'))
+		{
+			// fnmatch() tests the character classes on the unfolded bytes
+			auto end = pattern.find(":]", j + 2);
+			if(pattern[j + 1] != ':' || m_case_insensitive || end == std::string::npos)
+			{
+				return false;
+			}
+			auto name = pattern.substr(j + 2, end - j - 2);
+			auto cls = std::find_if(classes.begin(), classes.end(),
+						[&](const auto& p) { return p.first == name; });
+			if(cls == classes.end())
+			{
+				return false;
+			}
+			for(int v = 0; v < 256; v++)
+			{
+				if(cls->second(v))
+				{
+					set.set(v);
+				}
+			}
+			j = end + 2;
+			continue;
+		}
+
+		if(c == '\\')
+		{
+			if(++j >= pattern.size())
+			{
+				return false;
+			}
+			c = pattern[j];
+		}
+		j++;
+
+		if(j + 1 < pattern.size() && pattern[j] == '-' && pattern[j + 1] != ']')
+		{
+			size_t k = j + 1;
+			uint8_t hi = pattern[k++];
+			if(hi == '\\')
+			{
+				if(k >= pattern.size())
+				{
+					return false;
+				}
+				hi = pattern[k++];
+			}
+			else if(hi == '[' && k < pattern.size()
+				&& (pattern[k] == '.' || pattern[k] == ':' || pattern[k] == '='))
+			{
+				return false;
+			}
+			if(m_case_insensitive && !is_single_case_range(c, hi))
+			{
+				return false;
+			}
+			for(uint32_t v = fold(c); v <= fold(hi); v++)
+			{
+				set.set(v);
+			}
+			j = k;
+			continue;
+		}
+
+		set.set(fold(c));
+	}
+
+	if(negate)
+	{
+		set.flip();
+	}
+	i = j;
+	return true;
+}
+
+// a star can also match the empty string, so it implies the next position
+void multi_pattern_search::glob_closure(std::vector<uint32_t>& positions) const
+{
+	size_t n = positions.size();
+	for(size_t i = 0; i < n; i++)
+	{
+		auto p = positions[i];
+		while(!m_glob_final[p] && m_glob_tokens[p].m_type == glob_token::STAR)
+		{
+			positions.push_back(++p);
+		}
+	}
+	std::sort(positions.begin(), positions.end());
+	positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+}
+
+uint32_t multi_pattern_search::glob_state(std::vector<uint32_t>& positions)
+{
+	glob_closure(positions);
+	std::string key((const char*)positions.data(), positions.size() * sizeof(uint32_t));
+	auto it = m_glob_state_ids.find(key);
+	if(it != m_glob_state_ids.end())
+	{
+		return it->second;
+	}
+
+	// a star right before the end of a pattern matches any rest of the string
+	uint32_t id = m_glob_states.size();
+	bool accept = false;
+	auto outcome = positions.empty() ? glob_outcome::NO_MATCH : glob_outcome::UNDECIDED;
+	for(auto p : positions)
+	{
+		accept = accept || m_glob_final[p];
+		if(!m_glob_final[p] && m_glob_tokens[p].m_type == glob_token::STAR && m_glob_final[p + 1])
+		{
+			outcome = glob_outcome::MATCH;
+		}
+	}
+	m_glob_outcomes.push_back(outcome);
+	m_glob_state_ids.emplace(std::move(key), id);
+	m_glob_states.push_back(positions);
+	m_accept.push_back(accept);
+	m_delta.resize(m_delta.size() + m_num_classes, s_unknown_state);
+	return id;
+}
+
+uint32_t multi_pattern_search::glob_step(uint32_t state, uint8_t c)
+{
+	auto cls = m_class[c];
+	auto next = m_delta[state * m_num_classes + cls];
+	if(next != s_unknown_state)
+	{
+		return next;
+	}
+
+	std::vector<uint32_t> positions;
+	for(auto p : m_glob_states[state])
+	{
+		if(m_glob_final[p])
+		{
+			continue;
+		}
+		const auto& t = m_glob_tokens[p];
+		switch(t.m_type)
+		{
+		case glob_token::STAR:
+			positions.push_back(p);
+			break;
+		case glob_token::ANY:
+			positions.push_back(p + 1);
+			break;
+		case glob_token::LITERAL:
+			if(t.m_byte == fold(c))
+			{
+				positions.push_back(p + 1);
+			}
+			break;
+		case glob_token::SET:
+			if(m_glob_sets[t.m_set][fold(c)])
+			{
+				positions.push_back(p + 1);
+			}
+			break;
+		}
+	}
+
+	if(m_glob_states.size() >= s_max_glob_states)
+	{
+		m_glob_states.clear();
+		m_glob_outcomes.clear();
+		m_glob_state_ids.clear();
+		m_accept.clear();
+		m_delta.clear();
+		std::vector<uint32_t> start = m_glob_starts;
+		glob_state(start);
+		return glob_state(positions);
+	}
+
+	next = glob_state(positions);
+	m_delta[state * m_num_classes + cls] = next;
+	return next;
+}
+
+bool multi_pattern_search::match_globs(const char* s, size_t len)
+{
+	const char* lit = m_glob_literal.data();
+	size_t lit_len = m_glob_literal.size();
+	switch(m_glob_shape)
+	{
+	case glob_shape::EXACT:
+		return m_case_insensitive
+			? libsinsp::string_kernels::iequals(s, len, lit, lit_len)
+			: libsinsp::string_kernels::equals(s, len, lit, lit_len);
+	case glob_shape::PREFIX:
+		return m_case_insensitive
+			? libsinsp::string_kernels::istarts_with(s, len, lit, lit_len)
+			: libsinsp::string_kernels::starts_with(s, len, lit, lit_len);
+	case glob_shape::SUFFIX:
+		return m_case_insensitive
+			? libsinsp::string_kernels::iends_with(s, len, lit, lit_len)
+			: libsinsp::string_kernels::ends_with(s, len, lit, lit_len);
+	case glob_shape::CONTAINS:
+		return m_case_insensitive
+			? libsinsp::string_kernels::icontains(s, len, lit, lit_len)
+			: libsinsp::string_kernels::contains(s, len, lit, lit_len);
+	case glob_shape::AUTOMATON:
+		break;
+	}
+
+	if(!m_glob_starts.empty())
+	{
+		uint32_t state = 0;
+		for(size_t i = 0; i < len && m_glob_outcomes[state] == glob_outcome::UNDECIDED; i++)
+		{
+			auto next = m_delta[state * m_num_classes + m_class[(uint8_t)s[i]]];
+			state = next != s_unknown_state ? next : glob_step(state, (uint8_t)s[i]);
+		}
+		if(m_glob_outcomes[state] == glob_outcome::MATCH)
+		{
+			return true;
+		}
+		if(m_accept[state])
+		{
+			return true;
+		}
+	}
+
+	for(const auto& p : m_glob_fallback)
+	{
+		if(sinsp_utils::glob_match(p.c_str(), s, m_case_insensitive))
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//
+// A data structure that allows testing a string S against a set of
+// patterns P with a single pass over S. The search succeeds if any of the
+// patterns Pi matches S, with the same semantics of the string filter
+// operators:
+// - CONTAINS: Pi is a substring of S (Aho-Corasick automaton)
+// - STARTSWITH: Pi is a prefix of S (trie walked from the start of S)
+// - ENDSWITH: Pi is a suffix of S (trie of the reversed patterns walked
+//   from the end of S)
+// - GLOB: S matches the fnmatch() pattern Pi (DFA built lazily from the
+//   positions of all the patterns)
+//
+// Case-insensitive matching folds ASCII letters only, like strcasestr()
+// and fnmatch() with FNM_CASEFOLD in the C locale. The DFA follows fnmatch()
+// in the C locale, whatever the current locale is. The few glob patterns
+// that it doesn't support (e.g. collating symbols, or case-insensitive
+// ranges like "[A-z]") are matched one at a time with
+// sinsp_utils::glob_match, and so are all the patterns on Windows, to keep
+// the PathMatchSpec() semantics. A single glob pattern with stars only at
+// its ends (e.g. "/etc/*") is matched as a literal, prefix, suffix or
+// substring, without the DFA.
+//
+// The automatons are built at the first match after adding patterns.
+//
+class multi_pattern_search
+{
+public:
+	enum class mode
+	{
+		CONTAINS,
+		STARTSWITH,
+		ENDSWITH,
+		GLOB,
+	};
+
+	multi_pattern_search(mode m, bool case_insensitive = false);
+	virtual ~multi_pattern_search() = default;
+
+	void add_pattern(std::string_view pattern);
+
+	// s must be NUL-terminated at s[len]
+	bool match(const char* s, size_t len);
+
+	inline bool match(const std::string& s)
+	{
+		return match(s.c_str(), s.size());
+	}
+
+	inline size_t num_patterns() const
+	{
+		return m_patterns.size();
+	}
+
+	// number of states of the automaton, for tests and benchmarks
+	inline size_t num_states() const
+	{
+		return m_accept.size();
+	}
+
+private:
+	// a glob pattern position: a literal byte, any byte, any string, or
+	// a byte of a bracket expression
+	struct glob_token
+	{
+		enum : uint8_t { LITERAL, ANY, STAR, SET } m_type;
+		uint8_t m_byte;
+		uint32_t m_set;
+	};
+
+	// whether the rest of the string can change the result of a glob state
+	enum class glob_outcome : uint8_t
+	{
+		UNDECIDED,
+		NO_MATCH,
+		MATCH,
+	};
+
+	enum class glob_shape
+	{
+		AUTOMATON,
+		EXACT,
+		PREFIX,
+		SUFFIX,
+		CONTAINS,
+	};
+
+	inline uint8_t fold(uint8_t c) const
+	{
+		return (m_case_insensitive && c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+	}
+
+	void build();
+	void build_classes(const std::vector<std::string>& alphabet, const std::vector<std::bitset<256>>& sets);
+	void build_literals();
+	bool match_literals(const char* s, size_t len) const;
+
+	bool parse_glob(const std::string& pattern, std::vector<glob_token>& tokens);
+	bool parse_glob_set(const std::string& pattern, size_t& i, std::bitset<256>& set) const;
+	bool set_glob_shape(const std::vector<glob_token>& tokens);
+	void glob_closure(std::vector<uint32_t>& positions) const;
+	uint32_t glob_state(std::vector<uint32_t>& positions);
+	uint32_t glob_step(uint32_t state, uint8_t c);
+	bool match_globs(const char* s, size_t len);
+
+	mode m_mode;
+	bool m_case_insensitive;
+	bool m_dirty = false;
+	std::vector<std::string> m_patterns;
+
+	// byte to equivalence class, see build_classes()
+	uint8_t m_class[256] = {};
+	uint32_t m_num_classes = 1;
+
+	// m_num_classes transitions for each state, and whether matching
+	// stops successfully at each state
+	std::vector<uint32_t> m_delta;
+	std::vector<uint8_t> m_accept;
+
+	// literal automatons only: the patterns always match (e.g. an
+	// empty pattern) or the dead state of the anchored ones
+	bool m_match_all = false;
+	uint32_t m_dead = UINT32_MAX;
+
+	// glob automaton only: the tokens of all the patterns in a single
+	// sequence, with one final position ending each pattern, and the
+	// positions corresponding to each DFA state
+	std::vector<glob_token> m_glob_tokens;
+	std::vector<bool> m_glob_final;
+	std::vector<std::bitset<256>> m_glob_sets;
+	std::vector<uint32_t> m_glob_starts;
+	std::vector<std::vector<uint32_t>> m_glob_states;
+	std::vector<glob_outcome> m_glob_outcomes;
+	std::unordered_map<std::string, uint32_t> m_glob_state_ids;
+	std::vector<std::string> m_glob_fallback;
+
+	// glob single patterns only: how the pattern is matched, and its
+	// literal part for the shapes without the automaton
+	glob_shape m_glob_shape = glob_shape::AUTOMATON;
+	std::string m_glob_literal;
+};
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/object_pool.h>
+
+#include <new>
+
+using namespace libsinsp;
+
+pool_allocator::pool_allocator(size_t slab_size):
+	m_slab_size(slab_size < s_max_block_size ? s_max_block_size : slab_size),
+	m_slab_pos(nullptr),
+	m_slab_left(0),
+	m_free_lists{},
+	m_n_objects(0),
+	m_n_large_bytes(0)
+{
+}
+
+// the slabs are released by their unique_ptrs
+pool_allocator::~pool_allocator() = default;
+
+void* pool_allocator::allocate(size_t size)
+{
+	size_t block_size = (size + s_block_granularity - 1) & ~(s_block_granularity - 1);
+	if(block_size == 0 || block_size > s_max_block_size)
+	{
+		void* p = ::operator new(size);
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_n_objects++;
+		m_n_large_bytes += size;
+		return p;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mtx);
+	auto& free_list = m_free_lists[block_size / s_block_granularity - 1];
+	if(free_list != nullptr)
+	{
+		auto block = free_list;
+		free_list = block->m_next;
+		m_n_objects++;
+		return block;
+	}
+
+	if(m_slab_left < block_size)
+	{
+		// the tail of the previous slab is lost, at most s_max_block_size
+		// bytes out of every slab
+		m_slabs.emplace_back(new char[m_slab_size]);
+		m_slab_pos = m_slabs.back().get();
+		m_slab_left = m_slab_size;
+	}
+	void* p = m_slab_pos;
+	m_slab_pos += block_size;
+	m_slab_left -= block_size;
+	m_n_objects++;
+	return p;
+}
+
+void pool_allocator::deallocate(void* p, size_t size) noexcept
+{
+	size_t block_size = (size + s_block_granularity - 1) & ~(s_block_granularity - 1);
+	if(block_size == 0 || block_size > s_max_block_size)
+	{
+		::operator delete(p);
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_n_objects--;
+		m_n_large_bytes -= size;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mtx);
+	auto& free_list = m_free_lists[block_size / s_block_granularity - 1];
+	auto block = static_cast<free_block*>(p);
+	block->m_next = free_list;
+	free_list = block;
+	m_n_objects--;
+}
+
+object_allocator_stats pool_allocator::get_stats() const
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	object_allocator_stats stats;
+	stats.n_objects = m_n_objects;
+	stats.n_reserved_bytes = m_slabs.size() * m_slab_size + m_n_large_bytes;
+	return stats;
+}
+
+void* object_allocation_hook::allocate(size_t size)
+{
+	auto allocator = m_allocator.load(std::memory_order_acquire);
+	char* block;
+	if(allocator != nullptr)
+	{
+		block = static_cast<char*>(allocator->allocate(size + s_header_size));
+	}
+	else
+	{
+		block = static_cast<char*>(::operator new(size + s_header_size));
+		m_n_default_bytes.fetch_add(size + s_header_size, std::memory_order_relaxed);
+	}
+	*reinterpret_cast<object_allocator**>(block) = allocator;
+	m_n_objects.fetch_add(1, std::memory_order_relaxed);
+	return block + s_header_size;
+}
+
+void object_allocation_hook::deallocate(void* p, size_t size) noexcept
+{
+	if(p == nullptr)
+	{
+		return;
+	}
+
+	char* block = static_cast<char*>(p) - s_header_size;
+	auto allocator = *reinterpret_cast<object_allocator**>(block);
+	if(allocator != nullptr)
+	{
+		allocator->deallocate(block, size + s_header_size);
+	}
+	else
+	{
+		::operator delete(block);
+		m_n_default_bytes.fetch_sub(size + s_header_size, std::memory_order_relaxed);
+	}
+	m_n_objects.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void object_allocation_hook::set_allocator(std::shared_ptr<object_allocator> allocator)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	m_allocator.store(allocator.get(), std::memory_order_release);
+	if(allocator != nullptr)
+	{
+		m_allocators.push_back(std::move(allocator));
+	}
+}
+
+object_allocator_stats object_allocation_hook::get_stats() const
+{
+	object_allocator_stats stats;
+	stats.n_objects = m_n_objects.load(std::memory_order_relaxed);
+	stats.n_reserved_bytes = m_n_default_bytes.load(std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(m_mtx);
+	for(const auto& allocator : m_allocators)
+	{
+		stats.n_reserved_bytes += allocator->get_stats().n_reserved_bytes;
+	}
+	return stats;
+}
@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <libsinsp/sinsp_public.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace libsinsp {
+
+struct object_allocator_stats
+{
+	/** Number of objects currently allocated */
+	uint64_t n_objects = 0;
+
+	/** Memory currently held by the allocator, including the free blocks */
+	uint64_t n_reserved_bytes = 0;
+};
+
+/**
+ * @brief Allocates the memory of the sinsp state objects, see
+ * sinsp_thread_manager::set_threadinfo_allocator() and
+ * sinsp_fdtable::set_fdinfo_allocator(). Implementations must be thread
+ * safe, since objects can be freed from a different thread (e.g. the
+ * event snapshots of sinsp_pipeline).
+ */
+class SINSP_PUBLIC object_allocator
+{
+public:
+	virtual ~object_allocator() = default;
+
+	virtual void* allocate(size_t size) = 0;
+	virtual void deallocate(void* p, size_t size) noexcept = 0;
+	virtual object_allocator_stats get_stats() const = 0;
+};
+
+/**
+ * @brief Allocator for many objects of a few sizes, with a high churn.
+ * Freed blocks are kept in a free list per size and reused by the next
+ * allocations of the same size, new blocks are carved out of big slabs
+ * instead of being requested one by one to the global allocator. The
+ * memory is never given back before the allocator is destroyed, so the
+ * reserved memory is the peak of the allocated one and doesn't grow with
+ * fragmentation.
+ */
+class SINSP_PUBLIC pool_allocator: public object_allocator
+{
+public:
+	explicit pool_allocator(size_t slab_size = 256 * 1024);
+	~pool_allocator() override;
+
+	pool_allocator(const pool_allocator&) = delete;
+	pool_allocator& operator=(const pool_allocator&) = delete;
+
+	void* allocate(size_t size) override;
+	void deallocate(void* p, size_t size) noexcept override;
+	object_allocator_stats get_stats() const override;
+
+private:
+	// blocks are multiple of this size, bigger blocks go to operator new
+	static constexpr size_t s_block_granularity = 16;
+	static constexpr size_t s_max_block_size = 4096;
+
+	struct free_block
+	{
+		free_block* m_next;
+	};
+
+	mutable std::mutex m_mtx;
+	size_t m_slab_size;
+	std::vector<std::unique_ptr<char[]>> m_slabs;
+	char* m_slab_pos;
+	size_t m_slab_left;
+	free_block* m_free_lists[s_max_block_size / s_block_granularity];
+	uint64_t m_n_objects;
+	uint64_t m_n_large_bytes;
+};
+
+/**
+ * @brief Routes the allocations of a class to the installed
+ * object_allocator, or to the global operator new if there is none. Every
+ * block remembers its allocator, so the allocator can be changed while
+ * objects are alive. Installed allocators are kept alive until the program
+ * exits.
+ */
+class SINSP_PUBLIC object_allocation_hook
+{
+public:
+	object_allocation_hook() = default;
+
+	void* allocate(size_t size);
+	void deallocate(void* p, size_t size) noexcept;
+
+	void set_allocator(std::shared_ptr<object_allocator> allocator);
+	object_allocator_stats get_stats() const;
+
+private:
+	// keeps the objects aligned like the global operator new does
+	static constexpr size_t s_header_size = alignof(std::max_align_t);
+
+	std::atomic<object_allocator*> m_allocator{nullptr};
+	std::atomic<uint64_t> m_n_objects{0};
+	std::atomic<uint64_t> m_n_default_bytes{0};
+
+	mutable std::mutex m_mtx;
+	std::vector<std::shared_ptr<object_allocator>> m_allocators;
+};
+
+}; // libsinsp
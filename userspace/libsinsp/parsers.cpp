@@ -591,7 +591,7 @@ bool sinsp_parser::reset(sinsp_evt *evt)
 	{
 		if(etype == PPME_PROCINFO_E)
 		{
-			evt->set_tinfo(m_inspector->get_thread_ref(evt->get_scap_evt()->tid, false, false).get());
+			evt->set_tinfo(m_inspector->get_thread_ptr(evt->get_scap_evt()->tid, false, false));
 		}
 		else
 		{
@@ -650,7 +650,7 @@ bool sinsp_parser::reset(sinsp_evt *evt)
 	}
 	else
 	{
-		evt->set_tinfo(m_inspector->get_thread_ref(evt->get_scap_evt()->tid, query_os, false).get());
+		evt->set_tinfo(m_inspector->get_thread_ptr(evt->get_scap_evt()->tid, query_os, false));
 	}
 
 	if(etype == PPME_SCHEDSWITCH_6_E)
@@ -680,9 +680,10 @@ bool sinsp_parser::reset(sinsp_evt *evt)
 		return false;
 	}
 
-	if(query_os)
+	if(query_os && !(evt->get_tinfo()->m_flags & PPM_CL_ACTIVE))
 	{
 		evt->get_tinfo()->m_flags |= PPM_CL_ACTIVE;
+		evt->get_tinfo()->invalidate_snapshot();
 	}
 
 	if(PPME_IS_ENTER(etype))
@@ -986,6 +987,7 @@ void sinsp_parser::parse_clone_exit_caller(sinsp_evt *evt, int64_t child_tid)
 	{
 		/* In case of invalid thread we enrich it with fresh info and we obtain a sort of valid thread info */
 		valid_caller = false;
+		caller_tinfo->invalidate_snapshot();
 
 		/* pid. */
 		caller_tinfo->m_pid = evt->get_param(4)->as<int64_t>();
@@ -1098,7 +1100,7 @@ void sinsp_parser::parse_clone_exit_caller(sinsp_evt *evt, int64_t child_tid)
 	/*=============================== CHILD ALREADY THERE ===========================*/
 
 	/* See if the child is already there, if yes and it is valid we return immediately */
-	sinsp_threadinfo* existing_child_tinfo = m_inspector->get_thread_ref(child_tid, false, true).get();
+	sinsp_threadinfo* existing_child_tinfo = m_inspector->get_thread_ptr(child_tid, false, true);
 	if(existing_child_tinfo != nullptr)
 	{
 		/* If this was an inverted clone, all is fine, we've already taken care
@@ -1183,7 +1185,7 @@ void sinsp_parser::parse_clone_exit_caller(sinsp_evt *evt, int64_t child_tid)
 			child_tinfo->set_cwd(caller_tinfo->get_cwd());
 
 			/* Not a thread, copy env */
-			child_tinfo->m_env = caller_tinfo->m_env;
+			child_tinfo->copy_env(*caller_tinfo);
 		}
 
 		/* Create info about the thread group */
@@ -1629,6 +1631,7 @@ void sinsp_parser::parse_clone_exit_child(sinsp_evt *evt)
 	if(lookup_tinfo->is_invalid())
 	{
 		valid_lookup_thread = false;
+		lookup_tinfo->invalidate_snapshot();
 
 		if(!is_thread_leader)
 		{
@@ -1774,7 +1777,7 @@ void sinsp_parser::parse_clone_exit_child(sinsp_evt *evt)
 			child_tinfo->set_cwd(lookup_tinfo->get_cwd());
 
 			/* Not a thread, copy env */
-			child_tinfo->m_env = lookup_tinfo->m_env;
+			child_tinfo->copy_env(*lookup_tinfo);
 		}
 		else
 		{
@@ -2032,6 +2035,9 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 		return;
 	}
 
+	// most of the fields of the thread are replaced below
+	evt->get_tinfo()->invalidate_snapshot();
+
 	/* In some corner cases an execve is thrown by a secondary thread when
 	 * the main thread is already dead. In these cases the secondary thread
 	 * will become a main thread (it will change its tid) and here we will have
@@ -2043,6 +2049,8 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 	if(evt->get_tinfo()->is_dead())
 	{
 		evt->get_tinfo()->resurrect_thread();
+		/* the count of the thread group changes */
+		m_inspector->m_thread_manager->invalidate_snapshots();
 	}
 
 	// Get the exe
@@ -2523,7 +2531,7 @@ std::string sinsp_parser::parse_dirfd(sinsp_evt *evt, std::string_view name, int
 		return "<UNKNOWN>";
 	}
 
-	evt->set_fd_info(evt->get_tinfo()->get_fd(dirfd));
+	evt->set_fd_info(evt->find_fd(dirfd));
 
 	if(evt->get_fd_info() == NULL)
 	{
@@ -3752,6 +3760,11 @@ void sinsp_parser::parse_thread_exit(sinsp_evt *evt)
 	}
 	evt->get_tinfo()->set_dead();
 
+	/* The count of the thread group and the reaper change: the snapshots of
+	 * the other threads of the group are refreshed as for a removal.
+	 */
+	m_inspector->m_thread_manager->invalidate_snapshots();
+
 	/* [Store the tid to remove]
 	 * We set the current tid to remove. We don't remove it here so we can parse the event
 	 */
@@ -4537,10 +4550,12 @@ void sinsp_parser::parse_dup_exit(sinsp_evt *evt)
 		if(retval == 0)
 		{
 			evt->get_tinfo()->m_flags |= PPM_CL_PIPE_DST;
+			evt->get_tinfo()->invalidate_snapshot();
 		}
 		if(retval == 1)
 		{
 			evt->get_tinfo()->m_flags |= PPM_CL_PIPE_SRC;
+			evt->get_tinfo()->invalidate_snapshot();
 		}
 
 		if(evt->get_fd_info() == NULL)
@@ -4702,6 +4717,7 @@ void sinsp_parser::parse_getrlimit_setrlimit_exit(sinsp_evt *evt)
 					return;
 				}
 				main_thread->m_fdlimit = curval;
+				main_thread->invalidate_snapshot();
 			}
 			else
 			{
@@ -4761,7 +4777,7 @@ void sinsp_parser::parse_prlimit_exit(sinsp_evt *evt)
 					tid = evt->get_tid();
 				}
 
-				sinsp_threadinfo* ptinfo = m_inspector->get_thread_ref(tid, true, true).get();
+				sinsp_threadinfo* ptinfo = m_inspector->get_thread_ptr(tid, true, true);
 				/* If the thread info is invalid we cannot recover the main thread because we don't even
 				 * have the `pid` of the thread.
 				 */
@@ -4779,6 +4795,7 @@ void sinsp_parser::parse_prlimit_exit(sinsp_evt *evt)
 					return;
 				}
 				main_thread->m_fdlimit = newcur;
+				main_thread->invalidate_snapshot();
 			}
 		}
 	}
@@ -4864,6 +4881,8 @@ void sinsp_parser::parse_context_switch(sinsp_evt* evt)
 
 	evt->get_tinfo()->m_pfminor = evt->get_param(2)->as<uint64_t>();
 
+	evt->get_tinfo()->invalidate_snapshot();
+
 	auto main_tinfo = evt->get_tinfo()->get_main_thread();
 	if(main_tinfo)
 	{
@@ -4872,6 +4891,8 @@ void sinsp_parser::parse_context_switch(sinsp_evt* evt)
 		main_tinfo->m_vmrss_kb = evt->get_param(4)->as<uint32_t>();
 
 		main_tinfo->m_vmswap_kb = evt->get_param(5)->as<uint32_t>();
+
+		main_tinfo->invalidate_snapshot();
 	}
 }
 
@@ -4885,6 +4906,7 @@ void sinsp_parser::parse_brk_munmap_mmap_exit(sinsp_evt* evt)
 	evt->get_tinfo()->m_vmsize_kb = evt->get_param(1)->as<uint32_t>();
 	evt->get_tinfo()->m_vmrss_kb = evt->get_param(2)->as<uint32_t>();
 	evt->get_tinfo()->m_vmswap_kb = evt->get_param(3)->as<uint32_t>();
+	evt->get_tinfo()->invalidate_snapshot();
 }
 
 void sinsp_parser::parse_setresuid_exit(sinsp_evt *evt)
@@ -5397,6 +5419,8 @@ void sinsp_parser::parse_prctl_exit_event(sinsp_evt *evt)
 			 */
 			child_subreaper = (evt->get_param(3)->as<int64_t>()) != 0 ? true : false;
 			caller_tinfo->m_tginfo->set_reaper(child_subreaper);
+			/* the reaper is shared by the whole thread group */
+			m_inspector->m_thread_manager->invalidate_snapshots();
 			break;
 
 		case PPM_PR_GET_CHILD_SUBREAPER:
@@ -5404,6 +5428,8 @@ void sinsp_parser::parse_prctl_exit_event(sinsp_evt *evt)
 			/* arg2 != 0 means the calling process is a child_subreaper */
 			child_subreaper = (evt->get_param(3)->as<int64_t>()) != 0 ? true : false;
 			caller_tinfo->m_tginfo->set_reaper(child_subreaper);
+			/* the reaper is shared by the whole thread group */
+			m_inspector->m_thread_manager->invalidate_snapshots();
 			break;
 
 		default:
@@ -5446,6 +5472,7 @@ void sinsp_parser::parse_chroot_exit(sinsp_evt *evt)
 		{
 			evt->get_tinfo()->m_root = resolved_path;
 		}
+		evt->get_tinfo()->invalidate_snapshot();
 		// Root change, let's detect if we are on a container
 
 		auto container_id = evt->get_tinfo()->m_container_id;
@@ -5476,6 +5503,7 @@ void sinsp_parser::parse_setsid_exit(sinsp_evt *evt)
 	{
 		if (evt->get_thread_info()) {
 			evt->get_thread_info()->m_sid = retval;
+			evt->get_thread_info()->invalidate_snapshot();
 		}
 	}
 }
@@ -5578,6 +5606,8 @@ void sinsp_parser::parse_capset_exit(sinsp_evt *evt)
 	tinfo->m_cap_permitted = evt->get_param(2)->as<uint64_t>();
 
 	tinfo->m_cap_effective = evt->get_param(3)->as<uint64_t>();
+
+	tinfo->invalidate_snapshot();
 }
 
 void sinsp_parser::parse_unshare_setns_exit(sinsp_evt *evt)
@@ -5623,6 +5653,7 @@ void sinsp_parser::parse_unshare_setns_exit(sinsp_evt *evt)
 		tinfo->m_cap_inheritable = max_caps;
 		tinfo->m_cap_permitted = max_caps;
 		tinfo->m_cap_effective = max_caps;
+		tinfo->invalidate_snapshot();
 	}
 }
 
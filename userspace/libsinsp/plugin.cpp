@@ -17,6 +17,7 @@ limitations under the License.
 */
 
 
+#include <algorithm>
 #include <inttypes.h>
 #include <string.h>
 #include <vector>
@@ -896,6 +897,121 @@ std::unique_ptr<sinsp_filter_check> sinsp_plugin::new_filtercheck(std::shared_pt
 }
 
 bool sinsp_plugin::extract_fields(sinsp_evt* evt, uint32_t num_fields, ss_plugin_extract_field *fields)
+{
+	// the plugin is allowed to reuse the memory of the previous results
+	m_batch_valid = false;
+	return extract_fields_impl(evt, num_fields, fields);
+}
+
+size_t sinsp_plugin::register_batched_field(const ss_plugin_extract_field& field)
+{
+	// many rules use the very same fields, extract them only once
+	size_t free_id = m_batched_fields.size();
+	for (size_t i = 0; i < m_batched_fields.size(); i++)
+	{
+		auto& b = m_batched_fields[i];
+		if (b.refs == 0)
+		{
+			free_id = std::min(free_id, i);
+			continue;
+		}
+		if (b.field.field_id == field.field_id
+			&& b.field.arg_index == field.arg_index
+			&& b.field.arg_present == field.arg_present
+			&& b.field.ftype == field.ftype
+			&& b.field.flist == field.flist
+			&& b.has_arg_key == (field.arg_key != nullptr)
+			&& (!b.has_arg_key || b.arg_key == field.arg_key))
+		{
+			b.refs++;
+			return i;
+		}
+	}
+
+	if (free_id == m_batched_fields.size())
+	{
+		m_batched_fields.emplace_back();
+	}
+	auto& b = m_batched_fields[free_id];
+	b.field = field;
+	b.has_arg_key = field.arg_key != nullptr;
+	b.arg_key = b.has_arg_key ? field.arg_key : "";
+	b.refs = 1;
+	m_batch_dirty = true;
+	return free_id;
+}
+
+void sinsp_plugin::unregister_batched_field(size_t id)
+{
+	if (id >= m_batched_fields.size() || m_batched_fields[id].refs == 0)
+	{
+		ASSERT(false);
+		return;
+	}
+	if (--m_batched_fields[id].refs == 0)
+	{
+		m_batch_dirty = true;
+	}
+}
+
+void sinsp_plugin::rebuild_batch()
+{
+	m_batch.clear();
+	for (auto& b : m_batched_fields)
+	{
+		if (b.refs == 0)
+		{
+			continue;
+		}
+		// the key is set here since moving the strings can move their data
+		b.field.arg_key = b.has_arg_key ? (char*) b.arg_key.c_str() : nullptr;
+		b.batch_idx = m_batch.size();
+		m_batch.push_back(b.field);
+	}
+	m_batch_dirty = false;
+	m_batch_valid = false;
+}
+
+bool sinsp_plugin::extract_batched_field(sinsp_evt* evt, size_t id, ss_plugin_extract_field** field)
+{
+	ASSERT(id < m_batched_fields.size() && m_batched_fields[id].refs > 0);
+	if (m_batch_dirty)
+	{
+		rebuild_batch();
+	}
+
+	if (!m_batch_valid
+		|| m_batch_evt != evt
+		|| m_batch_evtnum != evt->get_num()
+		|| m_batch_scap_evt != evt->get_scap_evt())
+	{
+		for (auto& f : m_batch)
+		{
+			f.res_len = 0;
+		}
+		m_batch_success = extract_fields_impl(evt, m_batch.size(), m_batch.data());
+		m_batch_valid = true;
+		m_batch_evt = evt;
+		m_batch_evtnum = evt->get_num();
+		m_batch_scap_evt = evt->get_scap_evt();
+	}
+
+	auto& f = m_batch[m_batched_fields[id].batch_idx];
+	if (!m_batch_success)
+	{
+		// one of the fields made the whole batch fail, don't let it hide
+		// the other ones
+		f.res_len = 0;
+		if (!extract_fields_impl(evt, 1, &f))
+		{
+			return false;
+		}
+	}
+	*field = &f;
+	return true;
+}
+
+bool sinsp_plugin::extract_fields_impl(sinsp_evt* evt, uint32_t num_fields, ss_plugin_extract_field *fields)
 {
 	if (!m_inited)
 	{
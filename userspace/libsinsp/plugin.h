@@ -124,7 +124,15 @@ public:
 		m_accessed_table_fields(),
 		m_ephemeral_tables(),
 		m_ephemeral_tables_clear(false),
-		m_accessed_entries_clear(false) { }
+		m_accessed_entries_clear(false),
+		m_batched_fields(),
+		m_batch(),
+		m_batch_dirty(false),
+		m_batch_valid(false),
+		m_batch_success(false),
+		m_batch_evt(nullptr),
+		m_batch_evtnum(0),
+		m_batch_scap_evt(nullptr) { }
 	virtual ~sinsp_plugin();
 	sinsp_plugin(const sinsp_plugin& s) = delete;
 	sinsp_plugin& operator = (const sinsp_plugin& s) = delete;
@@ -202,6 +210,27 @@ public:
 
 	bool extract_fields(sinsp_evt* evt, uint32_t num_fields, ss_plugin_extract_field *fields);
 
+	/**
+	 * @brief Registers a field to be extracted in batch: the first time
+	 * one of the registered fields is requested for an event, all of them
+	 * are extracted with a single extract_fields() call of the plugin and
+	 * the results are cached until the next event. Identical fields share
+	 * the same registration. Returns the id to be passed to
+	 * extract_batched_field() and unregister_batched_field().
+	 *
+	 * Like the plugin extraction itself, this is not thread safe.
+	 */
+	size_t register_batched_field(const ss_plugin_extract_field& field);
+	void unregister_batched_field(size_t id);
+
+	/**
+	 * @brief Extracts a field registered with register_batched_field() and
+	 * sets `field` to its extracted copy, valid until the next extraction
+	 * from this plugin. If extracting the whole batch fails, the field is
+	 * extracted alone.
+	 */
+	bool extract_batched_field(sinsp_evt* evt, size_t id, ss_plugin_extract_field** field);
+
 	/** Event Parsing **/
 	inline const std::unordered_set<std::string>& parse_event_sources() const
 	{
@@ -376,6 +405,26 @@ private:
 	bool m_ephemeral_tables_clear;
 	bool m_accessed_entries_clear;
 
+	/** Batched field extraction state and helpers **/
+	struct batched_field
+	{
+		ss_plugin_extract_field field;
+		std::string arg_key;
+		bool has_arg_key = false;
+		uint32_t refs = 0;
+		size_t batch_idx = 0;
+	};
+	std::vector<batched_field> m_batched_fields;
+	std::vector<ss_plugin_extract_field> m_batch;
+	bool m_batch_dirty;
+	bool m_batch_valid;
+	bool m_batch_success;
+	const sinsp_evt* m_batch_evt;
+	uint64_t m_batch_evtnum;
+	const void* m_batch_scap_evt;
+	bool extract_fields_impl(sinsp_evt* evt, uint32_t num_fields, ss_plugin_extract_field *fields);
+	void rebuild_batch();
+
 	inline void clear_ephemeral_tables()
 	{
 		if (m_ephemeral_tables_clear)
@@ -25,6 +25,8 @@ sinsp_filter_check_plugin::sinsp_filter_check_plugin()
 	static const filter_check_info s_no_plugin_fields_info = {"plugin", "", "", 0, nullptr};
 	m_info = &s_no_plugin_fields_info;
 	m_eplugin = nullptr;
+	m_batched = false;
+	m_batched_field_id = 0;
 }
 
 sinsp_filter_check_plugin::sinsp_filter_check_plugin(std::shared_ptr<sinsp_plugin> plugin)
@@ -36,6 +38,8 @@ sinsp_filter_check_plugin::sinsp_filter_check_plugin(std::shared_ptr<sinsp_plugi
 
 	m_info = plugin->fields_info();
 	m_eplugin = plugin;
+	m_batched = false;
+	m_batched_field_id = 0;
 }
 
 sinsp_filter_check_plugin::sinsp_filter_check_plugin(const sinsp_filter_check_plugin &p)
@@ -43,12 +47,30 @@ sinsp_filter_check_plugin::sinsp_filter_check_plugin(const sinsp_filter_check_pl
 	m_eplugin = p.m_eplugin;
 	m_info = p.m_info;
 	m_compatible_plugin_sources_bitmap = p.m_compatible_plugin_sources_bitmap;
+	// the copy registers its own field once parsed
+	m_batched = false;
+	m_batched_field_id = 0;
+}
+
+sinsp_filter_check_plugin::~sinsp_filter_check_plugin()
+{
+	unregister_batched_field();
+}
+
+void sinsp_filter_check_plugin::unregister_batched_field()
+{
+	if (m_batched)
+	{
+		m_eplugin->unregister_batched_field(m_batched_field_id);
+		m_batched = false;
+	}
 }
 
 int32_t sinsp_filter_check_plugin::parse_field_name(std::string_view val, bool alloc_state, bool needed_for_filtering)
 {
 	int32_t res = sinsp_filter_check::parse_field_name(val, alloc_state, needed_for_filtering);
 
+	unregister_batched_field();
 	m_arg_present = false;
 	m_arg_key = NULL;
 	m_arg_index = 0;
@@ -116,6 +138,23 @@ int32_t sinsp_filter_check_plugin::parse_field_name(std::string_view val, bool a
 		{
 			throw sinsp_exception(string("filter '") + string(val) + string("': ") + m_field->m_name + string(" requires an argument but none provided"));
 		}
+
+		// the checks used by filters and formatters are extracted together
+		// with all the other fields of the same plugin
+		if (alloc_state && m_eplugin)
+		{
+			ss_plugin_extract_field efield;
+			efield.field_id = m_field_id;
+			efield.field = m_field->m_name;
+			efield.arg_key = m_arg_key;
+			efield.arg_index = m_arg_index;
+			efield.arg_present = m_arg_present;
+			efield.ftype = m_field->m_type;
+			efield.flist = m_field->m_flags & EPF_IS_LIST;
+			efield.res_len = 0;
+			m_batched_field_id = m_eplugin->register_batched_field(efield);
+			m_batched = true;
+		}
 	}
 
 	return res;
@@ -128,6 +167,9 @@ std::unique_ptr<sinsp_filter_check> sinsp_filter_check_plugin::allocate_new()
 
 bool sinsp_filter_check_plugin::extract(sinsp_evt *evt, std::vector<extract_value_t>& values, bool sanitize_strings)
 {
+	// the plugins are not reentrant, see is_thread_safe()
+	state_guard guard(this);
+
 	// reject the event if it comes from an unknown event source
 	if (evt->get_source_idx() == sinsp_no_event_source_idx)
 	{
@@ -160,25 +202,33 @@ bool sinsp_filter_check_plugin::extract(sinsp_evt *evt, std::vector<extract_valu
 	// note: use non-transformed type, we'll apply transformations later on
 	auto type = sinsp_filter_check::get_field_info()->m_type;
 
-	// here we want to extract just one field
-	uint32_t num_fields = 1;
-
 	// populate the field to extract for the plugin
-	ss_plugin_extract_field efield;
-	efield.field_id = m_field_id;
-	efield.field = m_info->m_fields[m_field_id].m_name;
-	efield.arg_key = m_arg_key;
-	efield.arg_index = m_arg_index;
-	efield.arg_present = m_arg_present;
-	efield.ftype = type;
-	efield.flist = m_info->m_fields[m_field_id].m_flags & EPF_IS_LIST;
-	if (!m_eplugin->extract_fields(evt, num_fields, &efield) || efield.res_len == 0)
+	ss_plugin_extract_field single_field;
+	ss_plugin_extract_field* efield = &single_field;
+	if (m_batched)
 	{
-		return false;
+		if (!m_eplugin->extract_batched_field(evt, m_batched_field_id, &efield) || efield->res_len == 0)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		single_field.field_id = m_field_id;
+		single_field.field = m_info->m_fields[m_field_id].m_name;
+		single_field.arg_key = m_arg_key;
+		single_field.arg_index = m_arg_index;
+		single_field.arg_present = m_arg_present;
+		single_field.ftype = type;
+		single_field.flist = m_info->m_fields[m_field_id].m_flags & EPF_IS_LIST;
+		if (!m_eplugin->extract_fields(evt, 1, &single_field) || single_field.res_len == 0)
+		{
+			return false;
+		}
 	}
 
 	values.clear();
-	for (uint32_t i = 0; i < efield.res_len; ++i)
+	for (uint32_t i = 0; i < efield->res_len; ++i)
 	{
 		extract_value_t res;
 		switch(type)
@@ -188,26 +238,26 @@ bool sinsp_filter_check_plugin::extract(sinsp_evt *evt, std::vector<extract_valu
 			case PT_ABSTIME:
 			{
 				res.len = sizeof(uint64_t);
-				res.ptr = (uint8_t*) &efield.res.u64[i];
+				res.ptr = (uint8_t*) &efield->res.u64[i];
 				break;
 			}
 			case PT_IPADDR:
 			case PT_IPNET:
 			{
-				res.len = (uint32_t) efield.res.buf[i].len;
-				res.ptr = (uint8_t*) efield.res.buf[i].ptr;
+				res.len = (uint32_t) efield->res.buf[i].len;
+				res.ptr = (uint8_t*) efield->res.buf[i].ptr;
 				break;
 			}
 			case PT_CHARBUF:
 			{
-				res.len = strlen(efield.res.str[i]);
-				res.ptr = (uint8_t*) efield.res.str[i];
+				res.len = strlen(efield->res.str[i]);
+				res.ptr = (uint8_t*) efield->res.str[i];
 				break;
 			}
 			case PT_BOOL:
 			{
 				res.len = sizeof(ss_plugin_bool);
-				res.ptr = (uint8_t*) &efield.res.boolean[i];
+				res.ptr = (uint8_t*) &efield->res.boolean[i];
 				break;
 			}
 			default:
@@ -39,7 +39,7 @@ public:
 
 	explicit sinsp_filter_check_plugin(const sinsp_filter_check_plugin &p);
 
-	virtual ~sinsp_filter_check_plugin() = default;
+	virtual ~sinsp_filter_check_plugin();
 
 	std::unique_ptr<sinsp_filter_check> allocate_new() override;
 
@@ -64,6 +64,11 @@ private:
 	std::vector<bool> m_compatible_plugin_sources_bitmap;
 	std::shared_ptr<sinsp_plugin> m_eplugin;
 
+	// id of the field in the batch extracted by the plugin for every event,
+	// see sinsp_plugin::register_batched_field()
+	bool m_batched;
+	size_t m_batched_field_id;
+
 	// extract_arg_index() extracts a valid index from the argument if
 	// format is valid, otherwise it throws an exception.
 	// `full_field_name` has the format "field[argument]" and it is necessary
@@ -73,4 +78,6 @@ private:
 	// extract_arg_key() extracts a valid string from the argument. If we pass
 	// a numeric argument, it will be converted to string.
 	void extract_arg_key();
+
+	void unregister_batched_field();
 };
@@ -17,6 +17,7 @@ limitations under the License.
 */
 
 #include <libsinsp/plugin.h>
+#include <libsinsp/sinsp.h>
 
 #define __CATCH_ERR_MSG(_ERR, _F) \
 { \
@@ -1285,6 +1286,16 @@ ss_plugin_rc sinsp_plugin::sinsp_table_wrapper::read_entry_field(ss_plugin_table
 	return res;
 }
 
+// the static fields of the threads are copied by their snapshots
+static void invalidate_thread_snapshot(libsinsp::state::table_entry* e)
+{
+	auto tinfo = dynamic_cast<sinsp_threadinfo*>(e);
+	if(tinfo != nullptr)
+	{
+		tinfo->invalidate_snapshot();
+	}
+}
+
 ss_plugin_rc sinsp_plugin::sinsp_table_wrapper::write_entry_field(ss_plugin_table_t* _t, ss_plugin_table_entry_t* _e, const ss_plugin_table_field_t* f, const ss_plugin_state_data* in)
 {
 	auto t = static_cast<sinsp_table_wrapper*>(_t);
@@ -1325,6 +1336,7 @@ ss_plugin_rc sinsp_plugin::sinsp_table_wrapper::write_entry_field(ss_plugin_tabl
 			_type val; \
 			convert_types(in->_dtype, val); \
 			e->get()->set_static_field<_type>(*aa, val); \
+			invalidate_thread_snapshot(e->get()); \
 		} \
 		return SS_PLUGIN_SUCCESS; \
 	}
@@ -118,6 +118,14 @@ sinsp::sinsp(bool static_container, const std::string &static_id, const std::str
 
 	m_proc_scan_timeout_ms = SCAP_PROC_SCAN_TIMEOUT_NONE;
 	m_proc_scan_log_interval_ms = SCAP_PROC_SCAN_LOG_NONE;
+	m_ringbuffer_merge_mode = SCAP_RINGBUFFER_MERGE_HEAP;
+	m_ringbuffer_order_mode = SCAP_RINGBUFFER_ORDER_STRICT;
+	m_ringbuffer_order_window_ns = 0;
+	m_ringbuffer_tail_advance_bytes = 0;
+	m_ringbuffer_wait_mode = SCAP_RINGBUFFER_WAIT_BACKOFF;
+	m_ringbuffer_wait_latency_us = 0;
+	m_ringbuffer_wait_idle_us = 0;
+	m_scap_batch_size = 1;
 
 	m_replay_scap_evt = NULL;
 
@@ -439,6 +447,13 @@ void sinsp::open_kmod(unsigned long driver_buffer_bytes_dim, const libsinsp::eve
 	/* Engine-specific args. */
 	scap_kmod_engine_params params;
 	params.buffer_bytes_dim = driver_buffer_bytes_dim;
+	params.merge_mode = m_ringbuffer_merge_mode;
+	params.order_mode = m_ringbuffer_order_mode;
+	params.order_window_ns = m_ringbuffer_order_window_ns;
+	params.wait_mode = m_ringbuffer_wait_mode;
+	params.wait_latency_us = m_ringbuffer_wait_latency_us;
+	params.wait_idle_us = m_ringbuffer_wait_idle_us;
+	params.tail_advance_bytes = m_ringbuffer_tail_advance_bytes;
 	oargs.engine_params = &params;
 
 	scap_platform* platform = scap_linux_alloc_platform(::on_new_entry_from_proc, this);
@@ -472,6 +487,13 @@ void sinsp::open_bpf(const std::string& bpf_path, unsigned long driver_buffer_by
 	scap_bpf_engine_params params;
 	params.buffer_bytes_dim = driver_buffer_bytes_dim;
 	params.bpf_probe = bpf_path.data();
+	params.merge_mode = m_ringbuffer_merge_mode;
+	params.order_mode = m_ringbuffer_order_mode;
+	params.order_window_ns = m_ringbuffer_order_window_ns;
+	params.wait_mode = m_ringbuffer_wait_mode;
+	params.wait_latency_us = m_ringbuffer_wait_latency_us;
+	params.wait_idle_us = m_ringbuffer_wait_idle_us;
+	params.tail_advance_bytes = m_ringbuffer_tail_advance_bytes;
 	oargs.engine_params = &params;
 
 	scap_platform* platform = scap_linux_alloc_platform(::on_new_entry_from_proc, this);
@@ -621,6 +643,12 @@ void sinsp::open_modern_bpf(unsigned long driver_buffer_bytes_dim, uint16_t cpus
 	params.buffer_bytes_dim = driver_buffer_bytes_dim;
 	params.cpus_for_each_buffer = cpus_for_each_buffer;
 	params.allocate_online_only = online_only;
+	params.merge_mode = m_ringbuffer_merge_mode;
+	params.order_mode = m_ringbuffer_order_mode;
+	params.order_window_ns = m_ringbuffer_order_window_ns;
+	params.wait_mode = m_ringbuffer_wait_mode;
+	params.wait_latency_us = m_ringbuffer_wait_latency_us;
+	params.wait_idle_us = m_ringbuffer_wait_idle_us;
 	oargs.engine_params = &params;
 
 	scap_platform* platform = scap_linux_alloc_platform(::on_new_entry_from_proc, this);
@@ -751,6 +779,9 @@ void sinsp::close()
 		m_h = NULL;
 	}
 
+	// the pending events point into the buffers of the closed handle
+	m_delayed_scap_evt.clear();
+
 	m_is_dumping = false;
 
 	deinit_state();
@@ -895,6 +926,7 @@ void sinsp::on_new_entry_from_proc(void* context,
 
 				sinsp_tinfo->m_filtered_out = !m_filter->run(&tevt);
 			}
+			sinsp_tinfo->invalidate_snapshot();
 
 			// we shouldn't see any fds yet
 			ASSERT(tinfo->fdlist == nullptr);
@@ -1087,7 +1119,7 @@ void sinsp::get_procs_cpu_from_driver(uint64_t ts)
 	}
 }
 
-int32_t sinsp::fetch_next_event(sinsp_evt*& evt)
+int32_t sinsp::fetch_next_event(sinsp_evt*& evt, uint32_t scap_batch_size)
 {
 	// check if an event must be replayed, which currently happens
 	// when a capture file is read and we discover the first "event" block
@@ -1107,7 +1139,7 @@ int32_t sinsp::fetch_next_event(sinsp_evt*& evt)
 	int32_t res = SCAP_SUCCESS;
 	if (m_delayed_scap_evt.empty())
 	{
-		res = m_delayed_scap_evt.next(m_h);
+		res = m_delayed_scap_evt.next(m_h, scap_batch_size);
 	}
 
 	// in case we receive a timeout (when there's no element to fetch and no
@@ -1161,7 +1193,7 @@ int32_t sinsp::next(sinsp_evt **puevt)
 	sinsp_evt* evt = &m_evt;
 
 	// fetch the next event
-	int32_t res = fetch_next_event(evt);
+	int32_t res = fetch_next_event(evt, m_scap_batch_size);
 
 	// if we fetched an event successfully, check if we need to suppress
 	// it from userspace and update the result status
@@ -1173,50 +1205,94 @@ int32_t sinsp::next(sinsp_evt **puevt)
 	// in case we don't succeed, handle each scenario and return
 	if(res != SCAP_SUCCESS)
 	{
-		if(res == SCAP_TIMEOUT)
+		return handle_next_failure(res, evt, puevt);
+	}
+
+	// Finally set output evt;
+	// From now on, any return must have the correct output being set.
+	*puevt = evt;
+	return process_next_event(evt, true);
+}
+
+int32_t sinsp::handle_next_failure(int32_t res, sinsp_evt* evt, sinsp_evt** puevt)
+{
+	if(res == SCAP_TIMEOUT)
+	{
+		if (m_external_event_processor)
 		{
-			if (m_external_event_processor)
-			{
-				m_external_event_processor->process_event(NULL, libsinsp::EVENT_RETURN_TIMEOUT);
-			}
+			m_external_event_processor->process_event(NULL, libsinsp::EVENT_RETURN_TIMEOUT);
 		}
-		else if(res == SCAP_EOF)
+	}
+	else if(res == SCAP_EOF)
+	{
+		if (m_external_event_processor)
 		{
-			if (m_external_event_processor)
-			{
-				m_external_event_processor->process_event(NULL, libsinsp::EVENT_RETURN_EOF);
-			}
-			*puevt = evt;
+			m_external_event_processor->process_event(NULL, libsinsp::EVENT_RETURN_EOF);
 		}
-		else if(res == SCAP_UNEXPECTED_BLOCK)
+		*puevt = evt;
+	}
+	else if(res == SCAP_UNEXPECTED_BLOCK)
+	{
+		// This mostly happens in concatenated scap files, where an unexpected block
+		// represents the end of a file and the start of the next appended one.
+		// In this case, we restart the capture so that the internal states gets reset
+		// and the blocks coming from the next appended file get consumed.
+		restart_capture();
+		res = SCAP_TIMEOUT;
+	}
+	else if(res == SCAP_FILTERED_EVENT)
+	{
+		// This will happen if SCAP has filtered the event in userspace (tid suppression).
+		// A valid event was read from the driver, but we are choosing to not report it to
+		// the client at the client's request.
+		// However, we still need to return here so that the client doesn't time out the
+		// request.
+		if(m_external_event_processor)
 		{
-			// This mostly happens in concatenated scap files, where an unexpected block
-			// represents the end of a file and the start of the next appended one.
-			// In this case, we restart the capture so that the internal states gets reset
-			// and the blocks coming from the next appended file get consumed.
-			restart_capture();
-			res = SCAP_TIMEOUT;
+			m_external_event_processor->process_event(NULL, libsinsp::EVENT_RETURN_FILTERED);
 		}
-		else if(res == SCAP_FILTERED_EVENT)
+	}
+	else
+	{
+		m_lasterr = scap_getlasterr(m_h);
+	}
+
+	return res;
+}
+
+void sinsp::run_periodic_tasks(uint64_t ts)
+{
+	if (m_auto_threads_purging && !is_offline())
+	{
+		m_thread_manager->remove_inactive_threads();
+	}
+
+	if (m_auto_stats_print && is_debug_enabled() && is_live())
+	{
+		if(ts > m_next_stats_print_time_ns)
 		{
-			// This will happen if SCAP has filtered the event in userspace (tid suppression).
-			// A valid event was read from the driver, but we are choosing to not report it to
-			// the client at the client's request.
-			// However, we still need to return here so that the client doesn't time out the
-			// request.
-			if(m_external_event_processor)
+			if(m_next_stats_print_time_ns)
 			{
-				m_external_event_processor->process_event(NULL, libsinsp::EVENT_RETURN_FILTERED);
+				print_capture_stats(sinsp_logger::SEV_DEBUG);
 			}
+
+			m_next_stats_print_time_ns = ts - (ts % ONE_SECOND_IN_NS) + ONE_SECOND_IN_NS;
 		}
-		else
-		{
-			m_lasterr = scap_getlasterr(m_h);
-		}
+	}
 
-		return res;
+	if (m_auto_containers_purging && !is_offline())
+	{
+		m_container_manager.remove_inactive_containers();
 	}
 
+	if (m_auto_usergroups_purging && !is_offline())
+	{
+		m_usergroup_manager.clear_host_users_groups();
+	}
+}
+
+int32_t sinsp::process_next_event(sinsp_evt* evt, bool periodic_tasks)
+{
 	/* Here we shouldn't receive unknown events */
 	ASSERT(!libsinsp::events::is_unknown_event((ppm_event_code)evt->get_type()));
 
@@ -1231,7 +1307,7 @@ int32_t sinsp::next(sinsp_evt **puevt)
 	//
 	// If required, retrieve the processes cpu from the kernel
 	//
-	if(m_get_procs_cpu_from_driver && is_live())
+	if(periodic_tasks && m_get_procs_cpu_from_driver && is_live())
 	{
 		get_procs_cpu_from_driver(ts);
 	}
@@ -1245,45 +1321,19 @@ int32_t sinsp::next(sinsp_evt **puevt)
 	evt->set_num(m_nevts);
 	m_lastevent_ts = ts;
 
-	if (m_auto_threads_purging)
-	{
-		//
-		// Delayed removal of threads from the thread table, so that
-		// things like exit() or close() can be parsed.
-		//
-		if(m_tid_to_remove != -1)
-		{
-			remove_thread(m_tid_to_remove);
-			m_tid_to_remove = -1;
-		}
-
-		if(!is_offline())
-		{
-			m_thread_manager->remove_inactive_threads();
-		}
-	}
-
-	if (m_auto_stats_print && is_debug_enabled() && is_live())
-	{
-		if(ts > m_next_stats_print_time_ns)
-		{
-			if(m_next_stats_print_time_ns)
-			{
-				print_capture_stats(sinsp_logger::SEV_DEBUG);
-			}
-
-			m_next_stats_print_time_ns = ts - (ts % ONE_SECOND_IN_NS) + ONE_SECOND_IN_NS;
-		}
-	}
-
-	if (m_auto_containers_purging && !is_offline())
+	//
+	// Delayed removal of threads from the thread table, so that
+	// things like exit() or close() can be parsed.
+	//
+	if (m_auto_threads_purging && m_tid_to_remove != -1)
 	{
-		m_container_manager.remove_inactive_containers();
+		remove_thread(m_tid_to_remove);
+		m_tid_to_remove = -1;
 	}
 
-	if (m_auto_usergroups_purging && !is_offline())
+	if(periodic_tasks)
 	{
-		m_usergroup_manager.clear_host_users_groups();
+		run_periodic_tasks(ts);
 	}
 
 	//
@@ -1296,7 +1346,7 @@ int32_t sinsp::next(sinsp_evt **puevt)
 		/* This is a removal logic we shouldn't scan /proc. If we don't have the thread
 		 * to remove we are fine.
 		 */
-		sinsp_threadinfo* ptinfo = get_thread_ref(m_tid_of_fd_to_remove, false).get();
+		sinsp_threadinfo* ptinfo = get_thread_ptr(m_tid_of_fd_to_remove, false);
 		if(ptinfo)
 		{
 			for(uint32_t j = 0; j < nfdr; j++)
@@ -1324,9 +1374,6 @@ int32_t sinsp::next(sinsp_evt **puevt)
 		pp.process_event(evt, m_event_sources);
 	}
 
-	// Finally set output evt;
-	// From now on, any return must have the correct output being set.
-	*puevt = evt;
 	if(evt->is_filtered_out())
 	{
 		ppm_event_category cat = evt->get_category();
@@ -1358,13 +1405,13 @@ int32_t sinsp::next(sinsp_evt **puevt)
 		evt->get_type() != PPME_SCHEDSWITCH_6_E)
 	{
 		evt->get_tinfo()->m_prevevent_ts = evt->get_tinfo()->m_lastevent_ts;
-		evt->get_tinfo()->m_lastevent_ts = m_lastevent_ts;
+		evt->get_tinfo()->m_lastevent_ts = ts;
 	}
 
 	//
 	// Done
 	//
-	return res;
+	return SCAP_SUCCESS;
 }
 
 uint64_t sinsp::get_num_events() const
@@ -1391,6 +1438,54 @@ bool sinsp::suppress_events_tid(int64_t tid)
 	return true;
 }
 
+int32_t sinsp::next_batch(uint32_t max_events, const std::function<void(sinsp_evt*)>& on_event)
+{
+	// the scap events of the whole batch are fetched with a single
+	// scap_next_batch call, and the work that doesn't depend on the single
+	// event runs once, with the first event of the batch
+	uint32_t batch_size = std::max(m_scap_batch_size, max_events);
+	bool suppress = m_suppress.is_enabled();
+	bool periodic_tasks = true;
+	uint32_t nevents = 0;
+	int32_t res = SCAP_SUCCESS;
+
+	for(uint32_t j = 0; j < max_events; j++)
+	{
+		sinsp_evt* evt = &m_evt;
+		res = fetch_next_event(evt, batch_size);
+		if(res == SCAP_SUCCESS && suppress)
+		{
+			res = m_suppress.process_event(evt->get_scap_evt());
+		}
+		if(res != SCAP_SUCCESS)
+		{
+			sinsp_evt* uevt = nullptr;
+			res = handle_next_failure(res, evt, &uevt);
+			if(res == SCAP_FILTERED_EVENT)
+			{
+				continue;
+			}
+			break;
+		}
+
+		res = process_next_event(evt, periodic_tasks);
+		periodic_tasks = false;
+		if(res == SCAP_FILTERED_EVENT)
+		{
+			continue;
+		}
+
+		on_event(evt);
+		nevents++;
+	}
+
+	if(res == SCAP_TIMEOUT || res == SCAP_FILTERED_EVENT)
+	{
+		return nevents > 0 ? SCAP_SUCCESS : res;
+	}
+	return res;
+}
+
 void sinsp::clear_suppress_events_comm()
 {
 	m_suppress.clear_suppress_comm();
@@ -1869,6 +1964,37 @@ void sinsp::set_max_evt_output_len(uint32_t len)
 	m_max_evt_output_len = len;
 }
 
+void sinsp::fseek_ts(uint64_t ts)
+{
+	uint64_t evtnum;
+	if(scap_fseek_ts(m_h, ts, &evtnum) != SCAP_SUCCESS)
+	{
+		throw sinsp_exception(std::string("scap error: ") + scap_getlasterr(m_h));
+	}
+
+	// the events read before the seek are not replayed after it
+	m_delayed_scap_evt.clear();
+	m_replay_scap_evt = NULL;
+	m_nevts = evtnum;
+}
+
+void sinsp::fseek_evtnum(uint64_t evtnum)
+{
+	if(evtnum == 0)
+	{
+		throw sinsp_exception("invalid event number 0");
+	}
+
+	if(scap_fseek_evtnum(m_h, evtnum - 1) != SCAP_SUCCESS)
+	{
+		throw sinsp_exception(std::string("scap error: ") + scap_getlasterr(m_h));
+	}
+
+	m_delayed_scap_evt.clear();
+	m_replay_scap_evt = NULL;
+	m_nevts = evtnum - 1;
+}
+
 double sinsp::get_read_progress_file() const
 {
 	if(m_input_fd != 0)
@@ -1949,7 +2075,10 @@ double sinsp::get_read_progress_with_str(std::string* progress_str) const
 
 bool sinsp::remove_inactive_threads()
 {
-	return m_thread_manager->remove_inactive_threads();
+	/* Unlike the automatic purging, complete the whole scan of the table */
+	bool scanned = m_thread_manager->remove_inactive_threads();
+	m_thread_manager->purge_inactive_threads(UINT32_MAX);
+	return scanned;
 }
 
 void sinsp::set_thread_timeout_s(uint32_t val)
@@ -1967,6 +2096,34 @@ void sinsp::set_proc_scan_log_interval_ms(uint64_t val)
 	m_proc_scan_log_interval_ms = val;
 }
 
+void sinsp::set_ringbuffer_merge_mode(scap_ringbuffer_merge_mode mode)
+{
+	m_ringbuffer_merge_mode = mode;
+}
+
+void sinsp::set_ringbuffer_order_mode(scap_ringbuffer_order_mode mode, uint64_t window_ns)
+{
+	m_ringbuffer_order_mode = mode;
+	m_ringbuffer_order_window_ns = window_ns;
+}
+
+void sinsp::set_ringbuffer_tail_advance_bytes(uint32_t bytes)
+{
+	m_ringbuffer_tail_advance_bytes = bytes;
+}
+
+void sinsp::set_ringbuffer_wait_mode(scap_ringbuffer_wait_mode mode, uint64_t latency_us, uint64_t idle_us)
+{
+	m_ringbuffer_wait_mode = mode;
+	m_ringbuffer_wait_latency_us = latency_us;
+	m_ringbuffer_wait_idle_us = idle_us;
+}
+
+void sinsp::set_scap_batch_size(uint32_t batch_size)
+{
+	m_scap_batch_size = batch_size;
+}
+
 void sinsp::set_sinsp_stats_v2_enabled()
 {
 	if (m_sinsp_stats_v2 == nullptr)
@@ -1989,70 +2146,10 @@ void sinsp::set_sinsp_stats_v2_enabled()
 		m_sinsp_stats_v2->m_n_drops_full_threadtable = 0;
 		m_sinsp_stats_v2->m_n_missing_container_images = 0;
 		m_sinsp_stats_v2->m_n_containers= 0;
+		m_sinsp_stats_v2->m_threads_purging_time_ns = 0;
 	}
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// Note: this is defined here so we can inline it in sinso::next
-///////////////////////////////////////////////////////////////////////////////
-
-/* Returns true when we scan the table */
-bool sinsp_thread_manager::remove_inactive_threads()
-{
-	if(m_last_flush_time_ns == 0)
-	{
-		//
-		// Set the first table scan for 30 seconds in, so that we can spot bugs in the logic without having
-		// to wait for tens of minutes
-		//
-		if(m_inspector->m_threads_purging_scan_time_ns > 30 * ONE_SECOND_IN_NS)
-		{
-			m_last_flush_time_ns =
-				(m_inspector->get_lastevent_ts() - m_inspector->m_threads_purging_scan_time_ns + 30 * ONE_SECOND_IN_NS);
-		}
-		else
-		{
-			m_last_flush_time_ns =
-				(m_inspector->get_lastevent_ts() - m_inspector->m_threads_purging_scan_time_ns);
-		}
-	}
-
-	if(m_inspector->get_lastevent_ts() >
-		m_last_flush_time_ns + m_inspector->m_threads_purging_scan_time_ns)
-	{
-		std::unordered_set<int64_t> to_delete;
-
-		m_last_flush_time_ns = m_inspector->get_lastevent_ts();
-
-		libsinsp_logger()->format(sinsp_logger::SEV_INFO, "Flushing thread table");
-
-		/* Here we loop over the table in search of threads to delete. We remove:
-		 * 1. Invalid threads.
-		 * 2. Threads that we are not using and that are no more alive in /proc.
-		 */
-		m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
-			if(tinfo.is_invalid() ||
-				((m_inspector->get_lastevent_ts() > tinfo.m_lastaccess_ts + m_inspector->m_thread_timeout_ns) &&
-					!scap_is_thread_alive(m_inspector->get_scap_platform(), tinfo.m_pid, tinfo.m_tid, tinfo.m_comm.c_str())))
-			{
-				to_delete.insert(tinfo.m_tid);
-			}
-			return true;
-		});
-
-		for(const auto& tid_to_remove : to_delete)
-		{
-			remove_thread(tid_to_remove);
-		}
-
-		/* Clean expired threads in the group and children */
-		reset_child_dependencies();
-		return true;
-	}
-
-	return false;
-}
-
 std::unique_ptr<sinsp_threadinfo>
 libsinsp::event_processor::build_threadinfo(sinsp* inspector)
 {
@@ -76,6 +76,7 @@ limitations under the License.
 #include <libsinsp/user.h>
 #include <libsinsp/utils.h>
 
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
@@ -185,6 +186,22 @@ public:
 		scap_fseek(m_h, filepos);
 	}
 
+	/*!
+	  \brief Moves the reading position of a capture file to the first event
+	  with a timestamp greater or equal than ts, using the index of the file.
+	  Files without an index are indexed on the first seek.
+
+	  \note The skipped events are not parsed, so the state of the inspector
+	  (e.g. the thread table) doesn't reflect them.
+	*/
+	void fseek_ts(uint64_t ts);
+
+	/*!
+	  \brief Moves the reading position of a capture file so that the next
+	  event is the one with the given (1-based) number. See fseek_ts().
+	*/
+	void fseek_evtnum(uint64_t evtnum);
+
 	std::string generate_gvisor_config(std::string socket_path);
 
 
@@ -210,6 +227,25 @@ public:
 	*/
 	virtual int32_t next(sinsp_evt **evt);
 
+	/*!
+	  \brief Process up to `max_events` events from the open capture source and
+	  pass every one of them to `on_event`.
+
+	  Every event is parsed exactly like with \ref next, and it can be considered
+	  valid only until `on_event` returns. Events suppressed in userspace are
+	  skipped. The events are fetched from libscap with a single
+	  `scap_next_batch` call, and the periodic work (threads, containers and
+	  users purging, stats, processes cpu) runs once per batch, at the same
+	  point of the processing of the first event as in \ref next.
+	  Changes to the suppressed comms and tids made from `on_event` apply from
+	  the next batch.
+
+	  \return SCAP_SUCCESS if at least one event has been processed and the
+	   capture can continue, otherwise the result of the last \ref next call
+	   (SCAP_TIMEOUT only if no event has been processed).
+	*/
+	int32_t next_batch(uint32_t max_events, const std::function<void(sinsp_evt*)>& on_event);
+
 	/*!
 	  \brief Get the maximum number of bytes currently in use by any CPU buffer
      */
@@ -370,6 +406,28 @@ public:
 		m_threads_purging_scan_time_ns = (uint64_t)val * ONE_SECOND_IN_NS;
 	}
 
+	/*!
+	 * \brief Sets the max number of threads the automatic threads purging
+	 * routine checks for each event. The routine spreads the scan of the
+	 * thread table over the next events, so that a big table does not stall
+	 * the event loop.
+	 */
+	inline void set_auto_threads_purging_batch_size(uint32_t val)
+	{
+		m_threads_purging_batch_size = val;
+	}
+
+	/*!
+	 * \brief Sets the max number of threads whose liveness the automatic
+	 * threads purging routine checks for each event. A check can mean
+	 * reading /proc, so this budget is much smaller than the batch size:
+	 * when it's exhausted, the scan resumes at the next event.
+	 */
+	inline void set_auto_threads_purging_liveness_checks(uint32_t val)
+	{
+		m_threads_purging_liveness_checks = val;
+	}
+
 	/*!
 	 * \brief Enables or disables an automatic routine that periodically purges
 	 * thread infos from the internal state. If disabled, the client is
@@ -438,6 +496,56 @@ public:
 	 */
 	void set_proc_scan_log_interval_ms(uint64_t val);
 
+	/*!
+	 * \brief sets how the live drivers (kmod, bpf, modern_bpf) select the next
+	 *        event among their ring buffers. Must be called before opening the
+	 *        inspector. Default is SCAP_RINGBUFFER_MERGE_HEAP, use
+	 *        SCAP_RINGBUFFER_MERGE_LINEAR to restore the legacy full scan.
+	 */
+	void set_ringbuffer_merge_mode(scap_ringbuffer_merge_mode mode);
+
+	/*!
+	 * \brief relaxes the ordering of the events coming from different ring
+	 *        buffers of the live drivers, so that every buffer is drained in
+	 *        larger batches. Must be called before opening the inspector.
+	 *        The events returned out of timestamp order are counted in the
+	 *        "n_evts_out_of_order" metric, reported with METRICS_V2_LIBSCAP_COUNTERS.
+	 *
+	 * \param mode SCAP_RINGBUFFER_ORDER_STRICT (default), SCAP_RINGBUFFER_ORDER_WINDOW
+	 *        or SCAP_RINGBUFFER_ORDER_PER_CPU.
+	 * \param window_ns ordering window used by SCAP_RINGBUFFER_ORDER_WINDOW.
+	 */
+	void set_ringbuffer_order_mode(scap_ringbuffer_order_mode mode, uint64_t window_ns = 0);
+
+	/*!
+	 * \brief makes the kmod and bpf drivers give back the consumed part of a
+	 *        ring buffer block every `bytes` bytes, instead of waiting for the
+	 *        whole block, and refill every ring buffer as soon as it is drained.
+	 *        Must be called before opening the inspector. Default is 0 (disabled).
+	 *        Use METRICS_V2_KERNEL_COUNTERS_PER_CPU to get the per-CPU drops and
+	 *        buffer latency.
+	 */
+	void set_ringbuffer_tail_advance_bytes(uint32_t bytes);
+
+	/*!
+	 * \brief sets how the live drivers (kmod, bpf, modern_bpf) wait for new
+	 *        events when their ring buffers are (almost) empty. Must be called
+	 *        before opening the inspector. Default is SCAP_RINGBUFFER_WAIT_BACKOFF.
+	 *
+	 * \param latency_us SCAP_RINGBUFFER_WAIT_ADAPTIVE only: maximum delay added
+	 *        to the events to read them in larger blocks.
+	 * \param idle_us SCAP_RINGBUFFER_WAIT_ADAPTIVE only: maximum sleep when there
+	 *        are no events, 0 for the default.
+	 */
+	void set_ringbuffer_wait_mode(scap_ringbuffer_wait_mode mode, uint64_t latency_us = 0, uint64_t idle_us = 0);
+
+	/*!
+	 * \brief fetch up to `batch_size` events from libscap with a single
+	 *        `scap_next_batch` call, and serve them one by one from \ref next
+	 *        and \ref next_batch. Default is 1 (one `scap_next` call per event).
+	 */
+	void set_scap_batch_size(uint32_t batch_size);
+
 	/*!
 	 * \brief enabling sinsp state counters on the hot path via initializing the respective smart pointer.
 	 */
@@ -508,6 +616,17 @@ public:
 		return m_thread_manager->get_thread_ref(tid, query_os_if_not_found, lookup_only, main_thread);
 	}
 
+	/*!
+	  \brief Same as get_thread_ref(), but returns a raw pointer without
+	   increasing the reference count of the thread. The pointer is valid only
+	   until the thread is removed from the table, i.e. it can be used while
+	   processing the current event but must not be stored.
+	*/
+	inline sinsp_threadinfo* get_thread_ptr(int64_t tid, bool query_os_if_not_found = false, bool lookup_only = true, bool main_thread = false)
+	{
+		return m_thread_manager->get_thread_ptr(tid, query_os_if_not_found, lookup_only, main_thread);
+	}
+
 	/*!
 	  \brief Fill the given structure with statistics about the currently
 	   open capture.
@@ -1117,7 +1236,10 @@ private:
 	bool is_initialstate_event(scap_evt* pevent) const;
 	void import_ifaddr_list();
 	void import_user_list();
-	int32_t fetch_next_event(sinsp_evt*& evt);
+	int32_t fetch_next_event(sinsp_evt*& evt, uint32_t scap_batch_size);
+	int32_t handle_next_failure(int32_t res, sinsp_evt* evt, sinsp_evt** puevt);
+	void run_periodic_tasks(uint64_t ts);
+	int32_t process_next_event(sinsp_evt* evt, bool periodic_tasks);
 
 	//
 	// Note: lookup_only should be used when the query for the thread is made
@@ -1236,6 +1358,8 @@ public:
 	bool m_auto_threads_purging = true;
 	uint64_t m_thread_timeout_ns = (uint64_t)1800 * ONE_SECOND_IN_NS;
 	uint64_t m_threads_purging_scan_time_ns = (uint64_t)1200 * ONE_SECOND_IN_NS;
+	uint32_t m_threads_purging_batch_size = 256;
+	uint32_t m_threads_purging_liveness_checks = 16;
 
 	//
 	// Container limits
@@ -1294,16 +1418,45 @@ public:
 	sinsp_evt_ptr m_async_evt;
 
 	// temp storage for scap_next
-	// stores top scap_evt while qualified events from m_async_events_queue are being processed
+	// stores top scap_evt while qualified events from m_async_events_queue are being processed,
+	// followed by the events of the last scap batch that have not been processed yet
 	struct
 	{
-		inline auto next(scap_t* h)
+		inline auto next(scap_t* h, uint32_t batch_size)
 		{
-			auto res = scap_next(h, &m_pevt, &m_cpuid, &m_dump_flags);
-			if (res != SCAP_SUCCESS)
+			int32_t res = SCAP_SUCCESS;
+			if (m_batch_pos >= m_batch_len)
 			{
-				clear();
+				if (batch_size <= 1)
+				{
+					res = scap_next(h, &m_pevt, &m_cpuid, &m_dump_flags);
+					if (res != SCAP_SUCCESS)
+					{
+						clear();
+					}
+					return res;
+				}
+
+				if (m_batch_evts.size() < batch_size)
+				{
+					m_batch_evts.resize(batch_size);
+					m_batch_cpuids.resize(batch_size);
+					m_batch_dump_flags.resize(batch_size);
+				}
+				m_batch_pos = 0;
+				res = scap_next_batch(h, m_batch_evts.data(), m_batch_cpuids.data(),
+						      m_batch_dump_flags.data(), batch_size, &m_batch_len);
+				if (res != SCAP_SUCCESS)
+				{
+					clear();
+					return res;
+				}
 			}
+
+			m_pevt = m_batch_evts[m_batch_pos];
+			m_cpuid = m_batch_cpuids[m_batch_pos];
+			m_dump_flags = m_batch_dump_flags[m_batch_pos];
+			m_batch_pos++;
 			return res;
 		}
 		inline void move(sinsp_evt * evt)
@@ -1311,7 +1464,9 @@ public:
 			evt->set_scap_evt(m_pevt);
 			evt->set_cpuid(m_cpuid);
 			evt->set_dump_flags(m_dump_flags);
-			clear();
+			m_pevt = nullptr;
+			m_cpuid = 0;
+			m_dump_flags = 0;
 		}
 		inline bool empty() const
 		{
@@ -1322,11 +1477,18 @@ public:
 			m_pevt = nullptr;
 			m_cpuid = 0;
 			m_dump_flags = 0;
+			m_batch_pos = 0;
+			m_batch_len = 0;
 		}
 
 		scap_evt* m_pevt{nullptr};
 		uint16_t  m_cpuid{0};
 		uint32_t  m_dump_flags;
+		std::vector<scap_evt*> m_batch_evts;
+		std::vector<uint16_t> m_batch_cpuids;
+		std::vector<uint32_t> m_batch_dump_flags;
+		uint32_t m_batch_pos{0};
+		uint32_t m_batch_len{0};
 	} m_delayed_scap_evt;
 
 	//
@@ -1353,6 +1515,15 @@ public:
 	uint64_t m_proc_scan_timeout_ms;
 	uint64_t m_proc_scan_log_interval_ms;
 
+	scap_ringbuffer_merge_mode m_ringbuffer_merge_mode;
+	scap_ringbuffer_order_mode m_ringbuffer_order_mode;
+	uint64_t m_ringbuffer_order_window_ns;
+	uint32_t m_ringbuffer_tail_advance_bytes;
+	scap_ringbuffer_wait_mode m_ringbuffer_wait_mode;
+	uint64_t m_ringbuffer_wait_latency_us;
+	uint64_t m_ringbuffer_wait_idle_us;
+	uint32_t m_scap_batch_size;
+
 	// Any thread with a comm in this set will not have its events
 	// returned in sinsp::next()
 	std::set<std::string> m_suppressed_comms;
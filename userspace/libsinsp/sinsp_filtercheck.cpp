@@ -22,16 +22,10 @@ limitations under the License.
 #include <libscap/strl.h>
 #include <libsinsp/sinsp_filtercheck.h>
 #include <libsinsp/value_parser.h>
+#include <libsinsp/string_kernels.h>
 
 #define STRPROPERTY_STORAGE_SIZE	1024
 
-#ifndef _GNU_SOURCE
-//
-// Fallback implementation of memmem
-//
-void *memmem(const void *haystack, size_t haystacklen, const void *needle, size_t needlelen);
-#endif
-
 #ifdef _WIN32
 #define NOMINMAX
 #pragma comment(lib, "Ws2_32.lib")
@@ -41,6 +35,37 @@ void *memmem(const void *haystack, size_t haystacklen, const void *needle, size_
 #include <netdb.h>
 #endif
 
+// the state lock of the calling thread, see
+// sinsp_filter_check::set_state_lock()
+static thread_local std::mutex* s_state_lock = nullptr;
+static thread_local bool s_state_locked = false;
+
+void sinsp_filter_check::set_state_lock(std::mutex* mtx)
+{
+	ASSERT(!s_state_locked);
+	s_state_lock = mtx;
+}
+
+sinsp_filter_check::state_guard::state_guard(const sinsp_filter_check* chk):
+	m_locked(false)
+{
+	if(s_state_lock != nullptr && !s_state_locked && !chk->is_thread_safe())
+	{
+		s_state_lock->lock();
+		s_state_locked = true;
+		m_locked = true;
+	}
+}
+
+sinsp_filter_check::state_guard::~state_guard()
+{
+	if(m_locked)
+	{
+		s_state_locked = false;
+		s_state_lock->unlock();
+	}
+}
+
 std::string std::to_string(boolop b)
 {
 	switch (b)
@@ -193,19 +218,12 @@ bool flt_compare_string(cmpop op, char* operand1, char* operand2)
 	case CO_NE:
 		return (strcmp(operand1, operand2) != 0);
 	case CO_CONTAINS:
+		// strstr() doesn't need the length of the strings, and beats the
+		// kernels followed by strlen() on NUL-terminated strings
 		return (strstr(operand1, operand2) != NULL);
-    case CO_ICONTAINS:
-#ifdef _WIN32
-	{
-		std::string s1(operand1);
-		std::string s2(operand2);
-		std::transform(s1.begin(), s1.end(), s1.begin(), [](unsigned char c){ return std::tolower(c); });
-		std::transform(s2.begin(), s2.end(), s2.begin(), [](unsigned char c){ return std::tolower(c); });
-		return (strstr(s1.c_str(), s2.c_str()) != NULL);
-	}
-#else
-		return (strcasestr(operand1, operand2) != NULL);
-#endif
+	case CO_ICONTAINS:
+		// folds ASCII letters only, on every platform and locale
+		return libsinsp::string_kernels::icontains(operand1, strlen(operand1), operand2, strlen(operand2));
 	case CO_BCONTAINS:
 		throw sinsp_exception("'bcontains' not supported for string filters");
 	case CO_STARTSWITH:
@@ -233,26 +251,69 @@ bool flt_compare_string(cmpop op, char* operand1, char* operand2)
 	}
 }
 
+bool flt_is_multi_pattern_op(cmpop op)
+{
+	switch(op)
+	{
+	case CO_CONTAINS:
+	case CO_ICONTAINS:
+	case CO_STARTSWITH:
+	case CO_ENDSWITH:
+	case CO_GLOB:
+	case CO_IGLOB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static std::unique_ptr<multi_pattern_search> new_multi_pattern_search(cmpop op)
+{
+	switch(op)
+	{
+	case CO_CONTAINS:
+		return std::make_unique<multi_pattern_search>(multi_pattern_search::mode::CONTAINS);
+	case CO_ICONTAINS:
+		return std::make_unique<multi_pattern_search>(multi_pattern_search::mode::CONTAINS, true);
+	case CO_STARTSWITH:
+		return std::make_unique<multi_pattern_search>(multi_pattern_search::mode::STARTSWITH);
+	case CO_ENDSWITH:
+		return std::make_unique<multi_pattern_search>(multi_pattern_search::mode::ENDSWITH);
+	case CO_GLOB:
+		return std::make_unique<multi_pattern_search>(multi_pattern_search::mode::GLOB);
+	case CO_IGLOB:
+		return std::make_unique<multi_pattern_search>(multi_pattern_search::mode::GLOB, true);
+	default:
+		ASSERT(false);
+		return nullptr;
+	}
+}
+
+static inline bool is_string_type(ppm_param_type type)
+{
+	return type == PT_CHARBUF || type == PT_FSPATH || type == PT_FSRELPATH;
+}
+
 bool flt_compare_buffer(cmpop op, char* operand1, char* operand2, uint32_t op1_len, uint32_t op2_len)
 {
 	switch(op)
 	{
 	case CO_EQ:
-		return op1_len == op2_len && (memcmp(operand1, operand2, op1_len) == 0);
+		return libsinsp::string_kernels::equals(operand1, op1_len, operand2, op2_len);
 	case CO_NE:
-		return op1_len != op2_len || (memcmp(operand1, operand2, op1_len) != 0);
+		return !libsinsp::string_kernels::equals(operand1, op1_len, operand2, op2_len);
 	case CO_CONTAINS:
-		return (memmem(operand1, op1_len, operand2, op2_len) != NULL);
+		return libsinsp::string_kernels::contains(operand1, op1_len, operand2, op2_len);
 	case CO_ICONTAINS:
 		throw sinsp_exception("'icontains' not supported for buffer filters");
 	case CO_BCONTAINS:
-		return (memmem(operand1, op1_len, operand2, op2_len) != NULL);
+		return libsinsp::string_kernels::contains(operand1, op1_len, operand2, op2_len);
 	case CO_STARTSWITH:
-		return op2_len <= op1_len && (memcmp(operand1, operand2, op2_len) == 0);
+		return libsinsp::string_kernels::starts_with(operand1, op1_len, operand2, op2_len);
 	case CO_BSTARTSWITH:
-		return op2_len <= op1_len && (memcmp(operand1, operand2, op2_len) == 0);
+		return libsinsp::string_kernels::starts_with(operand1, op1_len, operand2, op2_len);
 	case CO_ENDSWITH:
-		return (sinsp_utils::endswith(operand1, operand2, op1_len, op2_len));
+		return libsinsp::string_kernels::ends_with(operand1, op1_len, operand2, op2_len);
 	case CO_GLOB:
 		throw sinsp_exception("'glob' not supported for buffer filters");
 	case CO_IGLOB:
@@ -1190,6 +1251,7 @@ char* sinsp_filter_check::rawval_to_string(uint8_t* rawval,
 
 char* sinsp_filter_check::tostring(sinsp_evt* evt)
 {
+	state_guard guard(this);
 	m_extracted_values.clear();
 	if(!extract(evt, m_extracted_values))
 	{
@@ -1218,6 +1280,7 @@ char* sinsp_filter_check::tostring(sinsp_evt* evt)
 
 Json::Value sinsp_filter_check::tojson(sinsp_evt* evt)
 {
+	state_guard guard(this);
 	uint32_t len;
 	Json::Value jsonval = extract_as_js(evt, &len);
 
@@ -1356,6 +1419,50 @@ void sinsp_filter_check::add_filter_value(const char* str, uint32_t len, uint32_
 		ensure_unique_ptr_allocated(m_val_storages_paths);
 		m_val_storages_paths->add_search_path(item);
 	}
+
+	// Lists of string patterns are matched in a single pass, and glob
+	// patterns are compiled once instead of being parsed at each event.
+	// The compiled globs follow fnmatch() in the C locale, and fall back to
+	// sinsp_utils::glob_match where it differs (e.g. PathMatchSpec() on
+	// Windows), see multi_pattern_search
+	bool is_glob = m_cmpop == CO_GLOB || m_cmpop == CO_IGLOB;
+	if ((m_vals.size() > 1 || is_glob) && flt_is_multi_pattern_op(m_cmpop)
+		&& is_string_type(get_transformed_field_info()->m_type))
+	{
+		if (!m_val_storages_patterns)
+		{
+			m_val_storages_patterns = new_multi_pattern_search(m_cmpop);
+			for (size_t j = 0; j + 1 < m_vals.size(); j++)
+			{
+				m_val_storages_patterns->add_pattern((const char*)filter_value_p(j));
+			}
+		}
+		m_val_storages_patterns->add_pattern((const char*)item.first);
+	}
+
+	// Network lists are matched with a prefix trie instead of comparing
+	// the address with each network
+	if (m_cmpop == CO_IN || m_cmpop == CO_INTERSECTS || m_cmpop == CO_PMATCH)
+	{
+		switch (get_transformed_field_info()->m_type)
+		{
+		case PT_IPV4NET:
+		case PT_IPV6NET:
+		case PT_IPNET:
+			ensure_unique_ptr_allocated(m_val_storages_ipnets);
+			if (parsed_len == sizeof(ipv4net))
+			{
+				m_val_storages_ipnets->add_network(*(ipv4net*)item.first);
+			}
+			else if (parsed_len == sizeof(ipv6net))
+			{
+				m_val_storages_ipnets->add_network(*(ipv6net*)item.first);
+			}
+			break;
+		default:
+			break;
+		}
+	}
 }
 
 void sinsp_filter_check::add_filter_value(std::unique_ptr<sinsp_filter_check> rhs_chk)
@@ -1533,16 +1640,7 @@ bool sinsp_filter_check::compare_rhs(cmpop op, ppm_param_type type, std::vector<
 					// todo(jasondellaluce): refactor filter_value_t to actually use flt_compare instead of memcmp.
 					if (type == PT_IPNET)
 					{
-						bool found = false;
-						for (const auto& m : m_vals)
-						{
-							if (::flt_compare(CO_EQ, type, item.first, m.first, item.second, m.second))
-							{
-								found = true;
-								break;
-							}
-						}
-						if (!found)
+						if (!match_ipnet_values(type, item.first, item.second))
 						{
 							return false;
 						}
@@ -1568,12 +1666,9 @@ bool sinsp_filter_check::compare_rhs(cmpop op, ppm_param_type type, std::vector<
 					// todo(jasondellaluce): refactor filter_value_t to actually use flt_compare instead of memcmp.
 					if (type == PT_IPNET)
 					{
-						for (const auto& m : m_vals)
+						if (match_ipnet_values(type, item.first, item.second))
 						{
-							if (::flt_compare(CO_EQ, type, item.first, m.first, item.second, m.second))
-							{
-								return true;
-							}
+							return true;
 						}
 					}
 					else
@@ -1625,6 +1720,7 @@ bool sinsp_filter_check::compare_rhs(cmpop op, ppm_param_type type, const void*
 		case PT_IPV4NET:
 		case PT_IPV6NET:
 		case PT_IPNET:
+			return match_ipnet_values(type, operand1, op1_len);
 		case PT_SOCKADDR:
 		case PT_SOCKTUPLE:
 		case PT_FDLIST:
@@ -1682,6 +1778,12 @@ bool sinsp_filter_check::compare_rhs(cmpop op, ppm_param_type type, const void*
 	}
 	else
 	{
+		if (m_val_storages_patterns && op == m_cmpop && is_string_type(type))
+		{
+			// same string semantics of flt_compare_string
+			return m_val_storages_patterns->match((const char*)operand1, strlen((const char*)operand1));
+		}
+
 		return (::flt_compare(op,
 				      type,
 				      operand1,
@@ -1692,6 +1794,47 @@ bool sinsp_filter_check::compare_rhs(cmpop op, ppm_param_type type, const void*
 	}
 }
 
+bool sinsp_filter_check::match_ipnet_values(ppm_param_type type, const void* operand1, uint32_t op1_len)
+{
+	if (m_val_storages_ipnets)
+	{
+		// same length checks of flt_compare
+		switch(type)
+		{
+		case PT_IPV4NET:
+			return m_val_storages_ipnets->match(*(uint32_t*)operand1);
+		case PT_IPV6NET:
+			return m_val_storages_ipnets->match(*(ipv6addr*)operand1);
+		case PT_IPNET:
+			if (op1_len == sizeof(struct in_addr))
+			{
+				return m_val_storages_ipnets->match(*(uint32_t*)operand1);
+			}
+			if (op1_len == sizeof(struct in6_addr))
+			{
+				return m_val_storages_ipnets->match(*(ipv6addr*)operand1);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	for (uint16_t i=0; i < m_vals.size(); i++)
+	{
+		if (::flt_compare(CO_EQ,
+				  type,
+				  operand1,
+				  filter_value_p(i),
+				  op1_len,
+				  filter_value_len(i)))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 bool sinsp_filter_check::extract_nocache(sinsp_evt *evt, std::vector<extract_value_t>& values, bool sanitize_strings)
 {
 	values.clear();
@@ -1712,6 +1855,7 @@ uint8_t* sinsp_filter_check::extract_single(sinsp_evt *evt, uint32_t* len, bool
 
 bool sinsp_filter_check::extract(sinsp_evt *evt, std::vector<extract_value_t>& values, bool sanitize_strings)
 {
+	state_guard guard(this);
 	if(m_cache_metrics != NULL)
 	{
 		m_cache_metrics->m_num_extract++;
@@ -1724,14 +1868,36 @@ bool sinsp_filter_check::extract(sinsp_evt *evt, std::vector<extract_value_t>& v
 
 		if(en != m_extraction_cache_entry->m_evtnum)
 		{
-			m_extraction_cache_entry->m_evtnum = en;
-			auto ok = extract_nocache(evt, m_extraction_cache_entry->m_res, sanitize_strings);
-			ok = ok && apply_transformers(m_extraction_cache_entry->m_res);
+			auto& res = m_extraction_cache_entry->m_res;
+			auto ok = extract_nocache(evt, res, sanitize_strings);
+			ok = ok && apply_transformers(res);
 			if (!ok)
 			{
 				// clear results in case something fails
-				m_extraction_cache_entry->m_res.clear();
+				res.clear();
 			}
+
+			// note: strings are also used as C strings, so every value
+			// is copied with a terminator
+			auto& storage = m_extraction_cache_entry->m_storage;
+			size_t size = 0;
+			for (const auto& v : res)
+			{
+				size += v.len + 1;
+			}
+			storage.resize(size);
+			size = 0;
+			for (auto& v : res)
+			{
+				if (v.len > 0)
+				{
+					memcpy(storage.data() + size, v.ptr, v.len);
+				}
+				storage[size + v.len] = 0;
+				v.ptr = storage.data() + size;
+				size += v.len + 1;
+			}
+			m_extraction_cache_entry->m_evtnum = en;
 		}
 		else
 		{
@@ -1753,8 +1919,43 @@ bool sinsp_filter_check::extract(sinsp_evt *evt, std::vector<extract_value_t>& v
 	}
 }
 
+uint32_t sinsp_filter_check::extract_into(sinsp_evt *evt, extract_value_t* values, uint32_t capacity, bool sanitize_strings)
+{
+	state_guard guard(this);
+	// transformers and the extraction cache work on vectors
+	bool cached = m_extraction_cache_entry != NULL && !get_transformed_field_info()->is_arg_supported();
+	if(!extracts_single_value() || !m_transformers.empty() || cached)
+	{
+		m_extracted_values.clear();
+		if(!extract(evt, m_extracted_values, sanitize_strings))
+		{
+			return 0;
+		}
+		std::copy_n(m_extracted_values.begin(), std::min<size_t>(capacity, m_extracted_values.size()), values);
+		return m_extracted_values.size();
+	}
+
+	if(m_cache_metrics != NULL)
+	{
+		m_cache_metrics->m_num_extract++;
+	}
+
+	extract_value_t val;
+	val.ptr = extract_single(evt, &val.len, sanitize_strings);
+	if(val.ptr == NULL)
+	{
+		return 0;
+	}
+	if(capacity > 0)
+	{
+		values[0] = val;
+	}
+	return 1;
+}
+
 bool sinsp_filter_check::compare(sinsp_evt* evt)
 {
+	state_guard guard(this);
 	if(m_cache_metrics != NULL)
 	{
 		m_cache_metrics->m_num_eval++;
@@ -1769,8 +1970,8 @@ bool sinsp_filter_check::compare(sinsp_evt* evt)
 
 		if(en != m_eval_cache_entry->m_evtnum)
 		{
-			m_eval_cache_entry->m_evtnum = en;
 			m_eval_cache_entry->m_res = compare_nocache(evt);
+			m_eval_cache_entry->m_evtnum = en;
 		}
 		else
 		{
@@ -1788,15 +1989,35 @@ bool sinsp_filter_check::compare(sinsp_evt* evt)
 	}
 }
 
+bool sinsp_filter_check::has_default_compare() const
+{
+	return !has_filtercheck_value() && !get_transformed_field_info()->is_list();
+}
+
 bool sinsp_filter_check::compare_nocache(sinsp_evt* evt)
 {
+	auto lhs_type = get_transformed_field_info()->m_type;
+	if(!has_filtercheck_value() && !get_transformed_field_info()->is_list())
+	{
+		extract_value_t val;
+		switch(extract_into(evt, &val, 1, false))
+		{
+		case 0:
+			return false;
+		case 1:
+			return compare_rhs(m_cmpop, lhs_type, val.ptr, val.len);
+		default:
+			// let the vector version report the error
+			break;
+		}
+	}
+
 	m_extracted_values.clear();
 	if(!extract(evt, m_extracted_values, false))
 	{
 		return false;
 	}
 
-	auto lhs_type = get_transformed_field_info()->m_type;
 	if(has_filtercheck_value())
 	{
 		check_rhs_field_type_consistency();
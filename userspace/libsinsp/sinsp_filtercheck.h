@@ -21,11 +21,14 @@ limitations under the License.
 #include <string>
 #include <unordered_set>
 #include <memory>
+#include <mutex>
 #include <json/json.h>
 #include <libscap/scap.h>
 #include <libsinsp/tuples.h>
 #include <libsinsp/filter_value.h>
 #include <libsinsp/prefix_search.h>
+#include <libsinsp/ipnet_search.h>
+#include <libsinsp/multi_pattern_search.h>
 #include <libsinsp/event.h>
 #include <libsinsp/sinsp_filter_transformer.h>
 
@@ -68,9 +71,17 @@ enum boolop: uint8_t
 
 bool flt_compare(cmpop op, ppm_param_type type, const void* operand1, const void* operand2, uint32_t op1_len = 0, uint32_t op2_len = 0);
 bool flt_compare_avg(cmpop op, ppm_param_type type, const void* operand1, const void* operand2, uint32_t op1_len, uint32_t op2_len, uint32_t cnt1, uint32_t cnt2);
+bool flt_compare_int64(cmpop op, int64_t operand1, int64_t operand2);
+bool flt_compare_uint64(cmpop op, uint64_t operand1, uint64_t operand2);
+bool flt_compare_string(cmpop op, char* operand1, char* operand2);
 bool flt_compare_ipv4net(cmpop op, uint64_t operand1, const ipv4net* operand2);
 bool flt_compare_ipv6net(cmpop op, const ipv6addr *operand1, const ipv6net *operand2);
 
+// Returns true for the string operators that can compare a string with a
+// list of values at once, i.e. with a multi_pattern_search. The comparison
+// succeeds if any of the values matches.
+bool flt_is_multi_pattern_op(cmpop op);
+
 namespace std
 {
 std::string to_string(cmpop);
@@ -82,6 +93,10 @@ class check_extraction_cache_entry
 public:
 	uint64_t m_evtnum = UINT64_MAX;
 	std::vector<extract_value_t> m_res;
+
+	// copy of the values pointed by m_res, since the entry can be shared
+	// by many checks and outlive the one that extracted them
+	std::vector<uint8_t> m_storage;
 };
 
 class check_eval_cache_entry
@@ -257,6 +272,15 @@ public:
 		return m_vals;
 	}
 
+	//
+	// Return the prefix trie the networks in the filter values are
+	// matched with, if any
+	//
+	inline const ipnet_search* get_ipnet_search() const
+	{
+		return m_val_storages_ipnets.get();
+	}
+
 	//
 	// Return true if the filter check is compared against another filter check
 	//
@@ -302,11 +326,50 @@ public:
 	// \param values [out] the values extracted from the filter check
 	virtual bool extract(sinsp_evt*, std::vector<extract_value_t>& values, bool sanitize_strings = true);
 
+	//
+	// Same as extract(), but writes the values in a caller-provided array
+	// that can hold up to capacity of them. The single values of the checks
+	// supporting it (see extracts_single_value()) don't go through a vector,
+	// so they are extracted without allocating memory.
+	// Returns the number of extracted values, or 0 if the field has no value.
+	// If this is greater than capacity, only the first values are written.
+	//
+	uint32_t extract_into(sinsp_evt*, extract_value_t* values, uint32_t capacity, bool sanitize_strings = true);
+
 	//
 	// Compare the field with the constant value obtained from parse_filter_value()
 	//
 	virtual bool compare(sinsp_evt*);
 
+	//
+	// Return true if compare() is the comparison of the single value
+	// returned by extract_into() with the filter values, as done by the
+	// base class. Subclasses comparing some of their fields in a custom
+	// way return false for them. The filter programs only lower the
+	// checks returning true into their own instructions.
+	//
+	virtual bool has_default_compare() const;
+
+	//
+	// Return true if the current field is extracted from the event and its
+	// snapshot alone (see sinsp_evt::snapshot()), without reading the state
+	// of the inspector or of a plugin, so that it can be extracted by any
+	// thread. The other fields are extracted holding the state lock of the
+	// calling thread, see set_state_lock().
+	//
+	virtual bool is_thread_safe() const
+	{
+		return false;
+	}
+
+	//
+	// Set the mutex the calling thread holds while extracting the fields
+	// that are not thread safe, or nullptr to not lock anything. Set by the
+	// threads evaluating the events while another thread parses them, see
+	// sinsp_pipeline.
+	//
+	static void set_state_lock(std::mutex* mtx);
+
 	//
 	// Extract the value from the event and convert it into a string
 	//
@@ -320,9 +383,9 @@ public:
 
 	sinsp* m_inspector = nullptr;
 	std::vector<extract_value_t> m_extracted_values;
-	check_eval_cache_entry* m_eval_cache_entry = nullptr;
-	check_extraction_cache_entry* m_extraction_cache_entry = nullptr;
-	check_cache_metrics *m_cache_metrics = nullptr;
+	std::shared_ptr<check_eval_cache_entry> m_eval_cache_entry = nullptr;
+	std::shared_ptr<check_extraction_cache_entry> m_extraction_cache_entry = nullptr;
+	std::shared_ptr<check_cache_metrics> m_cache_metrics = nullptr;
 	boolop m_boolop = BO_NONE;
 	cmpop m_cmpop = CO_NONE;
 
@@ -333,6 +396,24 @@ public:
 
 
 protected:
+	//
+	// Holds the state lock of the calling thread while the current field
+	// is extracted, unless the field is thread safe or the thread already
+	// holds it. Every entry point of the extraction takes one.
+	//
+	class state_guard
+	{
+	public:
+		explicit state_guard(const sinsp_filter_check* chk);
+		~state_guard();
+
+		state_guard(const state_guard&) = delete;
+		state_guard& operator=(const state_guard&) = delete;
+
+	private:
+		bool m_locked;
+	};
+
 	virtual bool compare_nocache(sinsp_evt*);
 
 	virtual Json::Value extract_as_js(sinsp_evt*, uint32_t* len)
@@ -357,9 +438,21 @@ protected:
 	// \param len [out] length in bytes for the returned value
 	virtual uint8_t* extract_single(sinsp_evt*, uint32_t* len, bool sanitize_strings = true);
 
+	// Returns true if the current field is extracted by extract_single()
+	// alone. Subclasses that don't override the multi-valued extract for
+	// it can return true, to let extract_into() skip the vectors.
+	virtual bool extracts_single_value() const
+	{
+		return false;
+	}
+
 	bool compare_rhs(cmpop op, ppm_param_type type, const void* operand1, uint32_t op1_len = 0);
 	bool compare_rhs(cmpop op, ppm_param_type type, std::vector<extract_value_t>& values);
 
+	// Returns true if the given address of type PT_IPV4NET, PT_IPV6NET or
+	// PT_IPNET belongs to any of the networks in the filter values
+	bool match_ipnet_values(ppm_param_type type, const void* operand1, uint32_t op1_len);
+
 	Json::Value rawval_to_json(uint8_t* rawval, ppm_param_type ptype, ppm_print_format print_format, uint32_t len);
 
 	inline uint8_t* filter_value_p(uint16_t i = 0)
@@ -402,6 +495,8 @@ private:
 			g_hash_membuf,
 			g_equal_to_membuf>> m_val_storages_members;
 	std::unique_ptr<path_prefix_search> m_val_storages_paths;
+	std::unique_ptr<ipnet_search> m_val_storages_ipnets;
+	std::unique_ptr<multi_pattern_search> m_val_storages_patterns;
 	uint32_t m_val_storages_min_size;
 	uint32_t m_val_storages_max_size;
 
@@ -188,6 +188,7 @@ int32_t sinsp_filter_check_event::extract_arg(string_view fldname, string_view v
 		}
 
 		m_argname = pi->name;
+		m_arg_lookup = sinsp_evt_param_lookup(m_argname);
 		parsed_len = (uint32_t)(fldname.size() + strlen(pi->name) + 1);
 		m_argid = -1;
 
@@ -391,9 +392,29 @@ void sinsp_filter_check_event::validate_filter_value(const char* str, uint32_t l
 	}
 }
 
-uint8_t* extract_argraw(sinsp_evt *evt, uint32_t* len, const char *argname)
+// The parameters looked up by many fields, resolved on first use since the
+// event table is only set after the static initialization
+static const sinsp_evt_param_lookup& res_param()
 {
-	const sinsp_evt_param* pi = evt->get_param_by_name(argname);
+	static const sinsp_evt_param_lookup lookup("res");
+	return lookup;
+}
+
+static const sinsp_evt_param_lookup& fd_param()
+{
+	static const sinsp_evt_param_lookup lookup("fd");
+	return lookup;
+}
+
+static const sinsp_evt_param_lookup& data_param()
+{
+	static const sinsp_evt_param_lookup lookup("data");
+	return lookup;
+}
+
+static uint8_t* extract_argraw(sinsp_evt *evt, uint32_t* len, const sinsp_evt_param_lookup& arg)
+{
+	const sinsp_evt_param* pi = evt->get_param_by_name(arg);
 
 	if(pi != NULL)
 	{
@@ -543,7 +564,7 @@ uint8_t *sinsp_filter_check_event::extract_abspath(sinsp_evt *evt, uint32_t *len
 	}
 	else
 	{
-		evt->set_fd_info(evt->get_tinfo()->get_fd(dirfd));
+		evt->set_fd_info(evt->find_fd(dirfd));
 
 		if(evt->get_fd_info() == NULL)
 		{
@@ -613,7 +634,7 @@ Json::Value sinsp_filter_check_event::extract_as_js(sinsp_evt *evt, uint32_t* le
 
 uint8_t* sinsp_filter_check_event::extract_error_count(sinsp_evt *evt, uint32_t* len)
 {
-	const sinsp_evt_param* pi = evt->get_param_by_name("res");
+	const sinsp_evt_param* pi = evt->get_param_by_name(res_param());
 
 	if(pi != NULL)
 	{
@@ -631,7 +652,7 @@ uint8_t* sinsp_filter_check_event::extract_error_count(sinsp_evt *evt, uint32_t*
 
 	if((evt->get_info_flags() & EF_CREATES_FD) && PPME_IS_EXIT(evt->get_type()))
 	{
-		pi = evt->get_param_by_name("fd");
+		pi = evt->get_param_by_name(fd_param());
 
 		if(pi != NULL)
 		{
@@ -647,6 +668,11 @@ uint8_t* sinsp_filter_check_event::extract_error_count(sinsp_evt *evt, uint32_t*
 	return NULL;
 }
 
+bool sinsp_filter_check_event::extracts_single_value() const
+{
+	return true;
+}
+
 uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len, bool sanitize_strings)
 {
 	*len = 0;
@@ -664,7 +690,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 					return NULL;
 				}
 
-				m_val.u64 = evt->get_tinfo()->m_latency;
+				m_val.u64 = evt->get_thread_latency();
 			}
 
 			RETURN_EXTRACT_VAR(m_val.u64);
@@ -681,9 +707,10 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 					return NULL;
 				}
 
+				m_val.u64 = evt->get_thread_latency();
 				m_converter->set_val(PT_RELTIME,
 					EPF_NONE,
-					(uint8_t*)&evt->get_tinfo()->m_latency,
+					(uint8_t*)&m_val.u64,
 					8,
 					0,
 					ppm_print_format::PF_DEC);
@@ -706,7 +733,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 					return NULL;
 				}
 
-				uint64_t lat = evt->get_tinfo()->m_latency;
+				uint64_t lat = evt->get_thread_latency();
 
 				if(m_field_id == TYPE_LATENCY_S)
 				{
@@ -730,7 +757,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 					return NULL;
 				}
 
-				uint64_t lat = evt->get_tinfo()->m_latency;
+				uint64_t lat = evt->get_thread_latency();
 				if(lat != 0)
 				{
 					double llatency = log10((double)lat);
@@ -806,7 +833,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 				{
 					if(evt->get_tinfo() != NULL)
 					{
-						long long unsigned lat = evt->get_tinfo()->m_latency;
+						long long unsigned lat = evt->get_thread_latency();
 
 						m_strstorage += to_string(lat / 1000000000);
 						m_strstorage += ".";
@@ -1042,7 +1069,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 		m_val.u16 = evt->get_cpuid();
 		RETURN_EXTRACT_VAR(m_val.u16);
 	case TYPE_ARGRAW:
-		return extract_argraw(evt, len, m_arginfo->name);
+		return extract_argraw(evt, len, m_arg_lookup);
 		break;
 	case TYPE_ARGSTR:
 		{
@@ -1062,7 +1089,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 			}
 			else
 			{
-				argstr = evt->get_param_value_str(m_argname, &resolved_argstr, m_inspector->get_buffer_format());
+				argstr = evt->get_param_value_str(m_arg_lookup, &resolved_argstr, m_inspector->get_buffer_format());
 			}
 
 			if(resolved_argstr != NULL && resolved_argstr[0] != 0)
@@ -1077,10 +1104,10 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 		break;
 	case TYPE_INFO:
 		{
-			if(m_inspector->get_parser()->get_syslog_decoder().is_data_valid())
+			if(evt->get_syslog_decoder().is_data_valid())
 			{
 				// syslog is actually the only info line we support up until now
-				m_strstorage = m_inspector->get_parser()->get_syslog_decoder().get_info_line();
+				m_strstorage = evt->get_syslog_decoder().get_info_line();
 				RETURN_EXTRACT_STRING(m_strstorage);
 			}
 		}
@@ -1121,7 +1148,9 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 					m_strstorage += evt->get_param_name(j);
 					m_strstorage += '=';
 					m_strstorage += argstr;
-					m_strstorage += string("(") + resolved_argstr + ") ";
+					m_strstorage += '(';
+					m_strstorage += resolved_argstr;
+					m_strstorage += ") ";
 				}
 			}
 
@@ -1136,12 +1165,12 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 		{
 			if(m_is_compare)
 			{
-				return extract_argraw(evt, len, "data");
+				return extract_argraw(evt, len, data_param());
 			}
 
 			const char* resolved_argstr;
 			const char* argstr;
-			argstr = evt->get_param_value_str("data", &resolved_argstr, m_inspector->get_buffer_format());
+			argstr = evt->get_param_value_str(data_param(), &resolved_argstr, m_inspector->get_buffer_format());
 			*len = evt->get_rawbuf_str_len();
 
 			return (uint8_t*)argstr;
@@ -1154,7 +1183,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 		break;
 	case TYPE_RESRAW:
 		{
-			const sinsp_evt_param* pi = evt->get_param_by_name("res");
+			const sinsp_evt_param* pi = evt->get_param_by_name(res_param());
 
 			if(pi != NULL)
 			{
@@ -1164,7 +1193,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 
 			if((evt->get_info_flags() & EF_CREATES_FD) && PPME_IS_EXIT(evt->get_type()))
 			{
-				pi = evt->get_param_by_name("fd");
+				pi = evt->get_param_by_name(fd_param());
 
 				if(pi != NULL)
 				{
@@ -1181,7 +1210,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 			const char* resolved_argstr;
 			const char* argstr;
 
-			const sinsp_evt_param* pi = evt->get_param_by_name("res");
+			const sinsp_evt_param* pi = evt->get_param_by_name(res_param());
 
 			if(pi != NULL)
 			{
@@ -1193,7 +1222,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 				}
 				else
 				{
-					argstr = evt->get_param_value_str("res", &resolved_argstr);
+					argstr = evt->get_param_value_str(res_param(), &resolved_argstr);
 					ASSERT(resolved_argstr != NULL && resolved_argstr[0] != 0);
 
 					if(resolved_argstr != NULL && resolved_argstr[0] != 0)
@@ -1210,7 +1239,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 			{
 				if((evt->get_info_flags() & EF_CREATES_FD) && PPME_IS_EXIT(evt->get_type()))
 				{
-					pi = evt->get_param_by_name("fd");
+					pi = evt->get_param_by_name(fd_param());
 					if (pi)
 					{
 						int64_t res = pi->as<int64_t>();
@@ -1221,7 +1250,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 						}
 						else
 						{
-							argstr = evt->get_param_value_str("fd", &resolved_argstr);
+							argstr = evt->get_param_value_str(fd_param(), &resolved_argstr);
 							ASSERT(resolved_argstr != NULL && resolved_argstr[0] != 0);
 
 							if(resolved_argstr != NULL && resolved_argstr[0] != 0)
@@ -1243,7 +1272,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 	case TYPE_FAILED:
 		{
 			m_val.u32 = 0;
-			const sinsp_evt_param* pi = evt->get_param_by_name("res");
+			const sinsp_evt_param* pi = evt->get_param_by_name(res_param());
 
 			if(pi != NULL)
 			{
@@ -1255,7 +1284,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 			}
 			else if((evt->get_info_flags() & EF_CREATES_FD) && PPME_IS_EXIT(evt->get_type()))
 			{
-				pi = evt->get_param_by_name("fd");
+				pi = evt->get_param_by_name(fd_param());
 
 				if(pi != NULL)
 				{
@@ -1353,7 +1382,7 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 			{
 				if(evt->get_tinfo() != NULL)
 				{
-					m_val.u64 = evt->get_tinfo()->m_latency;
+					m_val.u64 = evt->get_thread_latency();
 				}
 				else
 				{
@@ -1780,6 +1809,27 @@ uint8_t* sinsp_filter_check_event::extract_single(sinsp_evt *evt, uint32_t* len,
 	return NULL;
 }
 
+bool sinsp_filter_check_event::has_default_compare() const
+{
+	switch(m_field_id)
+	{
+	case TYPE_ARGRAW:
+	case TYPE_AROUND:
+	// extracted in its raw form when comparing
+	case TYPE_BUFFER:
+		return false;
+	default:
+		return sinsp_filter_check::has_default_compare();
+	}
+}
+
+bool sinsp_filter_check_event::is_thread_safe() const
+{
+	// the fields only read the event, its snapshot and the configuration
+	// of the inspector
+	return true;
+}
+
 bool sinsp_filter_check_event::compare_nocache(sinsp_evt *evt)
 {
 	bool res;
@@ -92,10 +92,13 @@ public:
 	std::unique_ptr<sinsp_filter_check> allocate_new() override;
 	int32_t parse_field_name(std::string_view, bool alloc_state, bool needed_for_filtering) override;
 	size_t parse_filter_value(const char* str, uint32_t len, uint8_t* storage, uint32_t storage_len) override;
+	bool has_default_compare() const override;
+	bool is_thread_safe() const override;
 
 protected:
 	Json::Value extract_as_js(sinsp_evt*, uint32_t* len) override;
 	virtual uint8_t* extract_single(sinsp_evt*, uint32_t* len, bool sanitize_strings = true) override;
+	bool extracts_single_value() const override;
 	virtual bool compare_nocache(sinsp_evt*) override;
 
 private:
@@ -115,6 +118,7 @@ private:
 	uint64_t m_tsdelta;
 	std::string m_strstorage;
 	std::string m_argname;
+	sinsp_evt_param_lookup m_arg_lookup;
 	int32_t m_argid;
 	uint32_t m_evtid;
 	uint32_t m_evtid1;
@@ -223,9 +223,10 @@ bool sinsp_filter_check_fd::extract_fdname_from_creator(sinsp_evt *evt, uint32_t
 				//
 				// XXX This is highly inefficient, as it re-requests the enter event and then
 				// does unnecessary allocations and copies. We assume that failed openat() happen
-				// rarely enough that we don't care.
+				// rarely enough that we don't care. The enter events are not
+				// kept with the snapshots.
 				//
-				if(!m_inspector->get_parser()->retrieve_enter_event(&enter_evt, evt))
+				if(evt->is_snapshot() || !m_inspector->get_parser()->retrieve_enter_event(&enter_evt, evt))
 				{
 					return false;
 				}
@@ -420,6 +421,7 @@ uint8_t* sinsp_filter_check_fd::extract_from_null_fd(sinsp_evt *evt, uint32_t* l
 
 bool sinsp_filter_check_fd::extract(sinsp_evt *evt, std::vector<extract_value_t>& values, bool sanitize_strings)
 {
+	state_guard guard(this);
 	values.clear();
 
 	if(!extract_fd(evt))
@@ -466,6 +468,12 @@ bool sinsp_filter_check_fd::extract(sinsp_evt *evt, std::vector<extract_value_t>
 	return sinsp_filter_check::extract(evt, values, sanitize_strings);
 }
 
+bool sinsp_filter_check_fd::extracts_single_value() const
+{
+	// fd.types without an argument is the only multi-valued field
+	return m_field_id != TYPE_FDTYPES || m_argid != -1;
+}
+
 uint8_t* sinsp_filter_check_fd::extract_single(sinsp_evt *evt, uint32_t* len, bool sanitize_strings)
 {
 	*len = 0;
@@ -481,7 +489,8 @@ uint8_t* sinsp_filter_check_fd::extract_single(sinsp_evt *evt, uint32_t* len, bo
 	//
 	if(m_field_id == TYPE_FDNUM)
 	{
-		RETURN_EXTRACT_VAR(m_tinfo->m_lastevent_fd);
+		m_val.s64 = evt->get_thread_lastevent_fd();
+		RETURN_EXTRACT_VAR(m_val.s64);
 	}
 
 	switch(m_field_id)
@@ -1301,7 +1310,7 @@ uint8_t* sinsp_filter_check_fd::extract_single(sinsp_evt *evt, uint32_t* len, bo
 				return NULL;
 			}
 
-			m_tstr = to_string(m_tinfo->m_tid) + to_string(m_tinfo->m_lastevent_fd);
+			m_tstr = to_string(m_tinfo->m_tid) + to_string(evt->get_thread_lastevent_fd());
 			RETURN_EXTRACT_STRING(m_tstr);
 		}
 		break;
@@ -1486,6 +1495,11 @@ bool sinsp_filter_check_fd::compare_net(sinsp_evt *evt)
 		return false;
 	}
 
+	if(m_cmpop == CO_IN)
+	{
+		return compare_net_in();
+	}
+
 	bool sip_cmp = false;
 	bool dip_cmp = false;
 
@@ -1524,6 +1538,29 @@ bool sinsp_filter_check_fd::compare_net(sinsp_evt *evt)
 	return false;
 }
 
+//
+// "in" lists can mix IPv4 and IPv6 networks and have many values, so they
+// are matched through the prefix trie of the filter values
+//
+bool sinsp_filter_check_fd::compare_net_in()
+{
+	switch (m_fdinfo->m_type)
+	{
+	case SCAP_FD_IPV4_SERVSOCK:
+		return match_ipnet_values(PT_IPNET, &m_fdinfo->m_sockinfo.m_ipv4serverinfo.m_ip, sizeof(uint32_t));
+	case SCAP_FD_IPV6_SERVSOCK:
+		return match_ipnet_values(PT_IPNET, &m_fdinfo->m_sockinfo.m_ipv6serverinfo.m_ip, sizeof(ipv6addr));
+	case SCAP_FD_IPV4_SOCK:
+		return match_ipnet_values(PT_IPNET, &m_fdinfo->m_sockinfo.m_ipv4info.m_fields.m_sip, sizeof(uint32_t)) ||
+			match_ipnet_values(PT_IPNET, &m_fdinfo->m_sockinfo.m_ipv4info.m_fields.m_dip, sizeof(uint32_t));
+	case SCAP_FD_IPV6_SOCK:
+		return match_ipnet_values(PT_IPNET, &m_fdinfo->m_sockinfo.m_ipv6info.m_fields.m_sip, sizeof(ipv6addr)) ||
+			match_ipnet_values(PT_IPNET, &m_fdinfo->m_sockinfo.m_ipv6info.m_fields.m_dip, sizeof(ipv6addr));
+	default:
+		return false;
+	}
+}
+
 bool sinsp_filter_check_fd::compare_port(sinsp_evt *evt)
 {
 	if(!extract_fd(evt))
@@ -1787,15 +1824,15 @@ bool sinsp_filter_check_fd::extract_fd(sinsp_evt *evt)
 
 		if (m_argid != -1)
 		{
-			m_fdinfo = m_tinfo->get_fd(m_argid);
+			m_fdinfo = evt->find_fd(m_argid);
 		}
 		else
 		{
 			m_fdinfo = evt->get_fd_info();
 
-			if (m_fdinfo == NULL && m_tinfo->m_lastevent_fd != -1)
+			if (m_fdinfo == NULL && evt->get_thread_lastevent_fd() != -1)
 			{
-				m_fdinfo = m_tinfo->get_fd(m_tinfo->m_lastevent_fd);
+				m_fdinfo = evt->find_fd(evt->get_thread_lastevent_fd());
 			}
 		}
 		// We'll check if fd is null below
@@ -1808,6 +1845,47 @@ bool sinsp_filter_check_fd::extract_fd(sinsp_evt *evt)
 	return true;
 }
 
+bool sinsp_filter_check_fd::has_default_compare() const
+{
+	switch(m_field_id)
+	{
+	case TYPE_IP:
+	case TYPE_PORT:
+	case TYPE_PROTO:
+	case TYPE_NET:
+	case TYPE_CLIENTIP_NAME:
+	case TYPE_SERVERIP_NAME:
+	case TYPE_LIP_NAME:
+	case TYPE_RIP_NAME:
+		return false;
+	default:
+		return sinsp_filter_check::has_default_compare();
+	}
+}
+
+bool sinsp_filter_check_fd::is_thread_safe() const
+{
+	switch(m_field_id)
+	{
+	// the local interfaces of the containers are looked up in the
+	// container manager
+	case TYPE_LNET:
+	case TYPE_RNET:
+	case TYPE_LIP:
+	case TYPE_RIP:
+	case TYPE_LIP_NAME:
+	case TYPE_RIP_NAME:
+	case TYPE_LPORT:
+	case TYPE_RPORT:
+	case TYPE_LPROTO:
+	case TYPE_RPROTO:
+	case TYPE_IS_SERVER:
+		return false;
+	default:
+		return true;
+	}
+}
+
 bool sinsp_filter_check_fd::compare_nocache(sinsp_evt *evt)
 {
 	//
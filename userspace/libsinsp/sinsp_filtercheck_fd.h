@@ -77,9 +77,12 @@ public:
 	std::unique_ptr<sinsp_filter_check> allocate_new() override;
 	int32_t parse_field_name(std::string_view, bool alloc_state, bool needed_for_filtering) override;
 	bool extract(sinsp_evt*, std::vector<extract_value_t>& values, bool sanitize_strings = true) override;
+	bool has_default_compare() const override;
+	bool is_thread_safe() const override;
 
 protected:
 	uint8_t* extract_single(sinsp_evt*, uint32_t* len, bool sanitize_strings = true) override;
+	bool extracts_single_value() const override;
 	bool compare_nocache(sinsp_evt*) override;
 
 private:
@@ -90,6 +93,7 @@ private:
 
 	bool compare_ip(sinsp_evt *evt);
 	bool compare_net(sinsp_evt *evt);
+	bool compare_net_in();
 	bool compare_port(sinsp_evt *evt);
 	bool compare_domain(sinsp_evt *evt);
 
@@ -101,6 +105,7 @@ private:
 
 	union {
 		uint32_t u32;
+		int64_t s64;
 		uint64_t u64;
 	} m_val;
 };
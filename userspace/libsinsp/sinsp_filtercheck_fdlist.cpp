@@ -93,7 +93,7 @@ uint8_t* sinsp_filter_check_fdlist::extract_single(sinsp_evt *evt, uint32_t* len
 		bool add_comma = true;
 		int64_t fd = *(int64_t *)(payload + pos);
 
-		sinsp_fdinfo *fdinfo = tinfo ? tinfo->get_fd(fd) : NULL;
+		sinsp_fdinfo *fdinfo = tinfo ? evt->find_fd(fd) : NULL;
 
 		switch(m_field_id)
 		{
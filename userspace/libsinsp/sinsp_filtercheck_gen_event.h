@@ -49,6 +49,10 @@ public:
 	virtual ~sinsp_filter_check_gen_event() = default;
 
 	std::unique_ptr<sinsp_filter_check> allocate_new() override;
+	bool is_thread_safe() const override
+	{
+		return true;
+	}
 
 protected:
 	uint8_t* extract_single(sinsp_evt*, uint32_t* len, bool sanitize_strings = true) override;
@@ -27,6 +27,10 @@ public:
 	virtual ~rawstring_check() = default;
 
 	std::unique_ptr<sinsp_filter_check> allocate_new() override;
+	bool is_thread_safe() const override
+	{
+		return true;
+	}
 	int32_t parse_field_name(std::string_view, bool alloc_state, bool needed_for_filtering) override;
 	uint8_t* extract_single(sinsp_evt*, uint32_t* len, bool sanitize_strings = true) override;
 
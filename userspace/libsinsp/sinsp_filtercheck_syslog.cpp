@@ -70,7 +70,7 @@ std::unique_ptr<sinsp_filter_check> sinsp_filter_check_syslog::allocate_new()
 uint8_t* sinsp_filter_check_syslog::extract_single(sinsp_evt *evt, uint32_t* len, bool sanitize_strings)
 {
 	*len = 0;
-	auto& decoder = m_inspector->get_parser()->get_syslog_decoder();
+	auto& decoder = evt->get_syslog_decoder();
 	if (!decoder.is_data_valid())
 	{
 		return NULL;
@@ -523,6 +523,11 @@ inline bool should_extract_xid(int64_t xid)
 	return xid >= -1 && xid <= UINT32_MAX;
 }
 
+bool sinsp_filter_check_thread::extracts_single_value() const
+{
+	return true;
+}
+
 uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len, bool sanitize_strings)
 {
 	*len = 0;
@@ -565,11 +570,10 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				// `threadinfo` lookup only applies when the process is running on the host and not in a pid
 				// namespace. However, if the process is running in a pid namespace, we instead traverse the process
 				// lineage until we find a match.
-				sinsp_threadinfo* sinfo = m_inspector->get_thread_ref(sid, false, true).get();
+				sinsp_threadinfo* sinfo = tinfo->lookup_thread(sid);
 				if(sinfo != NULL)
 				{
-					m_tstr = sinfo->get_comm();
-					RETURN_EXTRACT_STRING(m_tstr);
+					RETURN_EXTRACT_STRING(sinfo->get_comm());
 				}
 			}
 
@@ -594,8 +598,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 
 			// session_leader has been updated to the highest process that has the same session id.
 			// session_leader's comm is considered the session leader.
-			m_tstr = session_leader->get_comm();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(session_leader->get_comm());
 		}
 	case TYPE_SID_EXE:
 		{
@@ -607,11 +610,10 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				// `threadinfo` lookup only applies when the process is running on the host and not in a pid
 				// namespace. However, if the process is running in a pid namespace, we instead traverse the process
 				// lineage until we find a match.
-				sinsp_threadinfo* sinfo = m_inspector->get_thread_ref(sid, false, true).get();
+				sinsp_threadinfo* sinfo = tinfo->lookup_thread(sid);
 				if(sinfo != NULL)
 				{
-					m_tstr = sinfo->get_exe();
-					RETURN_EXTRACT_STRING(m_tstr);
+					RETURN_EXTRACT_STRING(sinfo->get_exe());
 				}
 			}
 
@@ -636,8 +638,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 
 			// session_leader has been updated to the highest process that has the same session id.
 			// session_leader's exe is considered the session leader.
-			m_tstr = session_leader->get_exe();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(session_leader->get_exe());
 		}
 	case TYPE_SID_EXEPATH:
 		{
@@ -649,11 +650,10 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				// `threadinfo` lookup only applies when the process is running on the host and not in a pid
 				// namespace. However, if the process is running in a pid namespace, we instead traverse the process
 				// lineage until we find a match.
-				sinsp_threadinfo* sinfo = m_inspector->get_thread_ref(sid, false, true).get();
+				sinsp_threadinfo* sinfo = tinfo->lookup_thread(sid);
 				if(sinfo != NULL)
 				{
-					m_tstr = sinfo->get_exepath();
-					RETURN_EXTRACT_STRING(m_tstr);
+					RETURN_EXTRACT_STRING(sinfo->get_exepath());
 				}
 			}
 
@@ -678,8 +678,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 
 			// session_leader has been updated to the highest process that has the same session id.
 			// session_leader's exepath is considered the session leader.
-			m_tstr = session_leader->get_exepath();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(session_leader->get_exepath());
 		}
 	case TYPE_VPGID_NAME:
 		{
@@ -691,11 +690,10 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				// `threadinfo` lookup only applies when the process is running on the host and not in a pid
 				// namespace. However, if the process is running in a pid namespace, we instead traverse the process
 				// lineage until we find a match.
-				sinsp_threadinfo* vpgidinfo = m_inspector->get_thread_ref(vpgid, false, true).get();
+				sinsp_threadinfo* vpgidinfo = tinfo->lookup_thread(vpgid);
 				if(vpgidinfo != NULL)
 				{
-					m_tstr = vpgidinfo->get_comm();
-					RETURN_EXTRACT_STRING(m_tstr);
+					RETURN_EXTRACT_STRING(vpgidinfo->get_comm());
 				}
 			}
 			// This can occur when the process group leader process has exited or if the process
@@ -719,8 +717,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 
 			// group_leader has been updated to the highest process that has the same process group id.
 			// group_leader's comm is considered the process group leader.
-			m_tstr = group_leader->get_comm();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(group_leader->get_comm());
 		}
 	case TYPE_VPGID_EXE:
 		{
@@ -732,11 +729,10 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				// `threadinfo` lookup only applies when the process is running on the host and not in a pid
 				// namespace. However, if the process is running in a pid namespace, we instead traverse the process
 				// lineage until we find a match.
-				sinsp_threadinfo* vpgidinfo = m_inspector->get_thread_ref(vpgid, false, true).get();
+				sinsp_threadinfo* vpgidinfo = tinfo->lookup_thread(vpgid);
 				if(vpgidinfo != NULL)
 				{
-					m_tstr = vpgidinfo->get_exe();
-					RETURN_EXTRACT_STRING(m_tstr);
+					RETURN_EXTRACT_STRING(vpgidinfo->get_exe());
 				}
 			}
 			// This can occur when the process group leader process has exited or if the process
@@ -760,8 +756,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 
 			// group_leader has been updated to the highest process that has the same process group id.
 			// group_leader's exe is considered the process group leader.
-			m_tstr = group_leader->get_exe();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(group_leader->get_exe());
 
 		}
 	case TYPE_VPGID_EXEPATH:
@@ -774,11 +769,10 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				// `threadinfo` lookup only applies when the process is running on the host and not in a pid
 				// namespace. However, if the process is running in a pid namespace, we instead traverse the process
 				// lineage until we find a match.
-				sinsp_threadinfo* vpgidinfo = m_inspector->get_thread_ref(vpgid, false, true).get();
+				sinsp_threadinfo* vpgidinfo = tinfo->lookup_thread(vpgid);
 				if(vpgidinfo != NULL)
 				{
-					m_tstr = vpgidinfo->get_exepath();
-					RETURN_EXTRACT_STRING(m_tstr);
+					RETURN_EXTRACT_STRING(vpgidinfo->get_exepath());
 				}
 			}
 
@@ -803,30 +797,27 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 
 			// group_leader has been updated to the highest process that has the same process group id.
 			// group_leader's exepath is considered the process group leader.
-			m_tstr = group_leader->get_exepath();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(group_leader->get_exepath());
 		}
 	case TYPE_TTY:
 		RETURN_EXTRACT_VAR(tinfo->m_tty);
 	case TYPE_NAME:
-		m_tstr = tinfo->get_comm();
-		RETURN_EXTRACT_STRING(m_tstr);
+		RETURN_EXTRACT_STRING(tinfo->get_comm());
 	case TYPE_EXE:
-		m_tstr = tinfo->get_exe();
-		RETURN_EXTRACT_STRING(m_tstr);
+		RETURN_EXTRACT_STRING(tinfo->get_exe());
 	case TYPE_EXEPATH:
-		m_tstr = tinfo->get_exepath();
-		RETURN_EXTRACT_STRING(m_tstr);
+		RETURN_EXTRACT_STRING(tinfo->get_exepath());
 	case TYPE_ARGS:
 		{
 			m_tstr.clear();
 
+			const auto& args = tinfo->get_args();
 			uint32_t j;
-			uint32_t nargs = (uint32_t)tinfo->m_args.size();
+			uint32_t nargs = (uint32_t)args.size();
 
 			for(j = 0; j < nargs; j++)
 			{
-				m_tstr += tinfo->m_args[j];
+				m_tstr += args[j];
 				if(j < nargs -1)
 				{
 					m_tstr += ' ';
@@ -923,14 +914,16 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 		}
 	case TYPE_EXELINE:
 		{
-			m_tstr = tinfo->get_exe() + " ";
+			m_tstr = tinfo->get_exe();
+			m_tstr += ' ';
 
+			const auto& args = tinfo->get_args();
 			uint32_t j;
-			uint32_t nargs = (uint32_t)tinfo->m_args.size();
+			uint32_t nargs = (uint32_t)args.size();
 
 			for(j = 0; j < nargs; j++)
 			{
-				m_tstr += tinfo->m_args[j];
+				m_tstr += args[j];
 				if(j < nargs -1)
 				{
 					m_tstr += ' ';
@@ -940,8 +933,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 			RETURN_EXTRACT_STRING(m_tstr);
 		}
 	case TYPE_CWD:
-		m_tstr = tinfo->get_cwd();
-		RETURN_EXTRACT_STRING(m_tstr);
+		RETURN_EXTRACT_STRING(tinfo->get_cwd());
 	case TYPE_NTHREADS:
 		{
 			m_val.u64 = tinfo->get_num_threads();
@@ -1022,13 +1014,11 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 		}
 	case TYPE_PNAME:
 		{
-			sinsp_threadinfo* ptinfo =
-				m_inspector->get_thread_ref(tinfo->m_ptid, false, true).get();
+			sinsp_threadinfo* ptinfo = tinfo->lookup_thread(tinfo->m_ptid);
 
 			if(ptinfo != NULL)
 			{
-				m_tstr = ptinfo->get_comm();
-				RETURN_EXTRACT_STRING(m_tstr);
+				RETURN_EXTRACT_STRING(ptinfo->get_comm());
 			}
 			else
 			{
@@ -1037,8 +1027,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 		}
 	case TYPE_PCMDLINE:
 		{
-			sinsp_threadinfo* ptinfo =
-				m_inspector->get_thread_ref(tinfo->m_ptid, false, true).get();
+			sinsp_threadinfo* ptinfo = tinfo->lookup_thread(tinfo->m_ptid);
 
 			if(ptinfo != NULL)
 			{
@@ -1145,18 +1134,15 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				}
 			}
 
-			m_tstr = mt->get_comm();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(mt->get_comm());
 		}
 	case TYPE_PEXE:
 		{
-			sinsp_threadinfo* ptinfo =
-				m_inspector->get_thread_ref(tinfo->m_ptid, false, true).get();
+			sinsp_threadinfo* ptinfo = tinfo->lookup_thread(tinfo->m_ptid);
 
 			if(ptinfo != NULL)
 			{
-				m_tstr = ptinfo->get_exe();
-				RETURN_EXTRACT_STRING(m_tstr);
+				RETURN_EXTRACT_STRING(ptinfo->get_exe());
 			}
 			else
 			{
@@ -1191,18 +1177,15 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				}
 			}
 
-			m_tstr = mt->get_exe();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(mt->get_exe());
 		}
 	case TYPE_PEXEPATH:
 		{
-			sinsp_threadinfo* ptinfo =
-				m_inspector->get_thread_ref(tinfo->m_ptid, false, true).get();
+			sinsp_threadinfo* ptinfo = tinfo->lookup_thread(tinfo->m_ptid);
 
 			if(ptinfo != NULL)
 			{
-				m_tstr = ptinfo->get_exepath();
-				RETURN_EXTRACT_STRING(m_tstr);
+				RETURN_EXTRACT_STRING(ptinfo->get_exepath());
 			}
 			else
 			{
@@ -1237,8 +1220,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 				}
 			}
 
-			m_tstr = mt->get_exepath();
-			RETURN_EXTRACT_STRING(m_tstr);
+			RETURN_EXTRACT_STRING(mt->get_exepath());
 		}
 	case TYPE_LOGINSHELLID:
 		{
@@ -1292,8 +1274,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 		}
 	case TYPE_PPID_DURATION:
 		{
-			sinsp_threadinfo* ptinfo =
-				m_inspector->get_thread_ref(tinfo->m_ptid, false, true).get();
+			sinsp_threadinfo* ptinfo = tinfo->lookup_thread(tinfo->m_ptid);
 
 			if(ptinfo != NULL)
 			{
@@ -1310,13 +1291,13 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 			}
 		}
 	case TYPE_FDOPENCOUNT:
-		m_val.u64 = tinfo->get_fd_opencount();
+		m_val.u64 = evt->get_fd_opencount();
 		RETURN_EXTRACT_VAR(m_val.u64);
 	case TYPE_FDLIMIT:
 		m_val.s64 = tinfo->get_fd_limit();
 		RETURN_EXTRACT_VAR(m_val.s64);
 	case TYPE_FDUSAGE:
-		m_val.d = tinfo->get_fd_usage_pct_d();
+		m_val.d = tinfo->get_fd_usage_pct_d(evt->get_fd_opencount());
 		RETURN_EXTRACT_VAR(m_val.d);
 	case TYPE_VMSIZE:
 		m_val.u64 = tinfo->m_vmsize_kb;
@@ -1380,7 +1361,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 	case TYPE_CGROUPS:
 		{
 			m_tstr.clear();
-			auto cgroups = tinfo->cgroups();
+			const auto& cgroups = tinfo->cgroups();
 
 			uint32_t j;
 			uint32_t nargs = (uint32_t)cgroups.size();
@@ -1488,7 +1469,8 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 			return extract_thread_cpu(evt, len, tinfo, false, true);
 		}
 	case TYPE_NAMETID:
-		m_tstr = tinfo->get_comm() + to_string(evt->get_tid());
+		m_tstr = tinfo->get_comm();
+		m_tstr += to_string(evt->get_tid());
 		RETURN_EXTRACT_STRING(m_tstr);
 	case TYPE_IS_CONTAINER_HEALTHCHECK:
 		m_val.u32 = (tinfo->m_category == sinsp_threadinfo::CAT_HEALTHCHECK);
@@ -1525,26 +1507,26 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 		RETURN_EXTRACT_STRING(m_tstr);
 	case TYPE_CMDNARGS:
 		{
-			m_val.u64 = (uint32_t)tinfo->m_args.size();
+			m_val.u64 = (uint32_t)tinfo->get_args().size();
 			RETURN_EXTRACT_VAR(m_val.u64);
 		}
 	case TYPE_CMDLENARGS:
 		{
 			m_val.u64 = 0;
+			const auto& args = tinfo->get_args();
 			uint32_t j;
-			uint32_t nargs = (uint32_t)tinfo->m_args.size();
+			uint32_t nargs = (uint32_t)args.size();
 
 			for(j = 0; j < nargs; j++)
 			{
-				m_val.u64 += tinfo->m_args[j].length();
+				m_val.u64 += args[j].length();
 
 			}
 			RETURN_EXTRACT_VAR(m_val.u64);
 		}
 	case TYPE_PVPID:
 		{
-			sinsp_threadinfo* ptinfo =
-				m_inspector->get_thread_ref(tinfo->m_ptid, false, true).get();
+			sinsp_threadinfo* ptinfo = tinfo->lookup_thread(tinfo->m_ptid);
 
 			if(ptinfo != NULL)
 			{
@@ -1600,8 +1582,7 @@ uint8_t* sinsp_filter_check_thread::extract_single(sinsp_evt *evt, uint32_t* len
 		RETURN_EXTRACT_VAR(tinfo->m_clone_ts);
 	case TYPE_PPID_CLONE_TS:
 		{
-			sinsp_threadinfo* ptinfo =
-				m_inspector->get_thread_ref(tinfo->m_ptid, false, true).get();
+			sinsp_threadinfo* ptinfo = tinfo->lookup_thread(tinfo->m_ptid);
 
 			if(ptinfo != NULL)
 			{
@@ -1937,6 +1918,48 @@ bool sinsp_filter_check_thread::compare_full_aenv(sinsp_evt *evt)
 	return found;
 }
 
+bool sinsp_filter_check_thread::has_default_compare() const
+{
+	switch(m_field_id)
+	{
+	case TYPE_APID:
+	case TYPE_ANAME:
+	case TYPE_AEXE:
+	case TYPE_AEXEPATH:
+	case TYPE_ACMDLINE:
+		// all the ancestors are compared one by one
+		if(m_argid == -1)
+		{
+			return false;
+		}
+		break;
+	case TYPE_AENV:
+		if(m_argname.empty())
+		{
+			return false;
+		}
+		break;
+	default:
+		break;
+	}
+	return sinsp_filter_check::has_default_compare();
+}
+
+bool sinsp_filter_check_thread::is_thread_safe() const
+{
+	switch(m_field_id)
+	{
+	// accumulated in the dynamic fields of the thread
+	case TYPE_TOTEXECTIME:
+	case TYPE_THREAD_CPU:
+	case TYPE_THREAD_CPU_USER:
+	case TYPE_THREAD_CPU_SYSTEM:
+		return false;
+	default:
+		return true;
+	}
+}
+
 bool sinsp_filter_check_thread::compare_nocache(sinsp_evt *evt)
 {
 	if(m_field_id == TYPE_APID)
@@ -115,9 +115,12 @@ public:
 	int32_t parse_field_name(std::string_view, bool alloc_state, bool needed_for_filtering) override;
 
 	int32_t get_argid() const;
+	bool has_default_compare() const override;
+	bool is_thread_safe() const override;
 
 protected:
 	uint8_t* extract_single(sinsp_evt*, uint32_t* len, bool sanitize_strings = true) override;
+	bool extracts_single_value() const override;
 	bool compare_nocache(sinsp_evt*) override;
 
 private:
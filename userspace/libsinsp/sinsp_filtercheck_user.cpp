@@ -117,3 +117,9 @@ uint8_t* sinsp_filter_check_user::extract_single(sinsp_evt *evt, uint32_t* len,
 
 	return NULL;
 }
+
+bool sinsp_filter_check_user::is_thread_safe() const
+{
+	// the user of the container events comes from the container manager
+	return m_field_id != TYPE_NAME;
+}
@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/sinsp_pipeline.h>
+
+#include <cinttypes>
+
+sinsp_pipeline::sinsp_pipeline(sinsp* inspector,
+			       uint32_t n_workers,
+			       const filter_factory& filters,
+			       const formatter_factory& formatters,
+			       output_callback on_output,
+			       uint32_t queue_size):
+	m_inspector(inspector),
+	m_on_output(std::move(on_output)),
+	m_queue_size(queue_size > 0 ? queue_size : 1),
+	m_n_in_flight(0),
+	m_stopped(false),
+	m_n_published(0),
+	m_n_matched(0)
+{
+	if(n_workers == 0)
+	{
+		throw sinsp_exception("the pipeline needs at least one worker");
+	}
+
+	// build all the filters before starting any thread, the factories
+	// are not required to be thread safe
+	for(uint32_t j = 0; j < n_workers; j++)
+	{
+		auto w = std::make_unique<worker>();
+		if(filters)
+		{
+			w->m_filter = filters();
+		}
+		if(formatters)
+		{
+			w->m_formatter = formatters();
+		}
+		m_workers.push_back(std::move(w));
+	}
+
+	for(auto& w : m_workers)
+	{
+		w->m_thread = std::thread(&sinsp_pipeline::run_worker, this, w.get());
+	}
+}
+
+sinsp_pipeline::~sinsp_pipeline()
+{
+	stop();
+}
+
+int32_t sinsp_pipeline::next()
+{
+	if(m_stopped)
+	{
+		throw sinsp_exception("next() called on a stopped pipeline");
+	}
+
+	sinsp_evt* evt = nullptr;
+	std::unique_ptr<sinsp_evt> snapshot;
+	int32_t res;
+	{
+		std::lock_guard<std::mutex> lock(m_state_mtx);
+		res = m_inspector->next(&evt);
+		if(res == SCAP_SUCCESS)
+		{
+			snapshot = evt->snapshot();
+		}
+	}
+
+	// the workers may need the state lock to drain the queue
+	if(snapshot != nullptr)
+	{
+		publish(std::move(snapshot));
+	}
+	return res;
+}
+
+void sinsp_pipeline::publish(std::unique_ptr<sinsp_evt> evt)
+{
+	std::unique_lock<std::mutex> lock(m_queue_mtx);
+	m_queue_not_full.wait(lock, [this] { return m_queue.size() < m_queue_size; });
+	m_queue.push_back(std::move(evt));
+	m_n_in_flight++;
+	m_n_published++;
+	lock.unlock();
+	m_queue_not_empty.notify_one();
+}
+
+void sinsp_pipeline::flush()
+{
+	std::unique_lock<std::mutex> lock(m_queue_mtx);
+	m_queue_drained.wait(lock, [this] { return m_n_in_flight == 0; });
+}
+
+void sinsp_pipeline::stop()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_queue_mtx);
+		if(m_stopped)
+		{
+			return;
+		}
+		m_stopped = true;
+	}
+	m_queue_not_empty.notify_all();
+
+	for(auto& w : m_workers)
+	{
+		if(w->m_thread.joinable())
+		{
+			w->m_thread.join();
+		}
+	}
+}
+
+void sinsp_pipeline::run_worker(worker* w)
+{
+	std::string output;
+	sinsp_filter_check::set_state_lock(&m_state_mtx);
+
+	while(true)
+	{
+		std::unique_ptr<sinsp_evt> evt;
+		{
+			std::unique_lock<std::mutex> lock(m_queue_mtx);
+			// the pending events are evaluated also after stop()
+			m_queue_not_empty.wait(lock, [this] { return !m_queue.empty() || m_stopped; });
+			if(m_queue.empty())
+			{
+				sinsp_filter_check::set_state_lock(nullptr);
+				return;
+			}
+			evt = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+		m_queue_not_full.notify_one();
+
+		try
+		{
+			if(!w->m_filter || w->m_filter->run(evt.get()))
+			{
+				output.clear();
+				if(w->m_formatter)
+				{
+					w->m_formatter->tostring(evt.get(), output);
+				}
+				m_n_matched++;
+				if(m_on_output)
+				{
+					m_on_output(evt.get(), output);
+				}
+			}
+		}
+		catch(const sinsp_exception& e)
+		{
+			libsinsp_logger()->format(sinsp_logger::SEV_ERROR,
+						  "pipeline: error evaluating event %" PRIu64 ": %s",
+						  evt->get_num(), e.what());
+		}
+		evt.reset();
+
+		std::unique_lock<std::mutex> lock(m_queue_mtx);
+		if(--m_n_in_flight == 0)
+		{
+			m_queue_drained.notify_all();
+		}
+	}
+}
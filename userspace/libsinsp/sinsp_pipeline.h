@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <libsinsp/sinsp.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+  \brief Runs the state engine and the filter evaluation on different threads.
+
+  The thread calling next() parses the events with sinsp::next(), in order,
+  and publishes a snapshot of every event (see sinsp_evt::snapshot()) to a
+  pool of worker threads. Every worker owns its own filter and formatter,
+  built with the given factories, and calls the output callback for the
+  events matching its filter. Events are evaluated out of order.
+
+  The snapshot freezes the event, its thread info and its fd info, together
+  with the threads the fields can reach from it (e.g. the parent and the
+  ancestors of the process), so the workers never read the thread table.
+  The thread snapshots are immutable and shared by the events until the
+  state of the threads changes, see sinsp_threadinfo::snapshot().
+
+  Only the thread safe fields (see sinsp_filter_check::is_thread_safe())
+  are extracted concurrently with the parsing. The others, e.g. the plugin
+  fields and the fields reading the container tables, are extracted holding
+  a lock that next() holds while parsing, see
+  sinsp_filter_check::set_state_lock().
+*/
+class SINSP_PUBLIC sinsp_pipeline
+{
+public:
+	typedef std::function<std::unique_ptr<sinsp_filter>()> filter_factory;
+	typedef std::function<std::unique_ptr<sinsp_evt_formatter>()> formatter_factory;
+
+	/*!
+	  \brief Called from the worker threads for every event matching the filter,
+	  `output` is empty when there is no formatter. Must be thread safe.
+	*/
+	typedef std::function<void(sinsp_evt* evt, const std::string& output)> output_callback;
+
+	/*!
+	  \param inspector an opened inspector, owned by the caller.
+	  \param n_workers number of worker threads, at least 1.
+	  \param filters builds the filter of every worker, a null filter matches all the events.
+	  \param formatters builds the formatter of every worker, can be empty.
+	  \param on_output see output_callback.
+	  \param queue_size maximum number of events waiting for a worker, next()
+	   blocks when the queue is full.
+	*/
+	sinsp_pipeline(sinsp* inspector,
+		       uint32_t n_workers,
+		       const filter_factory& filters,
+		       const formatter_factory& formatters,
+		       output_callback on_output,
+		       uint32_t queue_size = 4096);
+	~sinsp_pipeline();
+
+	sinsp_pipeline(const sinsp_pipeline&) = delete;
+	sinsp_pipeline& operator=(const sinsp_pipeline&) = delete;
+
+	/*!
+	  \brief Parse the next event and publish it to the workers.
+
+	  \return the result of sinsp::next().
+	*/
+	int32_t next();
+
+	/*!
+	  \brief Wait until all the published events have been evaluated.
+	*/
+	void flush();
+
+	/*!
+	  \brief Wait for the pending events and stop the workers, next() can't be
+	  called anymore. Called by the destructor.
+	*/
+	void stop();
+
+	inline uint64_t get_num_published() const
+	{
+		return m_n_published;
+	}
+
+	inline uint64_t get_num_matched() const
+	{
+		return m_n_matched;
+	}
+
+private:
+	struct worker
+	{
+		std::unique_ptr<sinsp_filter> m_filter;
+		std::unique_ptr<sinsp_evt_formatter> m_formatter;
+		std::thread m_thread;
+	};
+
+	void publish(std::unique_ptr<sinsp_evt> evt);
+	void run_worker(worker* w);
+
+	sinsp* m_inspector;
+	output_callback m_on_output;
+	size_t m_queue_size;
+	std::vector<std::unique_ptr<worker>> m_workers;
+
+	// held while parsing and while extracting the fields that are not
+	// thread safe
+	std::mutex m_state_mtx;
+
+	std::mutex m_queue_mtx;
+	std::condition_variable m_queue_not_empty;
+	std::condition_variable m_queue_not_full;
+	std::condition_variable m_queue_drained;
+	std::deque<std::unique_ptr<sinsp_evt>> m_queue;
+	uint64_t m_n_in_flight;
+	// written with m_queue_mtx held, also read by next() without it
+	std::atomic<bool> m_stopped;
+
+	uint64_t m_n_published;
+	std::atomic<uint64_t> m_n_matched;
+};
@@ -57,7 +57,7 @@ bool libsinsp::sinsp_suppress::check_suppressed_comm(uint64_t tid, const std::st
 
 int32_t libsinsp::sinsp_suppress::process_event(scap_evt *e)
 {
-	if(m_suppressed_tids.empty() && m_suppressed_comms.empty())
+	if(!is_enabled())
 	{
 		// nothing to suppress
 		return SCAP_SUCCESS;
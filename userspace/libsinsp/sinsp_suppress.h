@@ -46,6 +46,8 @@ public:
 
 	bool is_suppressed_tid(uint64_t tid) const;
 
+	bool is_enabled() const { return !m_suppressed_tids.empty() || !m_suppressed_comms.empty(); }
+
 	uint64_t get_num_suppressed_events() const { return m_num_suppressed_events; }
 
 	uint64_t get_num_suppressed_tids() const { return m_suppressed_tids.size(); }
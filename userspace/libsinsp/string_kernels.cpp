@@ -0,0 +1,486 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/string_kernels.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define STRING_KERNELS_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define STRING_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define STRING_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+typedef const char* (*find_fn)(const char*, size_t, const char*, size_t);
+typedef bool (*iequals_fn)(const char*, const char*, size_t);
+
+struct kernels
+{
+	const char* name;
+	find_fn find;
+	find_fn ifind;
+	iequals_fn iequals;
+};
+
+inline uint32_t lowest_bit(uint64_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long res;
+	_BitScanForward64(&res, mask);
+	return res;
+#else
+	return __builtin_ctzll(mask);
+#endif
+}
+
+inline uint8_t fold(uint8_t c)
+{
+	return (uint8_t)(c - 'A') < 26 ? c | 0x20 : c;
+}
+
+//
+// Scalar kernels, also used for the tails of the vectorized ones. The
+// searches start from the position "from" of the haystack.
+//
+
+bool scalar_iequals(const char* a, const char* b, size_t len)
+{
+	for(size_t i = 0; i < len; i++)
+	{
+		if(fold(a[i]) != fold(b[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+const char* scalar_find_from(const char* s, size_t len, const char* needle, size_t n, size_t from)
+{
+	if(n == 0)
+	{
+		return s;
+	}
+	while(from + n <= len)
+	{
+		auto p = (const char*)memchr(s + from, needle[0], len - n - from + 1);
+		if(p == nullptr)
+		{
+			return nullptr;
+		}
+		if(memcmp(p + 1, needle + 1, n - 1) == 0)
+		{
+			return p;
+		}
+		from = p - s + 1;
+	}
+	return nullptr;
+}
+
+const char* scalar_ifind_from(const char* s, size_t len, const char* needle, size_t n, size_t from)
+{
+	if(n == 0)
+	{
+		return s;
+	}
+	uint8_t first = fold(needle[0]);
+	for(size_t i = from; i + n <= len; i++)
+	{
+		if(fold(s[i]) == first && scalar_iequals(s + i + 1, needle + 1, n - 1))
+		{
+			return s + i;
+		}
+	}
+	return nullptr;
+}
+
+const char* scalar_find(const char* s, size_t len, const char* needle, size_t n)
+{
+	return scalar_find_from(s, len, needle, n, 0);
+}
+
+const char* scalar_ifind(const char* s, size_t len, const char* needle, size_t n)
+{
+	return scalar_ifind_from(s, len, needle, n, 0);
+}
+
+#ifdef STRING_KERNELS_SSE2
+
+// lowercases the ASCII letters, i.e. the bytes with x - 'A' < 26
+inline __m128i sse2_fold(__m128i x)
+{
+	__m128i t = _mm_sub_epi8(x, _mm_set1_epi8((char)('A' + 128)));
+	__m128i upper = _mm_cmplt_epi8(t, _mm_set1_epi8(-128 + 26));
+	return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+inline __m128i sse2_load(const char* p)
+{
+	return _mm_loadu_si128((const __m128i*)p);
+}
+
+const char* sse2_find(const char* s, size_t len, const char* needle, size_t n)
+{
+	if(n < 2 || len < n - 1 + 16)
+	{
+		return scalar_find(s, len, needle, n);
+	}
+
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[n - 1]);
+	const size_t end = len - n + 1;
+	for(size_t i = 0; i < end; )
+	{
+		size_t pos = std::min(i, end - 16);
+		__m128i a = sse2_load(s + pos);
+		__m128i b = sse2_load(s + pos + n - 1);
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))) >> (i - pos);
+		while(mask != 0)
+		{
+			auto bit = lowest_bit(mask);
+			if(memcmp(s + i + bit + 1, needle + 1, n - 2) == 0)
+			{
+				return s + i + bit;
+			}
+			mask &= mask - 1;
+		}
+		i = pos + 16;
+	}
+	return nullptr;
+}
+
+const char* sse2_ifind(const char* s, size_t len, const char* needle, size_t n)
+{
+	if(n < 2 || len < n - 1 + 16)
+	{
+		return scalar_ifind(s, len, needle, n);
+	}
+
+	const __m128i first = _mm_set1_epi8(fold(needle[0]));
+	const __m128i last = _mm_set1_epi8(fold(needle[n - 1]));
+	const size_t end = len - n + 1;
+	for(size_t i = 0; i < end; )
+	{
+		size_t pos = std::min(i, end - 16);
+		__m128i a = sse2_fold(sse2_load(s + pos));
+		__m128i b = sse2_fold(sse2_load(s + pos + n - 1));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))) >> (i - pos);
+		while(mask != 0)
+		{
+			auto bit = lowest_bit(mask);
+			if(scalar_iequals(s + i + bit + 1, needle + 1, n - 2))
+			{
+				return s + i + bit;
+			}
+			mask &= mask - 1;
+		}
+		i = pos + 16;
+	}
+	return nullptr;
+}
+
+bool sse2_iequals(const char* a, const char* b, size_t len)
+{
+	size_t i = 0;
+	for(; i + 16 <= len; i += 16)
+	{
+		__m128i x = sse2_fold(_mm_loadu_si128((const __m128i*)(a + i)));
+		__m128i y = sse2_fold(_mm_loadu_si128((const __m128i*)(b + i)));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff)
+		{
+			return false;
+		}
+	}
+	return scalar_iequals(a + i, b + i, len - i);
+}
+
+#endif // STRING_KERNELS_SSE2
+
+#ifdef STRING_KERNELS_AVX2
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET inline __m256i avx2_fold(__m256i x)
+{
+	__m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8((char)('A' + 128)));
+	__m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26), t);
+	return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+AVX2_TARGET inline __m256i avx2_load(const char* p)
+{
+	return _mm256_loadu_si256((const __m256i*)p);
+}
+
+AVX2_TARGET const char* avx2_find(const char* s, size_t len, const char* needle, size_t n)
+{
+	// the upper halves of the registers are still clean here
+	if(n < 2 || len < n - 1 + 32)
+	{
+		return sse2_find(s, len, needle, n);
+	}
+
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+	const size_t end = len - n + 1;
+	for(size_t i = 0; i < end; )
+	{
+		size_t pos = std::min(i, end - 32);
+		__m256i a = avx2_load(s + pos);
+		__m256i b = avx2_load(s + pos + n - 1);
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))) >> (i - pos);
+		while(mask != 0)
+		{
+			auto bit = lowest_bit(mask);
+			if(memcmp(s + i + bit + 1, needle + 1, n - 2) == 0)
+			{
+				return s + i + bit;
+			}
+			mask &= mask - 1;
+		}
+		i = pos + 32;
+	}
+	return nullptr;
+}
+
+AVX2_TARGET const char* avx2_ifind(const char* s, size_t len, const char* needle, size_t n)
+{
+	// the upper halves of the registers are still clean here
+	if(n < 2 || len < n - 1 + 32)
+	{
+		return sse2_ifind(s, len, needle, n);
+	}
+
+	const __m256i first = _mm256_set1_epi8(fold(needle[0]));
+	const __m256i last = _mm256_set1_epi8(fold(needle[n - 1]));
+	const size_t end = len - n + 1;
+	for(size_t i = 0; i < end; )
+	{
+		size_t pos = std::min(i, end - 32);
+		__m256i a = avx2_fold(avx2_load(s + pos));
+		__m256i b = avx2_fold(avx2_load(s + pos + n - 1));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))) >> (i - pos);
+		while(mask != 0)
+		{
+			auto bit = lowest_bit(mask);
+			if(scalar_iequals(s + i + bit + 1, needle + 1, n - 2))
+			{
+				return s + i + bit;
+			}
+			mask &= mask - 1;
+		}
+		i = pos + 32;
+	}
+	return nullptr;
+}
+
+AVX2_TARGET bool avx2_iequals(const char* a, const char* b, size_t len)
+{
+	size_t i = 0;
+	for(; i + 32 <= len; i += 32)
+	{
+		__m256i x = avx2_fold(_mm256_loadu_si256((const __m256i*)(a + i)));
+		__m256i y = avx2_fold(_mm256_loadu_si256((const __m256i*)(b + i)));
+		if((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xffffffff)
+		{
+			return false;
+		}
+	}
+	return scalar_iequals(a + i, b + i, len - i);
+}
+
+#endif // STRING_KERNELS_AVX2
+
+#ifdef STRING_KERNELS_NEON
+
+inline uint8x16_t neon_fold(uint8x16_t x)
+{
+	uint8x16_t upper = vcltq_u8(vsubq_u8(x, vdupq_n_u8('A')), vdupq_n_u8(26));
+	return vorrq_u8(x, vandq_u8(upper, vdupq_n_u8(0x20)));
+}
+
+// NEON has no movemask: narrowing the comparison result leaves 4 bits per byte
+inline uint64_t neon_mask(uint8x16_t eq)
+{
+	return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+inline uint8x16_t neon_load(const char* p)
+{
+	return vld1q_u8((const uint8_t*)p);
+}
+
+const char* neon_find(const char* s, size_t len, const char* needle, size_t n)
+{
+	if(n < 2 || len < n - 1 + 16)
+	{
+		return scalar_find(s, len, needle, n);
+	}
+
+	const uint8x16_t first = vdupq_n_u8(needle[0]);
+	const uint8x16_t last = vdupq_n_u8(needle[n - 1]);
+	const size_t end = len - n + 1;
+	for(size_t i = 0; i < end; )
+	{
+		size_t pos = std::min(i, end - 16);
+		uint8x16_t a = neon_load(s + pos);
+		uint8x16_t b = neon_load(s + pos + n - 1);
+		uint64_t mask = neon_mask(vandq_u8(vceqq_u8(a, first), vceqq_u8(b, last))) >> (i - pos) * 4;
+		while(mask != 0)
+		{
+			auto bit = lowest_bit(mask) / 4;
+			if(memcmp(s + i + bit + 1, needle + 1, n - 2) == 0)
+			{
+				return s + i + bit;
+			}
+			mask &= ~(0xfull << (bit * 4));
+		}
+		i = pos + 16;
+	}
+	return nullptr;
+}
+
+const char* neon_ifind(const char* s, size_t len, const char* needle, size_t n)
+{
+	if(n < 2 || len < n - 1 + 16)
+	{
+		return scalar_ifind(s, len, needle, n);
+	}
+
+	const uint8x16_t first = vdupq_n_u8(fold(needle[0]));
+	const uint8x16_t last = vdupq_n_u8(fold(needle[n - 1]));
+	const size_t end = len - n + 1;
+	for(size_t i = 0; i < end; )
+	{
+		size_t pos = std::min(i, end - 16);
+		uint8x16_t a = neon_fold(neon_load(s + pos));
+		uint8x16_t b = neon_fold(neon_load(s + pos + n - 1));
+		uint64_t mask = neon_mask(vandq_u8(vceqq_u8(a, first), vceqq_u8(b, last))) >> (i - pos) * 4;
+		while(mask != 0)
+		{
+			auto bit = lowest_bit(mask) / 4;
+			if(scalar_iequals(s + i + bit + 1, needle + 1, n - 2))
+			{
+				return s + i + bit;
+			}
+			mask &= ~(0xfull << (bit * 4));
+		}
+		i = pos + 16;
+	}
+	return nullptr;
+}
+
+bool neon_iequals(const char* a, const char* b, size_t len)
+{
+	size_t i = 0;
+	for(; i + 16 <= len; i += 16)
+	{
+		uint8x16_t x = neon_fold(vld1q_u8((const uint8_t*)(a + i)));
+		uint8x16_t y = neon_fold(vld1q_u8((const uint8_t*)(b + i)));
+		if(vminvq_u8(vceqq_u8(x, y)) != 0xff)
+		{
+			return false;
+		}
+	}
+	return scalar_iequals(a + i, b + i, len - i);
+}
+
+#endif // STRING_KERNELS_NEON
+
+std::vector<kernels> supported_kernels()
+{
+	std::vector<kernels> res;
+#ifdef STRING_KERNELS_AVX2
+	if(__builtin_cpu_supports("avx2"))
+	{
+		res.push_back({"avx2", avx2_find, avx2_ifind, avx2_iequals});
+	}
+#endif
+#ifdef STRING_KERNELS_SSE2
+	res.push_back({"sse2", sse2_find, sse2_ifind, sse2_iequals});
+#endif
+#ifdef STRING_KERNELS_NEON
+	res.push_back({"neon", neon_find, neon_ifind, neon_iequals});
+#endif
+	res.push_back({"scalar", scalar_find, scalar_ifind, scalar_iequals});
+	return res;
+}
+
+kernels& active_kernels()
+{
+	static kernels k = supported_kernels().front();
+	return k;
+}
+
+}
+
+const char* libsinsp::string_kernels::find(const char* s, size_t len, const char* needle, size_t needle_len)
+{
+	return active_kernels().find(s, len, needle, needle_len);
+}
+
+const char* libsinsp::string_kernels::ifind(const char* s, size_t len, const char* needle, size_t needle_len)
+{
+	return active_kernels().ifind(s, len, needle, needle_len);
+}
+
+bool libsinsp::string_kernels::iequals(const char* a, const char* b, size_t len)
+{
+	return active_kernels().iequals(a, b, len);
+}
+
+const char* libsinsp::string_kernels::implementation()
+{
+	return active_kernels().name;
+}
+
+std::vector<std::string> libsinsp::string_kernels::supported_implementations()
+{
+	std::vector<std::string> res;
+	for(const auto& k : supported_kernels())
+	{
+		res.push_back(k.name);
+	}
+	return res;
+}
+
+bool libsinsp::string_kernels::set_implementation(const std::string& name)
+{
+	for(const auto& k : supported_kernels())
+	{
+		if(name == k.name)
+		{
+			active_kernels() = k;
+			return true;
+		}
+	}
+	return false;
+}
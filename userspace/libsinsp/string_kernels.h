@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//
+// Vectorized string comparison kernels used by the filterchecks. All the
+// functions work on buffers with an explicit length, which don't need to be
+// NUL-terminated. Case-insensitive variants fold ASCII letters only, like
+// strcasestr() and strncasecmp() in the C locale, whatever the current
+// locale and platform are: the bytes >= 0x80 (e.g. UTF-8 sequences or
+// Latin-1 letters) are always compared as they are, so "\xC9" and "\xE9"
+// differ.
+//
+// The substring searches compare the first and the last byte of the needle
+// with 16 (SSE2, NEON) or 32 (AVX2) positions of the haystack at a time, and
+// only verify the whole needle on the positions where both match. The best
+// implementation supported by the CPU is selected at runtime, with a scalar
+// fallback for the other architectures. Case-sensitive equality is left to
+// memcmp(), which the C libraries already vectorize.
+//
+namespace libsinsp {
+namespace string_kernels {
+
+// Returns a pointer to the first occurrence of needle in s, or nullptr
+const char* find(const char* s, size_t len, const char* needle, size_t needle_len);
+
+// Same as find(), ignoring the case of ASCII letters
+const char* ifind(const char* s, size_t len, const char* needle, size_t needle_len);
+
+// Returns true if the two buffers are equal, ignoring the case of ASCII letters
+bool iequals(const char* a, const char* b, size_t len);
+
+inline bool contains(const char* s, size_t len, const char* needle, size_t needle_len)
+{
+	return find(s, len, needle, needle_len) != nullptr;
+}
+
+inline bool icontains(const char* s, size_t len, const char* needle, size_t needle_len)
+{
+	return ifind(s, len, needle, needle_len) != nullptr;
+}
+
+inline bool equals(const char* a, size_t a_len, const char* b, size_t b_len)
+{
+	return a_len == b_len && memcmp(a, b, a_len) == 0;
+}
+
+inline bool iequals(const char* a, size_t a_len, const char* b, size_t b_len)
+{
+	return a_len == b_len && iequals(a, b, a_len);
+}
+
+inline bool starts_with(const char* s, size_t len, const char* prefix, size_t prefix_len)
+{
+	return prefix_len <= len && memcmp(s, prefix, prefix_len) == 0;
+}
+
+inline bool istarts_with(const char* s, size_t len, const char* prefix, size_t prefix_len)
+{
+	return prefix_len <= len && iequals(s, prefix, prefix_len);
+}
+
+inline bool ends_with(const char* s, size_t len, const char* suffix, size_t suffix_len)
+{
+	return suffix_len <= len && memcmp(s + len - suffix_len, suffix, suffix_len) == 0;
+}
+
+inline bool iends_with(const char* s, size_t len, const char* suffix, size_t suffix_len)
+{
+	return suffix_len <= len && iequals(s + len - suffix_len, suffix, suffix_len);
+}
+
+// The name of the implementation in use, e.g. "avx2", "sse2", "neon" or "scalar"
+const char* implementation();
+
+// The implementations supported by the CPU, the best one first
+std::vector<std::string> supported_implementations();
+
+// Switches to one of the supported implementations, mostly for tests and
+// benchmarks. This is not thread-safe. Returns false if not supported.
+bool set_implementation(const std::string& name);
+
+}
+}
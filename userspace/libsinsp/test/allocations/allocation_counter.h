@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace test_helpers
+{
+
+/**
+ * Number of heap allocations made through the global operator new, i.e. by
+ * the standard containers and strings, since the start of the program.
+ *
+ * The counting operator new replaces the global one of the whole binary, so
+ * it is only linked into the allocation tests, which have their own binary.
+ */
+uint64_t num_allocations();
+
+}
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "allocation_counter.h"
+#include "filtercheck_extract.h"
+
+#include <chrono>
+
+// the hot single-valued fields are compared without allocating memory
+TEST_F(filtercheck_extract, no_allocations)
+{
+	auto evt = open_file_event();
+
+	static const std::vector<std::string> conditions = {
+		"evt.type = open",
+		"evt.dir = <",
+		"evt.num > 0",
+		"evt.rawres = 3",
+		"evt.res = SUCCESS",
+		"evt.failed = false",
+		"evt.category = file",
+		"evt.is_open_read = true",
+		"evt.arg.name = /var/lib/service/data/state.db",
+		"evt.rawarg.fd = 3",
+		"evt.args exists",
+		"evt.info exists",
+		"proc.name = worker",
+		"proc.exe = /usr/local/libexec/service-worker",
+		"proc.exepath = /usr/local/libexec/service-worker",
+		"proc.pid = 100",
+		"proc.cmdline startswith worker",
+		"proc.exeline startswith /usr",
+		"proc.args exists",
+		"proc.cwd exists",
+		"proc.pname = service",
+		"proc.pexe = /usr/local/bin/long-running-service",
+		"proc.pexepath = /usr/local/bin/long-running-service",
+		"proc.pcmdline startswith service",
+		"proc.aname[1] = service",
+		"proc.aexe[1] = /usr/local/bin/long-running-service",
+		"proc.aexepath[1] = /usr/local/bin/long-running-service",
+		"proc.aname = service",
+		"proc.sname exists",
+		"proc.vpgid.name exists",
+		"proc.is_exe_writable exists",
+		"proc.tty exists",
+		"thread.tid = 100",
+		"fd.name = /var/lib/service/data/state.db",
+		"fd.directory = /var/lib/service/data",
+		"fd.filename = state.db",
+		"fd.num = 3",
+		"fd.typechar = f",
+		"fd.type = file",
+		"fd.name glob /var/lib/*",
+		"fd.nameraw = /var/lib/service/data/state.db",
+		"fd.ino exists",
+		"fd.dev exists",
+	};
+	for(const auto& cond : conditions)
+	{
+		auto f = compile(cond);
+		ASSERT_TRUE(f->run(evt)) << cond;
+
+		uint64_t before = test_helpers::num_allocations();
+		for(int i = 0; i < 10; i++)
+		{
+			f->run(evt);
+		}
+		EXPECT_EQ(test_helpers::num_allocations() - before, 0) << cond;
+	}
+}
+
+TEST_F(filtercheck_extract, DISABLED_benchmark)
+{
+	using clock = std::chrono::steady_clock;
+
+	auto evt = open_file_event();
+
+	// conditions in the style of the common runtime security rules
+	static const std::vector<std::string> conditions = {
+		"evt.type in (open, openat, openat2) and evt.is_open_write = true and fd.typechar = f and fd.num >= 0",
+		"fd.name startswith /etc and not proc.name in (sshd, sudo, passwd)",
+		"proc.exepath endswith /bin/sh and proc.pname in (nginx, httpd, java)",
+		"fd.directory in (/bin, /sbin, /usr/bin, /usr/sbin) and evt.dir = <",
+		"proc.cmdline contains \"curl \" or proc.exe contains wget",
+		"proc.aexe[1] = /usr/local/bin/long-running-service and fd.filename glob *.db",
+	};
+	std::vector<std::unique_ptr<sinsp_filter>> filters;
+	for(const auto& cond : conditions)
+	{
+		filters.push_back(compile(cond));
+	}
+
+	const int n_loops = 100000;
+	uint64_t matches = 0;
+	uint64_t allocations = test_helpers::num_allocations();
+	auto start = clock::now();
+	for(int i = 0; i < n_loops; i++)
+	{
+		for(const auto& f : filters)
+		{
+			matches += f->run(evt);
+		}
+	}
+	double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / n_loops;
+	allocations = test_helpers::num_allocations() - allocations;
+
+	printf("%zu filters: %.1f ns/event, %.2f allocations/event (matches=%lu)\n",
+	       filters.size(), ns, (double)allocations / n_loops, (unsigned long)matches);
+}
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+#include <libsinsp/sinsp.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <map>
+#include <random>
+#include <unordered_map>
+
+TEST(sinsp_fdtable, dense_and_sparse_fds)
+{
+	sinsp inspector;
+	sinsp_fdtable table(&inspector);
+
+	std::vector<int64_t> fds = {0, 1, 2, 15, 16, 700, 1023, 1024, 5000, 1 << 20, -1};
+	for(auto fd : fds)
+	{
+		auto fdinfo = table.new_fdinfo();
+		fdinfo->m_name = std::to_string(fd);
+		ASSERT_EQ(table.add(fd, std::move(fdinfo))->m_fd, fd);
+	}
+	ASSERT_EQ(table.size(), fds.size());
+
+	for(auto fd : fds)
+	{
+		ASSERT_NE(table.find(fd), nullptr);
+		ASSERT_EQ(table.find(fd)->m_name, std::to_string(fd));
+	}
+	ASSERT_EQ(table.find(3), nullptr);
+	ASSERT_EQ(table.find(2048), nullptr);
+
+	std::map<int64_t, std::string> visited;
+	table.loop([&visited](int64_t fd, sinsp_fdinfo& fdinfo)
+	{
+		visited[fd] = fdinfo.m_name;
+		return true;
+	});
+	ASSERT_EQ(visited.size(), fds.size());
+
+	ASSERT_TRUE(table.erase(700));
+	ASSERT_FALSE(table.erase(700));
+	ASSERT_TRUE(table.erase(5000));
+	ASSERT_EQ(table.find(700), nullptr);
+	ASSERT_EQ(table.find(5000), nullptr);
+	ASSERT_EQ(table.size(), fds.size() - 2);
+
+	table.clear();
+	ASSERT_EQ(table.size(), 0);
+	ASSERT_EQ(table.find(0), nullptr);
+}
+
+TEST(sinsp_fdtable, replace_fd_being_closed)
+{
+	sinsp inspector;
+	sinsp_fdtable table(&inspector);
+
+	for(int64_t fd : {3, 4000})
+	{
+		auto fdinfo = table.add(fd, table.new_fdinfo());
+		fdinfo->m_name = "old";
+		fdinfo->m_flags |= sinsp_fdinfo::FLAGS_CLOSE_IN_PROGRESS;
+
+		auto replaced = table.new_fdinfo();
+		replaced->m_name = "new";
+		replaced->m_flags |= sinsp_fdinfo::FLAGS_CLOSE_IN_PROGRESS;
+		ASSERT_EQ(table.add(fd, std::move(replaced))->m_name, "new");
+
+		ASSERT_TRUE(table.find(fd)->m_flags & sinsp_fdinfo::FLAGS_CLOSE_CANCELED);
+		ASSERT_EQ(table.find(CANCELED_FD_NUMBER)->m_name, "old");
+		ASSERT_TRUE(table.erase(CANCELED_FD_NUMBER));
+	}
+	ASSERT_EQ(table.size(), 2);
+}
+
+TEST(sinsp_fdtable, max_size)
+{
+	sinsp inspector;
+	inspector.m_max_fdtable_size = 10;
+	sinsp_fdtable table(&inspector);
+
+	for(int64_t fd = 0; fd < 10; fd++)
+	{
+		ASSERT_NE(table.add(fd * 500, table.new_fdinfo()), nullptr);
+	}
+	ASSERT_EQ(table.add(10, table.new_fdinfo()), nullptr);
+	ASSERT_EQ(table.size(), 10);
+}
+
+// Compares the fd table with a plain std::unordered_map, run it with
+// --gtest_also_run_disabled_tests --gtest_filter='*benchmark*'
+TEST(sinsp_fdtable, DISABLED_benchmark)
+{
+	using clock = std::chrono::steady_clock;
+	auto ms = [](clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	};
+
+	sinsp inspector;
+	inspector.m_max_fdtable_size = UINT32_MAX;
+
+	// a typical process uses a few dozens of low fds, some servers use
+	// thousands of them
+	for(int64_t n_fds : {64, 4096, 100000})
+	{
+		const int rounds = 10000000 / n_fds;
+		std::mt19937_64 rng(n_fds);
+		std::vector<int64_t> lookups(1000000);
+		for(auto& fd : lookups)
+		{
+			fd = rng() % n_fds;
+		}
+		uint64_t sum = 0;
+
+		auto start = clock::now();
+		for(int r = 0; r < rounds; r++)
+		{
+			sinsp_fdtable table(&inspector);
+			for(int64_t fd = 0; fd < n_fds; fd++)
+			{
+				table.add(fd, table.new_fdinfo());
+			}
+			for(int64_t fd = 0; fd < n_fds; fd++)
+			{
+				table.erase(fd);
+			}
+		}
+		double table_add_erase = ms(start);
+		sinsp_fdtable table(&inspector);
+		for(int64_t fd = 0; fd < n_fds; fd++)
+		{
+			table.add(fd, table.new_fdinfo());
+		}
+		start = clock::now();
+		for(auto fd : lookups)
+		{
+			// skip the one-entry cache, like interleaved accesses do
+			table.reset_cache();
+			sum += table.find(fd)->m_fd;
+		}
+		double table_find = ms(start);
+
+		start = clock::now();
+		for(int r = 0; r < rounds; r++)
+		{
+			std::unordered_map<int64_t, std::unique_ptr<sinsp_fdinfo>> map;
+			for(int64_t fd = 0; fd < n_fds; fd++)
+			{
+				map.emplace(fd, table.new_fdinfo());
+			}
+			for(int64_t fd = 0; fd < n_fds; fd++)
+			{
+				map.erase(fd);
+			}
+		}
+		double map_add_erase = ms(start);
+		std::unordered_map<int64_t, std::unique_ptr<sinsp_fdinfo>> map;
+		for(int64_t fd = 0; fd < n_fds; fd++)
+		{
+			auto fdinfo = table.new_fdinfo();
+			fdinfo->m_fd = fd;
+			map.emplace(fd, std::move(fdinfo));
+		}
+		start = clock::now();
+		for(auto fd : lookups)
+		{
+			sum -= map.find(fd)->second->m_fd;
+		}
+		double map_find = ms(start);
+
+		ASSERT_EQ(sum, 0);
+		printf("%" PRId64 " fds: add+erase %.1f/%.1f ms, find %.1f/%.1f ms (fdtable/unordered_map)\n",
+		       n_fds, table_add_erase, map_add_erase, table_find, map_find);
+	}
+}
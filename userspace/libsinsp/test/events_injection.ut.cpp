@@ -64,3 +64,61 @@ TEST_F(sinsp_with_test_input, event_async_queue)
 	ASSERT_EQ(evt->get_scap_evt(), scap_evt1);
 }
 
+
+TEST_F(sinsp_with_test_input, event_batch)
+{
+	open_inspector();
+	m_inspector.set_scap_batch_size(4);
+
+	std::vector<const scap_evt*> expected;
+	for (int i = 0; i < 10; ++i)
+	{
+		auto* scap_evt = add_event(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file",
+					     PPM_O_RDWR, 0, 5, (uint64_t)123);
+		expected.push_back(scap_evt);
+	}
+	// the async event must be returned between the scap events of the same batch
+	expected.insert(expected.begin() + 3, add_async_event(expected[2]->ts + 1, -1, PPME_ASYNCEVENT_E, 3,
+		100, "event_name", scap_const_sized_buffer{NULL, 0}));
+
+	std::vector<const scap_evt*> received;
+	auto on_event = [&received](sinsp_evt* evt) { received.push_back(evt->get_scap_evt()); };
+
+	ASSERT_EQ(m_inspector.next_batch(6, on_event), SCAP_SUCCESS);
+	ASSERT_EQ(received.size(), 6);
+	ASSERT_EQ(m_inspector.next_batch(6, on_event), SCAP_SUCCESS);
+	ASSERT_EQ(received, expected);
+	ASSERT_EQ(m_inspector.next_batch(6, on_event), SCAP_TIMEOUT);
+	ASSERT_EQ(received.size(), expected.size());
+	// only the events coming from libscap are counted by the capture
+	ASSERT_EQ(m_inspector.get_num_events(), expected.size() - 1);
+}
+
+TEST_F(sinsp_with_test_input, event_batch_suppression)
+{
+	open_inspector();
+
+	uint64_t last_ts = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		uint64_t ts = increasing_ts();
+		int64_t tid = i % 2 == 0 ? 1 : 2;
+		if(tid == 1)
+		{
+			last_ts = ts;
+		}
+		add_event(ts, tid, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file",
+			  PPM_O_RDWR, 0, 5, (uint64_t)123);
+	}
+	m_inspector.suppress_events_tid(2);
+
+	// the events are fetched from libscap with a single call even with the
+	// default scap batch size, and the suppressed ones don't move the
+	// capture time, as with next()
+	std::vector<int64_t> tids;
+	auto on_event = [&tids](sinsp_evt* evt) { tids.push_back(evt->get_tid()); };
+	ASSERT_EQ(m_inspector.next_batch(8, on_event), SCAP_SUCCESS);
+	ASSERT_EQ(tids, std::vector<int64_t>({1, 1}));
+	ASSERT_EQ(m_inspector.get_lastevent_ts(), last_ts);
+	ASSERT_EQ(m_inspector.get_num_events(), 4);
+}
@@ -600,3 +600,50 @@ TEST_F(sinsp_with_test_input, net_connect_enter_event_is_missing_wo_fd_param_exi
 	fdinfo = evt->get_fd_info();
 	ASSERT_EQ(fdinfo, nullptr);
 }
+
+TEST_F(sinsp_with_test_input, net_ipnet_in_lists)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	int64_t client_fd = 9;
+	add_event_advance_ts(increasing_ts(), 1, PPME_SOCKET_SOCKET_E, 3, (uint32_t) PPM_AF_INET, (uint32_t) SOCK_STREAM, (uint32_t) 0);
+	add_event_advance_ts(increasing_ts(), 1, PPME_SOCKET_SOCKET_X, 1, client_fd);
+
+	sockaddr_in client = test_utils::fill_sockaddr_in(DEFAULT_CLIENT_PORT, DEFAULT_IPV4_CLIENT_STRING);
+	sockaddr_in server = test_utils::fill_sockaddr_in(DEFAULT_SERVER_PORT, DEFAULT_IPV4_SERVER_STRING);
+	std::vector<uint8_t> server_sockaddr = test_utils::pack_sockaddr(reinterpret_cast<sockaddr*>(&server));
+	add_event_advance_ts(increasing_ts(), 1, PPME_SOCKET_CONNECT_E, 2, client_fd, scap_const_sized_buffer{server_sockaddr.data(), server_sockaddr.size()});
+	std::vector<uint8_t> socktuple = test_utils::pack_socktuple(reinterpret_cast<sockaddr*>(&client), reinterpret_cast<sockaddr*>(&server));
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SOCKET_CONNECT_X, 3, return_value, scap_const_sized_buffer{socktuple.data(), socktuple.size()}, client_fd);
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	auto eval = [&](const std::string& cond)
+	{
+		return sinsp_filter_compiler(factory, cond).compile()->run(evt);
+	};
+
+	// the server is 142.251.111.147 and the client is 172.40.111.222
+	ASSERT_TRUE(eval("fd.snet in (10.0.0.0/8, 2001:db8::/32, 142.251.0.0/16)"));
+	ASSERT_FALSE(eval("fd.snet in (10.0.0.0/8, 2001:db8::/32, 142.252.0.0/16)"));
+	ASSERT_TRUE(eval("fd.cnet in (172.40.111.222/32)"));
+	ASSERT_FALSE(eval("fd.cnet in (172.40.111.223/32, 142.251.111.147/32)"));
+	ASSERT_TRUE(eval("fd.snet pmatch (192.168.0.0/16, 142.0.0.0/8)"));
+	ASSERT_TRUE(eval("fd.snet = 142.251.111.0/24"));
+	ASSERT_FALSE(eval("fd.snet = 142.251.112.0/24"));
+
+	// every value is considered, not only the first one
+	ASSERT_TRUE(eval("fd.net in (2001:db8::/32, 10.0.0.0/8, 172.40.0.0/16)"));
+	ASSERT_TRUE(eval("fd.net in (10.0.0.0/8, 142.251.111.147/32)"));
+	ASSERT_FALSE(eval("fd.net in (2001:db8::/32, 10.0.0.0/8)"));
+	ASSERT_TRUE(eval("fd.net = 172.40.0.0/16"));
+
+	// many networks
+	std::string list;
+	for(int i = 0; i < 2000; i++)
+	{
+		list += (i == 0 ? "" : ", ") + std::to_string(1 + i % 100) + "." + std::to_string(i / 100) + ".0.0/16";
+	}
+	ASSERT_FALSE(eval("fd.snet in (" + list + ")"));
+	ASSERT_TRUE(eval("fd.snet in (" + list + ", 142.251.111.0/24)"));
+}
@@ -351,3 +351,28 @@ TEST_F(sinsp_with_test_input, bitmaskparams)
 	evt->get_param_as_str(2, &val_str);
 	ASSERT_STREQ(val_str, "O_RDONLY|O_CLOEXEC");
 }
+
+/* Assert that the parameters found with a lookup resolved in advance are the ones found by name */
+TEST_F(sinsp_with_test_input, param_lookup)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	sinsp_evt_param_lookup fd("fd");
+	sinsp_evt_param_lookup name("name");
+	sinsp_evt_param_lookup unknown("not_a_param");
+	ASSERT_EQ(fd.position(PPME_SYSCALL_OPEN_X), 0);
+	ASSERT_EQ(name.position(PPME_SYSCALL_OPEN_X), 1);
+	ASSERT_EQ(name.position(PPME_SYSCALL_OPENAT_2_X), 2);
+	ASSERT_EQ(name.position(PPME_SYSCALL_GETUID_X), -1);
+	ASSERT_EQ(unknown.position(PPME_SYSCALL_OPEN_X), -1);
+	ASSERT_EQ(name.position(PPM_EVENT_MAX), -1);
+
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	sinsp_evt* evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", PPM_O_RDWR, 0, 5, (uint64_t)123);
+	for(const char* param : {"fd", "name", "flags", "mode", "dev", "ino", "not_a_param"})
+	{
+		ASSERT_EQ(evt->get_param_by_name(sinsp_evt_param_lookup(param)), evt->get_param_by_name(param)) << param;
+	}
+	ASSERT_EQ(evt->get_param_by_name(name)->as<std::string_view>(), "/tmp/the_file");
+}
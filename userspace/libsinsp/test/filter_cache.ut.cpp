@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/filter_cache.h>
+#include <libsinsp/eventformatter.h>
+#include "sinsp_with_test_input.h"
+#include "test_utils.h"
+
+TEST_F(sinsp_with_test_input, filter_cache_shared_entries)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	auto cache = std::make_shared<sinsp_filter_cache>();
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	auto compile = [&](const std::string& cond)
+	{
+		return sinsp_filter_compiler(factory, cond, cache).compile();
+	};
+
+	auto f1 = compile("evt.type = open and fd.name = /tmp/the_file");
+	auto f2 = compile("evt.type = open and fd.name startswith /tmp");
+	auto f3 = compile("proc.name = init and (evt.type = open and fd.name = /tmp/the_file)");
+	auto f4 = compile("toupper(fd.name) = /TMP/THE_FILE");
+	auto f5 = compile("not fd.name = /tmp/the_file");
+
+	// evt.type and fd.name are extracted once for all the filters
+	ASSERT_EQ(cache->num_extraction_entries(), 4);
+	// 5 distinct checks and 3 distinct "and" sub-expressions
+	ASSERT_EQ(cache->num_eval_entries(), 8);
+
+	sinsp_evt_formatter formatter(&m_inspector, "%fd.name %toupper(fd.name)", m_default_filterlist, cache);
+	ASSERT_EQ(cache->num_extraction_entries(), 6);
+
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", PPM_O_RDWR, 0, 5, (uint64_t)123);
+	ASSERT_TRUE(f1->run(evt));
+	ASSERT_TRUE(f2->run(evt));
+	ASSERT_TRUE(f3->run(evt));
+	ASSERT_TRUE(f4->run(evt));
+	ASSERT_FALSE(f5->run(evt));
+	std::string output;
+	ASSERT_TRUE(formatter.tostring(evt, output));
+	ASSERT_EQ(output, "/tmp/the_file /TMP/THE_FILE");
+
+	const auto& metrics = cache->get_metrics();
+	ASSERT_GT(metrics.m_num_eval_cache, 0);
+	ASSERT_GT(metrics.m_num_extract_cache, 0);
+
+	// the cached values don't depend on the filter that extracted them
+	f1.reset();
+	f3.reset();
+	ASSERT_TRUE(f2->run(evt));
+	ASSERT_TRUE(formatter.tostring(evt, output));
+	ASSERT_EQ(output, "/tmp/the_file /TMP/THE_FILE");
+
+	// a new event invalidates all the entries
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/etc/passwd", PPM_O_RDWR, 0);
+	evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)4, "/etc/passwd", PPM_O_RDWR, 0, 5, (uint64_t)123);
+	ASSERT_FALSE(f2->run(evt));
+	ASSERT_FALSE(f4->run(evt));
+	ASSERT_TRUE(f5->run(evt));
+	ASSERT_TRUE(formatter.tostring(evt, output));
+	ASSERT_EQ(output, "/etc/passwd /ETC/PASSWD");
+}
+
+TEST_F(sinsp_with_test_input, filter_cache_compared_field_not_shared)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	// evt.buffer is extracted raw on the left-hand side of a comparison,
+	// and formatted as a right-hand side field
+	auto cache = std::make_shared<sinsp_filter_cache>();
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	auto cached = sinsp_filter_compiler(factory, "evt.buffer = val(evt.buffer)", cache).compile();
+	auto uncached = sinsp_filter_compiler(factory, "evt.buffer = val(evt.buffer)").compile();
+	ASSERT_EQ(cache->num_extraction_entries(), 2);
+
+	for(const std::string& data : {std::string("hello"), std::string("he\x01\x02lo")})
+	{
+		auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_READ_X, 2, (int64_t)data.size(),
+						scap_const_sized_buffer{data.data(), data.size()});
+		ASSERT_EQ(cached->run(evt), uncached->run(evt)) << data;
+	}
+}
+
+TEST_F(sinsp_with_test_input, filter_cache_args_not_shared)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	auto cache = std::make_shared<sinsp_filter_cache>();
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	auto f1 = sinsp_filter_compiler(factory, "evt.arg.name = /tmp/the_file", cache).compile();
+	auto f2 = sinsp_filter_compiler(factory, "evt.arg.flags contains O_RDWR", cache).compile();
+
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", PPM_O_RDWR, 0, 5, (uint64_t)123);
+	ASSERT_TRUE(f1->run(evt));
+	ASSERT_TRUE(f2->run(evt));
+	ASSERT_EQ(cache->get_metrics().m_num_extract_cache, 0);
+}
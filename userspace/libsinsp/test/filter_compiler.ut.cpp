@@ -382,3 +382,148 @@ TEST_F(sinsp_with_test_input, filter_transformers_wrong_input_type)
 	ASSERT_THROW(evaluate_filter_str(&m_inspector, "b64(evt.rawres) = -1", generate_getcwd_failed_entry_event()),
 		     sinsp_exception);
 }
+
+TEST_F(sinsp_with_test_input, filter_adaptive_ordering)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	sinsp_filter_check_list filter_list;
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, filter_list);
+	std::vector<std::string> conditions = {
+		"proc.name = init and evt.type = close",
+		"proc.name = init and not evt.type = open and evt.dir = >",
+		"proc.name = nginx or evt.type = open",
+		"(proc.name = init and fd.name contains tmp) or not (evt.type in (open, close) or proc.name = nginx)",
+	};
+
+	std::vector<std::unique_ptr<sinsp_filter>> adaptive;
+	std::vector<std::unique_ptr<sinsp_filter>> plain;
+	for(const auto& c : conditions)
+	{
+		adaptive.push_back(sinsp_filter_compiler(factory, c).compile());
+		adaptive.back()->set_adaptive_ordering(64);
+		plain.push_back(sinsp_filter_compiler(factory, c).compile());
+	}
+
+	// the results never change while the checks are reordered
+	for(int i = 0; i < 500; i++)
+	{
+		sinsp_evt* evt;
+		switch(i % 4)
+		{
+		case 0:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)3);
+			break;
+		case 1:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+			break;
+		case 2:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", PPM_O_RDWR, 0, 5, (uint64_t)123);
+			break;
+		default:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_INOTIFY_INIT1_X, 2, (int64_t)12, (uint16_t)32);
+			break;
+		}
+		for(size_t j = 0; j < conditions.size(); j++)
+		{
+			ASSERT_EQ(adaptive[j]->run(evt), plain[j]->run(evt)) << conditions[j] << " at event " << i;
+		}
+	}
+
+	// `proc.name = init` is never decisive in the "and" and `proc.name = nginx`
+	// is never decisive in the "or", so they are moved last
+	for(size_t j = 0; j < 3; j++)
+	{
+		ASSERT_EQ(adaptive[j]->m_filter->m_checks.size(), 1);
+		auto expr = dynamic_cast<sinsp_filter_expression*>(adaptive[j]->m_filter->m_checks[0].get());
+		ASSERT_NE(expr, nullptr);
+		auto& last = expr->m_checks.back();
+		ASSERT_STREQ(last->get_field_info()->m_name, "proc.name") << conditions[j];
+		ASSERT_EQ(expr->m_checks.front()->m_boolop & ~BO_NOT, BO_NONE);
+	}
+}
+
+TEST_F(sinsp_with_test_input, filter_merge_patterns)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	sinsp_filter_check_list filter_list;
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, filter_list);
+	std::vector<std::pair<std::string, size_t>> conditions = {
+		{"fd.name contains tmp or evt.type = close or fd.name contains etc", 2},
+		{"fd.name startswith /etc or fd.name startswith /tmp or fd.name endswith _file or fd.name endswith .conf", 2},
+		{"proc.name glob i*t or proc.name glob n* or proc.name iglob INI? or proc.name iglob X*", 2},
+		{"not (fd.name icontains TMP or fd.name icontains ETC) and evt.dir = <", 1},
+		{"toupper(proc.name) contains NIT or toupper(proc.name) contains GIN or proc.name contains GIN", 2},
+		{"fd.name contains tmp or fd.directory contains tmp or evt.num > 2", 3},
+	};
+
+	std::vector<std::unique_ptr<sinsp_filter>> merged;
+	std::vector<std::unique_ptr<sinsp_filter>> plain;
+	for(const auto& c : conditions)
+	{
+		sinsp_filter_compiler compiler(factory, c.first);
+		compiler.set_merge_patterns(true);
+		merged.push_back(compiler.compile());
+		plain.push_back(sinsp_filter_compiler(factory, c.first).compile());
+	}
+
+	// the checks merged in the "or" expression
+	for(size_t j = 0; j < conditions.size(); j++)
+	{
+		auto expr = dynamic_cast<sinsp_filter_expression*>(merged[j]->m_filter->m_checks[0].get());
+		ASSERT_NE(expr, nullptr);
+		for(size_t depth = 0; j == 3 && depth < 2; depth++)
+		{
+			// and -> not -> or
+			expr = dynamic_cast<sinsp_filter_expression*>(expr->m_checks[0].get());
+			ASSERT_NE(expr, nullptr);
+		}
+		ASSERT_EQ(expr->m_checks.size(), conditions[j].second) << conditions[j].first;
+	}
+
+	uint64_t n_true = 0;
+	for(int i = 0; i < 8; i++)
+	{
+		sinsp_evt* evt;
+		switch(i % 4)
+		{
+		case 0:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)3);
+			break;
+		case 1:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+			break;
+		case 2:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", PPM_O_RDWR, 0, 5, (uint64_t)123);
+			break;
+		default:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)4, "/etc/ld.so.conf", PPM_O_RDWR, 0, 5, (uint64_t)123);
+			break;
+		}
+		for(size_t j = 0; j < conditions.size(); j++)
+		{
+			bool expected = plain[j]->run(evt);
+			ASSERT_EQ(merged[j]->run(evt), expected) << conditions[j].first << " at event " << i;
+			n_true += expected;
+		}
+	}
+	ASSERT_GT(n_true, 0);
+
+	// string operators accept lists of values from an AST
+	using namespace libsinsp::filter;
+	auto list = ast::binary_check_expr::create(
+		ast::field_expr::create("fd.name", ""), "endswith", ast::list_expr::create({"_file", ".conf"}));
+	auto f = sinsp_filter_compiler(factory, list.get()).compile();
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)5, "/etc/x.conf", PPM_O_RDWR, 0, 5, (uint64_t)123);
+	ASSERT_TRUE(f->run(evt));
+	evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)6, "/etc/x.cnf", PPM_O_RDWR, 0, 5, (uint64_t)123);
+	ASSERT_FALSE(f->run(evt));
+
+	// ...but only for string fields
+	auto wrong = ast::binary_check_expr::create(
+		ast::field_expr::create("evt.num", ""), "contains", ast::list_expr::create({"1", "2"}));
+	ASSERT_THROW(sinsp_filter_compiler(factory, wrong.get()).compile(), sinsp_exception);
+}
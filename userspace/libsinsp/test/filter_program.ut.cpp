@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/filter_program.h>
+#include "sinsp_with_test_input.h"
+#include "test_utils.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cinttypes>
+#include <random>
+
+static const std::vector<std::string> s_program_atoms = {
+	"evt.type = open",
+	"evt.type in (close, inotify_init1)",
+	"evt.dir = <",
+	"proc.name = init",
+	"proc.name = nginx",
+	"fd.name contains tmp",
+	"fd.name startswith /etc",
+	"evt.arg.flags contains O_RDWR",
+	"evt.num > 3",
+	"toupper(proc.name) = INIT",
+	"evt.rawres >= 0",
+	"fd.num exists",
+	"proc.pid = 1",
+	"proc.name icontains NIT",
+	"fd.name endswith _file",
+	"fd.snet in (10.0.0.0/8, 2001:db8::/32)",
+};
+
+static std::string random_condition(std::mt19937& rng, int depth)
+{
+	if(depth == 0 || rng() % 3 == 0)
+	{
+		return s_program_atoms[rng() % s_program_atoms.size()];
+	}
+
+	switch(rng() % 3)
+	{
+	case 0:
+		return "not (" + random_condition(rng, depth - 1) + ")";
+	default:
+	{
+		std::string op = (rng() % 2) ? " and " : " or ";
+		std::string res = "(" + random_condition(rng, depth - 1) + ")";
+		size_t n = 1 + rng() % 3;
+		for(size_t i = 0; i < n; i++)
+		{
+			res += op + "(" + random_condition(rng, depth - 1) + ")";
+		}
+		return res;
+	}
+	}
+}
+
+class filter_program_test : public sinsp_with_test_input
+{
+protected:
+	sinsp_evt* next_event(int i)
+	{
+		sinsp_evt* evt;
+		switch(i % 4)
+		{
+		case 0:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)3);
+			break;
+		case 1:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+			break;
+		case 2:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", PPM_O_RDWR, 0, 5, (uint64_t)123);
+			break;
+		default:
+			evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_INOTIFY_INIT1_X, 2, (int64_t)12, (uint16_t)32);
+			break;
+		}
+		return evt;
+	}
+};
+
+TEST_F(filter_program_test, lowering)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	auto lower = [&](const std::string& cond)
+	{
+		sinsp_filter_compiler compiler(factory, cond);
+		compiler.set_flat_program(true);
+		auto f = compiler.compile();
+		EXPECT_NE(f->get_program(), nullptr);
+		return f->get_program()->as_string();
+	};
+
+	ASSERT_EQ(lower("evt.type = open and not (proc.name = init or fd.name = /tmp)"),
+		"0: extract 0 (evt.type) 2\n"
+		"1: cmp_str 0 EQ\n"
+		"2: jmp_false 9\n"
+		"3: extract 1 (proc.name) 5\n"
+		"4: cmp_str 1 EQ\n"
+		"5: jmp_true 8\n"
+		"6: extract 2 (fd.name) 8\n"
+		"7: cmp_str 2 EQ\n"
+		"8: not\n"
+		"9: ret\n");
+
+	// a false "evt.type = open" jumps straight to the last check
+	ASSERT_EQ(lower("(evt.type = open and proc.name = init) or fd.name = /tmp"),
+		"0: extract 0 (evt.type) 2\n"
+		"1: cmp_str 0 EQ\n"
+		"2: jmp_false 6\n"
+		"3: extract 1 (proc.name) 5\n"
+		"4: cmp_str 1 EQ\n"
+		"5: jmp_true 8\n"
+		"6: extract 2 (fd.name) 8\n"
+		"7: cmp_str 2 EQ\n"
+		"8: ret\n");
+
+	// the program is discarded when the tree can change
+	sinsp_filter_compiler compiler(factory, "evt.type = open or proc.name = init");
+	compiler.set_flat_program(true);
+	auto f = compiler.compile();
+	ASSERT_NE(f->get_program(), nullptr);
+	f->set_adaptive_ordering(16);
+	ASSERT_EQ(f->get_program(), nullptr);
+	f->compile_program();
+	ASSERT_NE(f->get_program(), nullptr);
+	f->add_check(factory->new_filtercheck("evt.type"));
+	ASSERT_EQ(f->get_program(), nullptr);
+}
+
+TEST_F(filter_program_test, typed_comparisons)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	int64_t client_fd = 9;
+	add_event_advance_ts(increasing_ts(), 1, PPME_SOCKET_SOCKET_E, 3, (uint32_t)PPM_AF_INET, (uint32_t)SOCK_STREAM, (uint32_t)0);
+	add_event_advance_ts(increasing_ts(), 1, PPME_SOCKET_SOCKET_X, 1, client_fd);
+	sockaddr_in client = test_utils::fill_sockaddr_in(DEFAULT_CLIENT_PORT, DEFAULT_IPV4_CLIENT_STRING);
+	sockaddr_in server = test_utils::fill_sockaddr_in(DEFAULT_SERVER_PORT, DEFAULT_IPV4_SERVER_STRING);
+	std::vector<uint8_t> socktuple = test_utils::pack_socktuple(reinterpret_cast<sockaddr*>(&client), reinterpret_cast<sockaddr*>(&server));
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SOCKET_CONNECT_X, 3, (int64_t)0, scap_const_sized_buffer{socktuple.data(), socktuple.size()}, client_fd);
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	struct lowered
+	{
+		std::string cond;
+		std::string insn;
+		bool res;
+	};
+
+	// the server is 142.251.111.147:443 and the client is 172.40.111.222
+	std::vector<lowered> conditions = {
+		{"proc.pid = 1", "cmp_int 0 EQ", true},
+		{"evt.rawres < 0", "cmp_int 0 LT", false},
+		{"fd.sport = 443", "cmp_uint 0 EQ", true},
+		{"evt.num >= 100000", "cmp_uint 0 GE", false},
+		{"proc.name = init", "cmp_str 0 EQ", true},
+		{"toupper(proc.name) = INIT", "cmp_str 0 EQ", true},
+		{"fd.name contains 142.251", "cmp_str 0 CONTAINS", true},
+		{"fd.name endswith :80", "cmp_str 0 ENDSWITH", false},
+		{"fd.snet in (10.0.0.0/8, 2001:db8::/32, 142.251.0.0/16)", "cmp_ipnet 0 IN", true},
+		{"fd.cnet pmatch (172.40.111.223/32)", "cmp_ipnet 0 PMATCH", false},
+		{"fd.num exists", "const 1", true},
+		{"proc.pname exists", "const 1", false},
+		// compared by the checks
+		{"proc.name glob in*", "check 0", true},
+		{"proc.name in (init, nginx)", "check 0", true},
+		{"fd.ip = 142.251.111.147", "check 0", true},
+		{"fd.snet = 142.251.111.0/24", "check 0", true},
+		{"proc.aname = init", "check 0", false},
+	};
+
+	for(const auto& c : conditions)
+	{
+		sinsp_filter_compiler compiler(factory, c.cond);
+		compiler.set_flat_program(true);
+		auto flat = compiler.compile();
+		auto program = flat->get_program()->as_string();
+		ASSERT_NE(program.find(c.insn), std::string::npos) << c.cond << "\n" << program;
+		ASSERT_EQ(flat->run(evt), c.res) << c.cond;
+		ASSERT_EQ(sinsp_filter_compiler(factory, c.cond).compile()->run(evt), c.res) << c.cond;
+	}
+}
+
+TEST_F(filter_program_test, differential)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	auto tree_cache = std::make_shared<sinsp_filter_cache>();
+	auto flat_cache = std::make_shared<sinsp_filter_cache>();
+	auto compile = [&](const std::string& cond, bool flat, std::shared_ptr<sinsp_filter_cache> cache)
+	{
+		sinsp_filter_compiler compiler(factory, cond, cache);
+		compiler.set_flat_program(flat);
+		return compiler.compile();
+	};
+
+	std::mt19937 rng(42);
+	std::vector<std::string> conditions;
+	std::vector<std::unique_ptr<sinsp_filter>> tree, flat, tree_cached, flat_cached;
+	for(int i = 0; i < 300; i++)
+	{
+		conditions.push_back(random_condition(rng, 4));
+		tree.push_back(compile(conditions.back(), false, nullptr));
+		flat.push_back(compile(conditions.back(), true, nullptr));
+		tree_cached.push_back(compile(conditions.back(), false, tree_cache));
+		flat_cached.push_back(compile(conditions.back(), true, flat_cache));
+		ASSERT_EQ(tree.back()->get_program(), nullptr);
+		ASSERT_NE(flat.back()->get_program(), nullptr);
+	}
+
+	uint64_t n_true = 0;
+	for(int i = 0; i < 40; i++)
+	{
+		auto evt = next_event(i);
+		for(size_t j = 0; j < conditions.size(); j++)
+		{
+			bool expected = tree[j]->run(evt);
+			ASSERT_EQ(flat[j]->run(evt), expected) << conditions[j] << "\n" << flat[j]->get_program()->as_string();
+			ASSERT_EQ(tree_cached[j]->run(evt), expected) << conditions[j];
+			ASSERT_EQ(flat_cached[j]->run(evt), expected) << conditions[j];
+			n_true += expected;
+		}
+	}
+
+	// make sure that both outcomes have been covered
+	ASSERT_GT(n_true, 0);
+	ASSERT_LT(n_true, 40 * conditions.size());
+	ASSERT_GT(flat_cache->get_metrics().m_num_eval_cache, 0);
+}
+
+TEST_F(filter_program_test, DISABLED_benchmark)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	using clock = std::chrono::steady_clock;
+	auto ns = [](clock::time_point start)
+	{
+		return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+	};
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	const int n_loops = 20000;
+
+	for(int depth : {1, 3, 5})
+	{
+		std::mt19937 rng(depth);
+		std::vector<std::unique_ptr<sinsp_filter>> tree, flat;
+		for(int i = 0; i < 100; i++)
+		{
+			auto cond = random_condition(rng, depth);
+			tree.push_back(sinsp_filter_compiler(factory, cond).compile());
+			sinsp_filter_compiler compiler(factory, cond);
+			compiler.set_flat_program(true);
+			flat.push_back(compiler.compile());
+		}
+
+		double tree_ns = 0;
+		double flat_ns = 0;
+		uint64_t n_evals = 0;
+		uint64_t n_matches = 0;
+		for(int j = 0; j < 4; j++)
+		{
+			auto evt = next_event(j);
+
+			auto start = clock::now();
+			for(int k = 0; k < n_loops; k++)
+			{
+				for(auto& f : tree)
+				{
+					n_matches += f->run(evt);
+				}
+			}
+			tree_ns += ns(start);
+
+			start = clock::now();
+			for(int k = 0; k < n_loops; k++)
+			{
+				for(auto& f : flat)
+				{
+					n_matches += f->run(evt);
+				}
+			}
+			flat_ns += ns(start);
+			n_evals += (uint64_t)n_loops * tree.size();
+		}
+
+		printf("depth=%d: tree %.1f ns/filter, flat program %.1f ns/filter (matches=%" PRIu64 ")\n",
+		       depth, tree_ns / n_evals, flat_ns / n_evals, n_matches);
+	}
+}
@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/filter_ruleset.h>
+#include "sinsp_with_test_input.h"
+#include "test_utils.h"
+
+#include <chrono>
+#include <cinttypes>
+
+TEST_F(sinsp_with_test_input, filter_ruleset_run)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	sinsp_filter_ruleset ruleset(&m_inspector);
+	auto open_rule = ruleset.add("open", "syscall", "evt.type = open and evt.dir = <", factory);
+	auto close_rule = ruleset.add("close", "syscall", "evt.type = close", factory);
+	auto init_rule = ruleset.add("init", "syscall", "proc.name = init", factory);
+	auto other_rule = ruleset.add("other", "some_plugin_source", "evt.type = open", factory);
+	ASSERT_EQ(ruleset.size(), 4);
+	ASSERT_EQ(ruleset.get(close_rule).m_name, "close");
+	ASSERT_THROW(ruleset.add("broken", "syscall", "evt.type = ", factory), sinsp_exception);
+	ASSERT_EQ(ruleset.size(), 4);
+
+	auto codes = ruleset.enabled_event_codes("syscall");
+	ASSERT_TRUE(codes.contains(PPME_SYSCALL_OPEN_X));
+	ASSERT_TRUE(codes.contains(PPME_SYSCALL_READ_X));
+	ruleset.enable(init_rule, false);
+	codes = ruleset.enabled_event_codes("syscall");
+	ASSERT_TRUE(codes.contains(PPME_SYSCALL_OPEN_X));
+	ASSERT_TRUE(codes.contains(PPME_SYSCALL_CLOSE_E));
+	ASSERT_FALSE(codes.contains(PPME_SYSCALL_READ_X));
+	ASSERT_FALSE(ruleset.get(init_rule).m_enabled);
+	ruleset.enable(init_rule, true);
+
+	// rules are matched in the order they were added
+	std::vector<size_t> matches;
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", (uint32_t) PPM_O_RDWR, (uint32_t) 0);
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", (uint32_t) PPM_O_RDWR, (uint32_t) 0, (uint32_t) 5, (uint64_t)123);
+	ASSERT_TRUE(ruleset.run(evt, matches));
+	ASSERT_EQ(matches, std::vector<size_t>({open_rule, init_rule}));
+
+	size_t id = 0;
+	ASSERT_TRUE(ruleset.run_first(evt, id));
+	ASSERT_EQ(id, open_rule);
+
+	ruleset.enable(open_rule, false);
+	matches.clear();
+	ASSERT_TRUE(ruleset.run(evt, matches));
+	ASSERT_EQ(matches, std::vector<size_t>({init_rule}));
+	ASSERT_TRUE(ruleset.run_first(evt, id));
+	ASSERT_EQ(id, init_rule);
+
+	evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)3);
+	matches.clear();
+	ASSERT_TRUE(ruleset.run(evt, matches));
+	ASSERT_EQ(matches, std::vector<size_t>({close_rule, init_rule}));
+
+	ruleset.enable(init_rule, false);
+	ruleset.enable(close_rule, false);
+	matches.clear();
+	ASSERT_FALSE(ruleset.run(evt, matches));
+	ASSERT_FALSE(ruleset.run_first(evt, id));
+	ASSERT_TRUE(matches.empty());
+
+	ASSERT_THROW(ruleset.enable(other_rule + 1, true), std::out_of_range);
+}
+
+TEST_F(sinsp_with_test_input, filter_ruleset_compiler_options)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	const std::vector<std::string> conditions = {
+		"evt.type = open and fd.name contains the_file",
+		"fd.name contains other or fd.name contains the_file or fd.name startswith /etc",
+		"fd.name endswith .log or fd.name endswith .txt",
+		"not proc.name = init or fd.num = 3",
+	};
+
+	sinsp_filter_ruleset ruleset(&m_inspector);
+	sinsp_filter_ruleset optimized(&m_inspector);
+	optimized.set_flat_program(true);
+	optimized.set_merge_patterns(true);
+	for(size_t i = 0; i < conditions.size(); i++)
+	{
+		ruleset.add("rule_" + std::to_string(i), "syscall", conditions[i], factory);
+		optimized.add("rule_" + std::to_string(i), "syscall", conditions[i], factory);
+	}
+
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", (uint32_t) PPM_O_RDWR, (uint32_t) 0);
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", (uint32_t) PPM_O_RDWR, (uint32_t) 0, (uint32_t) 5, (uint64_t)123);
+	std::vector<size_t> matches, optimized_matches;
+	ASSERT_TRUE(ruleset.run(evt, matches));
+	ASSERT_TRUE(optimized.run(evt, optimized_matches));
+	ASSERT_EQ(matches, std::vector<size_t>({0, 1, 3}));
+	ASSERT_EQ(optimized_matches, matches);
+}
+
+TEST_F(sinsp_with_test_input, DISABLED_filter_ruleset_benchmark)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	using clock = std::chrono::steady_clock;
+	auto ns = [](clock::time_point start)
+	{
+		return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+	};
+
+	// cycles through events of different types
+	auto generate_event = [this](int i) -> sinsp_evt*
+	{
+		switch(i % 4)
+		{
+		case 0:
+			return add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_CLOSE_E, 1, (int64_t)3);
+		case 1:
+			return add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", (uint32_t) PPM_O_RDWR, (uint32_t) 0);
+		case 2:
+			return add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", (uint32_t) PPM_O_RDWR, (uint32_t) 0, (uint32_t) 5, (uint64_t)123);
+		default:
+			return add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_INOTIFY_INIT1_X, 2, (int64_t)12, (uint16_t)32);
+		}
+	};
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+	const std::vector<std::string> types = {"open", "close", "read", "write", "connect", "execve", "clone", "inotify_init1"};
+	const int n_loops = 20000;
+
+	for(int n_rules : {10, 100, 1000})
+	{
+		sinsp_filter_ruleset ruleset(&m_inspector);
+		auto cache = std::make_shared<sinsp_filter_cache>();
+		std::vector<std::unique_ptr<sinsp_filter>> filters;
+		std::vector<std::unique_ptr<sinsp_filter>> cached_filters;
+		for(int i = 0; i < n_rules; i++)
+		{
+			std::string cond = "evt.type = " + types[i % types.size()] + " and proc.name = proc_" + std::to_string(i);
+			ruleset.add("rule_" + std::to_string(i), "syscall", cond, factory);
+			filters.push_back(sinsp_filter_compiler(factory, cond).compile());
+			cached_filters.push_back(sinsp_filter_compiler(factory, cond, cache).compile());
+		}
+
+		double linear = 0;
+		double cached = 0;
+		double indexed = 0;
+		uint64_t n_events = 0;
+		uint64_t n_matches = 0;
+		std::vector<size_t> matches;
+		for(int j = 0; j < 4; j++)
+		{
+			sinsp_evt* evt = generate_event(j);
+
+			// every iteration is evaluated as a new event, so that nothing
+			// is served by the caches of the previous ones
+			uint64_t num = evt->get_num();
+			auto start = clock::now();
+			for(int k = 0; k < n_loops; k++)
+			{
+				for(auto& f : filters)
+				{
+					n_matches += f->run(evt);
+				}
+			}
+			linear += ns(start);
+
+			start = clock::now();
+			for(int k = 0; k < n_loops; k++)
+			{
+				evt->set_num(++num);
+				for(auto& f : cached_filters)
+				{
+					n_matches += f->run(evt);
+				}
+			}
+			cached += ns(start);
+
+			start = clock::now();
+			for(int k = 0; k < n_loops; k++)
+			{
+				evt->set_num(++num);
+				matches.clear();
+				n_matches += ruleset.run(evt, matches);
+			}
+			indexed += ns(start);
+			n_events += n_loops;
+		}
+
+		printf("rules=%d: all filters %.1f ns/event, all filters with cache %.1f ns/event, ruleset %.1f ns/event (matches=%" PRIu64 ")\n",
+		       n_rules, linear / n_events, cached / n_events, indexed / n_events, n_matches);
+	}
+}
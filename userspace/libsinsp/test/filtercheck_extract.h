@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <libsinsp/filter_cache.h>
+#include "sinsp_with_test_input.h"
+
+class filtercheck_extract : public sinsp_with_test_input
+{
+protected:
+	// a process with paths longer than the small string buffers opening a
+	// file, so that string copies would have to allocate
+	sinsp_evt* open_file_event()
+	{
+		add_default_init_thread();
+		open_inspector();
+		generate_execve_enter_and_exit_event(0, INIT_TID, INIT_TID, INIT_PID, INIT_PTID,
+						     "/usr/local/bin/long-running-service", "service",
+						     "/usr/local/bin/long-running-service");
+		generate_clone_x_event(0, 100, 100, INIT_PID);
+		generate_execve_enter_and_exit_event(0, 100, 100, 100, INIT_PID,
+						     "/usr/local/libexec/service-worker", "worker",
+						     "/usr/local/libexec/service-worker");
+		sinsp_evt* evt = add_event_advance_ts(increasing_ts(), 100, PPME_SYSCALL_OPEN_E, 3,
+						      "/var/lib/service/data/state.db", PPM_O_RDWR, 0);
+		evt = add_event_advance_ts(increasing_ts(), 100, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3,
+					   "/var/lib/service/data/state.db", PPM_O_RDWR, 0, 5, (uint64_t)123);
+		return evt;
+	}
+
+	std::unique_ptr<sinsp_filter> compile(const std::string& cond, std::shared_ptr<sinsp_filter_cache> cache = nullptr)
+	{
+		auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist);
+		return sinsp_filter_compiler(factory, cond, cache).compile();
+	}
+};
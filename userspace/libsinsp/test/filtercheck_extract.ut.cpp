@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "filtercheck_extract.h"
+#include "test_utils.h"
+
+// extract_into() returns the same values of extract(), with or without
+// room for all of them
+TEST_F(filtercheck_extract, same_as_extract)
+{
+	auto evt = open_file_event();
+
+	static const std::vector<std::string> fields = {
+		"evt.type", "evt.num", "evt.arg.name", "proc.name", "proc.exe", "proc.cmdline",
+		"proc.aname[1]", "fd.name", "fd.num", "fd.types", "fd.types[3]", "fd.cip",
+	};
+	for(const auto& field : fields)
+	{
+		std::unique_ptr<sinsp_filter_check> chk(m_default_filterlist.new_filter_check_from_fldname(field, &m_inspector, false));
+		ASSERT_NE(chk, nullptr) << field;
+		chk->parse_field_name(field, true, false);
+
+		std::vector<extract_value_t> expected;
+		bool has_value = chk->extract(evt, expected, false);
+
+		extract_value_t values[8];
+		uint32_t n = chk->extract_into(evt, values, 8, false);
+		ASSERT_EQ(n, has_value ? expected.size() : 0) << field;
+		for(uint32_t i = 0; i < n; i++)
+		{
+			ASSERT_EQ(std::string((const char*)values[i].ptr, values[i].len),
+				  std::string((const char*)expected[i].ptr, expected[i].len)) << field;
+		}
+
+		extract_value_t first;
+		ASSERT_EQ(chk->extract_into(evt, &first, 1, false), n) << field;
+		if(n > 0)
+		{
+			ASSERT_EQ(std::string((const char*)first.ptr, first.len),
+				  std::string((const char*)expected[0].ptr, expected[0].len)) << field;
+		}
+	}
+}
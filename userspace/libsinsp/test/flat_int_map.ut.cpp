@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <libsinsp/flat_int_map.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+TEST(flat_int_map, basic)
+{
+	flat_int_map<int64_t, std::shared_ptr<int>> m;
+	ASSERT_TRUE(m.empty());
+	ASSERT_EQ(m.find(1), nullptr);
+	ASSERT_FALSE(m.erase(1));
+
+	ASSERT_TRUE(m.insert(1, std::make_shared<int>(10)));
+	ASSERT_TRUE(m.insert(-1, std::make_shared<int>(-10)));
+	ASSERT_FALSE(m.insert(1, std::make_shared<int>(11)));
+	ASSERT_EQ(m.size(), 2);
+	ASSERT_EQ(**m.find(1), 11);
+	ASSERT_EQ(**m.find(-1), -10);
+
+	ASSERT_TRUE(m.erase(1));
+	ASSERT_EQ(m.find(1), nullptr);
+	ASSERT_EQ(m.size(), 1);
+
+	m.clear();
+	ASSERT_TRUE(m.empty());
+	ASSERT_EQ(m.find(-1), nullptr);
+}
+
+TEST(flat_int_map, random_operations)
+{
+	// the values are checked against std::unordered_map with a small key
+	// range, so that long probe sequences are erased and re-filled often
+	flat_int_map<int64_t, std::unique_ptr<int64_t>> m;
+	std::unordered_map<int64_t, int64_t> expected;
+	std::mt19937_64 rng(42);
+
+	for(int64_t i = 0; i < 200000; i++)
+	{
+		int64_t key = (int64_t)(rng() % 4096);
+		switch(rng() % 3)
+		{
+		case 0:
+			ASSERT_EQ(m.insert(key, std::make_unique<int64_t>(i)), expected.count(key) == 0);
+			expected[key] = i;
+			break;
+		case 1:
+			ASSERT_EQ(m.erase(key), expected.erase(key) == 1);
+			break;
+		default:
+		{
+			auto v = m.find(key);
+			auto it = expected.find(key);
+			ASSERT_EQ(v != nullptr, it != expected.end());
+			if(v)
+			{
+				ASSERT_EQ(**v, it->second);
+			}
+			break;
+		}
+		}
+		ASSERT_EQ(m.size(), expected.size());
+	}
+
+	size_t n = 0;
+	m.for_each([&](int64_t key, const std::unique_ptr<int64_t>& v)
+	{
+		EXPECT_EQ(*v, expected.at(key));
+		n++;
+		return true;
+	});
+	ASSERT_EQ(n, expected.size());
+}
+
+TEST(flat_int_map, for_each_interrupted)
+{
+	flat_int_map<int64_t, std::shared_ptr<int>> m(100);
+	for(int i = 0; i < 100; i++)
+	{
+		m.insert(i, std::make_shared<int>(i));
+	}
+
+	int n = 0;
+	ASSERT_FALSE(m.for_each([&n](int64_t, std::shared_ptr<int>&) { return ++n < 10; }));
+	ASSERT_EQ(n, 10);
+}
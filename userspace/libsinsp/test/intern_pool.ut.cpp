@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/intern_pool.h>
+#include <libsinsp/sinsp.h>
+
+#include <thread>
+
+struct string_size
+{
+	size_t operator()(const std::string& s) const
+	{
+		return s.size();
+	}
+};
+
+using test_pool = libsinsp::intern_pool<std::string, std::hash<std::string>, string_size>;
+
+TEST(intern_pool, shares_equal_values)
+{
+	test_pool pool;
+
+	auto a = pool.intern("a value long enough to be allocated");
+	auto b = pool.intern("a value long enough to be allocated");
+	auto c = pool.intern("another value");
+	ASSERT_EQ(a, b);
+	ASSERT_NE(a, c);
+	ASSERT_EQ(*c, "another value");
+
+	auto stats = pool.get_stats();
+	ASSERT_EQ(stats.n_lookups, 3);
+	ASSERT_EQ(stats.n_hits, 1);
+	ASSERT_EQ(stats.n_values, 2);
+	ASSERT_EQ(stats.n_saved_bytes, a->size());
+
+	// a value leaves the pool with its last reference
+	b.reset();
+	ASSERT_EQ(pool.get_stats().n_saved_bytes, 0);
+	a.reset();
+	ASSERT_EQ(pool.get_stats().n_values, 1);
+
+	auto d = pool.intern("a value long enough to be allocated");
+	ASSERT_EQ(pool.get_stats().n_hits, 1);
+	ASSERT_EQ(pool.get_stats().n_values, 2);
+}
+
+TEST(intern_pool, concurrent_interning)
+{
+	test_pool pool;
+
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&pool]() {
+			for(int i = 0; i < 10000; i++)
+			{
+				auto v = pool.intern(std::to_string(i % 100));
+				ASSERT_EQ(*v, std::to_string(i % 100));
+			}
+		});
+	}
+	for(auto& t : threads)
+	{
+		t.join();
+	}
+
+	ASSERT_EQ(pool.get_stats().n_lookups, 40000);
+	ASSERT_EQ(pool.get_stats().n_values, 0);
+}
+
+TEST(intern_pool, stats_cover_all_shards)
+{
+	test_pool pool;
+
+	std::vector<test_pool::ptr_t> values;
+	for(int i = 0; i < 1000; i++)
+	{
+		values.push_back(pool.intern("value " + std::to_string(i)));
+	}
+	for(int i = 0; i < 1000; i++)
+	{
+		ASSERT_EQ(pool.intern("value " + std::to_string(i)), values[i]);
+	}
+
+	auto stats = pool.get_stats();
+	ASSERT_EQ(stats.n_lookups, 2000);
+	ASSERT_EQ(stats.n_hits, 1000);
+	ASSERT_EQ(stats.n_values, 1000);
+
+	values.clear();
+	ASSERT_EQ(pool.get_stats().n_values, 0);
+}
+
+TEST(intern_pool, threadinfo_lists)
+{
+	auto before = sinsp_thread_manager::get_threadinfo_interning_stats();
+
+	sinsp_threadinfo a(nullptr), b(nullptr);
+	a.set_args({"--config", "/etc/service/config.yaml"});
+	b.set_args({"--config", "/etc/service/config.yaml"});
+	a.set_cgroups({"cpuset=/docker/875f9d8728e84761e4669b21acbf035b3a3fda62d7f6e35dd857781932cd74e8"});
+	b.set_cgroups({"cpuset=/docker/875f9d8728e84761e4669b21acbf035b3a3fda62d7f6e35dd857781932cd74e8"});
+	ASSERT_EQ(&a.get_args(), &b.get_args());
+	ASSERT_EQ(&a.cgroups(), &b.cgroups());
+	ASSERT_EQ(b.get_args().size(), 2);
+	ASSERT_EQ(b.get_cgroup("cpuset"), "/docker/875f9d8728e84761e4669b21acbf035b3a3fda62d7f6e35dd857781932cd74e8");
+
+	b.set_args({"--config", "/etc/other/config.yaml"});
+	ASSERT_NE(&a.get_args(), &b.get_args());
+	ASSERT_EQ(a.get_args()[1], "/etc/service/config.yaml");
+
+	auto after = sinsp_thread_manager::get_threadinfo_interning_stats();
+	ASSERT_EQ(after.n_lookups - before.n_lookups, 5);
+	ASSERT_EQ(after.n_hits - before.n_hits, 2);
+	ASSERT_GT(after.n_saved_bytes, before.n_saved_bytes);
+}
@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/ipnet_search.h>
+#include <libsinsp/sinsp_filtercheck.h>
+#include <arpa/inet.h>
+
+#include <chrono>
+#include <random>
+
+static ipv4net make_ipv4net(const std::string& addr, uint32_t prefix_len)
+{
+	ipv4net net;
+	inet_pton(AF_INET, addr.c_str(), &net.m_ip);
+	net.m_netmask = prefix_len == 0 ? 0 : htonl(~(uint32_t)0 << (32 - prefix_len));
+	return net;
+}
+
+static uint32_t make_ipv4(const std::string& addr)
+{
+	uint32_t ip;
+	inet_pton(AF_INET, addr.c_str(), &ip);
+	return ip;
+}
+
+TEST(ipnet_search, ipv4)
+{
+	ipnet_search s;
+	ASSERT_FALSE(s.match(make_ipv4("10.0.0.1")));
+
+	s.add_network(make_ipv4net("10.0.0.0", 8));
+	s.add_network(make_ipv4net("192.168.1.0", 24));
+	s.add_network(make_ipv4net("172.16.5.4", 32));
+	ASSERT_TRUE(s.match(make_ipv4("10.0.0.1")));
+	ASSERT_TRUE(s.match(make_ipv4("10.255.255.255")));
+	ASSERT_FALSE(s.match(make_ipv4("11.0.0.1")));
+	ASSERT_TRUE(s.match(make_ipv4("192.168.1.77")));
+	ASSERT_FALSE(s.match(make_ipv4("192.168.2.77")));
+	ASSERT_TRUE(s.match(make_ipv4("172.16.5.4")));
+	ASSERT_FALSE(s.match(make_ipv4("172.16.5.5")));
+
+	// networks contained in other ones don't add nodes
+	auto nodes = s.num_nodes();
+	s.add_network(make_ipv4net("10.1.0.0", 16));
+	ASSERT_EQ(s.num_nodes(), nodes);
+
+	// the host bits of the network address are ignored
+	s.add_network(make_ipv4net("8.8.4.4", 16));
+	ASSERT_TRUE(s.match(make_ipv4("8.8.8.8")));
+
+	// IPv6 networks are kept apart
+	ASSERT_FALSE(s.match(ipv6addr("::ffff:a00:1")));
+
+	s.add_network(make_ipv4net("0.0.0.0", 0));
+	ASSERT_TRUE(s.match(make_ipv4("1.2.3.4")));
+}
+
+TEST(ipnet_search, ipv6)
+{
+	ipnet_search s;
+	s.add_network(ipv6net("2001:db8::/32"));
+	s.add_network(ipv6net("fe80::/10"));
+	s.add_network(ipv6net("::1/128"));
+	ASSERT_TRUE(s.match(ipv6addr("2001:db8:1::1")));
+	ASSERT_FALSE(s.match(ipv6addr("2001:db9::1")));
+	ASSERT_TRUE(s.match(ipv6addr("febf::1")));
+	ASSERT_FALSE(s.match(ipv6addr("fec0::1")));
+	ASSERT_TRUE(s.match(ipv6addr("::1")));
+	ASSERT_FALSE(s.match(ipv6addr("::2")));
+	ASSERT_FALSE(s.match(make_ipv4("10.0.0.1")));
+}
+
+// the trie must agree with flt_compare on any address and network
+TEST(ipnet_search, same_as_flt_compare)
+{
+	std::mt19937 rng(7);
+	std::vector<ipv4net> v4;
+	std::vector<ipv6net> v6;
+	ipnet_search s;
+	for(int i = 0; i < 200; i++)
+	{
+		ipv4net n4;
+		n4.m_ip = rng() & htonl(0xffff0000); // keep some overlap
+		uint32_t len4 = rng() % 33;
+		n4.m_netmask = len4 == 0 ? 0 : htonl(~(uint32_t)0 << (32 - len4));
+		v4.push_back(n4);
+		s.add_network(n4);
+
+		char buf[INET6_ADDRSTRLEN];
+		uint8_t raw[16] = {0x20, 0x01, (uint8_t)(rng() % 4), (uint8_t)rng(), (uint8_t)rng()};
+		inet_ntop(AF_INET6, raw, buf, sizeof(buf));
+		v6.emplace_back(std::string(buf) + "/" + std::to_string(1 + rng() % 128));
+		s.add_network(v6.back());
+	}
+
+	for(int i = 0; i < 5000; i++)
+	{
+		uint32_t a4 = rng() & htonl(0xffff00ff);
+		bool expected = false;
+		for(const auto& n : v4)
+		{
+			expected = expected || flt_compare_ipv4net(CO_EQ, a4, &n);
+		}
+		ASSERT_EQ(s.match(a4), expected);
+
+		ipv6addr a6 = {};
+		uint8_t* b = (uint8_t*)a6.m_b;
+		b[0] = 0x20;
+		b[1] = 0x01;
+		b[2] = rng() % 4;
+		b[3] = rng();
+		b[4] = rng();
+		b[15] = rng();
+		expected = false;
+		for(const auto& n : v6)
+		{
+			expected = expected || flt_compare_ipv6net(CO_EQ, &a6, &n);
+		}
+		ASSERT_EQ(s.match(a6), expected);
+	}
+}
+
+TEST(ipnet_search, DISABLED_benchmark)
+{
+	using clock = std::chrono::steady_clock;
+
+	std::mt19937 rng(1);
+	std::vector<ipv4net> nets;
+	ipnet_search s;
+	for(int i = 0; i < 10000; i++)
+	{
+		ipv4net n;
+		n.m_ip = rng();
+		n.m_netmask = htonl(~(uint32_t)0 << (32 - (16 + rng() % 17)));
+		nets.push_back(n);
+		s.add_network(n);
+	}
+
+	std::vector<uint32_t> addrs;
+	for(int i = 0; i < 1000; i++)
+	{
+		addrs.push_back(i % 2 ? rng() : nets[rng() % nets.size()].m_ip);
+	}
+
+	uint64_t matches = 0;
+	auto start = clock::now();
+	for(int k = 0; k < 10; k++)
+	{
+		for(auto a : addrs)
+		{
+			for(const auto& n : nets)
+			{
+				if(flt_compare_ipv4net(CO_EQ, a, &n))
+				{
+					matches++;
+					break;
+				}
+			}
+		}
+	}
+	double linear = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (10 * addrs.size());
+
+	start = clock::now();
+	for(int k = 0; k < 1000; k++)
+	{
+		for(auto a : addrs)
+		{
+			matches += s.match(a);
+		}
+	}
+	double trie = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (1000 * addrs.size());
+
+	printf("10k prefixes: linear %.1f ns/lookup, trie %.1f ns/lookup, %zu nodes (matches=%lu)\n",
+	       linear, trie, s.num_nodes(), (unsigned long)matches);
+}
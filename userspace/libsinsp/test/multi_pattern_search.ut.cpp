@@ -0,0 +1,342 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/multi_pattern_search.h>
+#include <libsinsp/sinsp_filtercheck.h>
+#include <libsinsp/utils.h>
+
+#include <random>
+#include <tuple>
+
+TEST(multi_pattern_search, contains)
+{
+	multi_pattern_search s(multi_pattern_search::mode::CONTAINS);
+	ASSERT_FALSE(s.match("anything"));
+
+	s.add_pattern("he");
+	s.add_pattern("she");
+	s.add_pattern("his");
+	s.add_pattern("hers");
+	ASSERT_TRUE(s.match("ushers"));
+	ASSERT_TRUE(s.match("this"));
+	ASSERT_TRUE(s.match("ahe"));
+	ASSERT_FALSE(s.match("hi"));
+	ASSERT_FALSE(s.match("HE"));
+	ASSERT_FALSE(s.match(""));
+
+	// patterns can be added after the first match
+	s.add_pattern("xyz");
+	ASSERT_TRUE(s.match("__xyz"));
+
+	// the empty pattern is contained in any string
+	s.add_pattern("");
+	ASSERT_TRUE(s.match(""));
+}
+
+TEST(multi_pattern_search, icontains)
+{
+	multi_pattern_search s(multi_pattern_search::mode::CONTAINS, true);
+	s.add_pattern("/Etc/");
+	s.add_pattern("shadow");
+	ASSERT_TRUE(s.match("/etc/passwd"));
+	ASSERT_TRUE(s.match("/ETC/passwd"));
+	ASSERT_TRUE(s.match("/var/SHADOW.bak"));
+	ASSERT_FALSE(s.match("/usr/bin/etc"));
+}
+
+TEST(multi_pattern_search, startswith_endswith)
+{
+	multi_pattern_search p(multi_pattern_search::mode::STARTSWITH);
+	p.add_pattern("/etc/");
+	p.add_pattern("/usr/lib");
+	ASSERT_TRUE(p.match("/etc/passwd"));
+	ASSERT_TRUE(p.match("/usr/lib64/libc.so"));
+	ASSERT_FALSE(p.match("/usr/bin/ls"));
+	ASSERT_FALSE(p.match("/tmp/etc/"));
+	ASSERT_FALSE(p.match("/etc"));
+
+	multi_pattern_search s(multi_pattern_search::mode::ENDSWITH);
+	s.add_pattern(".sh");
+	s.add_pattern("/bash");
+	ASSERT_TRUE(s.match("/tmp/x.sh"));
+	ASSERT_TRUE(s.match("/bin/bash"));
+	ASSERT_FALSE(s.match("/bin/zsh"));
+	ASSERT_FALSE(s.match("sh"));
+	ASSERT_FALSE(s.match("/tmp/x.sh.bak"));
+}
+
+TEST(multi_pattern_search, glob)
+{
+	multi_pattern_search s(multi_pattern_search::mode::GLOB);
+	s.add_pattern("/etc/*.conf");
+	s.add_pattern("/tmp/?");
+	s.add_pattern("*\\*");
+	s.add_pattern("/dev/[st]ty*");
+	ASSERT_TRUE(s.match("/etc/ld.so.conf"));
+	ASSERT_TRUE(s.match("/etc/.conf"));
+	ASSERT_FALSE(s.match("/etc/ld.so.conf.d"));
+	ASSERT_TRUE(s.match("/tmp/a"));
+	ASSERT_FALSE(s.match("/tmp/ab"));
+	ASSERT_TRUE(s.match("a literal star*"));
+	ASSERT_FALSE(s.match("no star"));
+	ASSERT_TRUE(s.match("/dev/tty0"));
+	ASSERT_FALSE(s.match("/dev/pty0"));
+
+	multi_pattern_search i(multi_pattern_search::mode::GLOB, true);
+	i.add_pattern("*.EXE");
+	ASSERT_TRUE(i.match("setup.exe"));
+	ASSERT_FALSE(i.match("setup.ex"));
+}
+
+// the automatons must agree with flt_compare on any string
+TEST(multi_pattern_search, same_as_flt_compare)
+{
+	const std::vector<std::pair<cmpop, multi_pattern_search>> searches = {
+		{CO_CONTAINS, multi_pattern_search(multi_pattern_search::mode::CONTAINS)},
+		{CO_ICONTAINS, multi_pattern_search(multi_pattern_search::mode::CONTAINS, true)},
+		{CO_STARTSWITH, multi_pattern_search(multi_pattern_search::mode::STARTSWITH)},
+		{CO_ENDSWITH, multi_pattern_search(multi_pattern_search::mode::ENDSWITH)},
+		{CO_GLOB, multi_pattern_search(multi_pattern_search::mode::GLOB)},
+		{CO_IGLOB, multi_pattern_search(multi_pattern_search::mode::GLOB, true)},
+	};
+
+	std::mt19937 rng(11);
+	auto random_string = [&](const std::string& alphabet, size_t max_len)
+	{
+		std::string res;
+		size_t len = rng() % (max_len + 1);
+		for(size_t i = 0; i < len; i++)
+		{
+			res.push_back(alphabet[rng() % alphabet.size()]);
+		}
+		return res;
+	};
+
+	for(auto s : searches)
+	{
+		bool glob = s.first == CO_GLOB || s.first == CO_IGLOB;
+		for(int round = 0; round < 50; round++)
+		{
+			std::vector<std::string> patterns;
+			auto search = s.second;
+			for(size_t n = 1 + rng() % 8; n > 0; n--)
+			{
+				patterns.push_back(random_string(glob ? "abAB*?\\[]" : "abAB", 5));
+				search.add_pattern(patterns.back());
+			}
+
+			for(int i = 0; i < 100; i++)
+			{
+				auto str = random_string("abAB*?", 10);
+				bool expected = false;
+				for(auto& p : patterns)
+				{
+					expected = expected || flt_compare(s.first, PT_CHARBUF, str.c_str(), p.c_str());
+				}
+				ASSERT_EQ(search.match(str), expected)
+					<< std::to_string(s.first) << " '" << str << "' on " << patterns.size() << " patterns";
+			}
+		}
+	}
+}
+
+TEST(multi_pattern_search, glob_brackets)
+{
+	multi_pattern_search s(multi_pattern_search::mode::GLOB);
+	s.add_pattern("/dev/[!a-s]ty[0-9]");
+	s.add_pattern("*.[ch]");
+	s.add_pattern("[]-]x");
+	s.add_pattern("id_[[:digit:][:upper:]]");
+	ASSERT_TRUE(s.match("/dev/tty0"));
+	ASSERT_FALSE(s.match("/dev/pty0"));
+	ASSERT_FALSE(s.match("/dev/ttyx"));
+	ASSERT_TRUE(s.match("main.c"));
+	ASSERT_FALSE(s.match("main.cc"));
+	ASSERT_TRUE(s.match("]x"));
+	ASSERT_TRUE(s.match("-x"));
+	ASSERT_TRUE(s.match("id_7"));
+	ASSERT_TRUE(s.match("id_Q"));
+	ASSERT_FALSE(s.match("id_q"));
+
+	// character classes are not folded like fnmatch() does, so they are
+	// matched with it
+	multi_pattern_search i(multi_pattern_search::mode::GLOB, true);
+	i.add_pattern("[[:upper:]]*");
+	i.add_pattern("*.[C-H]");
+	ASSERT_TRUE(i.match("Makefile"));
+	ASSERT_TRUE(i.match("main.c"));
+	ASSERT_TRUE(i.match("main.H"));
+	ASSERT_FALSE(i.match("main.x"));
+}
+
+// the libc implementations don't agree on the case-insensitive ranges that
+// span both cases or mix letters with other bytes, e.g. '_' is in "[A-z]",
+// so these are matched with fnmatch()
+TEST(multi_pattern_search, iglob_ranges)
+{
+	for(const std::string p : {"[A-z]", "[!A-z]", "[a-Z]", "[Z-a]", "[0-z]", "[B-D]", "[b-d]", "[0-9]", "[!-/]"})
+	{
+		multi_pattern_search s(multi_pattern_search::mode::GLOB);
+		multi_pattern_search i(multi_pattern_search::mode::GLOB, true);
+		s.add_pattern(p);
+		i.add_pattern(p);
+		for(int c = 1; c < 256; c++)
+		{
+			std::string str(1, (char)c);
+			ASSERT_EQ(s.match(str), sinsp_utils::glob_match(p.c_str(), str.c_str(), false)) << p << " " << c;
+			ASSERT_EQ(i.match(str), sinsp_utils::glob_match(p.c_str(), str.c_str(), true)) << p << " " << c;
+		}
+	}
+
+#ifndef _WIN32
+	multi_pattern_search s(multi_pattern_search::mode::GLOB);
+	s.add_pattern("[A-z]*");
+	ASSERT_TRUE(s.match("_x"));
+	ASSERT_TRUE(s.match("`"));
+	ASSERT_FALSE(s.match("{"));
+
+	multi_pattern_search i(multi_pattern_search::mode::GLOB, true);
+	i.add_pattern("[A-z]*");
+	i.add_pattern("*.[B-D]");
+	ASSERT_TRUE(i.match("main.c"));
+	ASSERT_TRUE(i.match("Q"));
+	ASSERT_EQ(i.match("_x"), sinsp_utils::glob_match("[A-z]*", "_x", true));
+#endif
+}
+
+// the globs match like sinsp_utils::glob_match on every platform, which
+// uses PathMatchSpec() on Windows and fnmatch() elsewhere
+TEST(multi_pattern_search, glob_same_as_glob_match)
+{
+	static const std::vector<std::string> patterns = {"*.log;*.txt", "*.*", "[ab]*", "a?c", "*\\*"};
+	static const std::vector<std::string> subjects = {"x.txt", "abc", "a.c", "b", "a\\b", "ABC"};
+	for(bool icase : {false, true})
+	{
+		multi_pattern_search all(multi_pattern_search::mode::GLOB, icase);
+		for(const auto& p : patterns)
+		{
+			all.add_pattern(p);
+		}
+
+		for(const auto& str : subjects)
+		{
+			bool expected = false;
+			for(const auto& p : patterns)
+			{
+				multi_pattern_search s(multi_pattern_search::mode::GLOB, icase);
+				s.add_pattern(p);
+				bool res = sinsp_utils::glob_match(p.c_str(), str.c_str(), icase);
+				ASSERT_EQ(s.match(str), res) << p << " " << str;
+				expected = expected || res;
+			}
+			ASSERT_EQ(all.match(str), expected) << str;
+		}
+	}
+
+	multi_pattern_search s(multi_pattern_search::mode::GLOB);
+	s.add_pattern("*.log;*.txt");
+#ifdef _WIN32
+	ASSERT_TRUE(s.match("x.txt"));
+#else
+	ASSERT_FALSE(s.match("x.txt"));
+#endif
+}
+
+TEST(multi_pattern_search, glob_shapes)
+{
+	const std::vector<std::tuple<std::string, std::string, bool>> cases = {
+		{"/etc/passwd", "/etc/passwd", true},
+		{"/etc/passwd", "/etc/passwd2", false},
+		{"/etc/*", "/etc/shadow", true},
+		{"/etc/*", "/etc", false},
+		{"*.sh", "/tmp/x.sh", true},
+		{"*.sh", "/tmp/x.sh.bak", false},
+		{"**/bin/**", "/usr/bin/ls", true},
+		{"*/bin/*", "/usr/sbin/ls", false},
+		{"*\\**", "a*b", true},
+		{"*", "", true},
+		{"", "", true},
+		{"", "a", false},
+	};
+	for(const auto& c : cases)
+	{
+		multi_pattern_search s(multi_pattern_search::mode::GLOB);
+		s.add_pattern(std::get<0>(c));
+		ASSERT_EQ(s.match(std::get<1>(c)), std::get<2>(c)) << std::get<0>(c) << " " << std::get<1>(c);
+		ASSERT_EQ(s.num_states(), 0) << std::get<0>(c);
+	}
+
+	multi_pattern_search i(multi_pattern_search::mode::GLOB, true);
+	i.add_pattern("*/BIN/*");
+	ASSERT_TRUE(i.match("/usr/bin/ls"));
+	ASSERT_FALSE(i.match("/usr/sbin/ls"));
+}
+
+// the compiled globs must match exactly like fnmatch(), on random patterns
+// using all the supported syntax and some of the unsupported one
+TEST(multi_pattern_search, glob_same_as_fnmatch)
+{
+	static const std::vector<std::string> pattern_tokens = {
+		"a", "A", "b", "z", "-", "!", "^", "]", "[", "\\", "*", "?", ":",
+		"[:alpha:]", "[:lower:]", "[:upper:]", "[:punct:]", "[:foo:]", "[.a.]", "[=a=]",
+	};
+	static const std::string subject_alphabet = "aAbBzZ-!^][\\*?:.=";
+
+	std::mt19937 rng(13);
+	for(bool icase : {false, true})
+	{
+		for(int round = 0; round < 3000; round++)
+		{
+			std::vector<std::string> patterns;
+			multi_pattern_search search(multi_pattern_search::mode::GLOB, icase);
+			for(size_t n = (round % 2) ? 1 : 1 + rng() % 4; n > 0; n--)
+			{
+				std::string p;
+				for(size_t len = rng() % 9; len > 0; len--)
+				{
+					p += pattern_tokens[rng() % pattern_tokens.size()];
+				}
+				patterns.push_back(p);
+				search.add_pattern(p);
+			}
+
+			for(int i = 0; i < 30; i++)
+			{
+				std::string str;
+				for(size_t len = rng() % 7; len > 0; len--)
+				{
+					str.push_back(subject_alphabet[rng() % subject_alphabet.size()]);
+				}
+				bool expected = false;
+				for(const auto& p : patterns)
+				{
+					expected = expected || sinsp_utils::glob_match(p.c_str(), str.c_str(), icase);
+				}
+				std::string all;
+				for(const auto& p : patterns)
+				{
+					all += " '" + p + "'";
+				}
+				ASSERT_EQ(search.match(str), expected)
+					<< (icase ? "iglob" : "glob") << " '" << str << "' on" << all;
+			}
+		}
+	}
+}
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/object_pool.h>
+#include "sinsp_with_test_input.h"
+#include "test_utils.h"
+
+TEST(object_pool, pool_allocator_reuses_blocks)
+{
+	libsinsp::pool_allocator pool(4096);
+
+	void* a = pool.allocate(100);
+	void* b = pool.allocate(100);
+	ASSERT_NE(a, b);
+	ASSERT_EQ(pool.get_stats().n_objects, 2);
+	ASSERT_EQ(pool.get_stats().n_reserved_bytes, 4096);
+
+	// a freed block is given to the next allocation of the same size
+	pool.deallocate(a, 100);
+	ASSERT_EQ(pool.get_stats().n_objects, 1);
+	ASSERT_EQ(pool.allocate(97), a);
+	void* c = pool.allocate(200);
+	ASSERT_NE(c, a);
+
+	// big blocks don't go through the slabs
+	void* big = pool.allocate(10000);
+	ASSERT_EQ(pool.get_stats().n_reserved_bytes, 4096 + 10000);
+	pool.deallocate(big, 10000);
+
+	// a full slab triggers a new one
+	std::vector<void*> blocks;
+	for(int i = 0; i < 40; i++)
+	{
+		blocks.push_back(pool.allocate(256));
+	}
+	ASSERT_GT(pool.get_stats().n_reserved_bytes, 4096);
+	ASSERT_EQ(pool.get_stats().n_objects, 43);
+	for(auto p : blocks)
+	{
+		pool.deallocate(p, 256);
+	}
+	pool.deallocate(a, 100);
+	pool.deallocate(b, 100);
+	pool.deallocate(c, 200);
+	ASSERT_EQ(pool.get_stats().n_objects, 0);
+}
+
+TEST(object_pool, allocation_hook_switches_allocator)
+{
+	libsinsp::object_allocation_hook hook;
+
+	void* p1 = hook.allocate(64);
+	ASSERT_EQ(hook.get_stats().n_objects, 1);
+
+	auto pool = std::make_shared<libsinsp::pool_allocator>();
+	hook.set_allocator(pool);
+	void* p2 = hook.allocate(64);
+	ASSERT_EQ(pool->get_stats().n_objects, 1);
+	ASSERT_EQ(hook.get_stats().n_objects, 2);
+
+	// every block goes back to the allocator that created it
+	hook.set_allocator(nullptr);
+	hook.deallocate(p1, 64);
+	hook.deallocate(p2, 64);
+	ASSERT_EQ(pool->get_stats().n_objects, 0);
+	ASSERT_EQ(hook.get_stats().n_objects, 0);
+	ASSERT_EQ(hook.get_stats().n_reserved_bytes, pool->get_stats().n_reserved_bytes);
+}
+
+TEST_F(sinsp_with_test_input, object_pool_state_objects)
+{
+	auto threadinfo_pool = std::make_shared<libsinsp::pool_allocator>();
+	auto fdinfo_pool = std::make_shared<libsinsp::pool_allocator>();
+	sinsp_thread_manager::set_threadinfo_allocator(threadinfo_pool);
+	sinsp_fdtable::set_fdinfo_allocator(fdinfo_pool);
+
+	add_default_init_thread();
+	open_inspector();
+	uint64_t n_threads = threadinfo_pool->get_stats().n_objects;
+	ASSERT_GT(n_threads, 0);
+
+	int64_t fd = 3;
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", (uint32_t) 0, (uint32_t) 0);
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, fd, "/tmp/the_file", (uint32_t) 0, (uint32_t) 0, (uint32_t) 0, (uint64_t) 0);
+	uint64_t n_fdinfos = fdinfo_pool->get_stats().n_objects;
+	ASSERT_GT(n_fdinfos, 0);
+	ASSERT_EQ(sinsp_fdtable::get_fdinfo_allocator_stats().n_objects, n_fdinfos);
+
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, fd);
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_X, 1, (int64_t)0);
+	// the fd is removed when the next event is processed
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)100);
+	ASSERT_LT(fdinfo_pool->get_stats().n_objects, n_fdinfos);
+
+	sinsp_thread_manager::set_threadinfo_allocator(nullptr);
+	sinsp_fdtable::set_fdinfo_allocator(nullptr);
+
+	m_inspector.close();
+	ASSERT_EQ(threadinfo_pool->get_stats().n_objects, 0);
+}
@@ -264,6 +264,49 @@ TEST_F(sinsp_with_test_input, plugin_syscall_extract)
 	ASSERT_FALSE(field_has_value(evt, "sample.tick", pl_flist));
 }
 
+// scenario: all the plugin fields used by the filters and the formatters
+// should be extracted with a single call to the plugin for every event
+TEST_F(sinsp_with_test_input, plugin_batched_extraction)
+{
+	filter_check_list pl_flist;
+	register_plugin(&m_inspector, get_plugin_api_sample_plugin_source);
+	auto pl = register_plugin(&m_inspector, get_plugin_api_sample_syscall_extract);
+	add_plugin_filterchecks(&m_inspector, pl, sinsp_syscall_event_source_name, pl_flist);
+	add_default_init_thread();
+	open_inspector();
+
+	auto factory = std::make_shared<sinsp_filter_factory>(&m_inspector, pl_flist);
+	auto filter = sinsp_filter_compiler(factory,
+		"sample.is_open = 1 and sample.proc_name = init and sample.tick = false and sample.is_open = 1").compile();
+	sinsp_evt_formatter formatter(&m_inspector, "%sample.proc_name %sample.tick %sample.extract_calls", pl_flist);
+
+	std::string output;
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	ASSERT_TRUE(filter->run(evt));
+	ASSERT_TRUE(formatter.tostring(evt, output));
+	ASSERT_EQ(output, "init false 1");
+
+	evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/the_file", PPM_O_RDWR, 0, 5, (uint64_t)123);
+	ASSERT_TRUE(filter->run(evt));
+	ASSERT_TRUE(formatter.tostring(evt, output));
+	ASSERT_EQ(output, "init false 2");
+
+	evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_INOTIFY_INIT1_X, 2, (int64_t)12, (uint16_t)32);
+	ASSERT_FALSE(filter->run(evt));
+	ASSERT_TRUE(formatter.tostring(evt, output));
+	ASSERT_EQ(output, "init false 3");
+
+	// a field making the whole batch fail doesn't hide the other ones
+	sinsp_evt_formatter failing(&m_inspector, "%sample.is_open %sample.open_count", pl_flist);
+	evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	ASSERT_TRUE(filter->run(evt));
+	// note: tostring() fails since one of the fields has no value
+	ASSERT_FALSE(failing.tostring(evt, output));
+	ASSERT_EQ(output, "1 ");
+	ASSERT_TRUE(formatter.tostring(evt, output));
+	ASSERT_EQ(output.substr(0, 11), "init false ");
+}
+
 // scenario: an event sourcing plugin should produce events of "syscall"
 // event source and we should be able to extract filter values implemented
 // by both libsinsp and another plugin with field extraction capability
@@ -19,6 +19,8 @@ limitations under the License.
 #include <cstdio>
 #include <cstdlib>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include <driver/ppm_events_public.h>
 
@@ -35,9 +37,10 @@ limitations under the License.
 struct plugin_state
 {
     std::string lasterr;
-    uint64_t u64storage;
-    std::string strstorage;
-    const char* strptrstorage;
+    uint64_t num_extract_calls;
+    std::vector<uint64_t> u64storage;
+    std::vector<std::string> strstorage;
+    std::vector<const char*> strptrstorage;
     ss_plugin_table_t* thread_table;
     ss_plugin_table_field_t* thread_comm_field;
     ss_plugin_table_field_t* thread_opencount_field;
@@ -120,6 +123,11 @@ static const char* plugin_get_fields()
 		"type": "string",
 		"name": "sample.tick",
 		"desc": "'true' if the current event is a ticker notification"
+	},
+	{
+		"type": "uint64",
+		"name": "sample.extract_calls",
+		"desc": "Number of calls to the plugin field extraction so far"
 	}
 ])";
 }
@@ -250,13 +258,18 @@ static ss_plugin_rc plugin_extract_fields(ss_plugin_t *s, const ss_plugin_event_
     ss_plugin_table_entry_t* thread = NULL;
     ss_plugin_table_entry_t* evtcount = NULL;
     plugin_state *ps = (plugin_state *) s;
+    ps->num_extract_calls++;
+    // every field of the batch needs its own storage
+    ps->u64storage.resize(in->num_fields);
+    ps->strstorage.resize(in->num_fields);
+    ps->strptrstorage.resize(in->num_fields);
     for (uint32_t i = 0; i < in->num_fields; i++)
     {
         switch(in->fields[i].field_id)
         {
             case 0: // sample.is_open
-                ps->u64storage = evt_type_is_open(ev->evt->type);
-                in->fields[i].res.u64 = &ps->u64storage;
+                ps->u64storage[i] = evt_type_is_open(ev->evt->type);
+                in->fields[i].res.u64 = &ps->u64storage[i];
                 in->fields[i].res_len = 1;
                 break;
             case 1: // sample.open_count
@@ -282,8 +295,8 @@ static ss_plugin_rc plugin_extract_fields(ss_plugin_t *s, const ss_plugin_event_
                     in->table_reader_ext->release_table_entry(ps->thread_table, thread);
                     return SS_PLUGIN_FAILURE;
                 }
-                ps->u64storage = tmp.u64;
-                in->fields[i].res.u64 = &ps->u64storage;
+                ps->u64storage[i] = tmp.u64;
+                in->fields[i].res.u64 = &ps->u64storage[i];
                 in->fields[i].res_len = 1;
                 in->table_reader_ext->release_table_entry(ps->thread_table, thread);
                 break;
@@ -317,10 +330,10 @@ static ss_plugin_rc plugin_extract_fields(ss_plugin_t *s, const ss_plugin_event_
                 if (!evtcount)
                 {
                     // stubbing the counter to 0 if no entry exists
-                    ps->u64storage = 0;
-                    in->fields[i].res.u64 = &ps->u64storage;
+                    ps->u64storage[i] = 0;
+                    in->fields[i].res.u64 = &ps->u64storage[i];
                     in->fields[i].res_len = 1;
-                    return SS_PLUGIN_SUCCESS;
+                    break;
                 }
                 rc = in->table_reader.read_entry_field(ps->evtcount_table, evtcount, ps->evtcount_count_field, &tmp);
                 if (rc != SS_PLUGIN_SUCCESS)
@@ -330,8 +343,8 @@ static ss_plugin_rc plugin_extract_fields(ss_plugin_t *s, const ss_plugin_event_
                     in->table_reader_ext->release_table_entry(ps->evtcount_table, evtcount);
                     return SS_PLUGIN_FAILURE;
                 }
-                ps->u64storage = tmp.u64;
-                in->fields[i].res.u64 = &ps->u64storage;
+                ps->u64storage[i] = tmp.u64;
+                in->fields[i].res.u64 = &ps->u64storage[i];
                 in->fields[i].res_len = 1;
                 in->table_reader_ext->release_table_entry(ps->evtcount_table, evtcount);
                 break;
@@ -352,9 +365,9 @@ static ss_plugin_rc plugin_extract_fields(ss_plugin_t *s, const ss_plugin_event_
                     in->table_reader_ext->release_table_entry(ps->thread_table, thread);
                     return SS_PLUGIN_FAILURE;
                 }
-                ps->strstorage = std::string(tmp.str);
-                ps->strptrstorage = ps->strstorage.c_str();
-                in->fields[i].res.str = &ps->strptrstorage;
+                ps->strstorage[i] = std::string(tmp.str);
+                ps->strptrstorage[i] = ps->strstorage[i].c_str();
+                in->fields[i].res.str = &ps->strptrstorage[i];
                 in->fields[i].res_len = 1;
                 in->table_reader_ext->release_table_entry(ps->thread_table, thread);
                 break;
@@ -362,14 +375,19 @@ static ss_plugin_rc plugin_extract_fields(ss_plugin_t *s, const ss_plugin_event_
                 if (ev->evt->type == PPME_ASYNCEVENT_E
                     && strcmp("sampleticker", get_async_event_name(ev->evt)) == 0)
                 {
-                    ps->strstorage = "true";
+                    ps->strstorage[i] = "true";
                 }
                 else
                 {
-                    ps->strstorage = "false";
+                    ps->strstorage[i] = "false";
                 }
-                ps->strptrstorage = ps->strstorage.c_str();
-                in->fields[i].res.str = &ps->strptrstorage;
+                ps->strptrstorage[i] = ps->strstorage[i].c_str();
+                in->fields[i].res.str = &ps->strptrstorage[i];
+                in->fields[i].res_len = 1;
+                break;
+            case 5: // sample.extract_calls
+                ps->u64storage[i] = ps->num_extract_calls;
+                in->fields[i].res.u64 = &ps->u64storage[i];
                 in->fields[i].res_len = 1;
                 break;
             default:
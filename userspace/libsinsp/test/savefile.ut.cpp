@@ -18,9 +18,18 @@ limitations under the License.
 
 #include <libsinsp/sinsp.h>
 #include <libsinsp/sinsp_cycledumper.h>
+#include <libscap/engine/savefile/scap_reader.h>
+#include <libsinsp_test_var.h>
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include <sys/stat.h>
+
 using namespace std;
 
 #ifdef __x86_64__
@@ -181,4 +190,425 @@ TEST(savefile, cycledumper_seconds)
 
 	unlink(capture_scap);
 }
+
+static uint64_t dump_capture(const std::string& src, const std::string& dst, compression_mode mode,
+			     int level = SCAP_COMPRESSION_LEVEL_DEFAULT, uint32_t index_interval = 0)
+{
+	sinsp inspector;
+	inspector.open_savefile(src);
+
+	sinsp_dumper dumper;
+	if(index_interval != 0)
+	{
+		dumper.enable_index(index_interval);
+	}
+	dumper.open(&inspector, dst, mode, level);
+
+	uint64_t n_evts = 0;
+	int32_t res;
+	sinsp_evt* evt;
+	while((res = inspector.next(&evt)) != SCAP_EOF)
+	{
+		EXPECT_NE(res, SCAP_FAILURE);
+		dumper.dump(evt);
+		n_evts++;
+	}
+
+	dumper.close();
+	return n_evts;
+}
+
+TEST(savefile, gzip_blocks)
+{
+	char gzip_scap[] = "capture.XXXXXX.scap";
+	char blocks_scap[] = "capture.XXXXXX.scap";
+	close(mkstemps(gzip_scap, strlen(".scap")));
+	close(mkstemps(blocks_scap, strlen(".scap")));
+
+	uint64_t n_evts = dump_capture(RESOURCE_DIR "/sample.scap", gzip_scap, SCAP_COMPRESSION_GZIP);
+	ASSERT_EQ(dump_capture(RESOURCE_DIR "/sample.scap", blocks_scap, SCAP_COMPRESSION_GZIP_BLOCKS, 6), n_evts);
+
+	sinsp gzip_inspector, blocks_inspector;
+	gzip_inspector.open_savefile(gzip_scap);
+	blocks_inspector.open_savefile(blocks_scap);
+	ASSERT_EQ(blocks_inspector.m_thread_manager->get_thread_count(), 94);
+
+	int32_t res;
+	uint64_t n_read_evts = 0;
+	sinsp_evt *gzip_evt, *blocks_evt;
+	do
+	{
+		res = gzip_inspector.next(&gzip_evt);
+		ASSERT_EQ(blocks_inspector.next(&blocks_evt), res);
+		if(res == SCAP_SUCCESS)
+		{
+			n_read_evts++;
+			ASSERT_EQ(blocks_evt->get_scap_evt()->len, gzip_evt->get_scap_evt()->len);
+			ASSERT_EQ(memcmp(blocks_evt->get_scap_evt(), gzip_evt->get_scap_evt(), gzip_evt->get_scap_evt()->len), 0);
+			ASSERT_EQ(blocks_evt->get_cpuid(), gzip_evt->get_cpuid());
+		}
+	}
+	while(res != SCAP_EOF);
+
+	ASSERT_EQ(n_read_evts, n_evts);
+
+	unlink(gzip_scap);
+	unlink(blocks_scap);
+}
+
+TEST(savefile, gzip_blocks_growing_file)
+{
+	char blocks_scap[] = "capture.XXXXXX.scap";
+	char growing_scap[] = "capture.XXXXXX.scap";
+	close(mkstemps(blocks_scap, strlen(".scap")));
+	int growing_fd = mkstemps(growing_scap, strlen(".scap"));
+	ASSERT_NE(growing_fd, -1);
+
+	dump_capture(RESOURCE_DIR "/sample.scap", blocks_scap, SCAP_COMPRESSION_GZIP_BLOCKS, 6);
+
+	std::ifstream in(blocks_scap, std::ios::binary);
+	std::vector<char> compressed((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	ASSERT_GT(compressed.size(), 2);
+
+	// The file ends in the middle of a gzip member
+	size_t half = compressed.size() / 2;
+	ASSERT_EQ(write(growing_fd, compressed.data(), half), (ssize_t)half);
+
+	int fd = open(growing_scap, O_RDONLY);
+	ASSERT_NE(fd, -1);
+	scap_reader_t* r = scap_reader_open_blocks(fd, true);
+	ASSERT_NE(r, nullptr);
+
+	std::vector<uint8_t> buf(64 * 1024);
+	uint64_t first_size = 0;
+	int n;
+	while((n = r->read(r, buf.data(), buf.size())) > 0)
+	{
+		first_size += n;
+	}
+	ASSERT_EQ(n, 0);
+
+	ASSERT_EQ(write(growing_fd, compressed.data() + half, compressed.size() - half),
+		  (ssize_t)(compressed.size() - half));
+	close(growing_fd);
+
+	uint64_t second_size = 0;
+	while((n = r->read(r, buf.data(), buf.size())) > 0)
+	{
+		second_size += n;
+	}
+	ASSERT_EQ(n, 0);
+	r->close(r);
+
+	fd = open(blocks_scap, O_RDONLY);
+	ASSERT_NE(fd, -1);
+	r = scap_reader_open_blocks(fd, true);
+	ASSERT_NE(r, nullptr);
+	uint64_t full_size = 0;
+	while((n = r->read(r, buf.data(), buf.size())) > 0)
+	{
+		full_size += n;
+	}
+	r->close(r);
+
+	ASSERT_GT(second_size, 0);
+	ASSERT_EQ(first_size + second_size, full_size);
+
+	unlink(blocks_scap);
+	unlink(growing_scap);
+}
+
+TEST(savefile, mmap_growing_file)
+{
+	char growing_scap[] = "capture.XXXXXX.scap";
+	int growing_fd = mkstemps(growing_scap, strlen(".scap"));
+	ASSERT_NE(growing_fd, -1);
+
+	std::vector<uint8_t> data(3 * 4096);
+	for(size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = (uint8_t)(i * 7);
+	}
+	size_t first = 4096 + 100;
+	ASSERT_EQ(write(growing_fd, data.data(), first), (ssize_t)first);
+
+	int fd = open(growing_scap, O_RDONLY);
+	ASSERT_NE(fd, -1);
+	scap_reader_t* r = scap_reader_open_mmap(fd, true);
+	ASSERT_NE(r, nullptr);
+
+	auto head = (uint8_t*)r->read_nocopy(r, 4096);
+	ASSERT_NE(head, nullptr);
+	ASSERT_EQ(r->read_nocopy(r, 200), nullptr);
+
+	ASSERT_EQ(write(growing_fd, data.data() + first, data.size() - first), (ssize_t)(data.size() - first));
+	close(growing_fd);
+
+	// the appended data is read past the mapping, which stays in place
+	uint8_t buf[50];
+	ASSERT_EQ(r->read(r, buf, sizeof(buf)), (int)sizeof(buf));
+	ASSERT_EQ(memcmp(buf, data.data() + 4096, sizeof(buf)), 0);
+	auto tail = (uint8_t*)r->read_nocopy(r, 200);
+	ASSERT_NE(tail, nullptr);
+	ASSERT_EQ(memcmp(tail, data.data() + 4096 + sizeof(buf), 200), 0);
+	ASSERT_EQ(memcmp(head, data.data(), 4096), 0);
+
+	std::vector<uint8_t> rest(data.size());
+	ASSERT_EQ(r->read(r, rest.data(), rest.size()), (int)(data.size() - 4096 - sizeof(buf) - 200));
+	ASSERT_EQ(memcmp(rest.data(), data.data() + 4096 + sizeof(buf) + 200, data.size() - 4096 - sizeof(buf) - 200), 0);
+	ASSERT_EQ(r->read(r, buf, sizeof(buf)), 0);
+	ASSERT_EQ(r->seek(r, 0, SEEK_END), (int64_t)data.size());
+	r->close(r);
+
+	unlink(growing_scap);
+}
+
+struct read_evt
+{
+	uint64_t num;
+	uint64_t ts;
+	std::vector<uint8_t> data;
+};
+
+static std::vector<read_evt> read_capture(sinsp& inspector)
+{
+	std::vector<read_evt> evts;
+	int32_t res;
+	sinsp_evt* evt;
+	while((res = inspector.next(&evt)) != SCAP_EOF)
+	{
+		EXPECT_EQ(res, SCAP_SUCCESS);
+		if(res != SCAP_SUCCESS)
+		{
+			break;
+		}
+		uint8_t* data = (uint8_t*)evt->get_scap_evt();
+		evts.push_back({evt->get_num(), evt->get_ts(), std::vector<uint8_t>(data, data + evt->get_scap_evt()->len)});
+	}
+	return evts;
+}
+
+// the events read after the initial state ones, which are numbered from
+// expected[0].num
+static void check_seeks(const std::string& path, const std::vector<read_evt>& expected)
+{
+	sinsp inspector;
+	inspector.open_savefile(path);
+	sinsp_evt* evt;
+	uint64_t first_num = expected[0].num;
+	uint64_t last_num = expected.back().num;
+
+	for(uint64_t num : {first_num, first_num + 1, first_num + 49, first_num + 50, first_num + 237, last_num, first_num + 2})
+	{
+		inspector.fseek_evtnum(num);
+		ASSERT_EQ(inspector.next(&evt), SCAP_SUCCESS);
+		ASSERT_EQ(evt->get_num(), num);
+		const read_evt& e = expected[num - first_num];
+		ASSERT_EQ(std::vector<uint8_t>((uint8_t*)evt->get_scap_evt(), (uint8_t*)evt->get_scap_evt() + evt->get_scap_evt()->len), e.data);
+	}
+	inspector.fseek_evtnum(last_num + 1);
+	ASSERT_EQ(inspector.next(&evt), SCAP_EOF);
+
+	// the events of different CPUs are not sorted by timestamp
+	for(size_t i : {expected.size() / 3, expected.size() - 1, expected.size() / 2})
+	{
+		uint64_t ts = expected[i].ts - 1;
+		ASSERT_GE(ts, expected[0].ts);
+		size_t first = 0;
+		while(expected[first].ts < ts)
+		{
+			first++;
+		}
+		inspector.fseek_ts(ts);
+		ASSERT_EQ(inspector.next(&evt), SCAP_SUCCESS);
+		ASSERT_EQ(evt->get_num(), expected[first].num);
+		ASSERT_EQ(evt->get_ts(), expected[first].ts);
+	}
+	inspector.fseek_ts(0);
+	ASSERT_EQ(inspector.next(&evt), SCAP_SUCCESS);
+	ASSERT_EQ(evt->get_num(), 1);
+	inspector.fseek_ts(UINT64_MAX);
+	ASSERT_EQ(inspector.next(&evt), SCAP_EOF);
+}
+
+TEST(savefile, index)
+{
+	char plain_scap[] = "capture.XXXXXX.scap";
+	char indexed_scap[] = "capture.XXXXXX.scap";
+	close(mkstemps(plain_scap, strlen(".scap")));
+	close(mkstemps(indexed_scap, strlen(".scap")));
+
+	uint64_t n_evts = dump_capture(RESOURCE_DIR "/sample.scap", plain_scap, SCAP_COMPRESSION_NONE);
+	sinsp plain_inspector;
+	plain_inspector.open_savefile(plain_scap);
+	std::vector<read_evt> expected = read_capture(plain_inspector);
+	ASSERT_EQ(expected.size(), n_evts);
+
+	for(compression_mode mode : {SCAP_COMPRESSION_NONE, SCAP_COMPRESSION_GZIP_BLOCKS})
+	{
+		ASSERT_EQ(dump_capture(RESOURCE_DIR "/sample.scap", indexed_scap, mode, SCAP_COMPRESSION_LEVEL_DEFAULT, 50), n_evts);
+
+		// the index is skipped when reading the events
+		sinsp inspector;
+		inspector.open_savefile(indexed_scap);
+		std::vector<read_evt> evts = read_capture(inspector);
+		ASSERT_EQ(evts.size(), expected.size());
+		for(size_t i = 0; i < evts.size(); i++)
+		{
+			ASSERT_EQ(evts[i].num, expected[i].num);
+			ASSERT_EQ(evts[i].data, expected[i].data);
+		}
+
+		check_seeks(indexed_scap, expected);
+
+		// no sidecar is needed
+		struct stat st;
+		ASSERT_NE(stat((std::string(indexed_scap) + ".idx").c_str(), &st), 0);
+	}
+
+	// a gzip stream can't be seeked, so it can't carry an index
+	ASSERT_THROW(dump_capture(RESOURCE_DIR "/sample.scap", indexed_scap, SCAP_COMPRESSION_GZIP,
+				  SCAP_COMPRESSION_LEVEL_DEFAULT, 50),
+		     sinsp_exception);
+
+	unlink(plain_scap);
+	unlink(indexed_scap);
+}
+
+TEST(savefile, index_sidecar)
+{
+	char gzip_scap[] = "capture.XXXXXX.scap";
+	close(mkstemps(gzip_scap, strlen(".scap")));
+	std::string sidecar = std::string(gzip_scap) + ".idx";
+
+	dump_capture(RESOURCE_DIR "/sample.scap", gzip_scap, SCAP_COMPRESSION_GZIP);
+	sinsp plain_inspector;
+	plain_inspector.open_savefile(gzip_scap);
+	std::vector<read_evt> expected = read_capture(plain_inspector);
+
+	// the index is built on the first seek, then read from the sidecar
+	struct stat st;
+	ASSERT_NE(stat(sidecar.c_str(), &st), 0);
+	check_seeks(gzip_scap, expected);
+	ASSERT_EQ(stat(sidecar.c_str(), &st), 0);
+	check_seeks(gzip_scap, expected);
+
+	// a capture opened by fd can still be indexed
+	sinsp fd_inspector;
+	fd_inspector.open_savefile("", open(gzip_scap, O_RDONLY));
+	fd_inspector.fseek_evtnum(expected[10].num);
+	sinsp_evt* evt;
+	ASSERT_EQ(fd_inspector.next(&evt), SCAP_SUCCESS);
+	ASSERT_EQ(evt->get_num(), expected[10].num);
+
+	unlink(sidecar.c_str());
+	unlink(gzip_scap);
+}
+
+//
+// Run with --gtest_also_run_disabled_tests to compare the write and read
+// throughput and the ratio of the compression modes on the test captures.
+//
+TEST(savefile, DISABLED_compression_benchmark)
+{
+	struct config
+	{
+		const char* name;
+		compression_mode mode;
+		int level;
+	};
+	const config configs[] = {
+		{"none", SCAP_COMPRESSION_NONE, SCAP_COMPRESSION_LEVEL_DEFAULT},
+		{"gzip", SCAP_COMPRESSION_GZIP, SCAP_COMPRESSION_LEVEL_DEFAULT},
+		{"gzip-1", SCAP_COMPRESSION_GZIP, 1},
+		{"gzip-blocks-1", SCAP_COMPRESSION_GZIP_BLOCKS, 1},
+		{"gzip-blocks-6", SCAP_COMPRESSION_GZIP_BLOCKS, 6},
+	};
+	const std::string captures[] = {
+		RESOURCE_DIR "/sample.scap",
+		LIBSINSP_TEST_SCAP_FILES_DIR "kexec_arm64.scap",
+		LIBSINSP_TEST_SCAP_FILES_DIR "kexec_x86.scap",
+	};
+	char dump_scap[] = "capture.XXXXXX.scap";
+	close(mkstemps(dump_scap, strlen(".scap")));
+
+	for(const auto& capture : captures)
+	{
+		struct stat st;
+		if(stat(capture.c_str(), &st) != 0 || st.st_size == 0)
+		{
+			printf("%s: not found\n", capture.c_str());
+			continue;
+		}
+
+		// keep the events in memory, to time only their compression
+		std::vector<uint8_t> evts;
+		std::vector<uint16_t> cpuids;
+		{
+			sinsp inspector;
+			inspector.open_savefile(capture);
+			sinsp_evt* evt;
+			while(inspector.next(&evt) != SCAP_EOF)
+			{
+				auto data = (uint8_t*)evt->get_scap_evt();
+				evts.insert(evts.end(), data, data + evt->get_scap_evt()->len);
+				cpuids.push_back(evt->get_cpuid());
+			}
+		}
+
+		for(const auto& c : configs)
+		{
+			char error[SCAP_LASTERR_SIZE];
+			auto start = std::chrono::steady_clock::now();
+			scap_dumper_t* d = scap_dump_open(NULL, dump_scap, c.mode, error);
+			ASSERT_NE(d, nullptr) << error;
+			if(c.level != SCAP_COMPRESSION_LEVEL_DEFAULT)
+			{
+				ASSERT_EQ(scap_dump_set_compression_level(d, c.level), SCAP_SUCCESS);
+			}
+			size_t off = 0;
+			for(auto cpuid : cpuids)
+			{
+				auto e = (scap_evt*)(evts.data() + off);
+				ASSERT_EQ(scap_dump(d, e, cpuid, 0), SCAP_SUCCESS);
+				off += e->len;
+			}
+			uint64_t size = scap_dump_ftell(d);
+			scap_dump_close(d);
+			double write_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			int fd = open(dump_scap, O_RDONLY);
+			scap_reader_t* r = scap_reader_open_blocks(fd, true);
+			if(r == NULL)
+			{
+				r = scap_reader_open_mmap(fd, true);
+			}
+			if(r == NULL)
+			{
+				r = scap_reader_open_gzfile(gzdopen(fd, "rb"));
+			}
+			ASSERT_NE(r, nullptr);
+			std::vector<uint8_t> buf(64 * 1024);
+			uint64_t read_size = 0;
+			int n;
+			while((n = r->read(r, buf.data(), buf.size())) > 0)
+			{
+				read_size += n;
+			}
+			r->close(r);
+			double read_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			ASSERT_EQ(read_size, size);
+
+			ASSERT_EQ(stat(dump_scap, &st), 0);
+			printf("%s %s: write %.1f MB/s, read %.1f MB/s, ratio %.2f\n",
+			       capture.c_str(), c.name,
+			       size / write_s / (1024 * 1024),
+			       size / read_s / (1024 * 1024),
+			       (double)size / st.st_size);
+		}
+	}
+
+	unlink(dump_scap);
+}
 #endif
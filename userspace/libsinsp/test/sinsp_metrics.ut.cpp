@@ -37,7 +37,7 @@ TEST_F(sinsp_with_test_input, sinsp_libs_metrics_collector_prometheus)
 
 	libs_metrics_collector.snapshot();
 	auto metrics_snapshot = libs_metrics_collector.get_metrics();
-	ASSERT_EQ(metrics_snapshot.size(), 28);
+	ASSERT_EQ(metrics_snapshot.size(), 36);
 
 	/* Test prometheus_metrics_converter.convert_metric_to_text_prometheus */
 	std::string prometheus_text;
@@ -116,7 +116,7 @@ testns_falco_memory_rss_bytes{raw_name="memory_rss_bytes"} )";
 	}
 
 	ASSERT_EQ(metrics_names_all_str_post_unit_conversion_pre_prometheus_text_conversion, 
-	"cpu_usage_ratio memory_rss_bytes memory_vsz_bytes memory_pss_bytes container_memory_used_bytes host_cpu_usage_ratio host_memory_used_bytes host_procs_running host_open_fds n_threads n_fds n_noncached_fd_lookups n_cached_fd_lookups n_failed_fd_lookups n_added_fds n_removed_fds n_stored_evts n_store_evts_drops n_retrieved_evts n_retrieve_evts_drops n_noncached_thread_lookups n_cached_thread_lookups n_failed_thread_lookups n_added_threads n_removed_threads n_drops_full_threadtable n_missing_container_images n_containers");
+	"cpu_usage_ratio memory_rss_bytes memory_vsz_bytes memory_pss_bytes container_memory_used_bytes host_cpu_usage_ratio host_memory_used_bytes host_procs_running host_open_fds n_threads n_fds n_noncached_fd_lookups n_cached_fd_lookups n_failed_fd_lookups n_added_fds n_removed_fds n_stored_evts n_store_evts_drops n_retrieved_evts n_retrieve_evts_drops n_noncached_thread_lookups n_cached_thread_lookups n_failed_thread_lookups n_added_threads n_removed_threads n_drops_full_threadtable n_missing_container_images n_containers global_n_threadinfo_objects global_threadinfo_reserved_memory_bytes global_n_fdinfo_objects global_fdinfo_reserved_memory_bytes threads_purging_time_ns global_n_interned_lookups global_n_interned_hits global_interned_saved_memory_bytes");
 
 	// Test global wrapper base metrics (pseudo metrics)
 	prometheus_text = prometheus_metrics_converter.convert_metric_to_text_prometheus("kernel_release", "testns", "falco", {{"kernel_release", "6.6.7-200.fc39.x86_64"}});
@@ -267,7 +267,7 @@ TEST_F(sinsp_with_test_input, sinsp_libs_metrics_collector_output_rule)
 	libs_metrics_collector.snapshot();
 	libs_metrics_collector.snapshot();
 	metrics_snapshot = libs_metrics_collector.get_metrics();
-	ASSERT_EQ(metrics_snapshot.size(), 28);
+	ASSERT_EQ(metrics_snapshot.size(), 36);
 
 	/* These names should always be available, note that we currently can't check for the merged scap stats metrics here */
 	std::unordered_set<std::string> minimal_metrics_names = {"cpu_usage_perc", "memory_rss_kb", "host_open_fds", \
@@ -359,13 +359,13 @@ TEST_F(sinsp_with_test_input, sinsp_libs_metrics_collector_output_rule)
 	libs::metrics::libs_metrics_collector libs_metrics_collector6(&m_inspector, test_metrics_flags);
 	libs_metrics_collector6.snapshot();
 	metrics_snapshot = libs_metrics_collector6.get_metrics();
-	ASSERT_EQ(metrics_snapshot.size(), 19);
+	ASSERT_EQ(metrics_snapshot.size(), 27);
 
 	test_metrics_flags = (METRICS_V2_RESOURCE_UTILIZATION | METRICS_V2_STATE_COUNTERS);
 	libs::metrics::libs_metrics_collector libs_metrics_collector7(&m_inspector, test_metrics_flags);
 	libs_metrics_collector7.snapshot();
 	metrics_snapshot = libs_metrics_collector7.get_metrics();
-	ASSERT_EQ(metrics_snapshot.size(), 28);
+	ASSERT_EQ(metrics_snapshot.size(), 36);
 }
 
 TEST(sinsp_libs_metrics, sinsp_libs_metrics_convert_units)
@@ -0,0 +1,307 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/sinsp_pipeline.h>
+#include <libsinsp/plugin.h>
+#include "sinsp_with_test_input.h"
+#include "test_utils.h"
+#include "plugins/test_plugins.h"
+
+#include <mutex>
+#include <set>
+
+TEST_F(sinsp_with_test_input, pipeline_evaluates_snapshots)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	const int n_files = 200;
+	for (int i = 0; i < n_files; i++)
+	{
+		std::string name = "/tmp/file_" + std::to_string(i);
+		add_event(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, name.c_str(), (uint32_t) PPM_O_RDWR, (uint32_t) 0);
+		add_event(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, name.c_str(), (uint32_t) PPM_O_RDWR, (uint32_t) 0, (uint32_t) 5, (uint64_t)123);
+		// the fd is gone by the time the open event is evaluated
+		add_event(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)3);
+		add_event(increasing_ts(), 1, PPME_SYSCALL_CLOSE_X, 1, (int64_t)0);
+	}
+
+	auto filters = [this]()
+	{
+		sinsp_filter_compiler compiler(std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist),
+					       "evt.type = open and evt.dir = <");
+		return compiler.compile();
+	};
+	auto formatters = [this]()
+	{
+		return std::make_unique<sinsp_evt_formatter>(&m_inspector, "%proc.name %fd.name", m_default_filterlist);
+	};
+
+	std::mutex mtx;
+	std::multiset<std::string> outputs;
+	auto on_output = [&](sinsp_evt*, const std::string& output)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		outputs.insert(output);
+	};
+
+	sinsp_pipeline pipeline(&m_inspector, 4, filters, formatters, on_output, 16);
+	while (pipeline.next() == SCAP_SUCCESS)
+	{
+	}
+	pipeline.flush();
+
+	ASSERT_EQ(pipeline.get_num_published(), 4 * n_files);
+	ASSERT_EQ(pipeline.get_num_matched(), n_files);
+
+	std::multiset<std::string> expected;
+	for (int i = 0; i < n_files; i++)
+	{
+		expected.insert("init /tmp/file_" + std::to_string(i));
+	}
+	ASSERT_EQ(outputs, expected);
+
+	pipeline.stop();
+	ASSERT_THROW(pipeline.next(), sinsp_exception);
+}
+
+TEST_F(sinsp_with_test_input, pipeline_snapshots_the_parents)
+{
+	const int n_children = 100;
+	add_default_init_thread();
+	for (int i = 0; i < n_children; i++)
+	{
+		add_simple_thread(100 + i, 100 + i, INIT_TID, "parent_" + std::to_string(i));
+		add_simple_thread(1000 + i, 1000 + i, 100 + i, "child_" + std::to_string(i));
+	}
+	open_inspector();
+
+	int64_t not_relevant_64 = 0;
+	uint8_t not_relevant_8 = 0;
+	for (int i = 0; i < n_children; i++)
+	{
+		// the parent exits and the child is reparented to init while the
+		// workers evaluate the events of the child
+		int64_t child = 1000 + i;
+		std::string before = "/tmp/before_" + std::to_string(i);
+		std::string after = "/tmp/after_" + std::to_string(i);
+		add_event(increasing_ts(), child, PPME_SYSCALL_OPEN_E, 3, before.c_str(), (uint32_t) PPM_O_RDWR, (uint32_t) 0);
+		add_event(increasing_ts(), child, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, before.c_str(), (uint32_t) PPM_O_RDWR, (uint32_t) 0, (uint32_t) 5, (uint64_t)123);
+		add_event(increasing_ts(), 100 + i, PPME_PROCEXIT_1_E, 5, not_relevant_64, not_relevant_64, not_relevant_8, not_relevant_8, (int64_t)INIT_TID);
+		add_event(increasing_ts(), child, PPME_SYSCALL_OPEN_E, 3, after.c_str(), (uint32_t) PPM_O_RDWR, (uint32_t) 0);
+		add_event(increasing_ts(), child, PPME_SYSCALL_OPEN_X, 6, (uint64_t)4, after.c_str(), (uint32_t) PPM_O_RDWR, (uint32_t) 0, (uint32_t) 5, (uint64_t)123);
+	}
+
+	auto filters = [this]()
+	{
+		sinsp_filter_compiler compiler(std::make_shared<sinsp_filter_factory>(&m_inspector, m_default_filterlist),
+					       "evt.type = open and evt.dir = < and ((proc.pname startswith parent_ and proc.aname[2] = init) or proc.pname = init)");
+		return compiler.compile();
+	};
+	auto formatters = [this]()
+	{
+		return std::make_unique<sinsp_evt_formatter>(&m_inspector, "%proc.name %proc.pname %fd.name", m_default_filterlist);
+	};
+
+	std::mutex mtx;
+	std::multiset<std::string> outputs;
+	auto on_output = [&](sinsp_evt*, const std::string& output)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		outputs.insert(output);
+	};
+
+	sinsp_pipeline pipeline(&m_inspector, 4, filters, formatters, on_output, 8);
+	while (pipeline.next() == SCAP_SUCCESS)
+	{
+	}
+	pipeline.flush();
+
+	ASSERT_EQ(pipeline.get_num_matched(), 2 * n_children);
+
+	std::multiset<std::string> expected;
+	for (int i = 0; i < n_children; i++)
+	{
+		std::string child = "child_" + std::to_string(i);
+		expected.insert(child + " parent_" + std::to_string(i) + " /tmp/before_" + std::to_string(i));
+		expected.insert(child + " init /tmp/after_" + std::to_string(i));
+	}
+	ASSERT_EQ(outputs, expected);
+}
+
+TEST_F(sinsp_with_test_input, pipeline_without_filter)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	for (int i = 0; i < 10; i++)
+	{
+		add_event(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)0);
+	}
+
+	std::atomic<int> n_outputs{0};
+	{
+		sinsp_pipeline pipeline(&m_inspector, 2, nullptr, nullptr,
+					[&n_outputs](sinsp_evt*, const std::string& output)
+					{
+						EXPECT_TRUE(output.empty());
+						n_outputs++;
+					});
+		while (pipeline.next() == SCAP_SUCCESS)
+		{
+		}
+		// the pending events are evaluated before the destructor returns
+	}
+	ASSERT_EQ(n_outputs, 10);
+
+	ASSERT_THROW(sinsp_pipeline(&m_inspector, 0, nullptr, nullptr, nullptr), sinsp_exception);
+}
+
+TEST_F(sinsp_with_test_input, pipeline_shares_thread_snapshots)
+{
+	add_default_init_thread();
+	open_inspector();
+
+	auto evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)0);
+	auto first = evt->snapshot();
+	evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CLOSE_X, 1, (int64_t)0);
+	auto second = evt->snapshot();
+	ASSERT_NE(first->get_thread_info(), nullptr);
+	ASSERT_EQ(first->get_thread_info(), second->get_thread_info());
+
+	// a change of the thread state makes the next snapshot copy the
+	// threads again, the previous snapshots are not modified
+	evt = add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_CHDIR_X, 2, (int64_t)0, "/tmp/other");
+	auto third = evt->snapshot();
+	ASSERT_NE(third->get_thread_info(), first->get_thread_info());
+	ASSERT_EQ(third->get_thread_info()->m_comm, "init");
+	ASSERT_NE(third->get_thread_info()->get_cwd(), first->get_thread_info()->get_cwd());
+}
+
+TEST_F(sinsp_with_test_input, pipeline_refreshes_the_written_threads)
+{
+	add_default_init_thread();
+	add_simple_thread(100, 100, INIT_TID, "other");
+	open_inspector();
+
+	auto evt = add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_CLOSE_E, 1, (int64_t)0);
+	auto first = evt->snapshot();
+	ASSERT_NE(first->get_thread_info(), nullptr);
+
+	// the writes to another thread don't refresh the snapshots of init
+	add_event_advance_ts(increasing_ts(), 100, PPME_SYSCALL_BRK_4_E, 1, (uint64_t)0);
+	add_event_advance_ts(increasing_ts(), 100, PPME_SYSCALL_BRK_4_X, 4, (uint64_t)0, (uint32_t)1000, (uint32_t)100, (uint32_t)0);
+	evt = add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_CLOSE_X, 1, (int64_t)0);
+	ASSERT_EQ(evt->snapshot()->get_thread_info(), first->get_thread_info());
+
+	// the fd limit of the main thread is written by getrlimit
+	add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_GETRLIMIT_E, 1, (uint8_t)PPM_RLIMIT_NOFILE);
+	evt = add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_GETRLIMIT_X, 3, (int64_t)0, (int64_t)4096, (int64_t)8192);
+	auto second = evt->snapshot();
+	ASSERT_NE(second->get_thread_info(), first->get_thread_info());
+	ASSERT_EQ(get_field_as_string(second.get(), "proc.fdlimit"), "4096");
+
+	// and the shell pipe flags by dup
+	add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_OPEN_E, 3, "/tmp/file", (uint32_t) PPM_O_RDWR, (uint32_t) 0);
+	add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, "/tmp/file", (uint32_t) PPM_O_RDWR, (uint32_t) 0, (uint32_t) 5, (uint64_t)123);
+	add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_DUP_1_E, 1, (int64_t)3);
+	evt = add_event_advance_ts(increasing_ts(), INIT_TID, PPME_SYSCALL_DUP_1_X, 2, (int64_t)1, (int64_t)3);
+	auto third = evt->snapshot();
+	ASSERT_NE(third->get_thread_info(), second->get_thread_info());
+	ASSERT_TRUE(third->get_thread_info()->m_flags & PPM_CL_PIPE_SRC);
+	ASSERT_FALSE(second->get_thread_info()->m_flags & PPM_CL_PIPE_SRC);
+}
+
+// Meant to be run with USE_TSAN: the plugin fields and the container fields
+// are extracted by the workers while the state thread parses the plugin
+// tables and the container events.
+TEST_F(sinsp_with_test_input, pipeline_locks_the_state_fields)
+{
+	plugin_api api;
+	get_plugin_api_sample_syscall_extract(api);
+	auto pl = m_inspector.register_plugin(&api);
+	std::string err;
+	ASSERT_TRUE(pl->init("", err)) << err;
+
+	sinsp_filter_check_list flist;
+	flist.add_filter_check(sinsp_plugin::new_filtercheck(pl));
+
+	const int n_containers = 100;
+	add_default_init_thread();
+	for (int i = 0; i < n_containers; i++)
+	{
+		add_simple_thread(100 + i, 100 + i, INIT_TID, "proc_" + std::to_string(i));
+	}
+	open_inspector();
+
+	for (int i = 0; i < n_containers; i++)
+	{
+		char id[16];
+		snprintf(id, sizeof(id), "%012d", i);
+		m_inspector.get_thread_ref(100 + i)->m_container_id = id;
+
+		// the container shows up while the workers extract the fields of
+		// the events of the previous ones
+		sinsp_container_info container;
+		container.m_type = CT_CONTAINERD;
+		container.m_id = id;
+		container.m_name = "container_" + std::to_string(i);
+		container.set_lookup_status(sinsp_container_lookup::state::SUCCESSFUL);
+		std::string container_json = m_inspector.m_container_manager.container_to_json(container);
+		add_event(increasing_ts(), -1, PPME_CONTAINER_JSON_2_E, 1, container_json.c_str());
+
+		std::string name = "/tmp/file_" + std::to_string(i);
+		add_event(increasing_ts(), 100 + i, PPME_SYSCALL_OPEN_E, 3, name.c_str(), (uint32_t) PPM_O_RDWR, (uint32_t) 0);
+		add_event(increasing_ts(), 100 + i, PPME_SYSCALL_OPEN_X, 6, (uint64_t)3, name.c_str(), (uint32_t) PPM_O_RDWR, (uint32_t) 0, (uint32_t) 5, (uint64_t)123);
+	}
+
+	auto filters = [this, &flist]()
+	{
+		sinsp_filter_compiler compiler(std::make_shared<sinsp_filter_factory>(&m_inspector, flist),
+					       "evt.type = open and evt.dir = < and sample.is_open = 1");
+		return compiler.compile();
+	};
+	auto formatters = [this, &flist]()
+	{
+		return std::make_unique<sinsp_evt_formatter>(&m_inspector, "%sample.proc_name %container.name %fd.name", flist);
+	};
+
+	std::mutex mtx;
+	std::multiset<std::string> outputs;
+	auto on_output = [&](sinsp_evt*, const std::string& output)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		outputs.insert(output);
+	};
+
+	sinsp_pipeline pipeline(&m_inspector, 4, filters, formatters, on_output, 8);
+	while (pipeline.next() == SCAP_SUCCESS)
+	{
+	}
+	pipeline.flush();
+
+	std::multiset<std::string> expected;
+	for (int i = 0; i < n_containers; i++)
+	{
+		std::string n = std::to_string(i);
+		expected.insert("proc_" + n + " container_" + n + " /tmp/file_" + n);
+	}
+	ASSERT_EQ(outputs, expected);
+}
@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include <libsinsp/string_kernels.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <random>
+
+using namespace libsinsp;
+
+// restores the default implementation at the end of a test
+class string_kernels_test : public testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		string_kernels::set_implementation(string_kernels::supported_implementations().front());
+	}
+};
+
+static char fold(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static const char* naive_find(const std::string& s, const std::string& needle, bool icase)
+{
+	for(size_t i = 0; i + needle.size() <= s.size(); i++)
+	{
+		size_t j = 0;
+		while(j < needle.size() && (icase ? fold(s[i + j]) == fold(needle[j]) : s[i + j] == needle[j]))
+		{
+			j++;
+		}
+		if(j == needle.size())
+		{
+			return s.data() + i;
+		}
+	}
+	return nullptr;
+}
+
+TEST_F(string_kernels_test, basic)
+{
+	ASSERT_FALSE(string_kernels::supported_implementations().empty());
+	ASSERT_EQ(string_kernels::supported_implementations().back(), "scalar");
+	ASSERT_FALSE(string_kernels::set_implementation("unknown"));
+
+	for(const auto& impl : string_kernels::supported_implementations())
+	{
+		ASSERT_TRUE(string_kernels::set_implementation(impl));
+		ASSERT_EQ(impl, string_kernels::implementation());
+
+		std::string s = "/usr/bin/python3 -c import os; os.system('/bin/SH -i')";
+		ASSERT_EQ(string_kernels::find(s.data(), s.size(), "os.", 3), s.data() + s.find("os."));
+		ASSERT_EQ(string_kernels::find(s.data(), s.size(), "", 0), s.data());
+		ASSERT_EQ(string_kernels::find(s.data(), s.size(), "/bin/sh", 7), nullptr);
+		ASSERT_EQ(string_kernels::ifind(s.data(), s.size(), "/bin/sh", 7), s.data() + s.find("/bin/SH"));
+		ASSERT_EQ(string_kernels::ifind(s.data(), s.size(), "PYTHON", 6), s.data() + s.find("python"));
+		ASSERT_EQ(string_kernels::ifind(s.data(), 10, "PYTHON", 6), nullptr);
+
+		// the buffers don't need to be NUL-terminated
+		const char buf[] = {'a', 'b', '\0', 'c', 'd'};
+		ASSERT_EQ(string_kernels::find(buf, sizeof(buf), "\0c", 2), buf + 2);
+		ASSERT_TRUE(string_kernels::contains(buf, sizeof(buf), "cd", 2));
+		ASSERT_FALSE(string_kernels::contains(buf, 4, "cd", 2));
+
+		ASSERT_TRUE(string_kernels::iequals("Hello World, Hello World", 24, "hello world, hello WORLD", 24));
+		ASSERT_FALSE(string_kernels::iequals("Hello World, Hello World", 24, "hello world, hello WORLD", 23));
+		ASSERT_FALSE(string_kernels::iequals("@[`{", 4, "`{@[", 4));
+		ASSERT_TRUE(string_kernels::istarts_with("/ETC/passwd", 11, "/etc/", 5));
+		ASSERT_TRUE(string_kernels::iends_with("/tmp/x.SH", 9, ".sh", 3));
+		ASSERT_FALSE(string_kernels::iends_with("sh", 2, ".sh", 3));
+		ASSERT_TRUE(string_kernels::starts_with("/etc/passwd", 11, "/etc/", 5));
+		ASSERT_TRUE(string_kernels::ends_with("/tmp/x.sh", 9, ".sh", 3));
+		ASSERT_TRUE(string_kernels::equals("abc", 3, "abc", 3));
+		ASSERT_FALSE(string_kernels::equals("abc", 3, "abcd", 4));
+	}
+}
+
+// only ASCII letters are folded, the bytes >= 0x80 are compared as they are
+TEST_F(string_kernels_test, non_ascii_bytes)
+{
+	for(const auto& impl : string_kernels::supported_implementations())
+	{
+		ASSERT_TRUE(string_kernels::set_implementation(impl));
+
+		// UTF-8 "É" and "é" only differ in their second byte
+		std::string s = "/home/user/docs/\xC3\x89t\xC3\xA9/CAF\xC3\x89/x";
+		ASSERT_TRUE(string_kernels::icontains(s.data(), s.size(), "caf\xC3\x89", 5));
+		ASSERT_FALSE(string_kernels::icontains(s.data(), s.size(), "caf\xC3\xA9", 5));
+		ASSERT_EQ(string_kernels::ifind(s.data(), s.size(), "\xC3\xA9/", 3), s.data() + s.find("\xC3\xA9/"));
+		ASSERT_EQ(string_kernels::ifind(s.data(), s.size(), "\xC3\x89/", 3), s.data() + s.find("\xC3\x89/"));
+
+		// Latin-1 "É" and "é"
+		ASSERT_FALSE(string_kernels::iequals("\xC9t\xE9", 3, "\xE9T\xE9", 3));
+		ASSERT_TRUE(string_kernels::iequals("\xC9t\xE9", 3, "\xC9T\xE9", 3));
+
+		for(int c = 0x80; c < 0x100; c++)
+		{
+			// long enough to go through the vectorized loops
+			std::string hay(70, 'a');
+			hay[65] = (char)c;
+			char needle[] = {'A', (char)c, 'A'};
+			char other[] = {'A', (char)(c ^ 0x20), 'A'};
+			ASSERT_EQ(string_kernels::ifind(hay.data(), hay.size(), needle, 3), hay.data() + 64) << impl << " " << c;
+			ASSERT_EQ(string_kernels::ifind(hay.data(), hay.size(), other, 3), nullptr) << impl << " " << c;
+			ASSERT_FALSE(string_kernels::iequals(hay.data() + 64, other, 3)) << impl << " " << c;
+		}
+	}
+}
+
+// all the implementations must agree with a naive search, on any length
+// and alignment of the haystack and the needle
+TEST_F(string_kernels_test, same_as_naive)
+{
+	std::mt19937 rng(5);
+	auto random_string = [&](size_t len)
+	{
+		static const std::string alphabet = "aAbB@[`{/";
+		std::string res;
+		for(size_t i = 0; i < len; i++)
+		{
+			res.push_back(alphabet[rng() % alphabet.size()]);
+		}
+		return res;
+	};
+
+	for(const auto& impl : string_kernels::supported_implementations())
+	{
+		ASSERT_TRUE(string_kernels::set_implementation(impl));
+		for(int i = 0; i < 20000; i++)
+		{
+			auto s = random_string(rng() % 100);
+			auto needle = random_string(rng() % 6);
+			if(!s.empty() && rng() % 2)
+			{
+				// make sure to have some matches, and some long needles
+				size_t from = rng() % s.size();
+				needle = s.substr(from, rng() % (s.size() - from + 1));
+			}
+
+			auto expected = naive_find(s, needle, false);
+			ASSERT_EQ(string_kernels::find(s.data(), s.size(), needle.data(), needle.size()), expected)
+				<< impl << ": '" << s << "' '" << needle << "'";
+			expected = naive_find(s, needle, true);
+			ASSERT_EQ(string_kernels::ifind(s.data(), s.size(), needle.data(), needle.size()), expected)
+				<< impl << ": '" << s << "' '" << needle << "'";
+
+			auto other = s;
+			for(auto& c : other)
+			{
+				c = (rng() % 2) ? fold(c) : c;
+			}
+			if(!other.empty() && rng() % 4 == 0)
+			{
+				other[rng() % other.size()] = '`';
+			}
+			bool equal = true;
+			for(size_t j = 0; j < s.size(); j++)
+			{
+				equal = equal && fold(s[j]) == fold(other[j]);
+			}
+			ASSERT_EQ(string_kernels::iequals(s.data(), other.data(), s.size()), equal)
+				<< impl << ": '" << s << "' '" << other << "'";
+		}
+	}
+}
+
+TEST_F(string_kernels_test, DISABLED_benchmark)
+{
+	using clock = std::chrono::steady_clock;
+
+	// a corpus of realistic command lines and paths
+	std::mt19937 rng(3);
+	static const std::vector<std::string> words = {
+		"usr", "bin", "lib", "x86_64-linux-gnu", "python3", "node", "java", "bash", "sh",
+		"etc", "var", "log", "tmp", "home", "ubuntu", "config", "systemd", "kubelet",
+		"--verbose", "-c", "-Xmx512m", "--config", "/dev/null", "app.jar", "index.js",
+	};
+	std::vector<std::string> corpus;
+	for(int i = 0; i < 2000; i++)
+	{
+		std::string s;
+		size_t n = 3 + rng() % 12;
+		for(size_t j = 0; j < n; j++)
+		{
+			s += (i % 2 ? "/" : " ") + words[rng() % words.size()];
+		}
+		corpus.push_back(s);
+	}
+	static const std::vector<std::string> needles = {"/etc/shadow", "python", "ld_preload", "Kubelet", "--Config"};
+
+	const int n_loops = 50;
+	uint64_t n_searches = (uint64_t)n_loops * corpus.size() * needles.size();
+	uint64_t matches = 0;
+	auto bench = [&](const std::function<bool(const std::string&, const std::string&)>& fn)
+	{
+		auto start = clock::now();
+		for(int k = 0; k < n_loops; k++)
+		{
+			for(const auto& s : corpus)
+			{
+				for(const auto& n : needles)
+				{
+					matches += fn(s, n);
+				}
+			}
+		}
+		return std::chrono::duration<double, std::nano>(clock::now() - start).count() / n_searches;
+	};
+
+	printf("libc: strstr %.1f ns, strcasestr %.1f ns, memmem %.1f ns\n",
+	       bench([](const std::string& s, const std::string& n) { return strstr(s.c_str(), n.c_str()) != nullptr; }),
+	       bench([](const std::string& s, const std::string& n) { return strcasestr(s.c_str(), n.c_str()) != nullptr; }),
+	       bench([](const std::string& s, const std::string& n) { return memmem(s.data(), s.size(), n.data(), n.size()) != nullptr; }));
+
+	for(const auto& impl : string_kernels::supported_implementations())
+	{
+		string_kernels::set_implementation(impl);
+		printf("%s: contains %.1f ns, icontains %.1f ns, contains with strlen %.1f ns\n",
+		       impl.c_str(),
+		       bench([](const std::string& s, const std::string& n) { return string_kernels::contains(s.data(), s.size(), n.data(), n.size()); }),
+		       bench([](const std::string& s, const std::string& n) { return string_kernels::icontains(s.data(), s.size(), n.data(), n.size()); }),
+		       bench([](const std::string& s, const std::string& n) { return string_kernels::contains(s.c_str(), strlen(s.c_str()), n.c_str(), strlen(n.c_str())); }));
+	}
+	printf("(matches=%lu)\n", (unsigned long)matches);
+}
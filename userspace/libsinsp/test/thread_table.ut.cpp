@@ -232,6 +232,84 @@ TEST_F(sinsp_with_test_input, THRD_TABLE_remove_inactive_threads)
 	ASSERT_EQ(DEFAULT_TREE_NUM_PROCS - 1, m_inspector.m_thread_manager->get_thread_count());
 }
 
+TEST_F(sinsp_with_test_input, THRD_TABLE_remove_inactive_threads_incrementally)
+{
+	DEFAULT_TREE
+
+	m_inspector.m_thread_manager->get_threads()->loop([](sinsp_threadinfo& tinfo) {
+		tinfo.m_lastaccess_ts = 70;
+		return true;
+	});
+	set_threadinfo_last_access_time(p2_t3_tid, 20);
+
+	m_inspector.m_thread_manager->set_last_flush_time_ns(1);
+	m_inspector.m_threads_purging_scan_time_ns = 2;
+	m_inspector.m_thread_timeout_ns = 20;
+	m_inspector.set_lastevent_ts(80);
+	m_inspector.set_auto_threads_purging_batch_size(1);
+
+	/* Each call checks a single thread, first to remove it and then to clean its dependencies */
+	uint32_t calls = 0;
+	while(m_inspector.m_thread_manager->remove_inactive_threads())
+	{
+		calls++;
+		ASSERT_LE(calls, 2 * DEFAULT_TREE_NUM_PROCS);
+	}
+	ASSERT_GT(calls, DEFAULT_TREE_NUM_PROCS);
+	ASSERT_EQ(DEFAULT_TREE_NUM_PROCS - 1, m_inspector.m_thread_manager->get_thread_count());
+	ASSERT_FALSE(m_inspector.get_thread_ref(p2_t3_tid, false));
+	ASSERT_THREAD_GROUP_INFO(p2_t1_pid, 2, false, 2, 2, p2_t1_tid, p2_t2_tid);
+
+	/* The next scan starts only after the purging interval */
+	ASSERT_FALSE(m_inspector.m_thread_manager->remove_inactive_threads());
+	m_inspector.set_lastevent_ts(83);
+	ASSERT_TRUE(m_inspector.m_thread_manager->remove_inactive_threads());
+}
+
+TEST_F(sinsp_with_test_input, THRD_TABLE_remove_inactive_threads_liveness_checks_budget)
+{
+	add_default_init_thread();
+	const int64_t n_threads = 40;
+	for(int64_t tid = 100; tid < 100 + n_threads; tid++)
+	{
+		add_simple_thread(tid, tid, INIT_TID);
+	}
+	open_inspector();
+	m_inspector.set_sinsp_stats_v2_enabled();
+
+	m_inspector.m_thread_manager->get_threads()->loop([](sinsp_threadinfo& tinfo) {
+		tinfo.m_lastaccess_ts = tinfo.m_tid == INIT_TID ? 80 : 20;
+		return true;
+	});
+
+	m_inspector.m_thread_manager->set_last_flush_time_ns(1);
+	m_inspector.m_threads_purging_scan_time_ns = 2;
+	m_inspector.m_thread_timeout_ns = 20;
+	m_inspector.set_lastevent_ts(80);
+	m_inspector.set_auto_threads_purging_batch_size(256);
+	m_inspector.set_auto_threads_purging_liveness_checks(4);
+
+	/* All the threads fit in a batch, but only 4 of them are checked in /proc for each call */
+	uint32_t calls = 0;
+	uint64_t purging_time_ns = 0;
+	size_t n_threads_before = m_inspector.m_thread_manager->get_thread_count();
+	while(m_inspector.m_thread_manager->remove_inactive_threads())
+	{
+		calls++;
+		ASSERT_LE(calls, n_threads);
+		size_t n_threads_after = m_inspector.m_thread_manager->get_thread_count();
+		ASSERT_LE(n_threads_before - n_threads_after, 4);
+		n_threads_before = n_threads_after;
+
+		/* Every call accounts for its own purging time */
+		ASSERT_GE(m_inspector.get_sinsp_stats_v2()->m_threads_purging_time_ns, purging_time_ns);
+		purging_time_ns = m_inspector.get_sinsp_stats_v2()->m_threads_purging_time_ns;
+	}
+	ASSERT_GE(calls, n_threads / 4);
+	ASSERT_EQ(m_inspector.m_thread_manager->get_thread_count(), 1);
+	ASSERT_GT(purging_time_ns, 0);
+}
+
 TEST_F(sinsp_with_test_input, THRD_TABLE_traverse_default_tree)
 {
 	/* Instantiate the default tree */
@@ -630,3 +708,20 @@ TEST_F(sinsp_with_test_input, THRD_TABLE_add_and_remove_many_children)
 	/* Only init process */
 	ASSERT_EQ(m_inspector.m_thread_manager->get_thread_count(), 1);
 }
+
+TEST_F(sinsp_with_test_input, THRD_TABLE_get_thread_ptr)
+{
+	DEFAULT_TREE
+
+	/* The raw lookup returns the same object of the shared one */
+	auto p5_t2 = m_inspector.get_thread_ref(p5_t2_tid, false, false);
+	ASSERT_EQ(m_inspector.get_thread_ptr(p5_t2_tid, false, false), p5_t2.get());
+	ASSERT_EQ(p5_t2.use_count(), 2);
+
+	/* The cached entry must not be returned once the thread is removed */
+	p5_t2.reset();
+	ASSERT_TRUE(m_inspector.get_thread_ptr(p5_t2_tid, false, false));
+	remove_thread(p5_t2_tid, 0);
+	ASSERT_EQ(m_inspector.get_thread_ptr(p5_t2_tid, false, false), nullptr);
+	ASSERT_EQ(m_inspector.get_thread_ptr(p5_t1_tid), m_inspector.get_thread_ref(p5_t1_tid).get());
+}
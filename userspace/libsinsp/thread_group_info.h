@@ -109,9 +109,21 @@ public:
 		}
 	}
 
-	inline sinsp_threadinfo* get_first_thread() const { return m_threads.front().lock().get(); }
+	inline sinsp_threadinfo* get_first_thread() const
+	{
+		return m_threads.empty() ? nullptr : m_threads.front().lock().get();
+	}
+
+	/* Copy of the counters of the group without its threads, for the thread snapshots */
+	inline std::shared_ptr<thread_group_info> snapshot() const
+	{
+		return std::shared_ptr<thread_group_info>(new thread_group_info(m_pid, m_alive_count, m_reaper));
+	}
 
 private:
+	thread_group_info(int64_t group_pid, uint64_t alive_count, bool reaper):
+		m_pid(group_pid), m_alive_count(alive_count), m_reaper(reaper) {}
+
 	int64_t m_pid; /* unsigned if we want to use `-1` as an invalid value */
 	uint64_t m_alive_count;
 	std::list<std::weak_ptr<sinsp_threadinfo>> m_threads;
@@ -46,9 +46,11 @@ static void copy_ipv6_address(uint32_t* dest, uint32_t* src)
 
 sinsp_threadinfo::sinsp_threadinfo(sinsp* inspector, std::shared_ptr<libsinsp::state::dynamic_struct::field_infos> dyn_fields):
 	table_entry(dyn_fields),
-	m_cgroups(new cgroups_t),
 	m_inspector(inspector),
-	m_fdtable(inspector)
+	m_fdtable(inspector),
+	m_snapshot(nullptr),
+	m_snapshot_gen(0),
+	m_snapshot_cache_gen(0)
 {
 	init();
 }
@@ -162,6 +164,104 @@ sinsp_threadinfo::~sinsp_threadinfo()
 	}
 }
 
+// shared by all the inspectors, as the class operator new can't tell them
+// apart; never destroyed, thread infos can be freed by static destructors
+static libsinsp::object_allocation_hook& threadinfo_allocation_hook()
+{
+	static auto hook = new libsinsp::object_allocation_hook();
+	return *hook;
+}
+
+// hash and memory estimate of the interned lists
+struct strings_hash
+{
+	size_t operator()(const std::vector<std::string>& v) const
+	{
+		size_t ret = v.size();
+		for(const auto& str : v)
+		{
+			hash_combine(ret, str);
+		}
+		return ret;
+	}
+
+	size_t operator()(const sinsp_threadinfo::cgroups_t& v) const
+	{
+		size_t ret = v.size();
+		for(const auto& it : v)
+		{
+			hash_combine(ret, it.first);
+			hash_combine(ret, it.second);
+		}
+		return ret;
+	}
+};
+
+struct strings_size
+{
+	size_t operator()(const std::vector<std::string>& v) const
+	{
+		size_t ret = sizeof(v) + v.capacity() * sizeof(std::string);
+		for(const auto& str : v)
+		{
+			ret += str.capacity();
+		}
+		return ret;
+	}
+
+	size_t operator()(const sinsp_threadinfo::cgroups_t& v) const
+	{
+		size_t ret = sizeof(v) + v.capacity() * sizeof(sinsp_threadinfo::cgroups_t::value_type);
+		for(const auto& it : v)
+		{
+			ret += it.first.capacity() + it.second.capacity();
+		}
+		return ret;
+	}
+};
+
+using strings_intern_pool = libsinsp::intern_pool<std::vector<std::string>, strings_hash, strings_size>;
+using cgroups_intern_pool = libsinsp::intern_pool<sinsp_threadinfo::cgroups_t, strings_hash, strings_size>;
+
+// process-global and never destroyed, like the allocation hook: the lists
+// are interned when a thread info sets them, and a thread info doesn't need
+// an inspector. Processes running the same program usually share arguments
+// and environment, and the processes of a container its cgroups, so these
+// lists are interned instead of copied into every thread info
+static strings_intern_pool& global_args_pool()
+{
+	static auto pool = new strings_intern_pool();
+	return *pool;
+}
+
+static strings_intern_pool& global_env_pool()
+{
+	static auto pool = new strings_intern_pool();
+	return *pool;
+}
+
+static cgroups_intern_pool& global_cgroups_pool()
+{
+	static auto pool = new cgroups_intern_pool();
+	return *pool;
+}
+
+static const std::vector<std::string>& strings_or_empty(const std::shared_ptr<const std::vector<std::string>>& v)
+{
+	static const std::vector<std::string> empty;
+	return v ? *v : empty;
+}
+
+void* sinsp_threadinfo::operator new(size_t size)
+{
+	return threadinfo_allocation_hook().allocate(size);
+}
+
+void sinsp_threadinfo::operator delete(void* p, size_t size)
+{
+	threadinfo_allocation_hook().deallocate(p, size);
+}
+
 void sinsp_threadinfo::fix_sockets_coming_from_proc()
 {
 	m_fdtable.loop([this](int64_t fd, sinsp_fdinfo& fdi) {
@@ -215,7 +315,8 @@ void sinsp_threadinfo::compute_program_hash()
 	//
 	// The program hash includes the arguments as well
 	//
-	for (auto arg = m_args.begin(); arg != m_args.end() && rem_len > 0; ++arg)
+	const auto& args = get_args();
+	for (auto arg = args.begin(); arg != args.end() && rem_len > 0; ++arg)
 	{
 		if (arg->size() >= rem_len)
 		{
@@ -513,6 +614,7 @@ void sinsp_threadinfo::init(scap_threadinfo* pi)
 
 void sinsp_threadinfo::set_user(uint32_t uid)
 {
+	invalidate_snapshot();
 	scap_userinfo *user = m_inspector->m_usergroup_manager.get_user(m_container_id, uid);
 	if (!user)
 	{
@@ -543,6 +645,7 @@ void sinsp_threadinfo::set_user(uint32_t uid)
 
 void sinsp_threadinfo::set_group(uint32_t gid)
 {
+	invalidate_snapshot();
 	scap_groupinfo *group = m_inspector->m_usergroup_manager.get_group(m_container_id, gid);
 	if (!group)
 	{
@@ -569,6 +672,7 @@ void sinsp_threadinfo::set_group(uint32_t gid)
 
 void sinsp_threadinfo::set_loginuser(uint32_t loginuid)
 {
+	invalidate_snapshot();
 	scap_userinfo *login_user = m_inspector->m_usergroup_manager.get_user(m_container_id, loginuid);
 
 	if (login_user)
@@ -592,28 +696,28 @@ void sinsp_threadinfo::set_loginuser(uint32_t loginuid)
 	}
 }
 
-sinsp_threadinfo::cgroups_t& sinsp_threadinfo::cgroups() const
+const sinsp_threadinfo::cgroups_t& sinsp_threadinfo::cgroups() const
 {
 	if(m_cgroups)
 	{
 		return *m_cgroups;
 	}
 
-	static cgroups_t empty;
+	static const cgroups_t empty;
 	return empty;
 }
 
-std::string sinsp_threadinfo::get_comm() const
+const std::string& sinsp_threadinfo::get_comm() const
 {
 	return m_comm;
 }
 
-std::string sinsp_threadinfo::get_exe() const
+const std::string& sinsp_threadinfo::get_exe() const
 {
 	return m_exe;
 }
 
-std::string sinsp_threadinfo::get_exepath() const
+const std::string& sinsp_threadinfo::get_exepath() const
 {
 	return m_exepath;
 }
@@ -625,11 +729,18 @@ void sinsp_threadinfo::set_args(const char* args, size_t len)
 
 void sinsp_threadinfo::set_args(std::vector<std::string> args)
 {
-	m_args = args;
+	m_args = global_args_pool().intern(std::move(args));
+	invalidate_snapshot();
+}
+
+const std::vector<std::string>& sinsp_threadinfo::get_args() const
+{
+	return strings_or_empty(m_args);
 }
 
 void sinsp_threadinfo::set_env(const char* env, size_t len)
 {
+	invalidate_snapshot();
 	if (len == SCAP_MAX_ENV_SIZE && m_inspector->large_envs_enabled())
 	{
 		// the environment is possibly truncated, try to read from /proc
@@ -643,7 +754,13 @@ void sinsp_threadinfo::set_env(const char* env, size_t len)
 		}
 	}
 
-	m_env = sinsp_split(env, len, '\0');
+	m_env = global_env_pool().intern(sinsp_split(env, len, '\0'));
+}
+
+void sinsp_threadinfo::set_env(std::vector<std::string> env)
+{
+	m_env = global_env_pool().intern(std::move(env));
+	invalidate_snapshot();
 }
 
 bool sinsp_threadinfo::set_env_from_proc() {
@@ -656,16 +773,17 @@ bool sinsp_threadinfo::set_env_from_proc() {
 		return false;
 	}
 
-	m_env.clear();
+	std::vector<std::string> envs;
 	while (environment) {
 		std::string env;
 		getline(environment, env, '\0');
 		if (!env.empty())
 		{
-			m_env.emplace_back(env);
+			envs.emplace_back(env);
 		}
 	}
 
+	m_env = global_env_pool().intern(std::move(envs));
 	return true;
 }
 
@@ -673,7 +791,7 @@ const std::vector<std::string>& sinsp_threadinfo::get_env()
 {
 	if(is_main_thread())
 	{
-		return m_env;
+		return strings_or_empty(m_env);
 	}
 	else
 	{
@@ -686,7 +804,7 @@ const std::vector<std::string>& sinsp_threadinfo::get_env()
 		{
 			// it should never happen but provide a safe fallback just in case
 			// except during sinsp::scap_open() (see sinsp::get_thread()).
-			return m_env;
+			return strings_or_empty(m_env);
 		}
 	}
 }
@@ -739,7 +857,8 @@ void sinsp_threadinfo::set_cgroups(const char* cgroups, size_t len)
 
 void sinsp_threadinfo::set_cgroups(std::vector<std::string> cgroups)
 {
-	decltype(m_cgroups) tmp_cgroups(new cgroups_t);
+	invalidate_snapshot();
+	cgroups_t tmp_cgroups;
 
 	for( auto &def : cgroups)
 	{
@@ -774,15 +893,188 @@ void sinsp_threadinfo::set_cgroups(std::vector<std::string> cgroups)
 			subsys = "blkio";
 		}
 
-		tmp_cgroups->push_back(std::make_pair(subsys, cgroup));
+		tmp_cgroups.push_back(std::make_pair(subsys, cgroup));
 	}
 
-	m_cgroups.swap(tmp_cgroups);
+	m_cgroups = global_cgroups_pool().intern(std::move(tmp_cgroups));
 }
 
+struct sinsp_threadinfo::snapshot_threads
+{
+	std::unordered_map<int64_t, sinsp_threadinfo*> m_threads;
+	std::vector<std::shared_ptr<sinsp_threadinfo>> m_copies;
+
+	inline sinsp_threadinfo* find(int64_t tid) const
+	{
+		auto it = m_threads.find(tid);
+		return it == m_threads.end() ? nullptr : it->second;
+	}
+};
+
 sinsp_threadinfo* sinsp_threadinfo::get_parent_thread()
 {
-	return m_inspector->get_thread_ref(m_ptid, false).get();
+	if(m_snapshot != nullptr)
+	{
+		return m_snapshot->find(m_ptid);
+	}
+	return m_inspector->get_thread_ptr(m_ptid, false);
+}
+
+sinsp_threadinfo* sinsp_threadinfo::lookup_thread(int64_t tid)
+{
+	if(m_snapshot != nullptr)
+	{
+		return m_snapshot->find(tid);
+	}
+	return m_inspector->get_thread_ptr(tid, false, true);
+}
+
+std::shared_ptr<sinsp_threadinfo> sinsp_threadinfo::snapshot()
+{
+	if(m_inspector == nullptr)
+	{
+		return build_snapshot();
+	}
+
+	// the copied threads are only looked at while no thread was removed
+	uint64_t gen = m_inspector->m_thread_manager->get_snapshot_gen();
+	bool valid = m_snapshot_cache != nullptr && m_snapshot_cache_gen == gen;
+	for(auto it = m_snapshot_cache_sources.begin(); valid && it != m_snapshot_cache_sources.end(); ++it)
+	{
+		valid = it->first->m_snapshot_gen == it->second;
+	}
+
+	if(!valid)
+	{
+		m_snapshot_cache_sources.clear();
+		m_snapshot_cache = build_snapshot(&m_snapshot_cache_sources);
+		m_snapshot_cache_gen = gen;
+	}
+	return m_snapshot_cache;
+}
+
+std::shared_ptr<sinsp_threadinfo> sinsp_threadinfo::build_snapshot(
+	std::vector<std::pair<const sinsp_threadinfo*, uint64_t>>* sources) const
+{
+	auto threads = std::make_shared<snapshot_threads>();
+	auto ret = copy_state();
+	ret->m_snapshot_owner = threads;
+	ret->m_snapshot = threads.get();
+	threads->m_threads[m_tid] = ret.get();
+	if(sources != nullptr)
+	{
+		sources->emplace_back(this, m_snapshot_gen);
+	}
+
+	if(m_inspector == nullptr)
+	{
+		return ret;
+	}
+
+	// the lookups don't update the thread table cache, nor the access
+	// time of the threads
+	auto copy_thread = [this, &threads, sources](int64_t tid) -> sinsp_threadinfo*
+	{
+		if(tid < 0 || threads->m_threads.find(tid) != threads->m_threads.end())
+		{
+			return nullptr;
+		}
+		sinsp_threadinfo* tinfo = m_inspector->get_thread_ptr(tid, false, true);
+		if(tinfo == nullptr)
+		{
+			return nullptr;
+		}
+		auto copy = tinfo->copy_state();
+		copy->m_snapshot = threads.get();
+		threads->m_threads[tid] = copy.get();
+		threads->m_copies.push_back(std::move(copy));
+		if(sources != nullptr)
+		{
+			sources->emplace_back(tinfo, tinfo->m_snapshot_gen);
+		}
+		return tinfo;
+	};
+
+	// the ancestors and the main threads of this thread and of its
+	// ancestors, stopping at the threads already copied, so also on loops
+	std::vector<const sinsp_threadinfo*> pending = {this};
+	while(!pending.empty())
+	{
+		const sinsp_threadinfo* tinfo = pending.back();
+		pending.pop_back();
+		for(int64_t tid : {tinfo->m_pid, tinfo->m_ptid})
+		{
+			if(auto copied = copy_thread(tid))
+			{
+				pending.push_back(copied);
+			}
+		}
+	}
+
+	copy_thread(m_sid);
+	copy_thread(m_vpgid);
+	return ret;
+}
+
+std::shared_ptr<sinsp_threadinfo> sinsp_threadinfo::copy_state() const
+{
+	std::shared_ptr<sinsp_threadinfo> ret = m_inspector
+		? std::shared_ptr<sinsp_threadinfo>(m_inspector->build_threadinfo())
+		: std::make_shared<sinsp_threadinfo>();
+
+	// the copy is read from other threads, its fd table must not look into
+	// the inspector or update its stats
+	ret->m_fdtable = sinsp_fdtable(nullptr);
+
+	ret->m_tid = m_tid;
+	ret->m_pid = m_pid;
+	ret->m_ptid = m_ptid;
+	ret->m_reaper_tid = m_reaper_tid;
+	ret->m_sid = m_sid;
+	ret->m_comm = m_comm;
+	ret->m_exe = m_exe;
+	ret->m_exepath = m_exepath;
+	ret->m_exe_writable = m_exe_writable;
+	ret->m_exe_upper_layer = m_exe_upper_layer;
+	ret->m_exe_from_memfd = m_exe_from_memfd;
+	ret->m_args = m_args;
+	ret->m_env = m_env;
+	ret->m_cgroups = m_cgroups;
+	ret->m_container_id = m_container_id;
+	ret->m_flags = m_flags;
+	ret->m_fdlimit = m_fdlimit;
+	ret->m_user = m_user;
+	ret->m_loginuser = m_loginuser;
+	ret->m_group = m_group;
+	ret->m_cap_permitted = m_cap_permitted;
+	ret->m_cap_effective = m_cap_effective;
+	ret->m_cap_inheritable = m_cap_inheritable;
+	ret->m_exe_ino = m_exe_ino;
+	ret->m_exe_ino_ctime = m_exe_ino_ctime;
+	ret->m_exe_ino_mtime = m_exe_ino_mtime;
+	ret->m_exe_ino_ctime_duration_clone_ts = m_exe_ino_ctime_duration_clone_ts;
+	ret->m_exe_ino_ctime_duration_pidns_start = m_exe_ino_ctime_duration_pidns_start;
+	ret->m_vmsize_kb = m_vmsize_kb;
+	ret->m_vmrss_kb = m_vmrss_kb;
+	ret->m_vmswap_kb = m_vmswap_kb;
+	ret->m_pfmajor = m_pfmajor;
+	ret->m_pfminor = m_pfminor;
+	ret->m_vtid = m_vtid;
+	ret->m_vpid = m_vpid;
+	ret->m_vpgid = m_vpgid;
+	ret->m_pidns_init_start_ts = m_pidns_init_start_ts;
+	ret->m_root = m_root;
+	ret->m_program_hash = m_program_hash;
+	ret->m_program_hash_scripts = m_program_hash_scripts;
+	ret->m_tty = m_tty;
+	ret->m_tginfo = m_tginfo ? m_tginfo->snapshot() : nullptr;
+	ret->m_filtered_out = m_filtered_out;
+	ret->m_category = m_category;
+	ret->m_clone_ts = m_clone_ts;
+	ret->m_lastexec_ts = m_lastexec_ts;
+	ret->m_cwd = m_cwd;
+	ret->m_parent_loop_detected = m_parent_loop_detected;
+	return ret;
 }
 
 sinsp_fdinfo* sinsp_threadinfo::add_fd(int64_t fd, std::unique_ptr<sinsp_fdinfo> fdinfo)
@@ -904,7 +1196,7 @@ sinsp_threadinfo* sinsp_threadinfo::get_cwd_root()
 	}
 }
 
-std::string sinsp_threadinfo::get_cwd()
+const std::string& sinsp_threadinfo::get_cwd()
 {
 	// Ideally we should use get_cwd_root()
 	// but scap does not read CLONE_FS from /proc
@@ -920,7 +1212,8 @@ std::string sinsp_threadinfo::get_cwd()
 	else
 	{
 		///todo(@Andreagit97) not sure we want to return "./" it seems like a valid path
-		return "./";
+		static const std::string s_default_cwd = "./";
+		return s_default_cwd;
 	}
 }
 
@@ -934,6 +1227,7 @@ void sinsp_threadinfo::update_cwd(std::string_view cwd)
 	}
 
 	tinfo->m_cwd = sinsp_utils::concatenate_paths(m_cwd, cwd);
+	tinfo->invalidate_snapshot();
 
 	if(tinfo->m_cwd.empty() || tinfo->m_cwd.back() != '/')
 	{
@@ -964,11 +1258,15 @@ uint64_t sinsp_threadinfo::get_fd_usage_pct()
 }
 
 double sinsp_threadinfo::get_fd_usage_pct_d()
+{
+	return get_fd_usage_pct_d(get_fd_opencount());
+}
+
+double sinsp_threadinfo::get_fd_usage_pct_d(uint64_t fd_opencount)
 {
 	int64_t fdlimit = get_fd_limit();
 	if(fdlimit > 0)
 	{
-		uint64_t fd_opencount = get_fd_opencount();
 		ASSERT(fd_opencount <= (uint64_t) fdlimit);
 		if(fd_opencount <= (uint64_t) fdlimit)
 		{
@@ -1131,7 +1429,7 @@ void sinsp_threadinfo::populate_cmdline(std::string &cmdline, const sinsp_thread
 {
 	cmdline = tinfo->get_comm();
 
-	for (const auto& arg : tinfo->m_args)
+	for (const auto& arg : tinfo->get_args())
 	{
 		cmdline += " ";
 		cmdline += arg;
@@ -1183,18 +1481,18 @@ std::string sinsp_threadinfo::get_path_for_dir_fd(int64_t dir_fd)
 
 size_t sinsp_threadinfo::args_len() const
 {
-	return strvec_len(m_args);
+	return strvec_len(get_args());
 }
 
 size_t sinsp_threadinfo::env_len() const
 {
-	return strvec_len(m_env);
+	return strvec_len(strings_or_empty(m_env));
 }
 
 void sinsp_threadinfo::args_to_iovec(struct iovec **iov, int *iovcnt,
 				     std::string &rem) const
 {
-	return strvec_to_iovec(m_args,
+	return strvec_to_iovec(get_args(),
 			       iov, iovcnt,
 			       rem);
 }
@@ -1202,7 +1500,7 @@ void sinsp_threadinfo::args_to_iovec(struct iovec **iov, int *iovcnt,
 void sinsp_threadinfo::env_to_iovec(struct iovec **iov, int *iovcnt,
 				    std::string &rem) const
 {
-	return strvec_to_iovec(m_env,
+	return strvec_to_iovec(strings_or_empty(m_env),
 			       iov, iovcnt,
 			       rem);
 }
@@ -1387,10 +1685,13 @@ sinsp_thread_manager::sinsp_thread_manager(sinsp* inspector)
 
 void sinsp_thread_manager::clear()
 {
+	invalidate_snapshots();
 	m_threadtable.clear();
 	m_thread_groups.clear();
 	m_last_tid = 0;
 	m_last_flush_time_ns = 0;
+	m_purge_tids.clear();
+	m_purge_pos = 0;
 }
 
 /* This is called on the table after the `/proc` scan */
@@ -1419,6 +1720,9 @@ void sinsp_thread_manager::create_thread_dependencies(const std::shared_ptr<sins
 		return;
 	}
 
+	/* The thread group and the parent of the thread change */
+	invalidate_snapshots();
+
 	bool reaper = false;
 	/* reaper should be true if we are an init process for the init namespace or for an inner namespace */
 	if(tinfo->m_pid == 1 || tinfo->m_vpid == 1)
@@ -1474,6 +1778,24 @@ std::unique_ptr<sinsp_fdinfo> sinsp_thread_manager::new_fdinfo() const
 	return sinsp_fdtable(m_inspector).new_fdinfo();
 }
 
+void sinsp_thread_manager::set_threadinfo_allocator(std::shared_ptr<libsinsp::object_allocator> allocator)
+{
+	threadinfo_allocation_hook().set_allocator(std::move(allocator));
+}
+
+libsinsp::object_allocator_stats sinsp_thread_manager::get_threadinfo_allocator_stats()
+{
+	return threadinfo_allocation_hook().get_stats();
+}
+
+libsinsp::intern_pool_stats sinsp_thread_manager::get_threadinfo_interning_stats()
+{
+	libsinsp::intern_pool_stats ret = global_args_pool().get_stats();
+	ret += global_env_pool().get_stats();
+	ret += global_cgroups_pool().get_stats();
+	return ret;
+}
+
 /* Can be called when:
  * 1. We crafted a new event to create in clone parsers. (`from_scap_proctable==false`)
  * 2. We are doing a proc scan with a callback or without. (`from_scap_proctable==true`)
@@ -1518,6 +1840,7 @@ std::shared_ptr<sinsp_threadinfo> sinsp_thread_manager::add_thread(std::unique_p
 
 	tinfo_shared_ptr->compute_program_hash();
 	m_threadtable.put(tinfo_shared_ptr);
+	invalidate_snapshots();
 
 	if (m_inspector != nullptr && m_inspector->get_sinsp_stats_v2())
 	{
@@ -1674,6 +1997,9 @@ void sinsp_thread_manager::remove_thread(int64_t tid)
 		return;
 	}
 
+	/* This can reparent other threads */
+	invalidate_snapshots();
+
 	/* [Remove invalid threads]
 	 * All threads should have a m_tginfo apart from the invalid ones
 	 * which don't have a group or children.
@@ -1725,7 +2051,7 @@ void sinsp_thread_manager::remove_thread(int64_t tid)
 			 * We should have the reaper thread in the table, but if we don't have
 			 * it, we try to create it from /proc
 			 */
-			reaper_tinfo = m_inspector->get_thread_ref(thread_to_remove->m_reaper_tid , true).get();
+			reaper_tinfo = m_inspector->get_thread_ptr(thread_to_remove->m_reaper_tid , true);
 		}
 
 		if(reaper_tinfo == nullptr || reaper_tinfo->is_invalid())
@@ -1812,21 +2138,144 @@ void sinsp_thread_manager::clear_thread_pointers(sinsp_threadinfo& tinfo)
 	}
 }
 
+void sinsp_thread_manager::reset_thread_dependencies(sinsp_threadinfo& tinfo)
+{
+	tinfo.clean_expired_children();
+	/* Little optimization: only the main thread cleans the thread group from expired threads.
+	 * Downside: if the main thread is not present in the thread group because we lost it we don't
+	 * clean the thread group from expired threads.
+	 */
+	if(tinfo.is_main_thread() && tinfo.m_tginfo != nullptr)
+	{
+		tinfo.m_tginfo->clean_expired_threads();
+	}
+	clear_thread_pointers(tinfo);
+}
+
 void sinsp_thread_manager::reset_child_dependencies()
 {
 	m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
-		tinfo.clean_expired_children();
-		/* Little optimization: only the main thread cleans the thread group from expired threads.
-		 * Downside: if the main thread is not present in the thread group because we lost it we don't
-		 * clean the thread group from expired threads.
+		reset_thread_dependencies(tinfo);
+		return true;
+	});
+}
+
+/* Returns true when the table is being scanned */
+bool sinsp_thread_manager::remove_inactive_threads()
+{
+	if(m_last_flush_time_ns == 0)
+	{
+		//
+		// Set the first table scan for 30 seconds in, so that we can spot bugs in the logic without having
+		// to wait for tens of minutes
+		//
+		if(m_inspector->m_threads_purging_scan_time_ns > 30 * ONE_SECOND_IN_NS)
+		{
+			m_last_flush_time_ns =
+				(m_inspector->get_lastevent_ts() - m_inspector->m_threads_purging_scan_time_ns + 30 * ONE_SECOND_IN_NS);
+		}
+		else
+		{
+			m_last_flush_time_ns =
+				(m_inspector->get_lastevent_ts() - m_inspector->m_threads_purging_scan_time_ns);
+		}
+	}
+
+	if(m_purge_tids.empty())
+	{
+		if(m_inspector->get_lastevent_ts() <=
+			m_last_flush_time_ns + m_inspector->m_threads_purging_scan_time_ns)
+		{
+			return false;
+		}
+
+		m_last_flush_time_ns = m_inspector->get_lastevent_ts();
+
+		libsinsp_logger()->format(sinsp_logger::SEV_INFO, "Flushing thread table");
+
+		/* Checking a thread can mean looking into /proc, so rather than looping over the
+		 * whole table here we take its tids and check a batch of them for each event.
 		 */
-		if(tinfo.is_main_thread() && tinfo.m_tginfo != nullptr)
+		m_purge_tids.reserve(m_threadtable.size());
+		m_threadtable.const_loop([&] (const sinsp_threadinfo& tinfo) {
+			m_purge_tids.push_back(tinfo.m_tid);
+			return true;
+		});
+		m_purge_pos = 0;
+		m_purge_removing = true;
+	}
+
+	purge_inactive_threads(m_inspector->m_threads_purging_batch_size,
+			       std::max<uint32_t>(m_inspector->m_threads_purging_liveness_checks, 1));
+	return true;
+}
+
+void sinsp_thread_manager::purge_inactive_threads(uint32_t max_threads, uint32_t max_liveness_checks)
+{
+	if(m_purge_tids.empty())
+	{
+		return;
+	}
+
+	uint64_t start_ns = sinsp_utils::get_current_time_ns();
+	uint64_t lastevent_ts = m_inspector->get_lastevent_ts();
+	for(; max_threads > 0 && m_purge_pos < m_purge_tids.size(); max_threads--)
+	{
+		int64_t tid = m_purge_tids[m_purge_pos];
+
+		/* The thread could have been removed since the scan started */
+		sinsp_threadinfo* tinfo = m_threadtable.get(tid);
+		if(tinfo != nullptr)
+		{
+			if(!m_purge_removing)
+			{
+				/* Clean expired threads in the group and children */
+				reset_thread_dependencies(*tinfo);
+			}
+			/* We remove:
+			 * 1. Invalid threads.
+			 * 2. Threads that we are not using and that are no more alive in /proc.
+			 */
+			else if(tinfo->is_invalid())
+			{
+				remove_thread(tid);
+			}
+			else if(lastevent_ts > tinfo->m_lastaccess_ts + m_inspector->m_thread_timeout_ns)
+			{
+				/* The liveness checks have their own budget, since they can
+				 * read /proc: once it's spent, this thread is the first one
+				 * checked by the next batch.
+				 */
+				if(max_liveness_checks == 0)
+				{
+					break;
+				}
+				max_liveness_checks--;
+				if(!scap_is_thread_alive(m_inspector->get_scap_platform(), tinfo->m_pid, tinfo->m_tid, tinfo->m_comm.c_str()))
+				{
+					remove_thread(tid);
+				}
+			}
+		}
+		m_purge_pos++;
+
+		if(m_purge_pos == m_purge_tids.size() && m_purge_removing)
 		{
-			tinfo.m_tginfo->clean_expired_threads();
+			m_purge_pos = 0;
+			m_purge_removing = false;
 		}
-		clear_thread_pointers(tinfo);
-		return true;
-	});
+	}
+
+	if(m_purge_pos == m_purge_tids.size())
+	{
+		m_purge_tids.clear();
+		m_purge_pos = 0;
+	}
+
+	if(m_inspector->get_sinsp_stats_v2())
+	{
+		m_inspector->get_sinsp_stats_v2()->m_threads_purging_time_ns += sinsp_utils::get_current_time_ns() - start_ns;
+	}
 }
 
 void sinsp_thread_manager::create_thread_dependencies_after_proc_scan()
@@ -2026,99 +2475,120 @@ threadinfo_map_t::ptr_t sinsp_thread_manager::get_thread_ref(int64_t tid, bool q
 {
     auto sinsp_proc = find_thread(tid, lookup_only);
 
-    if(!sinsp_proc && query_os_if_not_found &&
-       (m_threadtable.size() < m_max_thread_table_size || tid == m_inspector->m_self_pid))
+    if(!sinsp_proc && query_os_if_not_found && add_thread_from_os(tid, main_thread))
     {
-        // Certain code paths can lead to this point from scap_open() (incomplete example:
-        // scap_proc_scan_proc_dir() -> resolve_container() -> get_env()). Adding a
-        // defensive check here to protect both, callers of get_env and get_thread.
-        if (!m_inspector->get_scap_handle())
-        {
-            libsinsp_logger()->format(sinsp_logger::SEV_INFO, "%s: Unable to complete for tid=%"
-                            PRIu64 ": sinsp::scap_t* is uninitialized", __func__, tid);
-            return NULL;
-        }
+        sinsp_proc = find_thread(tid, lookup_only);
+    }
 
-        scap_threadinfo scap_proc {};
-        bool have_scap_proc = false;
+    return sinsp_proc;
+}
 
-        // leaving scap_proc uninitialized could lead to undefined behaviour.
-        // to be safe we should initialized to zero.
-        memset(&scap_proc, 0, sizeof(scap_threadinfo));
+sinsp_threadinfo* sinsp_thread_manager::get_thread_ptr(int64_t tid, bool query_os_if_not_found, bool lookup_only, bool main_thread)
+{
+	auto sinsp_proc = find_thread_ptr(tid, lookup_only);
 
-        scap_proc.tid = -1;
-        scap_proc.pid = -1;
-        scap_proc.ptid = -1;
+	if(!sinsp_proc && query_os_if_not_found && add_thread_from_os(tid, main_thread))
+	{
+		sinsp_proc = find_thread_ptr(tid, lookup_only);
+	}
 
-		// unfortunately, sinsp owns the threade factory
-        auto newti = m_inspector->build_threadinfo();
+	return sinsp_proc;
+}
 
-        m_n_proc_lookups++;
+bool sinsp_thread_manager::add_thread_from_os(int64_t tid, bool main_thread)
+{
+    if(m_threadtable.size() >= m_max_thread_table_size && tid != m_inspector->m_self_pid)
+    {
+        return false;
+    }
 
-        if(main_thread)
-        {
-            m_n_main_thread_lookups++;
-        }
+    // Certain code paths can lead to this point from scap_open() (incomplete example:
+    // scap_proc_scan_proc_dir() -> resolve_container() -> get_env()). Adding a
+    // defensive check here to protect both, callers of get_env and get_thread.
+    if (!m_inspector->get_scap_handle())
+    {
+        libsinsp_logger()->format(sinsp_logger::SEV_INFO, "%s: Unable to complete for tid=%"
+                        PRIu64 ": sinsp::scap_t* is uninitialized", __func__, tid);
+        return false;
+    }
 
-        if(m_n_proc_lookups == m_max_n_proc_lookups)
-        {
-            libsinsp_logger()->format(sinsp_logger::SEV_INFO, "Reached max process lookup number, duration=%" PRIu64 "ms",
-                m_n_proc_lookups_duration_ns / 1000000);
-        }
+    scap_threadinfo scap_proc {};
+    bool have_scap_proc = false;
 
-        if(m_max_n_proc_lookups < 0 ||
-           m_n_proc_lookups <= m_max_n_proc_lookups)
-        {
-            bool scan_sockets = false;
+    // leaving scap_proc uninitialized could lead to undefined behaviour.
+    // to be safe we should initialized to zero.
+    memset(&scap_proc, 0, sizeof(scap_threadinfo));
 
-            if(m_max_n_proc_socket_lookups < 0 ||
-               m_n_proc_lookups <= m_max_n_proc_socket_lookups)
-            {
-                scan_sockets = true;
-                if(m_n_proc_lookups == m_max_n_proc_socket_lookups)
-                {
-                    libsinsp_logger()->format(sinsp_logger::SEV_INFO, "Reached max socket lookup number, tid=%" PRIu64 ", duration=%" PRIu64 "ms",
-                        tid, m_n_proc_lookups_duration_ns / 1000000);
-                }
-            }
+    scap_proc.tid = -1;
+    scap_proc.pid = -1;
+    scap_proc.ptid = -1;
+
+	// unfortunately, sinsp owns the threade factory
+    auto newti = m_inspector->build_threadinfo();
+
+    m_n_proc_lookups++;
+
+    if(main_thread)
+    {
+        m_n_main_thread_lookups++;
+    }
+
+    if(m_n_proc_lookups == m_max_n_proc_lookups)
+    {
+        libsinsp_logger()->format(sinsp_logger::SEV_INFO, "Reached max process lookup number, duration=%" PRIu64 "ms",
+            m_n_proc_lookups_duration_ns / 1000000);
+    }
+
+    if(m_max_n_proc_lookups < 0 ||
+       m_n_proc_lookups <= m_max_n_proc_lookups)
+    {
+        bool scan_sockets = false;
 
-            uint64_t ts = sinsp_utils::get_current_time_ns();
-            if(scap_proc_get(m_inspector->get_scap_platform(), tid, &scap_proc, scan_sockets) == SCAP_SUCCESS)
+        if(m_max_n_proc_socket_lookups < 0 ||
+           m_n_proc_lookups <= m_max_n_proc_socket_lookups)
+        {
+            scan_sockets = true;
+            if(m_n_proc_lookups == m_max_n_proc_socket_lookups)
             {
-                have_scap_proc = true;
+                libsinsp_logger()->format(sinsp_logger::SEV_INFO, "Reached max socket lookup number, tid=%" PRIu64 ", duration=%" PRIu64 "ms",
+                    tid, m_n_proc_lookups_duration_ns / 1000000);
             }
-            m_n_proc_lookups_duration_ns += sinsp_utils::get_current_time_ns() - ts;
         }
 
-        if(have_scap_proc)
-        {
-            newti->init(&scap_proc);
-        }
-        else
+        uint64_t ts = sinsp_utils::get_current_time_ns();
+        if(scap_proc_get(m_inspector->get_scap_platform(), tid, &scap_proc, scan_sockets) == SCAP_SUCCESS)
         {
-            //
-            // Add a fake entry to avoid a continuous lookup
-            //
-            newti->m_tid = tid;
-            newti->m_pid = -1;
-            newti->m_ptid = -1;
-            newti->m_reaper_tid = -1;
-            newti->m_not_expired_children = 0;
-            newti->m_comm = "<NA>";
-            newti->m_exe = "<NA>";
-            newti->m_user.set_uid(0xffffffff);
-            newti->m_group.set_gid(0xffffffff);
-            newti->m_loginuser.set_uid(0xffffffff);
+            have_scap_proc = true;
         }
+        m_n_proc_lookups_duration_ns += sinsp_utils::get_current_time_ns() - ts;
+    }
 
+    if(have_scap_proc)
+    {
+        newti->init(&scap_proc);
+    }
+    else
+    {
         //
-        // Done. Add the new thread to the list.
+        // Add a fake entry to avoid a continuous lookup
         //
-        add_thread(std::move(newti), false);
-        sinsp_proc = find_thread(tid, lookup_only);
+        newti->m_tid = tid;
+        newti->m_pid = -1;
+        newti->m_ptid = -1;
+        newti->m_reaper_tid = -1;
+        newti->m_not_expired_children = 0;
+        newti->m_comm = "<NA>";
+        newti->m_exe = "<NA>";
+        newti->m_user.set_uid(0xffffffff);
+        newti->m_group.set_gid(0xffffffff);
+        newti->m_loginuser.set_uid(0xffffffff);
     }
 
-    return sinsp_proc;
+    //
+    // Done. Add the new thread to the list.
+    //
+    add_thread(std::move(newti), false);
+    return true;
 }
 
 /* `lookup_only==true` means that we don't fill the `m_last_tinfo` field */
@@ -2160,6 +2630,7 @@ threadinfo_map_t::ptr_t sinsp_thread_manager::find_thread(int64_t tid, bool look
 			m_last_tinfo.reset();
 			m_last_tid = tid;
 			m_last_tinfo = thr;
+			m_last_tinfo_ptr = thr.get();
 			thr->m_lastaccess_ts = m_inspector->get_lastevent_ts();
 		}
 		return thr;
@@ -2174,6 +2645,52 @@ threadinfo_map_t::ptr_t sinsp_thread_manager::find_thread(int64_t tid, bool look
 	}
 }
 
+sinsp_threadinfo* sinsp_thread_manager::find_thread_ptr(int64_t tid, bool lookup_only)
+{
+	//
+	// Try looking up in our simple cache, checking that the cached thread
+	// is still alive doesn't need to lock the weak pointer
+	//
+	if(tid == m_last_tid && !m_last_tinfo.expired())
+	{
+		if (m_inspector != nullptr && m_inspector->get_sinsp_stats_v2())
+		{
+			m_inspector->get_sinsp_stats_v2()->m_n_cached_thread_lookups++;
+		}
+		m_last_tinfo_ptr->m_lastaccess_ts = m_inspector->get_lastevent_ts();
+		return m_last_tinfo_ptr;
+	}
+
+	//
+	// Caching failed, do a real lookup
+	//
+	auto thr = m_threadtable.find(tid);
+
+	if(thr)
+	{
+		if (m_inspector != nullptr && m_inspector->get_sinsp_stats_v2())
+		{
+			m_inspector->get_sinsp_stats_v2()->m_n_noncached_thread_lookups++;
+		}
+		if(!lookup_only)
+		{
+			m_last_tid = tid;
+			m_last_tinfo = *thr;
+			m_last_tinfo_ptr = thr->get();
+			(*thr)->m_lastaccess_ts = m_inspector->get_lastevent_ts();
+		}
+		return thr->get();
+	}
+	else
+	{
+		if (m_inspector != nullptr && m_inspector->get_sinsp_stats_v2())
+		{
+			m_inspector->get_sinsp_stats_v2()->m_n_failed_thread_lookups++;
+		}
+		return nullptr;
+	}
+}
+
 void sinsp_thread_manager::set_max_thread_table_size(uint32_t value)
 {
     m_max_thread_table_size = value;
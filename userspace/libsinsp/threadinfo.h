@@ -33,6 +33,9 @@ struct iovec {
 #include <memory>
 #include <set>
 #include <libsinsp/fdinfo.h>
+#include <libsinsp/flat_int_map.h>
+#include <libsinsp/intern_pool.h>
+#include <libsinsp/object_pool.h>
 #include <libsinsp/state/table.h>
 #include <libsinsp/thread_group_info.h>
 
@@ -140,33 +143,47 @@ public:
 		std::shared_ptr<libsinsp::state::dynamic_struct::field_infos> dyn_fields = nullptr);
 	virtual ~sinsp_threadinfo();
 
+	/*!
+	  \brief Thread infos are allocated with the process-global allocator set
+	  by sinsp_thread_manager::set_threadinfo_allocator(), this includes the
+	  subclasses built by external event processors.
+	*/
+	static void* operator new(size_t size);
+	static void operator delete(void* p, size_t size);
+
 	libsinsp::state::static_struct::field_infos static_fields() const override;
 
 	/*!
 	  \brief Return the name of the process containing this thread, e.g. "top".
 	*/
-	std::string get_comm() const;
+	const std::string& get_comm() const;
 
 	/*!
 	  \brief Return the name of the process containing this thread from argv[0], e.g. "/bin/top".
 	*/
-	std::string get_exe() const;
+	const std::string& get_exe() const;
 
 	/*!
 	  \brief Return the full executable path of the process containing this thread, e.g. "/bin/top".
 	*/
-	std::string get_exepath() const;
+	const std::string& get_exepath() const;
 
 	/*!
 	  \brief Return the working directory of the process containing this thread.
 	*/
-	std::string get_cwd();
+	const std::string& get_cwd();
 
 	inline void set_cwd(const std::string& v)
 	{
 		m_cwd = v;
+		invalidate_snapshot();
 	}
 
+	/*!
+	  \brief Return the command line arguments of this thread.
+	*/
+	const std::vector<std::string>& get_args() const;
+
 	/*!
 	  \brief Return the values of all environment variables for the process
 	  containing this thread.
@@ -223,6 +240,7 @@ public:
 	inline void set_dead()
 	{
 		m_flags |= PPM_CL_CLOSED;
+		invalidate_snapshot();
 	}
 
 	/*!
@@ -290,6 +308,7 @@ public:
 	inline void set_parent_loop_detected(bool v)
 	{
 		m_parent_loop_detected = v;
+		invalidate_snapshot();
 	}
 
 	/*!
@@ -302,6 +321,17 @@ public:
 			return this;
 		}
 
+		// A snapshot has a copy of the main thread instead of its thread group
+		if(m_snapshot != nullptr)
+		{
+			auto possible_main = lookup_thread(m_pid);
+			if(possible_main == nullptr || !possible_main->is_main_thread())
+			{
+				return nullptr;
+			}
+			return possible_main;
+		}
+
 		// This is possible when we have invalid threads
 		if(m_tginfo == nullptr)
 		{
@@ -327,6 +357,43 @@ public:
 	*/
 	sinsp_threadinfo* get_parent_thread();
 
+	/*!
+	  \brief Return a copy of the state of this thread that is not updated by
+	  the following events, so that it can be read from another thread
+	  without touching the inspector.
+
+	  The threads that the fields can reach from this one are copied
+	  together with it: its main thread, the ancestors of both, and the
+	  session and process group leaders. The copies find each other with
+	  lookup_thread(), get_main_thread() and get_parent_thread(), other
+	  threads are not found.
+	  The fd tables, the children, the dynamic fields and the values that
+	  change with every event (e.g. the latency, see sinsp_evt::snapshot())
+	  are not copied, and the thread group only keeps its counters.
+
+	  The copy is immutable and shared: it is kept by this thread and
+	  returned again until one of the copied threads changes, see
+	  invalidate_snapshot(), or a thread is added or removed, see
+	  sinsp_thread_manager::invalidate_snapshots().
+	*/
+	std::shared_ptr<sinsp_threadinfo> snapshot();
+
+	/*!
+	  \brief Make the snapshots that copy this thread build again, see
+	  snapshot(). Called after writing any of the fields they copy.
+	*/
+	inline void invalidate_snapshot()
+	{
+		m_snapshot_gen++;
+	}
+
+	/*!
+	  \brief Look up another thread of the inspector, without updating the
+	  thread table cache. For a snapshot, only the threads copied together
+	  with it are found, see snapshot().
+	*/
+	sinsp_threadinfo* lookup_thread(int64_t tid);
+
 	/*!
 	  \brief Retrieve information about one of this thread/process FDs.
 
@@ -382,9 +449,11 @@ public:
 	*/
 	uint64_t get_fd_usage_pct();
 	double get_fd_usage_pct_d();
+	double get_fd_usage_pct_d(uint64_t fd_opencount);
 
 	/*!
-	  \brief Return the number of open FDs for this thread.
+	  \brief Return the number of open FDs for this thread. The fd tables
+	  of the snapshots are empty, see sinsp_evt::get_fd_opencount().
 	*/
 	uint64_t get_fd_opencount() const;
 
@@ -481,7 +550,7 @@ public:
 	void set_loginuser(uint32_t loginuid);
 
 	using cgroups_t = std::vector<std::pair<std::string, std::string>>;
-	cgroups_t& cgroups() const;
+	const cgroups_t& cgroups() const;
 
 	//
 	// Core state
@@ -497,9 +566,6 @@ public:
 	bool m_exe_writable;
 	bool m_exe_upper_layer; ///< True if the executable file belongs to upper layer in overlayfs
 	bool m_exe_from_memfd;	///< True if the executable is stored in fileless memory referenced by memfd
-	std::vector<std::string> m_args; ///< Command line arguments (e.g. "-d1")
-	std::vector<std::string> m_env; ///< Environment variables
-	std::unique_ptr<cgroups_t> m_cgroups; ///< subsystem-cgroup pairs
 	std::string m_container_id; ///< heuristic-based container id
 	uint32_t m_flags; ///< The thread flags. See the PPM_CL_* declarations in ppm_events_public.h.
 	int64_t m_fdlimit;  ///< The maximum number of FDs this thread can open
@@ -640,6 +706,17 @@ public:
 	void set_args(const char* args, size_t len);
 	void set_args(std::vector<std::string> args);
 	void set_env(const char* env, size_t len);
+	void set_env(std::vector<std::string> env);
+
+	/*!
+	  \brief Share the environment of another thread, e.g. of the parent
+	  of a new process.
+	*/
+	inline void copy_env(const sinsp_threadinfo& other)
+	{
+		m_env = other.m_env;
+		invalidate_snapshot();
+	}
 	void set_cgroups(const char* cgroups, size_t len);
 	void set_cgroups(std::vector<std::string> cgroups);
 	bool is_lastevent_data_valid() const;
@@ -732,12 +809,40 @@ private:
 	//
 	sinsp_fdtable m_fdtable; // The fd table of this thread
 	std::string m_cwd; // current working directory
+	// The lists below are interned in the process-global pools, threads with
+	// equal ones share the same object, see get_args(), get_env() and cgroups()
+	std::shared_ptr<const std::vector<std::string>> m_args; // Command line arguments (e.g. "-d1")
+	std::shared_ptr<const std::vector<std::string>> m_env; // Environment variables
+	std::shared_ptr<const cgroups_t> m_cgroups; // subsystem-cgroup pairs
 	uint8_t* m_lastevent_data; // Used by some event parsers to store the last enter event
 
 	uint16_t m_lastevent_type;
 	uint16_t m_lastevent_cpuid;
 	sinsp_evt::category m_lastevent_category;
 	bool m_parent_loop_detected;
+
+	//
+	// Set on the copies made by snapshot(): the threads copied together,
+	// owned by the copy of the snapshotted thread
+	//
+	struct snapshot_threads;
+	std::shared_ptr<snapshot_threads> m_snapshot_owner;
+	snapshot_threads* m_snapshot;
+
+	// Bumped by invalidate_snapshot()
+	uint64_t m_snapshot_gen;
+
+	// The last snapshot of this thread, valid while the snapshot
+	// generation of the thread manager and the ones of the copied threads
+	// don't change. The copied threads can't be freed while the former
+	// doesn't change.
+	std::shared_ptr<sinsp_threadinfo> m_snapshot_cache;
+	uint64_t m_snapshot_cache_gen;
+	std::vector<std::pair<const sinsp_threadinfo*, uint64_t>> m_snapshot_cache_sources;
+
+	std::shared_ptr<sinsp_threadinfo> build_snapshot(
+		std::vector<std::pair<const sinsp_threadinfo*, uint64_t>>* sources = nullptr) const;
+	std::shared_ptr<sinsp_threadinfo> copy_state() const;
 };
 
 /*@}*/
@@ -752,27 +857,37 @@ public:
 
 	inline void put(ptr_t tinfo)
 	{
-		m_threads[tinfo->m_tid] = tinfo;
+		int64_t tid = tinfo->m_tid;
+		m_threads.insert(tid, std::move(tinfo));
 	}
 
 	inline sinsp_threadinfo* get(uint64_t tid)
 	{
-		auto it = m_threads.find(tid);
-		if (it == m_threads.end())
+		auto tinfo = m_threads.find(tid);
+		if (tinfo == nullptr)
 		{
 			return  nullptr;
 		}
-		return it->second.get();
+		return tinfo->get();
 	}
 
 	inline ptr_t get_ref(uint64_t tid)
 	{
-		auto it = m_threads.find(tid);
-		if (it == m_threads.end())
+		auto tinfo = m_threads.find(tid);
+		if (tinfo == nullptr)
 		{
 			return  nullptr;
 		}
-		return it->second;
+		return *tinfo;
+	}
+
+	/*!
+	  \brief Returns the stored shared pointer without copying it, or nullptr.
+	  The pointer is invalidated by put() and erase().
+	*/
+	inline const ptr_t* find(uint64_t tid)
+	{
+		return m_threads.find(tid);
 	}
 
 	inline void erase(uint64_t tid)
@@ -787,38 +902,26 @@ public:
 
 	bool const_loop_shared_pointer(const_shared_ptr_visitor_t callback)
 	{
-		for (auto& it : m_threads)
+		return m_threads.for_each([&callback](int64_t, const ptr_t& tinfo)
 		{
-			if (!callback(it.second))
-			{
-				return false;
-			}
-		}
-		return true;
+			return callback(tinfo);
+		});
 	}
 
 	bool const_loop(const_visitor_t callback) const
 	{
-		for (const auto& it : m_threads)
+		return m_threads.for_each([&callback](int64_t, const ptr_t& tinfo)
 		{
-			if (!callback(*it.second))
-			{
-				return false;
-			}
-		}
-		return true;
+			return callback(*tinfo);
+		});
 	}
 
 	bool loop(visitor_t callback)
 	{
-		for (auto& it : m_threads)
+		return m_threads.for_each([&callback](int64_t, ptr_t& tinfo)
 		{
-			if (!callback(*it.second))
-			{
-				return false;
-			}
-		}
-		return true;
+			return callback(*tinfo);
+		});
 	}
 
 	inline size_t size() const
@@ -827,7 +930,7 @@ public:
 	}
 
 protected:
-	std::unordered_map<int64_t, ptr_t> m_threads;
+	flat_int_map<int64_t, ptr_t> m_threads;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -843,12 +946,38 @@ public:
 
 	std::unique_ptr<sinsp_fdinfo> new_fdinfo() const;
 
+	/*!
+	  \brief Set the allocator of the sinsp_threadinfo objects, the default
+	  one is the global operator new. The allocator is process-global: it is
+	  used by all the inspectors, since it is called by the class operator
+	  new, and applies to the objects allocated after the call, while the
+	  existing ones are freed by the allocator that created them.
+	*/
+	static void set_threadinfo_allocator(std::shared_ptr<libsinsp::object_allocator> allocator);
+
+	/*!
+	  \brief Return the stats of the sinsp_threadinfo allocators, these
+	  include the objects of all the inspectors of the process.
+	*/
+	static libsinsp::object_allocator_stats get_threadinfo_allocator_stats();
+
+	/*!
+	  \brief Return the stats of the process-global pools interning the
+	  arguments, environments and cgroups of the threads, these are shared
+	  by all the inspectors of the process.
+	*/
+	static libsinsp::intern_pool_stats get_threadinfo_interning_stats();
+
 	threadinfo_map_t::ptr_t add_thread(std::unique_ptr<sinsp_threadinfo> threadinfo, bool from_scap_proctable);
 	sinsp_threadinfo* find_new_reaper(sinsp_threadinfo*);
 	void remove_thread(int64_t tid);
-	// Returns true if the table is actually scanned
-	// NOTE: this is implemented in sinsp.cpp so we can inline it from there
-	inline bool remove_inactive_threads();
+	// Starts a scan of the table when the purging interval has elapsed and
+	// advances the one in progress by a batch of threads. Returns true if
+	// the table is being scanned.
+	bool remove_inactive_threads();
+	// Advances the scan in progress, if any, by at most max_threads threads,
+	// checking the liveness of at most max_liveness_checks of them
+	void purge_inactive_threads(uint32_t max_threads, uint32_t max_liveness_checks = UINT32_MAX);
 	void remove_main_thread_fdtable(sinsp_threadinfo* main_thread);
 	void fix_sockets_coming_from_proc();
 	void reset_child_dependencies();
@@ -883,6 +1012,15 @@ public:
     //
     threadinfo_map_t::ptr_t find_thread(int64_t tid, bool lookup_only);
 
+	/*!
+	  \brief Same as get_thread_ref() and find_thread(), but return a raw
+	   pointer and never touch the reference count of the thread. Meant for
+	   the per-event lookups, the pointer must not be used after the thread
+	   is removed from the table.
+	*/
+	sinsp_threadinfo* get_thread_ptr(int64_t tid, bool query_os_if_not_found = false, bool lookup_only = true, bool main_thread=false);
+	sinsp_threadinfo* find_thread_ptr(int64_t tid, bool lookup_only);
+
 
 	void dump_threads_to_file(scap_dumper_t* dumper);
 
@@ -917,6 +1055,7 @@ public:
 
 	void clear_entries() override
 	{
+		invalidate_snapshots();
 		m_threadtable.clear();
 	}
 
@@ -1004,8 +1143,26 @@ public:
 		return m_max_thread_table_size;
 	}
 
+	/*!
+	  \brief Make all the threads build their next snapshot again, see
+	  sinsp_threadinfo::snapshot(). Called when a thread is added or
+	  removed, the changes to a single thread use
+	  sinsp_threadinfo::invalidate_snapshot().
+	*/
+	inline void invalidate_snapshots()
+	{
+		m_snapshot_gen++;
+	}
+
+	inline uint64_t get_snapshot_gen() const
+	{
+		return m_snapshot_gen;
+	}
+
 private:
 	inline void clear_thread_pointers(sinsp_threadinfo& threadinfo);
+	inline void reset_thread_dependencies(sinsp_threadinfo& tinfo);
+	bool add_thread_from_os(int64_t tid, bool main_thread);
 	void free_dump_fdinfos(std::vector<scap_fdinfo*>* fdinfos_to_free);
 
 	sinsp* m_inspector;
@@ -1014,7 +1171,16 @@ private:
 	threadinfo_map_t m_threadtable;
 	int64_t m_last_tid;
 	std::weak_ptr<sinsp_threadinfo> m_last_tinfo;
+	// same object as m_last_tinfo, only valid while m_last_tinfo is not expired
+	sinsp_threadinfo* m_last_tinfo_ptr = nullptr;
 	uint64_t m_last_flush_time_ns;
+	// The tids to check in the scan of the table in progress. The scan first
+	// removes the inactive threads and then, going through the same tids
+	// again, cleans the dependencies of the remaining ones.
+	std::vector<int64_t> m_purge_tids;
+	size_t m_purge_pos = 0;
+	bool m_purge_removing = false;
+	uint64_t m_snapshot_gen = 0;
 	// Increased legacy default of 131072 in January 2024 to prevent
 	// possible drops due to full threadtable on more modern servers
 	const uint32_t m_thread_table_default_size = 262144;
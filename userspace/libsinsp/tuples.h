@@ -74,6 +74,8 @@ private:
 public:
 	ipv6net(const std::string &str);
 	bool in_cidr(const ipv6addr &other) const;
+	const ipv6addr& get_addr() const { return m_addr; }
+	uint32_t get_prefix_len() const { return m_mask_len_bytes * 8 + 8 - m_mask_tail_bits; }
 };
 
 /*!